@@ -0,0 +1,212 @@
+// Allocation latency and message count of the task auction.
+//
+// The rovers start spread around the nest, some carrying a cube, with as
+// many cube clusters as there are rovers and half as many search sectors,
+// so the bundles have room to take over the tasks of a failed rover.
+// Bids go over the swarm bus and each packet reaches each other rover with
+// the given probability. The bench measures how long it takes until no
+// bundle changes any more and no task is held by two rovers, then removes
+// the rover holding the most valuable bundle and measures how long it
+// takes until the bundles settle again, which includes the time its bids
+// take to expire.
+//
+// usage: allocation_bench [delivery]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SwarmBus.h"
+#include "TaskAllocator.h"
+
+using namespace std;
+
+const long int tickTime = 100; //milliseconds
+const long int settleTime = 5000; //milliseconds without a bundle change
+const long int phaseTime = 30000; //milliseconds
+const float roundTime = 1200; //seconds left in the round
+
+// Tasks are identified by their meter cell, keep them in the cell centers.
+Point CellCenter(float x, float y)
+{
+  Point point = {(float)floor(x) + 0.5f, (float)floor(y) + 0.5f, 0};
+  return point;
+}
+
+struct Rover {
+  uint32_t node;
+  bool up;
+  SwarmBus bus;
+  TaskAllocator allocator;
+  long int lastChange;
+};
+
+struct Phase {
+  long int latency = -1; //milliseconds until the bundles settled
+  int packets = 0;
+  int reports = 0;
+  int conflicts = 0; //tasks held by two rovers once settled
+  int assigned = 0;
+};
+
+// Runs the rovers from start until the bundles settle or the phase ends.
+Phase Run(vector<Rover>& rovers, long int start, float delivery, mt19937& generator)
+{
+  uniform_real_distribution<float> uniform(0.0, 1.0);
+  Phase phase;
+  vector<SwarmState> states;
+
+  long int time;
+  for (time = start; time < start + phaseTime; time += tickTime)
+  {
+    for (Rover& rover : rovers)
+    {
+      if (!rover.up)
+      {
+        continue;
+      }
+
+      if (rover.allocator.Update(time))
+      {
+        rover.lastChange = time;
+      }
+
+      vector<AllocationBid> bids;
+      if (rover.allocator.TakeBids(time, bids))
+      {
+        for (const AllocationBid& bid : bids)
+        {
+          rover.bus.ReportBid(bid.location, bid.bid);
+        }
+      }
+
+      SwarmPacket packet;
+      if (!rover.bus.Flush(time, packet))
+      {
+        continue;
+      }
+      phase.packets++;
+      phase.reports += packet.reports.size();
+
+      for (Rover& receiver : rovers)
+      {
+        if (!receiver.up || &receiver == &rover || uniform(generator) >= delivery)
+        {
+          continue;
+        }
+
+        states.clear();
+        receiver.bus.Receive(packet, states);
+        for (const SwarmState& state : states)
+        {
+          AllocationBid bid = {state.location, state.value};
+          receiver.allocator.Receive(state.sender, bid, time);
+        }
+      }
+    }
+
+    bool settled = true;
+    for (const Rover& rover : rovers)
+    {
+      settled = settled && (!rover.up || time - rover.lastChange >= settleTime);
+    }
+    if (settled && time - start >= settleTime)
+    {
+      break;
+    }
+  }
+
+  long int last = start;
+  vector<uint32_t> held;
+  for (const Rover& rover : rovers)
+  {
+    if (!rover.up)
+    {
+      continue;
+    }
+    last = max(last, rover.lastChange);
+    for (const AllocationTask& task : rover.allocator.GetBundle())
+    {
+      uint32_t key = TaskAllocator::TaskKey(task.location);
+      phase.conflicts += count(held.begin(), held.end(), key);
+      held.push_back(key);
+    }
+  }
+  phase.assigned = held.size();
+  phase.latency = last - start;
+  return phase;
+}
+
+int main(int argc, char** argv)
+{
+  float delivery = argc > 1 ? atof(argv[1]) : 0.9;
+  int swarmSizes[] = {3, 6, 12, 24};
+
+  printf("%.0f%% of packets delivered\n", delivery * 100);
+  printf("rovers  tasks  assigned  latency s  packets  reports  conflicts | failed rover: latency s  packets  reports  conflicts\n");
+
+  for (int count : swarmSizes)
+  {
+    mt19937 generator(count);
+    uniform_real_distribution<float> uniform(0.0, 1.0);
+    uniform_real_distribution<float> position(-8.0, 8.0);
+
+    vector<AllocationTask> tasks;
+    for (int i = 0; i < count; i++)
+    {
+      AllocationTask cluster;
+      cluster.location = CellCenter(position(generator) * 1.25, position(generator) * 1.25);
+      cluster.value = 0.4 + 0.15 * (1 + generator() % 4);
+      cluster.cluster = true;
+      tasks.push_back(cluster);
+
+      if (i % 2 == 1)
+      {
+        continue;
+      }
+      AllocationTask sector;
+      float angle = 2 * M_PI * (i + 0.5) / count;
+      sector.location = CellCenter(5 * cos(angle), 5 * sin(angle));
+      sector.value = 0.3;
+      sector.cluster = false;
+      tasks.push_back(sector);
+    }
+
+    vector<Rover> rovers;
+    for (int i = 0; i < count; i++)
+    {
+      uint32_t node = SwarmBus::NameHash("rover" + to_string(i));
+      Rover rover = {node, true, SwarmBus(node), TaskAllocator(), 0};
+      Point location = {position(generator), position(generator), 0};
+      rover.allocator.SetNode(node);
+      rover.allocator.SetTasks(tasks);
+      rover.allocator.SetState(location, uniform(generator) < 0.3, roundTime);
+      rovers.push_back(rover);
+    }
+
+    Phase allocation = Run(rovers, 0, delivery, generator);
+
+    //the rover with the most valuable bundle stops, its bids expire
+    int failed = 0;
+    for (int i = 0; i < count; i++)
+    {
+      if (rovers[i].allocator.GetBundle().size() > rovers[failed].allocator.GetBundle().size())
+      {
+        failed = i;
+      }
+    }
+    rovers[failed].up = false;
+    long int start = allocation.latency + settleTime + tickTime;
+    Phase recovery = Run(rovers, start, delivery, generator);
+
+    printf("%6d  %5d  %8d  %9.1f  %7d  %7d  %9d | %23.1f  %7d  %7d  %9d\n", count, (int)tasks.size(),
+           allocation.assigned, allocation.latency / 1e3, allocation.packets, allocation.reports, allocation.conflicts,
+           recovery.latency / 1e3, recovery.packets, recovery.reports, recovery.conflicts);
+  }
+
+  return 0;
+}
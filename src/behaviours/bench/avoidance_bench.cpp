@@ -0,0 +1,266 @@
+// Rover to rover collisions with and without reciprocal avoidance.
+//
+// The rovers are skid steers that drive at the search velocity towards a
+// goal, turning at a limited rate, and beacon their pose and speed over the
+// swarm bus with each packet reaching each other rover with the given
+// probability. With avoidance every rover passes the velocity towards its
+// goal through ReciprocalAvoidance and drives the result the way the drive
+// controller does. Two scenarios: the rovers start evenly spaced on a
+// circle and cross to the opposite side, the hardest case since they all
+// meet in the middle, and the rovers drive between random waypoints in the
+// arena for ten minutes. The bench counts contacts, when two rovers come
+// closer than a rover length, the closest two rovers got, how long the
+// crossing took and the time spent in Avoid() per rover per tick.
+//
+// usage: avoidance_bench [delivery]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ReciprocalAvoidance.h"
+#include "SwarmBus.h"
+
+using namespace std;
+
+const long int tickTime = 100; //milliseconds
+const float maxSpeed = 0.35; //meters per second, the search velocity
+const float maxAngular = 1.2; //radians per second
+const float turnGain = 2.0; //angular velocity per radian of heading error
+const float contactDistance = 0.35; //meters between centers, about a rover length
+const float goalTolerance = 0.3; //meters
+const float arenaSize = 15; //meters
+const long int wanderTime = 600000; //milliseconds
+
+struct Rover {
+  uint32_t node;
+  Point pose;
+  float speed;
+  Point goal;
+  long int arrived;
+  SwarmBus bus;
+  ReciprocalAvoidance avoidance;
+};
+
+struct Totals {
+  int contacts = 0;
+  float closest = 1e9;
+  float crossing = 0; //seconds until the last rover arrived
+  int goals = 0;
+  double avoidTime = 0; //microseconds per call
+};
+
+float Shortest(float from, float to)
+{
+  float difference = to - from;
+  return atan2(sin(difference), cos(difference));
+}
+
+// Drives every rover one tick, returns false once all of them arrived.
+bool Step(vector<Rover>& rovers, bool avoid, long int time, mt19937& radio, float delivery, long int& avoidCalls, double& avoidSeconds)
+{
+  uniform_real_distribution<float> uniform(0.0, 1.0);
+  bool moving = false;
+
+  for (Rover& rover : rovers)
+  {
+    rover.avoidance.SetCurrentTime(time);
+
+    float dx = rover.goal.x - rover.pose.x;
+    float dy = rover.goal.y - rover.pose.y;
+    float distance = hypot(dx, dy);
+    float heading = atan2(dy, dx);
+    float velocity = distance < goalTolerance ? 0 : fmin(maxSpeed, distance);
+    if (distance < goalTolerance && rover.arrived < 0)
+    {
+      rover.arrived = time;
+    }
+    moving = moving || rover.arrived < 0;
+
+    if (avoid)
+    {
+      float vx = velocity * cos(heading);
+      float vy = velocity * sin(heading);
+      auto start = chrono::steady_clock::now();
+      bool avoided = rover.avoidance.Avoid(rover.pose, rover.speed, maxSpeed, vx, vy);
+      avoidSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      avoidCalls++;
+      if (avoided)
+      {
+        //same as DriveController::avoidRovers
+        heading = atan2(vy, vx);
+        velocity = hypot(vx, vy) * fmax(0.0f, cos(Shortest(rover.pose.theta, heading)));
+      }
+    }
+    else if (fabs(Shortest(rover.pose.theta, heading)) > M_PI_2)
+    {
+      velocity = 0;
+    }
+
+    float angular = fmax(-maxAngular, fmin(maxAngular, turnGain * Shortest(rover.pose.theta, heading)));
+    float seconds = tickTime / 1e3;
+    rover.pose.theta += angular * seconds;
+    rover.pose.x += velocity * cos(rover.pose.theta) * seconds;
+    rover.pose.y += velocity * sin(rover.pose.theta) * seconds;
+    rover.speed = velocity;
+  }
+
+  //beacons, the nest is at the origin
+  vector<SwarmState> states;
+  for (Rover& rover : rovers)
+  {
+    rover.bus.ReportPose(rover.pose, rover.speed);
+    SwarmPacket packet;
+    if (!rover.bus.Flush(time, packet))
+    {
+      continue;
+    }
+    for (Rover& receiver : rovers)
+    {
+      if (&receiver == &rover || uniform(radio) >= delivery)
+      {
+        continue;
+      }
+      states.clear();
+      receiver.bus.Receive(packet, states);
+      for (const SwarmState& state : states)
+      {
+        if (state.type == SwarmReport::POSE)
+        {
+          receiver.avoidance.SetNeighbour(state.sender, state.location, state.value / 100.0);
+        }
+      }
+    }
+  }
+
+  return moving;
+}
+
+// Counts the pairs that came into contact this tick.
+void CountContacts(const vector<Rover>& rovers, vector<vector<bool>>& touching, Totals& totals)
+{
+  for (int i = 0; i < rovers.size(); i++)
+  {
+    for (int j = i + 1; j < rovers.size(); j++)
+    {
+      float distance = hypot(rovers[i].pose.x - rovers[j].pose.x, rovers[i].pose.y - rovers[j].pose.y);
+      totals.closest = fmin(totals.closest, distance);
+      bool touch = distance < contactDistance;
+      totals.contacts += touch && !touching[i][j];
+      touching[i][j] = touch;
+    }
+  }
+}
+
+vector<Rover> MakeRovers(int count)
+{
+  vector<Rover> rovers;
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t node = SwarmBus::NameHash("rover" + to_string(i));
+    Rover rover = {node, Point(), 0, Point(), -1, SwarmBus(node), ReciprocalAvoidance()};
+    rovers.push_back(rover);
+  }
+  return rovers;
+}
+
+Totals Crossing(int count, bool avoid, float delivery)
+{
+  vector<Rover> rovers = MakeRovers(count);
+  float radius = fmax(3.0, count * 0.8 / M_PI); //keeps the start points apart
+  for (int i = 0; i < count; i++)
+  {
+    float bearing = 2 * M_PI * i / count;
+    rovers[i].pose = {radius * (float)cos(bearing), radius * (float)sin(bearing), bearing + (float)M_PI};
+    rovers[i].goal = {-rovers[i].pose.x, -rovers[i].pose.y, 0};
+  }
+
+  mt19937 radio(count);
+  Totals totals;
+  vector<vector<bool>> touching(count, vector<bool>(count, false));
+  long int avoidCalls = 0;
+  double avoidSeconds = 0;
+
+  long int time = 0;
+  while (Step(rovers, avoid, time, radio, delivery, avoidCalls, avoidSeconds) && time < 300000)
+  {
+    CountContacts(rovers, touching, totals);
+    time += tickTime;
+  }
+
+  totals.crossing = time / 1e3;
+  totals.avoidTime = avoidCalls > 0 ? avoidSeconds * 1e6 / avoidCalls : 0;
+  return totals;
+}
+
+Totals Wander(int count, bool avoid, float delivery)
+{
+  mt19937 generator(count);
+  mt19937 radio(count);
+  uniform_real_distribution<float> position(-arenaSize / 2, arenaSize / 2);
+
+  vector<Rover> rovers = MakeRovers(count);
+  for (Rover& rover : rovers)
+  {
+    rover.pose = {position(generator), position(generator), 0};
+    rover.goal = {position(generator), position(generator), 0};
+  }
+
+  Totals totals;
+  vector<vector<bool>> touching(count, vector<bool>(count, false));
+  long int avoidCalls = 0;
+  double avoidSeconds = 0;
+
+  for (long int time = 0; time < wanderTime; time += tickTime)
+  {
+    for (Rover& rover : rovers)
+    {
+      if (rover.arrived >= 0)
+      {
+        rover.goal = {position(generator), position(generator), 0};
+        rover.arrived = -1;
+        totals.goals++;
+      }
+    }
+    Step(rovers, avoid, time, radio, delivery, avoidCalls, avoidSeconds);
+    CountContacts(rovers, touching, totals);
+  }
+
+  totals.avoidTime = avoidCalls > 0 ? avoidSeconds * 1e6 / avoidCalls : 0;
+  return totals;
+}
+
+int main(int argc, char** argv)
+{
+  float delivery = argc > 1 ? atof(argv[1]) : 0.9;
+  int swarmSizes[] = {3, 6, 12, 24};
+
+  printf("%.0f%% of beacons delivered, contact under %.2f m between centers\n\n", delivery * 100, contactDistance);
+
+  printf("crossing to the opposite side of a circle\n");
+  printf("rovers | none: contacts  closest m  crossing s | avoidance: contacts  closest m  crossing s  us/call\n");
+  for (int count : swarmSizes)
+  {
+    Totals none = Crossing(count, false, delivery);
+    Totals avoided = Crossing(count, true, delivery);
+    printf("%6d | %14d  %9.2f  %10.1f | %19d  %9.2f  %10.1f  %7.2f\n", count,
+           none.contacts, none.closest, none.crossing, avoided.contacts, avoided.closest, avoided.crossing, avoided.avoidTime);
+  }
+
+  printf("\nrandom waypoints in a %.0f m arena for %.0f minutes\n", arenaSize, wanderTime / 60e3);
+  printf("rovers | none: contacts  goals | avoidance: contacts  closest m  goals  us/call\n");
+  for (int count : swarmSizes)
+  {
+    Totals none = Wander(count, false, delivery);
+    Totals avoided = Wander(count, true, delivery);
+    printf("%6d | %14d  %5d | %19d  %9.2f  %5d  %7.2f\n", count,
+           none.contacts, none.goals, avoided.contacts, avoided.closest, avoided.goals, avoided.avoidTime);
+  }
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+// Convergence of the swarm membership and role assignment.
+//
+// The rovers boot within the first five seconds, then every 40 seconds a
+// random rover (every third time the leader) goes silent and comes back 20
+// seconds later as if it had rebooted. Heartbeats reach each other rover
+// with the given probability. After every event the bench measures how
+// long it takes until every live rover has the same assignment holding
+// exactly the live rovers, and how many slots of the assignment changed.
+//
+// usage: membership_bench [seconds] [delivery]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SwarmMembership.h"
+
+using namespace std;
+
+const long int tickTime = 100; //milliseconds
+const long int bootWindow = 5000; //milliseconds
+const long int eventInterval = 40000; //milliseconds
+const long int downTime = 20000; //milliseconds
+
+struct Stats {
+  int events = 0;
+  int unconverged = 0;
+  long int totalTime = 0;
+  long int maxTime = 0;
+  int roleChanges = 0;
+
+  void Add(long int time, int changes)
+  {
+    events++;
+    totalTime += time;
+    maxTime = max(maxTime, time);
+    roleChanges += changes;
+  }
+};
+
+void Print(const char* event, const Stats& stats)
+{
+  if (stats.events == 0)
+  {
+    printf("  %-12s none\n", event);
+    return;
+  }
+  printf("  %-12s %3d  mean %5.1f s  max %5.1f s  %4.1f slots changed  %d unconverged\n", event, stats.events,
+         stats.totalTime / 1e3 / stats.events, stats.maxTime / 1e3, (float)stats.roleChanges / stats.events,
+         stats.unconverged);
+}
+
+int main(int argc, char** argv)
+{
+  float seconds = argc > 1 ? atof(argv[1]) : 1200;
+  float delivery = argc > 2 ? atof(argv[2]) : 0.9;
+  int swarmSizes[] = {3, 6, 12, 24};
+
+  for (int rovers : swarmSizes)
+  {
+    mt19937 generator(rovers);
+    uniform_real_distribution<float> uniform(0.0, 1.0);
+
+    vector<SwarmMembership> members;
+    vector<long int> bootTime(rovers);
+    vector<bool> up(rovers, false);
+    for (int i = 0; i < rovers; i++)
+    {
+      char name[16];
+      sprintf(name, "rover%02d", i);
+      members.push_back(SwarmMembership(name));
+      bootTime[i] = generator() % bootWindow;
+    }
+
+    long int lastBoot = *max_element(bootTime.begin(), bootTime.end());
+
+    Stats startup, leave, leaderLeave, join;
+    Stats* pending = &startup;
+    long int eventTime = 0;
+    vector<string> before; //assignment when the event happened
+    int down = -1;
+    long int downSince = 0;
+    int events = 0;
+
+    long int duration = seconds * 1000;
+    for (long int time = 0; time < duration; time += tickTime)
+    {
+      //a rover that went down comes back as a fresh process
+      if (down >= 0 && time - downSince >= downTime)
+      {
+        if (pending != nullptr)
+        {
+          pending->unconverged++;
+        }
+        before = members[down == 0 ? 1 : 0].GetAssignment();
+        char name[16];
+        sprintf(name, "rover%02d", down);
+        members[down] = SwarmMembership(name);
+        up[down] = true;
+        down = -1;
+        pending = &join;
+        eventTime = time;
+      }
+      else if (down < 0 && time >= bootWindow && time % eventInterval == 0)
+      {
+        if (pending != nullptr)
+        {
+          pending->unconverged++;
+        }
+        int leader = -1;
+        for (int i = 0; i < rovers; i++)
+        {
+          if (up[i] && members[i].IsLeader())
+          {
+            leader = i;
+            break;
+          }
+        }
+        down = (events++ % 3 == 0 && leader >= 0) ? leader : generator() % rovers;
+        pending = (down == leader) ? &leaderLeave : &leave;
+        before = members[down].GetAssignment();
+        up[down] = false;
+        downSince = time;
+        eventTime = time;
+      }
+
+      for (int i = 0; i < rovers; i++)
+      {
+        if (!up[i] && down != i && time >= bootTime[i])
+        {
+          up[i] = true;
+        }
+        if (!up[i])
+        {
+          continue;
+        }
+
+        SwarmHeartbeat heartbeat;
+        if (members[i].Update(time, heartbeat))
+        {
+          for (int j = 0; j < rovers; j++)
+          {
+            if (j != i && up[j] && uniform(generator) < delivery)
+            {
+              members[j].Receive(heartbeat, time);
+            }
+          }
+        }
+      }
+
+      if (pending == nullptr || time < bootWindow)
+      {
+        continue;
+      }
+
+      //converged once every live rover holds the same assignment of exactly the live rovers
+      int live = 0;
+      int first = -1;
+      for (int i = 0; i < rovers; i++)
+      {
+        if (up[i])
+        {
+          live++;
+          first = first < 0 ? i : first;
+        }
+      }
+
+      const vector<string>& assignment = members[first].GetAssignment();
+      bool converged = (int)assignment.size() == live;
+      for (int i = 0; i < rovers && converged; i++)
+      {
+        if (up[i])
+        {
+          converged = members[i].GetAssignment() == assignment && members[i].GetRole() >= 0;
+        }
+      }
+
+      if (converged)
+      {
+        int changes = 0;
+        for (int slot = 0; slot < (int)assignment.size(); slot++)
+        {
+          if (slot >= (int)before.size() || before[slot] != assignment[slot])
+          {
+            changes++;
+          }
+        }
+        pending->Add(time - (pending == &startup ? lastBoot : eventTime), changes);
+        pending = nullptr;
+      }
+    }
+
+    printf("%d rovers, %.0f%% of heartbeats delivered\n", rovers, delivery * 100);
+    Print("startup", startup);
+    Print("leave", leave);
+    Print("leader leave", leaderLeave);
+    Print("join", join);
+  }
+
+  return 0;
+}
@@ -0,0 +1,249 @@
+// Nest throughput and wait time with and without the nest scheduler.
+//
+// Each rover searches for a random time, then drives its cube back from a
+// random point around the nest and spends a fixed time in the collection
+// zone dropping it off and backing out. Without the scheduler a rover that
+// reaches the zone while another one is in it turns away for a while and
+// tries again, which is what the obstacle controller makes it do. With the
+// scheduler the rovers reserve the zone over the swarm bus, each packet
+// reaching each other rover with the given probability, wait at their
+// holding points and drive in when admitted. The bench counts drop offs
+// per minute, the time rovers spend waiting near the nest and how often
+// two rovers are in the zone at once.
+//
+// usage: nest_bench [delivery]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "NestScheduler.h"
+#include "SwarmBus.h"
+
+using namespace std;
+
+const long int tickTime = 100; //milliseconds
+const long int runTime = 3600000; //milliseconds
+const float meanSearchTime = 40; //seconds to find the next cube
+const float speed = 0.25; //meters per second
+const float zoneRadius = 1.0; //meters, where the rovers meet
+const long int zoneTime = 8000; //milliseconds to drive in, drop and back out
+const long int minBackOff = 5000; //milliseconds turned away from a busy zone
+const long int maxBackOff = 15000;
+
+enum State {SEARCHING, RETURNING, IN_ZONE, BACKING_OFF};
+
+struct Rover {
+  uint32_t node;
+  State state;
+  long int until; //end of the search, the drop off or the back off
+  Point location; //relative to the nest
+  long int waitStart;
+  SwarmBus bus;
+  NestScheduler scheduler;
+};
+
+struct Totals {
+  int drops = 0;
+  float wait = 0; //seconds
+  int waits = 0;
+  long int crowded = 0; //ticks with two rovers in the zone
+};
+
+// Moves the rover up to one tick of driving towards the target, returns
+// true once it is there.
+bool DriveTo(Rover& rover, Point target)
+{
+  float distance = hypot(target.x - rover.location.x, target.y - rover.location.y);
+  float step = speed * tickTime / 1e3;
+  if (distance <= step)
+  {
+    rover.location = target;
+    return true;
+  }
+  rover.location.x += step * (target.x - rover.location.x) / distance;
+  rover.location.y += step * (target.y - rover.location.y) / distance;
+  return false;
+}
+
+Totals Run(int count, bool scheduled, float delivery)
+{
+  //the cubes come up the same way with and without the scheduler
+  mt19937 generator(count);
+  mt19937 radio(count);
+  uniform_real_distribution<float> uniform(0.0, 1.0);
+  exponential_distribution<float> searchTime(1 / meanSearchTime);
+
+  vector<Rover> rovers;
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t node = SwarmBus::NameHash("rover" + to_string(i));
+    Rover rover = {node, SEARCHING, (long int)(searchTime(generator) * 1e3), Point(), -1, SwarmBus(node), NestScheduler()};
+    rover.scheduler.SetNode(node);
+    rovers.push_back(rover);
+  }
+
+  Totals totals;
+  vector<SwarmState> states;
+  Point nest = {0, 0, 0};
+
+  for (long int time = 0; time < runTime; time += tickTime)
+  {
+    int inZone = 0;
+
+    for (Rover& rover : rovers)
+    {
+      if (rover.state == SEARCHING && time >= rover.until)
+      {
+        float bearing = 2 * M_PI * uniform(generator);
+        float radius = 3 + 5 * uniform(generator);
+        rover.location = {radius * cos(bearing), radius * sin(bearing), 0};
+        rover.state = RETURNING;
+        rover.waitStart = -1;
+      }
+      else if (rover.state == BACKING_OFF && time >= rover.until)
+      {
+        rover.state = RETURNING;
+      }
+      else if (rover.state == IN_ZONE && time >= rover.until)
+      {
+        totals.drops++;
+        if (scheduled)
+        {
+          rover.scheduler.Done(time);
+        }
+        rover.state = SEARCHING;
+        rover.until = time + (long int)(searchTime(generator) * 1e3);
+      }
+
+      if (rover.state == RETURNING)
+      {
+        bool near = hypot(rover.location.x, rover.location.y) <= zoneRadius + 1e-3;
+
+        if (scheduled)
+        {
+          if (!rover.scheduler.Admit(rover.location, time))
+          {
+            if (DriveTo(rover, rover.scheduler.GetHoldingPoint()) && rover.waitStart < 0)
+            {
+              rover.waitStart = time;
+            }
+          }
+          else
+          {
+            if (rover.waitStart >= 0)
+            {
+              totals.wait += (time - rover.waitStart) / 1e3;
+              totals.waits++;
+              rover.waitStart = -1;
+            }
+            near = DriveTo(rover, rover.scheduler.GetEntryPoint());
+          }
+        }
+        else if (!near)
+        {
+          Point edge = {rover.location.x, rover.location.y, 0};
+          float distance = hypot(edge.x, edge.y);
+          edge.x *= zoneRadius / distance;
+          edge.y *= zoneRadius / distance;
+          DriveTo(rover, edge);
+        }
+
+        if (near)
+        {
+          bool busy = false;
+          for (const Rover& other : rovers)
+          {
+            busy = busy || (&other != &rover && other.state == IN_ZONE);
+          }
+
+          if (busy && !scheduled)
+          {
+            if (rover.waitStart < 0)
+            {
+              rover.waitStart = time;
+            }
+            rover.state = BACKING_OFF;
+            rover.until = time + minBackOff + (long int)(uniform(radio) * (maxBackOff - minBackOff));
+          }
+          else
+          {
+            if (rover.waitStart >= 0)
+            {
+              totals.wait += (time - rover.waitStart) / 1e3;
+              totals.waits++;
+            }
+            rover.location = nest;
+            rover.state = IN_ZONE;
+            rover.until = time + zoneTime;
+          }
+        }
+      }
+
+      inZone += rover.state == IN_ZONE;
+
+      if (!scheduled)
+      {
+        continue;
+      }
+
+      vector<NestReservation> reservations;
+      if (rover.scheduler.TakeReservations(time, reservations))
+      {
+        for (const NestReservation& reservation : reservations)
+        {
+          rover.bus.ReportReservation(reservation.entry, reservation.start);
+        }
+      }
+
+      SwarmPacket packet;
+      if (!rover.bus.Flush(time, packet))
+      {
+        continue;
+      }
+      for (Rover& receiver : rovers)
+      {
+        if (&receiver == &rover || uniform(radio) >= delivery)
+        {
+          continue;
+        }
+        states.clear();
+        receiver.bus.Receive(packet, states);
+        for (const SwarmState& state : states)
+        {
+          NestReservation reservation = {state.location, state.value};
+          receiver.scheduler.Receive(state.sender, reservation, time);
+        }
+      }
+    }
+
+    totals.crowded += inZone > 1;
+  }
+
+  return totals;
+}
+
+int main(int argc, char** argv)
+{
+  float delivery = argc > 1 ? atof(argv[1]) : 0.9;
+  int swarmSizes[] = {3, 6, 12};
+
+  printf("%.0f%% of packets delivered, %.0f minutes\n", delivery * 100, runTime / 60e3);
+  printf("rovers | direct: drops/min  wait s  crowded s | scheduled: drops/min  wait s  crowded s\n");
+
+  for (int count : swarmSizes)
+  {
+    Totals direct = Run(count, false, delivery);
+    Totals scheduled = Run(count, true, delivery);
+
+    printf("%6d | %17.2f  %6.1f  %9.1f | %20.2f  %6.1f  %9.1f\n", count,
+           direct.drops * 60e3 / runTime, direct.waits > 0 ? direct.wait / direct.waits : 0, direct.crowded * tickTime / 1e3,
+           scheduled.drops * 60e3 / runTime, scheduled.waits > 0 ? scheduled.wait / scheduled.waits : 0, scheduled.crowded * tickTime / 1e3);
+  }
+
+  return 0;
+}
@@ -0,0 +1,156 @@
+// Cost of reading a tuning constant through the parameter store, and a
+// check that readers never see half of an update while it is reloaded.
+//
+// The read is timed against a plain member, a copy taken under a mutex and
+// an atomic shared_ptr load, the usual ways to share values that change.
+// Then one thread reads as a controller would, taking the snapshot once a
+// tick, checking that every value in it belongs to the same version and
+// marking itself quiescent after the tick, while another thread reloads
+// new values as fast as it can. The bench counts the ticks that saw a
+// mixed snapshot, the reloads and the most replaced snapshots that were
+// waiting to be freed at once.
+//
+// usage: params_bench [seconds]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ParamStore.h"
+
+using namespace std;
+
+const long int reads = 50000000;
+
+long int NowNanoseconds()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Every registered value of a reload is derived from the same number.
+ParamStore::Lookup LookupFor(long int generation)
+{
+  return [generation](const string& name, double& value) {
+    value = 0.25 + (generation % 30) * 0.01;
+    return true;
+  };
+}
+
+// All values in range of the registry are set to the same number above,
+// so a whole snapshot has them all equal.
+bool IsWhole(const BehaviourParams* params, const vector<ParamStore::ParamInfo>& info)
+{
+  const float first = *(const float*)((const char*)params + info[0].offset);
+  for (const ParamStore::ParamInfo& param : info)
+  {
+    float value = *(const float*)((const char*)params + param.offset);
+    if (value != first && first >= param.min && first <= param.max)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TimeReads()
+{
+  ParamStore store;
+  BehaviourParams plain;
+  mutex lock;
+  shared_ptr<const BehaviourParams> shared = make_shared<BehaviourParams>();
+  volatile float sink = 0;
+
+  long int start = NowNanoseconds();
+  for (long int i = 0; i < reads; i++)
+  {
+    sink = sink + plain.searchVelocity;
+  }
+  double plainTime = (double)(NowNanoseconds() - start) / reads;
+
+  start = NowNanoseconds();
+  for (long int i = 0; i < reads; i++)
+  {
+    sink = sink + store.Get()->searchVelocity;
+  }
+  double storeTime = (double)(NowNanoseconds() - start) / reads;
+
+  start = NowNanoseconds();
+  for (long int i = 0; i < reads; i++)
+  {
+    lock.lock();
+    float value = plain.searchVelocity;
+    lock.unlock();
+    sink = sink + value;
+  }
+  double mutexTime = (double)(NowNanoseconds() - start) / reads;
+
+  start = NowNanoseconds();
+  for (long int i = 0; i < reads; i++)
+  {
+    sink = sink + atomic_load(&shared)->searchVelocity;
+  }
+  double sharedTime = (double)(NowNanoseconds() - start) / reads;
+
+  printf("read of one value  | member %.2f ns  store %.2f ns  mutex %.2f ns  atomic shared_ptr %.2f ns\n",
+         plainTime, storeTime, mutexTime, sharedTime);
+}
+
+void Race(float seconds)
+{
+  ParamStore store;
+  const vector<ParamStore::ParamInfo>& info = store.GetInfo();
+  atomic<bool> running(true);
+  long int ticks = 0;
+  long int mixed = 0;
+
+  //the built in defaults differ from each other, start from a whole set
+  store.Load(LookupFor(0));
+
+  thread reader([&]() {
+    while (running.load())
+    {
+      const BehaviourParams* params = store.Get();
+      if (!IsWhole(params, info))
+      {
+        mixed++;
+      }
+      ticks++;
+      store.Quiescent();
+    }
+  });
+
+  long int reloads = 0;
+  int mostRetired = 0;
+  long int loadTime = 0;
+  long int end = NowNanoseconds() + (long int)(seconds * 1e9);
+  while (NowNanoseconds() < end)
+  {
+    long int start = NowNanoseconds();
+    store.Load(LookupFor(reloads + 1));
+    loadTime += NowNanoseconds() - start;
+    reloads++;
+    mostRetired = max(mostRetired, store.GetRetiredCount());
+  }
+  running.store(false);
+  reader.join();
+
+  printf("reload while read  | %ld ticks, %ld mixed, %ld reloads at %.1f us, at most %d snapshots waiting to be freed\n",
+         ticks, mixed, reloads, loadTime / 1e3 / reloads, mostRetired);
+}
+
+int main(int argc, char** argv)
+{
+  float seconds = argc > 1 ? atof(argv[1]) : 2;
+
+  //the store logs every change it loads, keep the output to the results
+  streambuf* log = cout.rdbuf(nullptr);
+  TimeReads();
+  Race(seconds);
+  cout.rdbuf(log);
+  return 0;
+}
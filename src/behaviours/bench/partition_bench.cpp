@@ -0,0 +1,129 @@
+// How much of the arena changes hands when a rover leaves or joins.
+//
+// Compares the search wedges of SearchPartition against equal wedges laid
+// out in role slot order, where the membership moves the rover in the last
+// slot into the slot of a rover that left. For each swarm size a random
+// swarm loses a random rover, then a new rover joins, and the bench counts
+// the share of the bearings around the nest that end up with a different
+// rover, not counting the wedge of the rover that left or the one the new
+// rover takes, which have to change hands.
+//
+// usage: partition_bench [trials]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SearchPartition.h"
+#include "SwarmBus.h"
+
+using namespace std;
+
+const int samples = 3600; //bearings checked around the nest
+
+// Owner of each sampled bearing, 0 where nobody searches.
+vector<uint32_t> Owners(const SearchPartition& partition, const vector<uint32_t>& members)
+{
+  vector<uint32_t> owners(samples, 0);
+  for (uint32_t member : members)
+  {
+    float start, width;
+    partition.GetRegion(member, start, width);
+    for (int i = 0; i < samples; i++)
+    {
+      float bearing = 2 * M_PI * (i + 0.5) / samples - start;
+      bearing -= 2 * M_PI * floor(bearing / (2 * M_PI));
+      if (bearing < width)
+      {
+        owners[i] = member;
+      }
+    }
+  }
+  return owners;
+}
+
+// Equal wedges from bearing 0 in slot order.
+vector<uint32_t> SlotOwners(const vector<uint32_t>& slots)
+{
+  vector<uint32_t> owners(samples);
+  for (int i = 0; i < samples; i++)
+  {
+    owners[i] = slots[i * slots.size() / samples];
+  }
+  return owners;
+}
+
+// Share of the bearings that changed owner, not counting the ones the
+// given rovers had before or have after.
+float Moved(const vector<uint32_t>& before, const vector<uint32_t>& after, uint32_t ignore)
+{
+  int moved = 0;
+  for (int i = 0; i < samples; i++)
+  {
+    moved += before[i] != after[i] && before[i] != ignore && after[i] != ignore;
+  }
+  return (float)moved / samples;
+}
+
+int main(int argc, char** argv)
+{
+  int trials = argc > 1 ? atoi(argv[1]) : 200;
+  int swarmSizes[] = {3, 6, 12, 24};
+  mt19937 generator(1);
+
+  printf("%d trials, share of the arena that changes hands besides the wedge of the rover leaving or joining\n", trials);
+  printf("rovers | leave: partition  slots | join: partition  slots\n");
+
+  for (int count : swarmSizes)
+  {
+    float partitionLeave = 0, slotLeave = 0, partitionJoin = 0, slotJoin = 0;
+
+    for (int trial = 0; trial < trials; trial++)
+    {
+      vector<uint32_t> members;
+      for (int i = 0; i < count; i++)
+      {
+        members.push_back(SwarmBus::NameHash("rover" + to_string(trial) + "_" + to_string(i)));
+      }
+
+      SearchPartition partition;
+      partition.SetMembers(members);
+      vector<uint32_t> slots = members;
+
+      //a random rover leaves, the last slot takes its place
+      vector<uint32_t> partitionBefore = Owners(partition, members);
+      vector<uint32_t> slotBefore = SlotOwners(slots);
+      int leaving = generator() % count;
+      uint32_t left = members[leaving];
+
+      members.erase(members.begin() + leaving);
+      partition.SetMembers(members);
+      slots[leaving] = slots.back();
+      slots.pop_back();
+
+      vector<uint32_t> partitionAfter = Owners(partition, members);
+      vector<uint32_t> slotAfter = SlotOwners(slots);
+      partitionLeave += Moved(partitionBefore, partitionAfter, left);
+      slotLeave += Moved(slotBefore, slotAfter, left);
+
+      //a new rover joins in a new last slot
+      uint32_t joined = SwarmBus::NameHash("rover" + to_string(trial) + "_new");
+      members.push_back(joined);
+      partition.SetMembers(members);
+      slots.push_back(joined);
+
+      partitionJoin += Moved(partitionAfter, Owners(partition, members), joined);
+      slotJoin += Moved(slotAfter, SlotOwners(slots), joined);
+    }
+
+    printf("%6d | %16.0f%%  %4.0f%% | %15.0f%%  %4.0f%%\n", count,
+           100 * partitionLeave / trials, 100 * slotLeave / trials,
+           100 * partitionJoin / trials, 100 * slotJoin / trials);
+  }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+// Pickups of one cube in front of the rover with the gripper feedback of
+// the simulation and of the rover, run through the PickUpController the
+// way the logic controller drives it.
+//
+// The fingers and the wrist take a moment to get where they were sent and
+// the fingers stop on a cube if there is one. The simulated gripper
+// publishes the angles they are at, the rover arduino echoes the last
+// command instead. The camera sees the cube ahead of the fingers until it
+// is raised, and in the fingers once the wrist has been up for the camera
+// delay if it was grasped.
+//
+// The first run grasps nothing three times with the cube still in view and
+// checks that the controller gives up, hands control back and leaves the
+// cube alone until its ignore time runs out. The other runs hold the cube
+// on the first grasp and check it is not dropped for a retry before the
+// camera sees it, with either kind of feedback.
+//
+// usage: pickup_bench
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "PickUpController.h"
+
+using namespace std;
+
+const long int tickTime = 50; //milliseconds
+const long int runTime = 20000; //milliseconds
+const int trackID = 7;
+const float servoSpeed = M_PI_2 / 0.3; //radians per second
+const float cubeFingerAngle = 0.4; //radians, fingers stopped by a cube
+const float cameraDelay = 0.6; //seconds from the wrist up to the camera seeing the held cube
+
+struct Gripper {
+  bool measured;
+  bool grasps; //the fingers close on the cube
+  float finger = M_PI_2;
+  float wrist = 1.25;
+  float fingerCommand = M_PI_2;
+  float wristCommand = 1.25;
+
+  void Step(float seconds)
+  {
+    float stop = grasps ? cubeFingerAngle : 0;
+    float target = max(fingerCommand, stop);
+    finger += max(-servoSpeed * seconds, min(servoSpeed * seconds, target - finger));
+    wrist += max(-servoSpeed * seconds, min(servoSpeed * seconds, wristCommand - wrist));
+  }
+
+  float FingerFeedback() const {return measured ? finger : fingerCommand;}
+  float WristFeedback() const {return measured ? wrist : wristCommand;}
+
+  bool Holding() const {return grasps && fingerCommand < cubeFingerAngle;}
+  bool Raised() const {return wrist < 0.1;}
+};
+
+struct Run {
+  int attempts = 0;
+  long int released = -1; //time control was handed back after giving up
+  long int heldTime = -1;
+  int retakenInWindow = 0; //ticks the controller took control back during its ignore time
+  long int retaken = -1; //time control was taken back once the ignore time was over
+};
+
+Tag MakeCube(float distance)
+{
+  Tag tag;
+  tag.setID(0);
+  tag.setPositionX(0.0);
+  tag.setPositionY(0.0);
+  tag.setPositionZ(distance);
+  return tag;
+}
+
+Run PickUp(bool measured, bool grasps)
+{
+  //the constructor leaves some of the state to Reset(), the logic controller
+  //lives in static storage where it starts zeroed
+  PickUpController pickUp;
+  pickUp.SetCurrentTimeInMilliSecs(0);
+  pickUp.Reset();
+  Gripper gripper;
+  gripper.measured = measured;
+  gripper.grasps = grasps;
+
+  Run run;
+  bool control = false;
+  bool wasLocked = false;
+  long int raisedSince = -1;
+
+  for (long int time = 0; time < runTime; time += tickTime)
+  {
+    pickUp.SetCurrentTimeInMilliSecs(time);
+
+    //raised with the cube in the fingers the camera sees it right in front of the lens
+    if (gripper.Raised() && raisedSince < 0)
+    {
+      raisedSince = time;
+    }
+    else if (!gripper.Raised())
+    {
+      raisedSince = -1;
+    }
+    bool seenHeld = gripper.Holding() && raisedSince >= 0 && (time - raisedSince) / 1e3 >= cameraDelay;
+    pickUp.SetTagData(vector<Tag>{MakeCube(seenHeld ? 0.1 : 0.3)});
+    pickUp.SetTrackedTarget(0.1, 0.0, trackID);
+    pickUp.SetGripperData(gripper.FingerFeedback(), gripper.WristFeedback());
+
+    bool interrupt = pickUp.ShouldInterrupt();
+    if (pickUp.GetTargetHeld())
+    {
+      run.heldTime = time;
+      break;
+    }
+
+    if (interrupt)
+    {
+      bool hadControl = control;
+      control = pickUp.HasWork();
+      if (hadControl && !control && run.released < 0)
+      {
+        run.released = time;
+      }
+      else if (control && run.released >= 0)
+      {
+        if (pickUp.GetIgnoredTrack() == trackID)
+        {
+          run.retakenInWindow++;
+        }
+        else if (run.retaken < 0)
+        {
+          run.retaken = time;
+          break;
+        }
+      }
+    }
+
+    if (control)
+    {
+      Result result = pickUp.DoWork();
+      if (result.fingerAngle >= 0)
+      {
+        gripper.fingerCommand = result.fingerAngle;
+      }
+      if (result.wristAngle >= 0)
+      {
+        gripper.wristCommand = result.wristAngle;
+      }
+    }
+
+    if (pickUp.GetLockTarget() && !wasLocked)
+    {
+      run.attempts++;
+    }
+    wasLocked = pickUp.GetLockTarget();
+    gripper.Step(tickTime / 1e3);
+  }
+
+  return run;
+}
+
+int main(int argc, char** argv)
+{
+  bool failed = false;
+
+  Run empty = PickUp(true, false);
+  printf("empty grasps  | %d attempts, control handed back at %.1f s, taken back %d times while ignored, again at %.1f s\n",
+         empty.attempts, empty.released / 1e3, empty.retakenInWindow, empty.retaken / 1e3);
+  failed |= empty.attempts != 3 || empty.released < 0 || empty.retakenInWindow > 0 || empty.retaken < 0;
+
+  bool feedback[] = {true, false};
+  for (bool measured : feedback)
+  {
+    Run held = PickUp(measured, true);
+    printf("%-13s | held at %.1f s after %d attempts\n", measured ? "sim gripper" : "rover gripper", held.heldTime / 1e3, held.attempts);
+    failed |= held.heldTime < 0 || held.attempts != 1;
+  }
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  return failed ? 1 : 0;
+}
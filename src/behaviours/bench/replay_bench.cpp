@@ -0,0 +1,354 @@
+// Cost of recording every input of the logic controller, size of the log,
+// and speed and faithfulness of the replay.
+//
+// A rover is driven through a synthetic run by a LogicController that gets
+// the calls the ROSAdapter makes, in the same order: odometry and EKF poses
+// twice a tick, sonar once, tags when a cube or the nest is in view, the
+// poses of two other rovers, registry deltas once a second, and on every
+// tick the time, the localized center, DoWork and the swarm reports. The
+// wheel commands move the simulated rover. The same run is made once
+// without and once with recording, which must give the same results, then
+// the log is replayed into a fresh LogicController and every tick is
+// compared, and a copy of the log cut off halfway through a record, as a
+// crash or a power cut leaves it, is replayed up to the cut.
+//
+// usage: replay_bench [minutes of run]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "InputLog.h"
+#include "InputReplay.h"
+#include "LogicController.h"
+
+using namespace std;
+
+// Static storage, like the logic controller of the node.
+LogicController plainRun;
+LogicController recordedRun;
+LogicController replayedRun;
+LogicController cutReplayedRun;
+
+const long int tickTime = 100; //milliseconds, the behaviour loop
+const long int startTime = 5000; //ROS time of the first tick
+const float cameraHeight = 0.195; //meters above the ground
+
+double Seconds(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Distance the sonar at the bearing sees to the closest obstacle, 3 m when
+// there is none.
+float Sonar(Point pose, float bearing, const vector<Point>& obstacles)
+{
+  float range = 3;
+  float heading = pose.theta + bearing;
+  for (const Point& obstacle : obstacles)
+  {
+    float dx = obstacle.x - pose.x;
+    float dy = obstacle.y - pose.y;
+    float along = dx * cos(heading) + dy * sin(heading);
+    float across = -dx * sin(heading) + dy * cos(heading);
+    if (along > 0 && fabs(across) < 0.3)
+    {
+      range = min(range, along);
+    }
+  }
+  return range;
+}
+
+// A tag in the camera frame, x right, y down and z forward.
+Tag SeenTag(int id, Point pose, Point where)
+{
+  float dx = where.x - pose.x;
+  float dy = where.y - pose.y;
+  float forward = dx * cos(pose.theta) + dy * sin(pose.theta);
+  float left = -dx * sin(pose.theta) + dy * cos(pose.theta);
+
+  Tag tag;
+  tag.setID(id);
+  tag.setPosition(make_tuple(-left, cameraHeight, forward));
+  tag.setOrientation(::boost::math::quaternion<float>(0, 0, 0, 1));
+  return tag;
+}
+
+void Run(LogicController& logic, InputLog* log, int ticks, vector<RecordedResult>& results)
+{
+  mt19937 generator(7);
+  normal_distribution<float> gps(0, 0.05);
+  normal_distribution<float> sonarNoise(0, 0.02);
+  uniform_real_distribution<float> arena(-6, 6);
+
+  vector<Point> obstacles, cubes;
+  for (int i = 0; i < 8; i++)
+  {
+    obstacles.push_back(Point{arena(generator), arena(generator), 0});
+  }
+  for (int i = 0; i < 40; i++)
+  {
+    cubes.push_back(Point{arena(generator), arena(generator), 0});
+  }
+  Point center = {1.3, 0, 0};
+  Point pose = {0, 0, 0};
+  float linear = 0, angular = 0;
+  float finger = 0, wrist = 0;
+
+  logic.SetInputLog(log);
+  logic.SetSearchPattern("frontier", 12345);
+  logic.SetRoverId(0xabcdef);
+  logic.LoadParams([](const string& name, double& value) {
+    if (name != "drive/search_velocity")
+    {
+      return false;
+    }
+    value = 0.3;
+    return true;
+  });
+  logic.SetModeManual();
+
+  //the start, as the startup gate sees it
+  long int time = startTime;
+  for (int i = 0; i < 20; i++)
+  {
+    logic.SetMapPositionData(Point{gps(generator), gps(generator), 0}, time);
+    logic.AddCenterLocationSample(Point{gps(generator), gps(generator), 0});
+  }
+  logic.SetModeAuto();
+  logic.SetCenterLocationOdom(center);
+  logic.InitializeLocalizer(center);
+  logic.SetCenterLocationMap(center);
+  logic.SetSwarmMembers({0xabcdef, 0x123456, 0x654321});
+
+  for (int tick = 0; tick < ticks; tick++)
+  {
+    for (int half = 0; half < 2; half++)
+    {
+      float dt = tickTime / 2e3;
+      pose.theta += angular * dt;
+      pose.x += linear * cos(pose.theta) * dt;
+      pose.y += linear * sin(pose.theta) * dt;
+      time += tickTime / 2;
+
+      logic.SetPositionData(pose, time);
+      logic.SetVelocityData(linear, angular);
+      logic.SetMapPositionData(Point{pose.x + gps(generator), pose.y + gps(generator), pose.theta}, time);
+      logic.SetMapVelocityData(linear, angular);
+    }
+
+    logic.SetSonarData(Sonar(pose, 0.5, obstacles) + sonarNoise(generator), Sonar(pose, 0, obstacles) + sonarNoise(generator),
+                       Sonar(pose, -0.5, obstacles) + sonarNoise(generator));
+    logic.SetGripperData(finger, wrist);
+
+    vector<Tag> tags;
+    for (const Point& cube : cubes)
+    {
+      Tag tag = SeenTag(0, pose, cube);
+      if (get<2>(tag.getPosition()) > 0.1 && get<2>(tag.getPosition()) < 0.8 && fabs(get<0>(tag.getPosition())) < 0.3)
+      {
+        tags.push_back(tag);
+      }
+    }
+    if (hypot(pose.x - center.x, pose.y - center.y) < 1.2)
+    {
+      Tag tag = SeenTag(256, pose, center);
+      if (get<2>(tag.getPosition()) > 0.1)
+      {
+        tags.push_back(tag);
+      }
+    }
+    if (!tags.empty())
+    {
+      logic.SetAprilTags(tags);
+    }
+
+    //the other two rovers circle the nest
+    for (int other = 0; other < 2; other++)
+    {
+      float angle = time / 20000.0 + other * M_PI;
+      logic.ReceiveNeighbourPose(other == 0 ? 0x123456 : 0x654321, Point{3 * cos(angle), 3 * sin(angle), angle}, 0.2);
+    }
+    if (tick % 10 == 5)
+    {
+      ResourceEntry entry;
+      entry.cellX = tick % 7;
+      entry.cellY = tick % 5;
+      entry.remaining = 2;
+      entry.countClock = tick;
+      entry.countNode = 0x123456;
+      logic.MergeResourceDelta({entry});
+    }
+
+    //the behaviour loop
+    logic.ParamsQuiescent();
+    logic.SetCurrentTimeInMilliSecs(time);
+    logic.SetCenterLocationOdom(logic.GetLocalizedCenterLocation());
+    Result result = logic.DoWork();
+    results.push_back(RecordedResult(result));
+
+    vector<AllocationBid> bids;
+    logic.UpdateAllocation(time - startTime, bids);
+    vector<NestReservation> reservations;
+    logic.TakeNestReservations(reservations);
+    vector<ResourceEntry> delta;
+    logic.TakeResourceDelta(delta);
+
+    //wheel commands of up to 255 drive at most about half a meter a second
+    if (result.type != behavior || result.b != wait)
+    {
+      linear = (result.pd.left + result.pd.right) / 2 / 255 * 0.5;
+      angular = (result.pd.right - result.pd.left) / 255 * 2;
+    }
+    else
+    {
+      linear = angular = 0;
+    }
+    if (result.fingerAngle != -1)
+    {
+      finger = result.fingerAngle;
+    }
+    if (result.wristAngle != -1)
+    {
+      wrist = result.wristAngle;
+    }
+  }
+  logic.SetInputLog(nullptr);
+}
+
+// Replays the log into the logic controller, returns the ticks replayed and
+// how many of them differ from the results, or -1 if a record can't be read.
+long int Replay(const string& path, LogicController& logic, const vector<RecordedResult>& results, long int& mismatches,
+                long int& indexedTicks)
+{
+  InputLogReader reader;
+  if (!reader.Open(path))
+  {
+    return -1;
+  }
+  indexedTicks = reader.GetTickCount();
+
+  InputReplay replay(&logic);
+  long int ticks = 0;
+  mismatches = 0;
+  InputRecord record;
+  while (reader.Next(record))
+  {
+    RecordedResult replayed, recorded;
+    if (!replay.Apply(record, replayed, recorded))
+    {
+      return -1;
+    }
+    if (record.type == INPUT_TICK)
+    {
+      if (replayed != recorded || replayed != results[ticks])
+      {
+        mismatches++;
+      }
+      ticks++;
+    }
+  }
+  return ticks;
+}
+
+void TimeRecords(const string& path)
+{
+  const long int records = 10000000;
+  InputLog log;
+  log.Open(path);
+  Point pose = {1, 2, 3};
+  Result result;
+  result.type = waypoint;
+
+  auto start = chrono::steady_clock::now();
+  for (long int i = 0; i < records; i++)
+  {
+    log.Record(INPUT_POSITION, pose, (int64_t)i);
+    if (i % 20 == 19)
+    {
+      log.RecordTick(i, result);
+    }
+  }
+  double seconds = Seconds(start);
+  log.Close();
+  printf("recording          | %.1f ns per pose record, writes to the file included\n", seconds * 1e9 / records);
+}
+
+int main(int argc, char** argv)
+{
+  float minutes = argc > 1 ? atof(argv[1]) : 10;
+  int ticks = minutes * 60000 / tickTime;
+  string path = "/tmp/replay_bench.inputs";
+
+  //the controllers print as they go, keep the output to the results
+  streambuf* controllerLog = cout.rdbuf(nullptr);
+
+  TimeRecords(path);
+
+  vector<RecordedResult> plainResults, recordedResults, unused;
+  auto start = chrono::steady_clock::now();
+  Run(plainRun, nullptr, ticks, plainResults);
+  double plainTime = Seconds(start);
+
+  InputLog log;
+  log.Open(path);
+  start = chrono::steady_clock::now();
+  Run(recordedRun, &log, ticks, recordedResults);
+  double recordedTime = Seconds(start);
+  long int records = log.GetRecordCount();
+  long int bytes = log.GetBytesWritten();
+  log.Close();
+
+  long int differ = 0;
+  for (int i = 0; i < ticks; i++)
+  {
+    differ += plainResults[i] != recordedResults[i];
+  }
+  int moving = 0;
+  for (const RecordedResult& result : recordedResults)
+  {
+    moving += !result.waiting && (result.left != 0 || result.right != 0);
+  }
+
+  long int mismatches, indexedTicks;
+  start = chrono::steady_clock::now();
+  long int replayed = Replay(path, replayedRun, recordedResults, mismatches, indexedTicks);
+  double replayTime = Seconds(start);
+
+  //cut off inside a record a little past halfway, without the index
+  ifstream whole(path, ios::binary);
+  vector<char> contents((istreambuf_iterator<char>(whole)), istreambuf_iterator<char>());
+  string cutPath = "/tmp/replay_bench_cut.inputs";
+  ofstream cut(cutPath, ios::binary | ios::trunc);
+  cut.write(contents.data(), contents.size() / 2 + 7);
+  cut.close();
+  unlink((cutPath + ".index").c_str());
+  long int cutMismatches, cutIndexed;
+  long int cutReplayed = Replay(cutPath, cutReplayedRun, recordedResults, cutMismatches, cutIndexed);
+
+  cout.rdbuf(controllerLog);
+
+  double runTime = ticks * tickTime / 1e3;
+  printf("run                | %d ticks, %.0f s, %d with the wheels turning\n", ticks, runTime, moving);
+  printf("log                | %ld records, %.1f per tick, %.1f kB per second of run, %.1f MB per hour\n", records,
+         (double)records / ticks, bytes / runTime / 1e3, bytes / runTime * 3600 / 1e6);
+  printf("run with recording | %.1f us per tick without, %.1f us with, %ld results differ\n", plainTime * 1e6 / ticks,
+         recordedTime * 1e6 / ticks, differ);
+  printf("replay             | %ld of %ld indexed ticks in %.2f s, %.0f times as fast as the run, %ld results differ\n",
+         replayed, indexedTicks, replayTime, runTime / replayTime, mismatches);
+  printf("cut off log        | %ld bytes of %ld, %ld ticks found without the index, %ld replayed, %ld results differ\n",
+         contents.size() / 2 + 7, contents.size(), cutIndexed, cutReplayed, cutMismatches);
+
+  unlink(path.c_str());
+  unlink((path + ".index").c_str());
+  unlink((path + ".1").c_str());
+  unlink((path + ".1.index").c_str());
+  unlink(cutPath.c_str());
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Headless comparison of the search patterns.
+//
+// Drives a simple kinematic rover through the waypoints each pattern
+// generates in an empty arena and reports the ground the camera covered,
+// from the same coverage map the rovers use, and the time taken to
+// generate each waypoint.
+//
+// usage: search_bench [minutes] [arena width in meters]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "CoverageMap.h"
+#include "SearchPattern.h"
+
+using namespace std;
+
+const float timeStep = 0.1; //seconds
+const float linearSpeed = 0.3; //meters per second
+const float angularSpeed = 1.0; //radians per second, turning in place
+const float headingTolerance = 0.2; //radians, drive forward once this close
+const float waypointTolerance = 0.15; //meters
+
+int main(int argc, char** argv)
+{
+  float minutes = argc > 1 ? atof(argv[1]) : 20;
+  float arenaWidth = argc > 2 ? atof(argv[2]) : 15;
+  float arenaHalfWidth = arenaWidth / 2;
+
+  const char* names[] = {"square", "octagon", "star", "sector", "spiral", "levy", "lawnmower", "frontier", "random"};
+
+  cout << "pattern      m^2@5min  m^2@10min  m^2@" << minutes << "min  m^2/min  waypoints  ns/waypoint" << endl;
+
+  for (const char* name : names)
+  {
+    CoverageMap coverageMap;
+    Point center = {0, 0, 0};
+    coverageMap.SetOrigin(center);
+
+    unique_ptr<SearchPattern> pattern(CreateSearchPattern(name, &coverageMap, 1));
+
+    //leave the nest heading out along x like the rovers do
+    Point rover = {1.0, 0, 0};
+    pattern->Start(rover, center);
+
+    Point waypoint = rover;
+    Point target = rover; //waypoint before it was limited to the arena
+    int waypoints = 0;
+    double generateNanoseconds = 0;
+    float coveredAt5 = 0, coveredAt10 = 0;
+    int steps = minutes * 60 / timeStep;
+
+    for (int step = 0; step <= steps; step++)
+    {
+      float distance = hypot(waypoint.x - rover.x, waypoint.y - rover.y);
+      if (distance < waypointTolerance)
+      {
+        //the wall stopped the rover, the search controller reports it as blocked
+        if (target.x != waypoint.x || target.y != waypoint.y)
+        {
+          pattern->Blocked(target);
+        }
+
+        auto start = chrono::steady_clock::now();
+        target = pattern->Next(rover, center);
+        generateNanoseconds += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        waypoints++;
+
+        //the arena walls stop the rover short of waypoints outside them
+        waypoint = target;
+        waypoint.x = fmax(-arenaHalfWidth, fmin(arenaHalfWidth, waypoint.x));
+        waypoint.y = fmax(-arenaHalfWidth, fmin(arenaHalfWidth, waypoint.y));
+        continue;
+      }
+
+      float headingError = remainder(atan2(waypoint.y - rover.y, waypoint.x - rover.x) - rover.theta, 2 * M_PI);
+      if (fabs(headingError) > headingTolerance)
+      {
+        rover.theta += copysign(fmin(fabs(headingError), angularSpeed * timeStep), headingError);
+      }
+      else
+      {
+        rover.theta += headingError;
+        float travel = fmin(distance, linearSpeed * timeStep);
+        rover.x += travel * cos(rover.theta);
+        rover.y += travel * sin(rover.theta);
+      }
+
+      coverageMap.MarkFootprint(rover);
+
+      if (step == int(5 * 60 / timeStep)) coveredAt5 = coverageMap.GetCoveredArea();
+      if (step == int(10 * 60 / timeStep)) coveredAt10 = coverageMap.GetCoveredArea();
+    }
+
+    float covered = coverageMap.GetCoveredArea();
+    printf("%-12s %8.1f  %9.1f  %9.1f  %7.2f  %9d  %11.0f\n", name, coveredAt5, coveredAt10, covered,
+           covered / minutes, waypoints, generateNanoseconds / fmax(waypoints, 1));
+  }
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+// Cost of saving the state snapshot, time to restore it and whether it
+// survives a crash in the middle of a save.
+//
+// The saves are timed with and without the msync() that asks the kernel
+// to write the page back, the restore as opening the file and loading the
+// newest slot, the way the node does on startup. For the crash test a
+// child process saves as fast as it can and is killed with SIGKILL at a
+// random moment, then the parent loads the file and checks that it gets a
+// state that was written whole. Every field of a saved state is derived
+// from its save count, so a state mixed from two saves is caught. A second
+// test scribbles over part of the newest slot, the way a torn write of the
+// page would leave it, and checks the previous state is loaded instead.
+//
+// usage: snapshot_bench [file]
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "StateSnapshot.h"
+
+using namespace std;
+
+const int saves = 200000;
+const int restores = 2000;
+const int kills = 200;
+
+long int NowNanoseconds()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RoverState MakeState(long int count)
+{
+  RoverState state;
+  memset(&state, 0, sizeof(state));
+  state.savedTime = count;
+  state.runTime = count * 100;
+  state.centerLocationMap.x = count % 1000;
+  state.centerLocationMap.y = -(count % 1000);
+  state.centerLocation.x = count % 777;
+  state.centerLocation.y = count % 333;
+  state.centerM2 = count * 0.5;
+  state.centerSamples = count % 300;
+  state.role = count % 6;
+  state.epoch = count / 7;
+  state.processState = count % 3;
+  return state;
+}
+
+bool IsWhole(const RoverState& state)
+{
+  RoverState expected = MakeState(state.savedTime);
+  return memcmp(&state, &expected, sizeof(RoverState)) == 0;
+}
+
+double Percentile(vector<double> values, double share)
+{
+  sort(values.begin(), values.end());
+  return values[min(values.size() - 1, (size_t)(share * values.size()))];
+}
+
+double Mean(const vector<double>& values)
+{
+  double sum = 0;
+  for (double value : values)
+  {
+    sum += value;
+  }
+  return sum / values.size();
+}
+
+void TimeSaves(const string& path, bool sync)
+{
+  StateSnapshot snapshot;
+  snapshot.Open(path);
+
+  vector<double> times;
+  for (int i = 1; i <= saves; i++)
+  {
+    RoverState state = MakeState(i);
+    long int start = NowNanoseconds();
+    snapshot.Save(state, sync);
+    times.push_back((NowNanoseconds() - start) / 1e3);
+  }
+  printf("save %-13s | %7.2f us mean  %7.2f us p99  %7.2f us max\n", sync ? "with msync" : "without msync",
+         Mean(times), Percentile(times, 0.99), *max_element(times.begin(), times.end()));
+}
+
+void TimeRestores(const string& path)
+{
+  vector<double> times;
+  for (int i = 0; i < restores; i++)
+  {
+    long int start = NowNanoseconds();
+    StateSnapshot snapshot;
+    RoverState state;
+    bool loaded = snapshot.Open(path) && snapshot.Load(state);
+    times.push_back((NowNanoseconds() - start) / 1e3);
+    if (!loaded || !IsWhole(state))
+    {
+      printf("restore failed\n");
+      exit(1);
+    }
+  }
+  printf("open and load      | %7.2f us mean  %7.2f us p99\n", Mean(times), Percentile(times, 0.99));
+}
+
+void Kill(const string& path)
+{
+  mt19937 generator(1);
+  uniform_int_distribution<int> delay(100, 20000); //microseconds before the kill
+
+  int whole = 0;
+  int empty = 0;
+  long int lastCount = 0;
+  for (int i = 0; i < kills; i++)
+  {
+    pid_t child = fork();
+    if (child == 0)
+    {
+      StateSnapshot snapshot;
+      snapshot.Open(path);
+      RoverState state;
+      long int count = snapshot.Load(state) ? state.savedTime : 0;
+      while (true)
+      {
+        snapshot.Save(MakeState(++count));
+      }
+    }
+
+    usleep(delay(generator));
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+
+    StateSnapshot snapshot;
+    RoverState state;
+    if (!snapshot.Open(path) || !snapshot.Load(state))
+    {
+      empty++;
+      continue;
+    }
+    if (IsWhole(state) && state.savedTime >= lastCount)
+    {
+      whole++;
+      lastCount = state.savedTime;
+    }
+  }
+  printf("killed mid save    | %d of %d loads whole and not older than the one before, %d empty, %ld saves\n",
+         whole, kills, empty, lastCount);
+}
+
+void Tear(const string& path)
+{
+  StateSnapshot snapshot;
+  snapshot.Open(path);
+  snapshot.Save(MakeState(1000001));
+  snapshot.Save(MakeState(1000002));
+  snapshot.Close();
+
+  //the newest slot is the one the last save went to, find it by its bytes
+  vector<char> bytes;
+  {
+    ifstream in(path, ios::binary);
+    bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  }
+  RoverState newest = MakeState(1000002);
+  auto found = search(bytes.begin(), bytes.end(), (char*)&newest, (char*)&newest + sizeof(RoverState));
+  if (found == bytes.end())
+  {
+    printf("torn write         | newest state not found in the file\n");
+    return;
+  }
+  //half the state from a save that never finished
+  memset(&*found + sizeof(RoverState) / 2, 0x55, sizeof(RoverState) / 2);
+  {
+    ofstream out(path, ios::binary);
+    out.write(bytes.data(), bytes.size());
+  }
+
+  RoverState state;
+  snapshot.Open(path);
+  bool loaded = snapshot.Load(state);
+  printf("torn write         | %s\n", loaded && IsWhole(state) && state.savedTime == 1000001 ? "previous state loaded" : "FAILED");
+}
+
+int main(int argc, char** argv)
+{
+  string path = argc > 1 ? argv[1] : "/tmp/snapshot_bench.snapshot";
+  unlink(path.c_str());
+
+  printf("%zu byte state, %d saves\n", sizeof(RoverState), saves);
+  TimeSaves(path, false);
+  TimeSaves(path, true);
+  TimeRestores(path);
+  Kill(path);
+  Tear(path);
+
+  unlink(path.c_str());
+  return 0;
+}
@@ -0,0 +1,208 @@
+// Time from boot to leaving the start, and the error of the averaged nest
+// center, with the startup gate against the fixed 30 second delay.
+//
+// The rovers boot within the first five seconds of ROS time. The EKF
+// position deviation of each starts at a few meters and settles with a
+// random time constant once GPS comes in, a share of the rovers never
+// gets below the threshold, as happens with a poor fix. The map pose is
+// the start pose plus the current EKF error and GPS noise that is
+// correlated from tick to tick. The transforms come up one to four
+// seconds after boot and the roles come from SwarmMembership with every
+// heartbeat delivered.
+//
+// The fixed delay counts 30 seconds of wall clock, which is 30 seconds
+// times the simulation speed in ROS time, and averages every sample from
+// boot on. The gate waits in ROS time and only averages samples from the
+// converged pose. The bench prints the mean and longest time to ready in
+// ROS time, how many rovers gave up waiting and the mean distance of the
+// averaged center from the true start.
+//
+// usage: startup_bench [trials]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "StartupGate.h"
+#include "SwarmMembership.h"
+
+using namespace std;
+
+const long int tickTime = 100; //milliseconds, the behaviour loop
+const long int bootWindow = 5000; //milliseconds
+const long int fixedDelay = 30000; //milliseconds of wall clock
+const float noiseDeviation = 0.4; //meters, GPS noise around the EKF error
+const float noiseCorrelation = 0.95; //from one tick to the next
+const float unconvergedShare = 0.05;
+
+struct Rover {
+  long int bootTime;
+  float timeConstant; //milliseconds for the EKF deviation to settle
+  float finalDeviation; //meters
+  long int transformTime;
+  float noiseX = 0;
+  float noiseY = 0;
+  float biasX; //EKF error, shrinks with the deviation
+  float biasY;
+
+  StartupGate gate;
+  double sumX = 0;
+  double sumY = 0;
+  double sumSquares = 0;
+  int samples = 0;
+  double fixedX = 0; //every sample from boot for the fixed delay
+  double fixedY = 0;
+  int fixedSamples = 0;
+  long int readyTime = -1;
+  float gateError = 0;
+  float fixedError = 0;
+};
+
+struct Totals {
+  int rovers = 0;
+  double readyTime = 0;
+  long int maxReadyTime = 0;
+  int gaveUp = 0;
+  double gateError = 0;
+  double fixedError = 0;
+};
+
+void Run(int count, mt19937& generator, Totals& totals)
+{
+  uniform_real_distribution<float> uniform(0.0, 1.0);
+  normal_distribution<float> normal(0.0, 1.0);
+
+  vector<Rover> rovers(count);
+  vector<SwarmMembership> members;
+  for (int i = 0; i < count; i++)
+  {
+    Rover& rover = rovers[i];
+    rover.bootTime = uniform(generator) * bootWindow;
+    rover.timeConstant = 2000 + uniform(generator) * 6000;
+    rover.finalDeviation = uniform(generator) < unconvergedShare ? 0.8 : 0.15;
+    rover.transformTime = rover.bootTime + 1000 + uniform(generator) * 3000;
+    rover.biasX = normal(generator);
+    rover.biasY = normal(generator);
+    members.push_back(SwarmMembership("rover" + to_string(i)));
+  }
+
+  long int end = bootWindow + fixedDelay;
+  for (long int time = 0; time <= end; time += tickTime)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      Rover& rover = rovers[i];
+      if (time < rover.bootTime)
+      {
+        continue;
+      }
+
+      SwarmHeartbeat heartbeat;
+      if (members[i].Update(time, heartbeat))
+      {
+        for (int j = 0; j < count; j++)
+        {
+          if (j != i && time >= rovers[j].bootTime)
+          {
+            members[j].Receive(heartbeat, time);
+          }
+        }
+      }
+
+      float age = time - rover.bootTime;
+      float deviation = rover.finalDeviation + 4 * exp(-age / rover.timeConstant);
+      float spread = sqrt(1 - noiseCorrelation * noiseCorrelation);
+      rover.noiseX = noiseCorrelation * rover.noiseX + spread * noiseDeviation * normal(generator);
+      rover.noiseY = noiseCorrelation * rover.noiseY + spread * noiseDeviation * normal(generator);
+      float x = rover.biasX * deviation + rover.noiseX;
+      float y = rover.biasY * deviation + rover.noiseY;
+
+      rover.fixedX += x;
+      rover.fixedY += y;
+      rover.fixedSamples++;
+      if (rover.fixedSamples * tickTime == fixedDelay)
+      {
+        rover.fixedError = hypot(rover.fixedX / rover.fixedSamples, rover.fixedY / rover.fixedSamples);
+      }
+
+      if (rover.readyTime >= 0)
+      {
+        continue;
+      }
+
+      StartupGate& gate = rover.gate;
+      if (!gate.IsStarted())
+      {
+        gate.Start(time);
+      }
+      gate.SetPoseCovariance(deviation * deviation, deviation * deviation);
+      float uncertainty = -1;
+      if (rover.samples >= 2)
+      {
+        double meanX = rover.sumX / rover.samples;
+        double meanY = rover.sumY / rover.samples;
+        double variance = (rover.sumSquares - rover.samples * (meanX * meanX + meanY * meanY)) / (rover.samples - 1);
+        uncertainty = sqrt(max(0.0, variance) / rover.samples);
+      }
+      gate.SetCenterSamples(rover.samples, uncertainty);
+      gate.SetTransformAvailable(time >= rover.transformTime);
+      gate.SetRole(members[i].GetRole());
+
+      bool ready = gate.Update(time);
+      if (gate.ShouldSampleCenter())
+      {
+        rover.sumX += x;
+        rover.sumY += y;
+        rover.sumSquares += x * x + y * y;
+        rover.samples++;
+      }
+      if (ready)
+      {
+        rover.readyTime = time - rover.bootTime;
+        rover.gateError = hypot(rover.sumX / rover.samples, rover.sumY / rover.samples);
+        if (gate.GetTimeToReady() >= gate.maxWait)
+        {
+          totals.gaveUp++;
+        }
+      }
+    }
+  }
+
+  for (const Rover& rover : rovers)
+  {
+    totals.rovers++;
+    totals.readyTime += rover.readyTime;
+    totals.maxReadyTime = max(totals.maxReadyTime, rover.readyTime);
+    totals.gateError += rover.gateError;
+    totals.fixedError += rover.fixedError;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int trials = argc > 1 ? atoi(argv[1]) : 50;
+  int swarmSizes[] = {1, 3, 6, 12};
+  float speeds[] = {1, 2, 4};
+
+  printf("%d boots per swarm size, times in ROS seconds from boot\n", trials);
+  printf("rovers | gate: mean ready  max ready  gave up  center error | fixed: ready at 1x 2x 4x  center error\n");
+  for (int count : swarmSizes)
+  {
+    mt19937 generator(count);
+    Totals totals;
+    for (int trial = 0; trial < trials; trial++)
+    {
+      Run(count, generator, totals);
+    }
+    printf("%6d | %16.1f  %9.1f  %6.1f%%  %10.2f m | %16.0f %2.0f %2.0f  %10.2f m\n", count,
+           totals.readyTime / 1e3 / totals.rovers, totals.maxReadyTime / 1e3, 100.0 * totals.gaveUp / totals.rovers,
+           totals.gateError / totals.rovers,
+           fixedDelay * speeds[0] / 1e3, fixedDelay * speeds[1] / 1e3, fixedDelay * speeds[2] / 1e3,
+           totals.fixedError / totals.rovers);
+  }
+  return 0;
+}
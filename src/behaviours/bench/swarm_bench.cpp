@@ -0,0 +1,137 @@
+// Bandwidth of the swarm bus against the Waypoint broadcasts it replaces.
+//
+// Every rover reports its pose twice a second and the cubes and obstacles
+// it finds at random, and claims a role at startup. The old scheme sends
+// each report as its own swarmie_msgs/Waypoint and announces the rover
+// names as strings on startOrder and sortOrder. The swarm bus batches the
+// reports into SwarmPackets under its bandwidth budget. Every message is
+// sent once to each other rover, which is what a ROS topic does, so both
+// schemes pay the TCP/IP framing per message and per receiver.
+//
+// usage: swarm_bench [seconds]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SwarmBus.h"
+
+using namespace std;
+
+const long int tickTime = 100; //milliseconds
+const long int poseInterval = 500; //milliseconds
+const float resourceRate = 0.1; //sightings per second
+const float obstacleRate = 0.2; //reports per second
+
+const int waypointBytes = 16; //action, id, x and y
+const int stringHeaderBytes = 4; //std_msgs/String length prefix
+
+int main(int argc, char** argv)
+{
+  float seconds = argc > 1 ? atof(argv[1]) : 600;
+  int swarmSizes[] = {6, 12, 24};
+
+  printf("rovers  old B/s/rover  bus B/s/rover  saving  old startup B  bus startup B  dropped  lost\n");
+
+  for (int rovers : swarmSizes)
+  {
+    mt19937 generator(rovers);
+    uniform_real_distribution<float> uniform(0.0, 1.0);
+    uniform_real_distribution<float> position(-10.0, 10.0);
+
+    vector<string> names;
+    vector<SwarmBus> buses;
+    for (int i = 0; i < rovers; i++)
+    {
+      names.push_back("rover" + to_string(i));
+      buses.push_back(SwarmBus(SwarmBus::NameHash(names.back())));
+    }
+
+    int receivers = rovers - 1;
+    long int oldBytes = 0;
+    long int busBytes = 0;
+
+    //old startup, every rover publishes its name then the comma joined list
+    long int oldStartupBytes = 0;
+    int joinedLength = 0;
+    for (const string& name : names)
+    {
+      joinedLength += name.size() + 1;
+    }
+    for (const string& name : names)
+    {
+      oldStartupBytes += (stringHeaderBytes + name.size() + SwarmBus::transportBytes) * receivers;
+      oldStartupBytes += (stringHeaderBytes + joinedLength - 1 + SwarmBus::transportBytes) * receivers;
+    }
+
+    //bus startup, every rover claims a role in its first packet
+    for (int i = 0; i < rovers; i++)
+    {
+      buses[i].ReportRole(i);
+    }
+    long int busStartupBytes = 0;
+
+    vector<SwarmState> states;
+    long int duration = seconds * 1000;
+    for (long int time = 0; time < duration; time += tickTime)
+    {
+      for (int i = 0; i < rovers; i++)
+      {
+        //the old scheme has no role claim, its pose and reports are one Waypoint each
+        if (time % poseInterval == 0)
+        {
+          Point pose = {position(generator), position(generator), 2 * (float)M_PI * uniform(generator) - (float)M_PI};
+          buses[i].ReportPose(pose);
+          oldBytes += (waypointBytes + SwarmBus::transportBytes) * receivers;
+        }
+
+        if (uniform(generator) < resourceRate * tickTime / 1e3)
+        {
+          Point cube = {position(generator), position(generator), 0};
+          buses[i].ReportResource(cube, 1 + generator() % 4);
+          oldBytes += (waypointBytes + SwarmBus::transportBytes) * receivers;
+        }
+
+        if (uniform(generator) < obstacleRate * tickTime / 1e3)
+        {
+          Point obstacle = {position(generator), position(generator), 0};
+          buses[i].ReportObstacle(obstacle, 0.5);
+          oldBytes += (waypointBytes + SwarmBus::transportBytes) * receivers;
+        }
+
+        SwarmPacket packet;
+        if (buses[i].Flush(time, packet))
+        {
+          int bytes = SwarmBus::PacketBytes(packet.reports.size()) * receivers;
+          busBytes += bytes;
+          if (time == 0)
+          {
+            busStartupBytes += bytes;
+          }
+
+          for (int j = 0; j < rovers; j++)
+          {
+            states.clear();
+            buses[j].Receive(packet, states);
+          }
+        }
+      }
+    }
+
+    int dropped = 0, lost = 0;
+    for (const SwarmBus& bus : buses)
+    {
+      dropped += bus.GetReportsDropped();
+      lost += bus.GetPacketsLost();
+    }
+
+    float oldRate = oldBytes / seconds / rovers;
+    float busRate = busBytes / seconds / rovers;
+    printf("%6d  %13.0f  %13.0f  %5.0f%%  %12ld  %13ld  %7d  %4d\n", rovers, oldRate, busRate,
+           100 * (1 - busRate / oldRate), oldStartupBytes, busStartupBytes, dropped, lost);
+  }
+
+  return 0;
+}
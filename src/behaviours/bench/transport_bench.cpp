@@ -0,0 +1,380 @@
+// Latency and delivery of swarm packets over the UDP multicast transport
+// against TCP connections between every pair of rovers, the way ROS
+// topics carry them, both on the loopback.
+//
+// Every rover sends a swarm packet of four reports at a fixed rate, with
+// the send time in front of it. On the TCP path each rover writes every
+// packet with a length prefix, like TCPROS, to one connection per other
+// rover. On the multicast path each rover sends one datagram through its
+// own SwarmTransport. All rovers run in one poll() loop so the numbers do
+// not depend on how many cores there are. The bench reports the share of
+// the packets that reached every other rover, the mean and 99th percentile
+// latency and the send calls per packet.
+//
+// A second run drops a share of the received datagrams on purpose and
+// compares a reliable channel, which asks for the missing datagrams with
+// NACKs, against an unreliable one.
+//
+// A last run restarts one rover halfway, its sequence numbers start from
+// zero again, and counts how many of its packets the other rover still
+// takes.
+//
+// usage: transport_bench [seconds]
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SwarmCodec.h"
+#include "SwarmTransport.h"
+
+using namespace std;
+
+const long int sendInterval = 20; //milliseconds between packets of one rover
+const char* group = "239.255.42.99";
+const uint16_t port = 5406;
+const int timestampBytes = 8;
+
+struct Results {
+  long int sent = 0;
+  long int expected = 0;
+  long int delivered = 0;
+  long int sends = 0; //system calls
+  vector<double> latencies; //microseconds
+  long int nacks = 0;
+  long int retransmissions = 0;
+};
+
+long int NowNanoseconds()
+{
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The payload every rover sends, a typical swarm packet behind the time.
+int MakePayload(uint32_t sender, uint16_t seq, uint8_t* buffer, int capacity)
+{
+  SwarmPacket packet;
+  packet.sender = sender;
+  packet.seq = seq;
+  packet.reports.resize(4);
+
+  long int now = NowNanoseconds();
+  memcpy(buffer, &now, timestampBytes);
+  return timestampBytes + SwarmCodec::Encode(packet, buffer + timestampBytes, capacity - timestampBytes);
+}
+
+void Received(const uint8_t* payload, Results& results)
+{
+  long int sentAt;
+  memcpy(&sentAt, payload, timestampBytes);
+  results.latencies.push_back((NowNanoseconds() - sentAt) / 1e3);
+  results.delivered++;
+}
+
+Results RunMulticast(int count, float seconds, float loss, bool reliable)
+{
+  Results results;
+  vector<SwarmTransport*> transports;
+  vector<pollfd> fds;
+  for (int i = 0; i < count; i++)
+  {
+    SwarmTransport* transport = new SwarmTransport(SwarmBus::NameHash("rover" + to_string(i)));
+    transport->SetReliable(SWARM_CHANNEL_PACKET, reliable);
+    if (!transport->Open(group, port, "127.0.0.1"))
+    {
+      exit(1);
+    }
+    if (loss > 0)
+    {
+      transport->SimulateLoss(loss, i + 1);
+    }
+    transports.push_back(transport);
+    fds.push_back(pollfd{transport->GetSocket(), POLLIN, 0});
+  }
+
+  auto handler = [&](const SwarmDatagram& datagram) {Received(datagram.data, results);};
+  long int start = NowNanoseconds();
+  long int end = start + (long int)(seconds * 1e9);
+  //stop sending a little early so the last packets and their repairs can arrive
+  long int lastSend = end - 500000000;
+  vector<long int> nextSend(count);
+  for (int i = 0; i < count; i++)
+  {
+    nextSend[i] = start + i * sendInterval * 1000000 / count;
+  }
+
+  long int now;
+  while ((now = NowNanoseconds()) < end)
+  {
+    long int due = *min_element(nextSend.begin(), nextSend.end());
+    poll(fds.data(), fds.size(), max(0L, min(due - now, end - now) / 1000000));
+
+    long int time = (NowNanoseconds() - start) / 1000000;
+    for (int i = 0; i < count; i++)
+    {
+      transports[i]->Poll(time, handler);
+    }
+
+    now = NowNanoseconds();
+    for (int i = 0; i < count; i++)
+    {
+      if (now >= nextSend[i] && now < lastSend)
+      {
+        int length = MakePayload(i, results.sent, transports[i]->GetSendBuffer(), SwarmTransport::maxPayloadBytes);
+        transports[i]->Send(SWARM_CHANNEL_PACKET, length);
+        results.sent++;
+        results.expected += count - 1;
+        results.sends++;
+        nextSend[i] += sendInterval * 1000000;
+      }
+    }
+  }
+
+  for (SwarmTransport* transport : transports)
+  {
+    results.nacks += transport->GetNacksSent();
+    results.retransmissions += transport->GetRetransmissions();
+    delete transport;
+  }
+  return results;
+}
+
+// Rover 0 sends packets to rover 1, is created again as if its node had
+// restarted and sends as many again. Returns the share rover 1 delivered.
+double RunRestart(int packets)
+{
+  SwarmTransport receiver(SwarmBus::NameHash("rover1"));
+  receiver.SetReliable(SWARM_CHANNEL_PACKET, true);
+  if (!receiver.Open(group, port, "127.0.0.1"))
+  {
+    exit(1);
+  }
+
+  Results results;
+  auto handler = [&](const SwarmDatagram& datagram) {Received(datagram.data, results);};
+  for (int run = 0; run < 2; run++)
+  {
+    SwarmTransport sender(SwarmBus::NameHash("rover0"));
+    sender.SetReliable(SWARM_CHANNEL_PACKET, true);
+    if (!sender.Open(group, port, "127.0.0.1"))
+    {
+      exit(1);
+    }
+    for (int i = 0; i < packets; i++)
+    {
+      int length = MakePayload(0, i, sender.GetSendBuffer(), SwarmTransport::maxPayloadBytes);
+      sender.Send(SWARM_CHANNEL_PACKET, length);
+      usleep(1000);
+      receiver.Poll(run * packets + i, handler);
+    }
+  }
+  usleep(10000);
+  receiver.Poll(2 * packets, handler);
+
+  printf("restarted rover: %ld of %d packets delivered, %ld duplicates, %ld restarts noticed\n",
+         results.delivered, 2 * packets, receiver.GetDuplicates(), receiver.GetRestarts());
+  return (double)results.delivered / (2 * packets);
+}
+
+// One TCP connection between every pair of rovers, both directions on it.
+struct Connection {
+  int fd;
+  int rover;
+  vector<uint8_t> pending; //bytes read but not yet a whole message
+};
+
+Results RunTcp(int count, float seconds)
+{
+  Results results;
+
+  vector<int> listeners;
+  vector<uint16_t> ports;
+  for (int i = 0; i < count; i++)
+  {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    bind(fd, (sockaddr*)&address, sizeof(address));
+    listen(fd, count);
+    socklen_t length = sizeof(address);
+    getsockname(fd, (sockaddr*)&address, &length);
+    listeners.push_back(fd);
+    ports.push_back(ntohs(address.sin_port));
+  }
+
+  //outgoing[i] holds the connections rover i writes to
+  vector<vector<int>> outgoing(count);
+  vector<Connection> connections;
+  for (int i = 0; i < count; i++)
+  {
+    for (int j = i + 1; j < count; j++)
+    {
+      int fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      address.sin_port = htons(ports[j]);
+      connect(fd, (sockaddr*)&address, sizeof(address));
+      int accepted = accept(listeners[j], nullptr, nullptr);
+
+      fcntl(fd, F_SETFL, O_NONBLOCK);
+      fcntl(accepted, F_SETFL, O_NONBLOCK);
+      outgoing[i].push_back(fd);
+      outgoing[j].push_back(accepted);
+      connections.push_back(Connection{fd, i, vector<uint8_t>()});
+      connections.push_back(Connection{accepted, j, vector<uint8_t>()});
+    }
+  }
+
+  vector<pollfd> fds;
+  for (const Connection& connection : connections)
+  {
+    fds.push_back(pollfd{connection.fd, POLLIN, 0});
+  }
+
+  long int start = NowNanoseconds();
+  long int end = start + (long int)(seconds * 1e9);
+  long int lastSend = end - 500000000;
+  vector<long int> nextSend(count);
+  for (int i = 0; i < count; i++)
+  {
+    nextSend[i] = start + i * sendInterval * 1000000 / count;
+  }
+
+  uint8_t message[SwarmTransport::maxDatagramBytes];
+  uint8_t buffer[65536];
+  long int now;
+  while ((now = NowNanoseconds()) < end)
+  {
+    long int due = *min_element(nextSend.begin(), nextSend.end());
+    poll(fds.data(), fds.size(), max(0L, min(due - now, end - now) / 1000000));
+
+    for (int k = 0; k < fds.size(); k++)
+    {
+      if (!(fds[k].revents & POLLIN))
+      {
+        continue;
+      }
+      Connection& connection = connections[k];
+      int got = read(connection.fd, buffer, sizeof(buffer));
+      if (got <= 0)
+      {
+        continue;
+      }
+      connection.pending.insert(connection.pending.end(), buffer, buffer + got);
+
+      //length prefixed messages
+      int used = 0;
+      while (connection.pending.size() - used >= 4)
+      {
+        uint32_t length;
+        memcpy(&length, &connection.pending[used], 4);
+        if (connection.pending.size() - used - 4 < length)
+        {
+          break;
+        }
+        Received(&connection.pending[used + 4], results);
+        used += 4 + length;
+      }
+      connection.pending.erase(connection.pending.begin(), connection.pending.begin() + used);
+    }
+
+    now = NowNanoseconds();
+    for (int i = 0; i < count; i++)
+    {
+      if (now >= nextSend[i] && now < lastSend)
+      {
+        uint32_t length = MakePayload(i, results.sent, message + 4, sizeof(message) - 4);
+        memcpy(message, &length, 4);
+        for (int fd : outgoing[i])
+        {
+          write(fd, message, length + 4);
+          results.sends++;
+        }
+        results.sent++;
+        results.expected += count - 1;
+        nextSend[i] += sendInterval * 1000000;
+      }
+    }
+  }
+
+  for (const Connection& connection : connections)
+  {
+    close(connection.fd);
+  }
+  for (int fd : listeners)
+  {
+    close(fd);
+  }
+  return results;
+}
+
+double Percentile(vector<double> values, double share)
+{
+  if (values.empty())
+  {
+    return 0;
+  }
+  sort(values.begin(), values.end());
+  return values[min(values.size() - 1, (size_t)(share * values.size()))];
+}
+
+double Mean(const vector<double>& values)
+{
+  double sum = 0;
+  for (double value : values)
+  {
+    sum += value;
+  }
+  return values.empty() ? 0 : sum / values.size();
+}
+
+int main(int argc, char** argv)
+{
+  float seconds = argc > 1 ? atof(argv[1]) : 3;
+  int swarmSizes[] = {3, 6, 12, 24};
+
+  printf("each rover sends a packet every %ld ms for %.0f s on the loopback\n", sendInterval, seconds);
+  printf("rovers | tcp pairs: delivered  mean us  p99 us  sends/packet | multicast: delivered  mean us  p99 us  sends/packet\n");
+  for (int count : swarmSizes)
+  {
+    Results tcp = RunTcp(count, seconds);
+    Results udp = RunMulticast(count, seconds, 0, false);
+    printf("%6d | %20.1f%%  %7.0f  %6.0f  %15.1f | %19.1f%%  %7.0f  %6.0f  %15.1f\n", count,
+           100.0 * tcp.delivered / tcp.expected, Mean(tcp.latencies), Percentile(tcp.latencies, 0.99), (double)tcp.sends / tcp.sent,
+           100.0 * udp.delivered / udp.expected, Mean(udp.latencies), Percentile(udp.latencies, 0.99), (double)udp.sends / udp.sent);
+  }
+
+  printf("\n12 rovers, received datagrams dropped on purpose\n");
+  printf("  loss | unreliable: delivered | reliable: delivered  p99 us  nacks  retransmissions\n");
+  float losses[] = {0.05, 0.1, 0.3};
+  for (float loss : losses)
+  {
+    Results unreliable = RunMulticast(12, seconds, loss, false);
+    Results reliable = RunMulticast(12, seconds, loss, true);
+    printf("%5.0f%% | %21.1f%% | %18.1f%%  %6.0f  %5ld  %15ld\n", loss * 100,
+           100.0 * unreliable.delivered / unreliable.expected,
+           100.0 * reliable.delivered / reliable.expected, Percentile(reliable.latencies, 0.99), reliable.nacks, reliable.retransmissions);
+  }
+
+  printf("\n");
+  RunRestart(100);
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include "CoverageMap.h"
+
+#include <algorithm> // For min and max
+#include <cmath> // For trig functions
+#include <limits> // For numeric limits
+
+constexpr float CoverageMap::cellSize;
+
+CoverageMap::CoverageMap()
+{
+  bits.assign((cellsPerSide * cellsPerSide + 63) / 64, 0);
+  frontierPosition.assign(cellsPerSide * cellsPerSide, -1);
+}
+
+void CoverageMap::SetOrigin(Point origin)
+{
+  this->origin = origin;
+  hasOrigin = true;
+
+  bits.assign(bits.size(), 0);
+  frontierPosition.assign(frontierPosition.size(), -1);
+  frontier.clear();
+
+  //cubes are never left in the nest so don't send the rover into it
+  for (float x = -nestRadius; x <= nestRadius; x += cellSize)
+  {
+    for (float y = -nestRadius; y <= nestRadius; y += cellSize)
+    {
+      int index;
+      if (hypot(x, y) <= nestRadius && ToIndex(origin.x + x, origin.y + y, index))
+      {
+        SetSeen(index);
+      }
+    }
+  }
+
+  //the nest doesn't count as searched ground
+  coveredCells = 0;
+}
+
+void CoverageMap::MarkFootprint(Point pose)
+{
+  if (!hasOrigin)
+  {
+    return;
+  }
+
+  float c = cos(pose.theta);
+  float s = sin(pose.theta);
+  float farHalfWidth = footprintFar * tan(footprintHalfFOV);
+
+  //bounding box of the footprint wedge
+  float cornersX[3] = {footprintNear, footprintFar, footprintFar};
+  float cornersY[3] = {0, farHalfWidth, -farHalfWidth};
+  float minX = pose.x, maxX = pose.x, minY = pose.y, maxY = pose.y;
+  for (int i = 0; i < 3; i++)
+  {
+    float x = pose.x + c * cornersX[i] - s * cornersY[i];
+    float y = pose.y + s * cornersX[i] + c * cornersY[i];
+    minX = fmin(minX, x);
+    maxX = fmax(maxX, x);
+    minY = fmin(minY, y);
+    maxY = fmax(maxY, y);
+  }
+
+  float half = cellsPerSide * cellSize / 2;
+  int minColumn = max(0, (int)floor((minX - origin.x + half) / cellSize));
+  int maxColumn = min(cellsPerSide - 1, (int)floor((maxX - origin.x + half) / cellSize));
+  int minRow = max(0, (int)floor((minY - origin.y + half) / cellSize));
+  int maxRow = min(cellsPerSide - 1, (int)floor((maxY - origin.y + half) / cellSize));
+
+  for (int row = minRow; row <= maxRow; row++)
+  {
+    for (int column = minColumn; column <= maxColumn; column++)
+    {
+      //cell center in the rover frame
+      float dx = origin.x - half + (column + 0.5) * cellSize - pose.x;
+      float dy = origin.y - half + (row + 0.5) * cellSize - pose.y;
+      float forward = c * dx + s * dy;
+      float lateral = -s * dx + c * dy;
+
+      if (forward < footprintNear || forward > footprintFar || fabs(lateral) > forward * tan(footprintHalfFOV))
+      {
+        continue;
+      }
+
+      SetSeen(row * cellsPerSide + column);
+    }
+  }
+}
+
+void CoverageMap::MarkSeen(Point point, float radius)
+{
+  if (!hasOrigin)
+  {
+    return;
+  }
+
+  int covered = coveredCells;
+  for (float x = -radius; x <= radius; x += cellSize)
+  {
+    for (float y = -radius; y <= radius; y += cellSize)
+    {
+      int index;
+      if (hypot(x, y) <= radius && ToIndex(point.x + x, point.y + y, index))
+      {
+        SetSeen(index);
+      }
+    }
+  }
+
+  //given up on, not searched
+  coveredCells = covered;
+}
+
+bool CoverageMap::NearestFrontier(Point from, float minDistance, Point& nearest) const
+{
+  float closest = numeric_limits<float>::max();
+  bool found = false;
+  float half = cellsPerSide * cellSize / 2;
+
+  for (int index : frontier)
+  {
+    float x = origin.x - half + (index % cellsPerSide + 0.5) * cellSize;
+    float y = origin.y - half + (index / cellsPerSide + 0.5) * cellSize;
+    float distance = hypot(x - from.x, y - from.y);
+
+    if (distance >= minDistance && distance < closest)
+    {
+      closest = distance;
+      nearest.x = x;
+      nearest.y = y;
+      nearest.theta = atan2(y - from.y, x - from.x);
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+void CoverageMap::SetSeen(int index)
+{
+  if (IsSeen(index))
+  {
+    return;
+  }
+
+  bits[index >> 6] |= (uint64_t)1 << (index & 63);
+  coveredCells++;
+  RemoveFrontier(index);
+
+  //unseen neighbours of a seen cell are on the frontier
+  int row = index / cellsPerSide;
+  int column = index % cellsPerSide;
+  if (column > 0 && !IsSeen(index - 1)) AddFrontier(index - 1);
+  if (column < cellsPerSide - 1 && !IsSeen(index + 1)) AddFrontier(index + 1);
+  if (row > 0 && !IsSeen(index - cellsPerSide)) AddFrontier(index - cellsPerSide);
+  if (row < cellsPerSide - 1 && !IsSeen(index + cellsPerSide)) AddFrontier(index + cellsPerSide);
+}
+
+void CoverageMap::AddFrontier(int index)
+{
+  if (frontierPosition[index] >= 0)
+  {
+    return;
+  }
+
+  frontierPosition[index] = frontier.size();
+  frontier.push_back(index);
+}
+
+void CoverageMap::RemoveFrontier(int index)
+{
+  int position = frontierPosition[index];
+  if (position < 0)
+  {
+    return;
+  }
+
+  //move the last frontier cell into the hole
+  int last = frontier.back();
+  frontier[position] = last;
+  frontierPosition[last] = position;
+  frontier.pop_back();
+  frontierPosition[index] = -1;
+}
+
+bool CoverageMap::ToIndex(float x, float y, int& index) const
+{
+  float half = cellsPerSide * cellSize / 2;
+  int column = (int)floor((x - origin.x + half) / cellSize);
+  int row = (int)floor((y - origin.y + half) / cellSize);
+
+  if (column < 0 || column >= cellsPerSide || row < 0 || row >= cellsPerSide)
+  {
+    return false;
+  }
+
+  index = row * cellsPerSide + column;
+  return true;
+}
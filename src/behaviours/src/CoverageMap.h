@@ -0,0 +1,75 @@
+#ifndef COVERAGEMAP_H
+#define COVERAGEMAP_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Bitmap of the ground the camera has already looked at, in the map frame.
+//
+// The arena around the nest is split into cells the size of a fraction of
+// the camera footprint and each cell is one bit, so the whole arena fits
+// in a couple of kilobytes. Each pose update marks the cells under the
+// camera footprint. The frontier (unseen cells next to seen ones) is kept
+// up to date as cells are marked so picking the next place to search does
+// not need to scan the bitmap.
+class CoverageMap
+{
+public:
+  CoverageMap();
+
+  // Clears the map and centers it on the given map frame point, normally
+  // the nest, which is marked as seen. Nothing is marked until an origin
+  // has been set.
+  void SetOrigin(Point origin);
+  bool HasOrigin() const {return hasOrigin;}
+
+  // Marks the cells under the camera footprint at the given map frame pose.
+  void MarkFootprint(Point pose);
+
+  // Marks the cells within radius of the point as seen without looking at
+  // them, used to give up on ground the rover can't reach, such as the
+  // frontier behind a wall. They don't count as covered.
+  void MarkSeen(Point point, float radius);
+
+  // Nearest frontier cell center to the given point that is at least
+  // minDistance away. Returns false if there is no frontier.
+  bool NearestFrontier(Point from, float minDistance, Point& frontier) const;
+
+  float GetCoveredArea() const {return coveredCells * cellSize * cellSize;} //square meters
+  int GetFrontierSize() const {return frontier.size();}
+
+  static constexpr float cellSize = 0.25; //meters
+  static const int cellsPerSide = 96; //24m square around the origin
+
+private:
+
+  bool IsSeen(int index) const {return (bits[index >> 6] >> (index & 63)) & 1;}
+  void SetSeen(int index);
+  void AddFrontier(int index);
+  void RemoveFrontier(int index);
+  bool ToIndex(float x, float y, int& index) const;
+
+  //camera footprint on the ground relative to the rover center
+  const float footprintNear = 0.12; //meters ahead
+  const float footprintFar = 0.77; //meters ahead
+  const float footprintHalfFOV = 0.5; //radians
+  const float nestRadius = 0.75; //meters around the origin that are never searched
+
+  bool hasOrigin = false;
+  Point origin;
+
+  vector<uint64_t> bits; //one bit per cell, row major
+  int coveredCells = 0;
+
+  // frontier as a dense list of cell indexes and the position of each
+  // cell in that list (-1 if not on the frontier) for constant time
+  // insertion and removal
+  vector<int> frontier;
+  vector<int> frontierPosition;
+};
+
+#endif // COVERAGEMAP_H
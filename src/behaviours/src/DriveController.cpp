@@ -5,16 +5,28 @@
 
 DriveController::DriveController() {
 
-  fastVelPID.SetConfiguration(fastVelConfig());
-  fastYawPID.SetConfiguration(fastYawConfig());
+  applyParams(BehaviourParams());
+  pursuitYawPID.SetConfiguration(pursuitYawConfig());
 
-  slowVelPID.SetConfiguration(slowVelConfig());
-  slowYawPID.SetConfiguration(slowYawConfig());
+}
+
+void DriveController::applyParams(const BehaviourParams& params)
+{
+  paramsVersion = params.version;
+  searchVelocity = params.searchVelocity;
+  waypointTolerance = params.waypointTolerance;
+
+  //only the configuration changes, the integral and error history are kept
+  fastVelPID.SetConfiguration(fastVelConfig(params.fastVel));
+  fastYawPID.SetConfiguration(fastYawConfig(params.fastYaw));
 
-  constVelPID.SetConfiguration(constVelConfig());
-  constYawPID.SetConfiguration(constYawConfig());
+  slowVelPID.SetConfiguration(slowVelConfig(params.slowVel));
+  slowYawPID.SetConfiguration(slowYawConfig(params.slowYaw));
 
+  constVelPID.SetConfiguration(constVelConfig(params.constVel));
+  constYawPID.SetConfiguration(constYawConfig(params.constYaw));
 
+  pursuitVelPID.SetConfiguration(pursuitVelConfig(params.fastVel));
 }
 
 DriveController::~DriveController() {}
@@ -22,8 +34,10 @@ DriveController::~DriveController() {}
 void DriveController::Reset()
 {
   waypoints.clear();
+  clearPlan();
 
-  if (stateMachineState == STATE_MACHINE_ROTATE || stateMachineState == STATE_MACHINE_SKID_STEER)
+  if (stateMachineState == STATE_MACHINE_ROTATE || stateMachineState == STATE_MACHINE_SKID_STEER
+      || stateMachineState == STATE_MACHINE_PURE_PURSUIT)
   {
     stateMachineState = STATE_MACHINE_WAYPOINTS;
   }
@@ -32,6 +46,11 @@ void DriveController::Reset()
 Result DriveController::DoWork()
 {
 
+  if (params != nullptr && params->Get()->version != paramsVersion)
+  {
+    applyParams(*params->Get());
+  }
+
   ///WARNING waypoint input must use FAST_PID at this point in time failure to set fast pid will result in no movment
 
   if(result.type == behavior)
@@ -67,6 +86,9 @@ Result DriveController::DoWork()
 
   }
 
+  //keep the route around obstacles up to date with what the sonars see
+  repairPlan();
+
   switch(stateMachineState)
   {
 
@@ -80,22 +102,6 @@ Result DriveController::DoWork()
     break;
   }
 
-  //getCurrLocAVG();
-
-  /*
-  static bool averaged = false;
-  averaged = DriveController::CNMCurrentLocationAVG();
-
-  if(averaged){
-  cout << "AVERAGED - Averaged Current location complete" << endl;
-  }
-
-  if(averaged)
-  {
-*/
-
-
-
 case STATE_MACHINE_WAYPOINTS:
 {
 
@@ -111,6 +117,13 @@ case STATE_MACHINE_WAYPOINTS:
       //if too close remove it
       waypoints.pop_back();
     }
+    else if (waypointOccupied(waypoints.back()) && moveWaypointClear(waypoints.back()))
+    {
+      //the obstacle map says this waypoint can't be reached, it was moved
+      //next to the obstacle instead of dropped since it may be the nest or a
+      //lane entry, check the distance to it again
+      cout << "DRIVE - moved waypoint off a known obstacle to x: " << waypoints.back().x << " y: " << waypoints.back().y << endl;
+    }
     else
     {
       //this waypoint is far enough to be worth driving to
@@ -118,6 +131,12 @@ case STATE_MACHINE_WAYPOINTS:
     }
   }
 
+  //the planned goal was reached or dropped
+  if (planGoalIndex >= (int)waypoints.size())
+  {
+    clearPlan();
+  }
+
   //if we are out of waypoints then interupt and return to logic controller
   if (waypoints.empty())
   {
@@ -128,11 +147,22 @@ case STATE_MACHINE_WAYPOINTS:
   }
   else
   {
+    //route around known obstacles if the way to the next waypoint is blocked
+    planToWaypoint();
+
     //select setpoint for heading and begin driving to the next waypoint
     stateMachineState = STATE_MACHINE_ROTATE;
     waypoints.back().theta = atan2(waypoints.back().y - currentLocation.y, waypoints.back().x - currentLocation.x);
     result.pd.setPointYaw = waypoints.back().theta;
 
+    //roughly facing the waypoint already, blend into it without a pivot
+    if (purePursuit && fabs(angles::shortest_angular_distance(currentLocation.theta, waypoints.back().theta)) < pursuitMaxHeadingError)
+    {
+      stateMachineState = STATE_MACHINE_PURE_PURSUIT;
+      followPath();
+      break;
+    }
+
     //cout << "**************************************************************************" << endl; //DEBUGGING CODE
     //cout << "Waypoint x : " << waypoints.back().x << " y : " << waypoints.back().y << endl; //DEBUGGING CODE
     //fall through on purpose
@@ -172,6 +202,18 @@ case STATE_MACHINE_ROTATE:
   }
   else
   {
+    //heading error at the moment the rotation is considered done, the pose is
+    //already extrapolated to the control tick so this is the error we act on
+    cout << "DRIVE - rotate complete, heading error at decision: " << errorYaw
+         << " rad, angular velocity: " << angularVelocity << " rad/s" << endl;
+
+    if (purePursuit)
+    {
+      stateMachineState = STATE_MACHINE_PURE_PURSUIT;
+      followPath();
+      break;
+    }
+
     //move to differential drive step
     stateMachineState = STATE_MACHINE_SKID_STEER;
 
@@ -199,11 +241,19 @@ case STATE_MACHINE_SKID_STEER:
   if (fabs(errorYaw) < M_PI_2 &&  distance > waypointTolerance)
   {
     // drive and turn simultaniously
-    result.pd.setPointVel = searchVelocity;
+    float velocity = obstacleSpeedLimit(searchVelocity, waypoints.back().theta, distance);
+
+    float heading = waypoints.back().theta;
+    if (avoidRovers(velocity, heading))
+    {
+      errorYaw = angles::shortest_angular_distance(currentLocation.theta, heading);
+    }
+
+    result.pd.setPointVel = velocity;
     if (result.PIDMode == FAST_PID)
     {
       //cout << "linear velocity:  " << linearVelocity << endl; //DEBUGGING CODE
-      fastPID((searchVelocity-linearVelocity) ,errorYaw, result.pd.setPointVel, result.pd.setPointYaw);
+      fastPID((velocity-linearVelocity) ,errorYaw, result.pd.setPointVel, result.pd.setPointYaw);
     }
   }
   else {
@@ -218,6 +268,12 @@ case STATE_MACHINE_SKID_STEER:
   break;
 }
 
+case STATE_MACHINE_PURE_PURSUIT:
+{
+  followPath();
+  break;
+}
+
 default:
 {
   break;
@@ -264,10 +320,19 @@ void DriveController::ProcessData()
 
     if(result.reset) {
       waypoints.clear();
+      clearPlan();
     }
 
     //add waypoints onto stack and change state to start following them
     if (!result.wpts.waypoints.empty()) {
+
+      //new waypoints go on top of the stack, drop the route planned below them
+      if (planGoalIndex >= 0)
+      {
+        waypoints.resize(min((int)waypoints.size(), planGoalIndex + 1));
+        clearPlan();
+      }
+
       waypoints.insert(waypoints.end(),result.wpts.waypoints.begin(), result.wpts.waypoints.end());
       stateMachineState = STATE_MACHINE_WAYPOINTS;
     }
@@ -367,22 +432,313 @@ void DriveController::constPID(float erroVel,float constAngularError, float setP
 }
 
 
+void DriveController::pursuitPID(float errorVel,float errorAngular, float setPointVel, float setPointAngular)
+{
+  //velocity as in fast PID, the yaw PID tracks the angular rate of the pursuit arc
+  float velOut = pursuitVelPID.PIDOut(errorVel, setPointVel);
+  float yawOut = pursuitYawPID.PIDOut(errorAngular, setPointAngular);
+
+  int left = velOut - yawOut;
+  int right = velOut + yawOut;
+
+  int sat = 180;
+  if (left  >  sat) {left  =  sat;}
+  if (left  < -sat) {left  = -sat;}
+  if (right >  sat) {right =  sat;}
+  if (right < -sat) {right = -sat;}
+
+  this->left = left;
+  this->right = right;
+}
+
+
 void DriveController::SetVelocityData(float linearVelocity,float angularVelocity)
 {
   this->linearVelocity = linearVelocity;
   this->angularVelocity = angularVelocity;
 }
 
+// Pure pursuit over the whole waypoint stack. The rover steers on the arc
+// through a look-ahead point on the path, so intermediate waypoints are
+// passed without stopping. The speed is limited by the curvature of that
+// arc and by the distance left to the last waypoint.
+void DriveController::followPath()
+{
+  if (waypoints.empty())
+  {
+    stateMachineState = STATE_MACHINE_WAYPOINTS;
+    return;
+  }
+
+  float lookAhead = fmax(minLookAhead, fmin(maxLookAhead, minLookAhead + lookAheadGain * fabs(linearVelocity)));
+
+  //intermediate waypoints inside the look-ahead circle are done
+  while (waypoints.size() > 1 && hypot(waypoints.back().x - currentLocation.x, waypoints.back().y - currentLocation.y) < lookAhead)
+  {
+    waypoints.pop_back();
+  }
+
+  //passed the goal of the plan
+  if (planGoalIndex >= (int)waypoints.size())
+  {
+    clearPlan();
+  }
+
+  float distance = hypot(waypoints.back().x - currentLocation.x, waypoints.back().y - currentLocation.y);
+  if (distance < waypointTolerance)
+  {
+    //stop and let the waypoint state pop it
+    left = 0.0;
+    right = 0.0;
+    stateMachineState = STATE_MACHINE_WAYPOINTS;
+    return;
+  }
+
+  Point target = lookAheadPoint(lookAhead);
+
+  //look-ahead point in the rover frame
+  float dx = target.x - currentLocation.x;
+  float dy = target.y - currentLocation.y;
+  float forward = cos(currentLocation.theta) * dx + sin(currentLocation.theta) * dy;
+  float lateral = -sin(currentLocation.theta) * dx + cos(currentLocation.theta) * dy;
+
+  if (forward <= 0)
+  {
+    //the path is behind the rover, pivot towards it first
+    left = 0.0;
+    right = 0.0;
+    stateMachineState = STATE_MACHINE_ROTATE;
+    return;
+  }
+
+  //arc through the rover and the look-ahead point
+  float curvature = 2 * lateral / (forward * forward + lateral * lateral);
+
+  float velocity = searchVelocity;
+  if (fabs(curvature) > 0.001)
+  {
+    velocity = fmin(velocity, sqrt(maxLateralAcceleration / fabs(curvature)));
+  }
+  velocity = fmin(velocity, sqrt(2 * pursuitDeceleration * remainingPathLength()));
+  velocity = obstacleSpeedLimit(velocity, atan2(dy, dx), hypot(dx, dy));
+  velocity = fmax(velocity, minPursuitVelocity);
+
+  float angular = fmax(-maxPursuitAngular, fmin(maxPursuitAngular, velocity * curvature));
+
+  float heading = atan2(dy, dx);
+  if (avoidRovers(velocity, heading))
+  {
+    //arc onto the heading that keeps clear, turning hard if it is behind
+    float errorHeading = angles::shortest_angular_distance(currentLocation.theta, heading);
+    curvature = fabs(errorHeading) < M_PI_2 ? 2 * sin(errorHeading) / lookAhead : copysign(2 / lookAhead, errorHeading);
+    angular = fmax(-maxPursuitAngular, fmin(maxPursuitAngular, fmax(velocity, minPursuitVelocity) * curvature));
+  }
+
+  //the set points only feed forward, round them so the integrals are not reset every tick
+  float setPointVel = round(velocity / 0.05) * 0.05;
+  float setPointAngular = round(angular / 0.1) * 0.1;
+
+  result.pd.setPointVel = velocity;
+  pursuitPID(velocity - linearVelocity, angular - angularVelocity, setPointVel, setPointAngular);
+}
+
+Point DriveController::lookAheadPoint(float lookAhead)
+{
+  //walk the path from the rover until it leaves the look-ahead circle
+  Point from = currentLocation;
+  for (int i = waypoints.size() - 1; i >= 0; i--)
+  {
+    Point to = waypoints[i];
+    float endDistance = hypot(to.x - currentLocation.x, to.y - currentLocation.y);
+    if (endDistance >= lookAhead)
+    {
+      //intersection of the segment with the circle, the root further along the segment
+      float sx = to.x - from.x;
+      float sy = to.y - from.y;
+      float fx = from.x - currentLocation.x;
+      float fy = from.y - currentLocation.y;
+      float a = sx * sx + sy * sy;
+      float b = 2 * (fx * sx + fy * sy);
+      float c = fx * fx + fy * fy - lookAhead * lookAhead;
+      float discriminant = b * b - 4 * a * c;
+      float t = a > 0 && discriminant >= 0 ? (-b + sqrt(discriminant)) / (2 * a) : 1;
+      t = fmax(0, fmin(1, t));
+
+      Point target;
+      target.x = from.x + t * sx;
+      target.y = from.y + t * sy;
+      target.theta = 0;
+      return target;
+    }
+    from = to;
+  }
+
+  //the whole path is inside the circle, aim at its end
+  return waypoints.front();
+}
+
+float DriveController::remainingPathLength()
+{
+  float length = 0;
+  Point from = currentLocation;
+  for (int i = waypoints.size() - 1; i >= 0; i--)
+  {
+    length += hypot(waypoints[i].x - from.x, waypoints[i].y - from.y);
+    from = waypoints[i];
+  }
+  return length;
+}
+
+float DriveController::obstacleSpeedLimit(float velocity, float heading, float distance)
+{
+  //look ahead along the path and slow down if the map has an obstacle on it
+  if (occupancyGrid != nullptr)
+  {
+    Point ahead;
+    float lookAhead = fmin(lookAheadDistance, distance);
+    ahead.x = currentLocation.x + lookAhead * cos(heading);
+    ahead.y = currentLocation.y + lookAhead * sin(heading);
+    if (!occupancyGrid->IsPathClear(currentLocation, ahead, lookAheadClearance))
+    {
+      velocity = fmin(velocity, searchVelocity * blockedVelocityScale);
+    }
+  }
+
+  return velocity;
+}
+
+bool DriveController::avoidRovers(float& velocity, float& heading)
+{
+  if (avoidance == nullptr)
+  {
+    return false;
+  }
+
+  float vx = velocity * cos(heading);
+  float vy = velocity * sin(heading);
+  if (!avoidance->Avoid(currentLocation, linearVelocity, searchVelocity, vx, vy))
+  {
+    return false;
+  }
+
+  //a skid steer only drives along its heading, the sideways part has to wait for the turn
+  heading = atan2(vy, vx);
+  velocity = hypot(vx, vy) * fmax(0.0, cos(angles::shortest_angular_distance(currentLocation.theta, heading)));
+  return true;
+}
+
+bool DriveController::GetCurrentWaypoint(Point& waypoint) const
+{
+  if (waypoints.empty())
+  {
+    return false;
+  }
+
+  waypoint = waypoints.back();
+  return true;
+}
+
+void DriveController::planToWaypoint()
+{
+  if (pathPlanner == nullptr || occupancyGrid == nullptr || planGoalIndex >= 0)
+  {
+    return;
+  }
+
+  if (occupancyGrid->IsPathClear(currentLocation, waypoints.back(), planClearance))
+  {
+    return;
+  }
+
+  if (pathPlanner->Plan(currentLocation, waypoints.back()))
+  {
+    planGoalIndex = waypoints.size() - 1;
+    pushPlannedWaypoints();
+  }
+}
 
+void DriveController::repairPlan()
+{
+  if (planGoalIndex < 0 || !pathPlanner->HasPendingChanges())
+  {
+    return;
+  }
 
+  if (pathPlanner->Repair(currentLocation))
+  {
+    pushPlannedWaypoints();
+  }
+  else
+  {
+    //no way around, fall back to driving straight and let the obstacle controller handle it
+    waypoints.resize(min((int)waypoints.size(), planGoalIndex + 1));
+    clearPlan();
+  }
+}
 
-PIDConfig DriveController::fastVelConfig()
+void DriveController::pushPlannedWaypoints()
+{
+  waypoints.resize(planGoalIndex + 1);
+
+  //waypoints is a stack so the first waypoint to drive to goes on last
+  const vector<Point>& planned = pathPlanner->GetWaypoints();
+  waypoints.insert(waypoints.end(), planned.rbegin(), planned.rend());
+}
+
+void DriveController::clearPlan()
+{
+  planGoalIndex = -1;
+  if (pathPlanner != nullptr)
+  {
+    pathPlanner->Clear();
+  }
+}
+
+bool DriveController::waypointOccupied(Point waypoint)
+{
+  if (occupancyGrid == nullptr)
+  {
+    return false;
+  }
+
+  return occupancyGrid->IsOccupiedNear(waypoint.x, waypoint.y, waypointClearance);
+}
+
+bool DriveController::moveWaypointClear(Point& waypoint)
+{
+  //rings of growing radius, each starting on the side the rover comes from
+  float towardsRover = atan2(currentLocation.y - waypoint.y, currentLocation.x - waypoint.x);
+  for (float radius = OccupancyGrid::cellSize; radius <= maxWaypointShift + 1e-3; radius += OccupancyGrid::cellSize)
+  {
+    int steps = max(8, (int)ceil(2 * M_PI * radius / OccupancyGrid::cellSize));
+    for (int i = 0; i < steps; i++)
+    {
+      //alternate sides so the closest angle to the rover comes first
+      float angle = towardsRover + ((i + 1) / 2) * (i % 2 == 0 ? 1 : -1) * 2 * M_PI / steps;
+      Point moved = waypoint;
+      moved.x += radius * cos(angle);
+      moved.y += radius * sin(angle);
+      if (!waypointOccupied(moved))
+      {
+        waypoint = moved;
+        return true;
+      }
+    }
+  }
+
+  //enclosed, drive to it anyway and leave it to the obstacle controller
+  return false;
+}
+
+
+
+
+PIDConfig DriveController::fastVelConfig(PIDGains gains)
 {
   PIDConfig config;
 
-  config.Kp = 60; //proportional constant
-  config.Ki = 10; //integral constant
-  config.Kd = 2; //derivative constant
+  config.Kp = gains.Kp; //proportional constant
+  config.Ki = gains.Ki; //integral constant
   config.satUpper = 255; //upper limit for PID output
   config.satLower = -255; //lower limit for PID output
   config.antiWindup = config.satUpper; //prevent integral from acruing error untill proportional output drops below a certain limit
@@ -399,12 +755,11 @@ PIDConfig DriveController::fastVelConfig()
 
 }
 
-PIDConfig DriveController::fastYawConfig() {
+PIDConfig DriveController::fastYawConfig(PIDGains gains) {
   PIDConfig config;
 
-  config.Kp = 60;
-  config.Ki = 15;
-  config.Kd = 5;
+  config.Kp = gains.Kp;
+  config.Ki = gains.Ki;
   config.satUpper = 255;
   config.satLower = -255;
   config.antiWindup = config.satUpper/6;
@@ -421,12 +776,11 @@ PIDConfig DriveController::fastYawConfig() {
 
 }
 
-PIDConfig DriveController::slowVelConfig() {
+PIDConfig DriveController::slowVelConfig(PIDGains gains) {
   PIDConfig config;
 
-  config.Kp = 100;
-  config.Ki = 8;
-  config.Kd = 1.1;
+  config.Kp = gains.Kp;
+  config.Ki = gains.Ki;
   config.satUpper = 255;
   config.satLower = -255;
   config.antiWindup = config.satUpper/2;
@@ -443,12 +797,11 @@ PIDConfig DriveController::slowVelConfig() {
 
 }
 
-PIDConfig DriveController::slowYawConfig() {
+PIDConfig DriveController::slowYawConfig(PIDGains gains) {
   PIDConfig config;
 
-  config.Kp = 70;
-  config.Ki = 16;
-  config.Kd = 10;
+  config.Kp = gains.Kp;
+  config.Ki = gains.Ki;
   config.satUpper = 255;
   config.satLower = -255;
   config.antiWindup = config.satUpper/4;
@@ -465,12 +818,11 @@ PIDConfig DriveController::slowYawConfig() {
 
 }
 
-PIDConfig DriveController::constVelConfig() {
+PIDConfig DriveController::constVelConfig(PIDGains gains) {
   PIDConfig config;
 
-  config.Kp = 60;
-  config.Ki = 10;
-  config.Kd = 2;
+  config.Kp = gains.Kp;
+  config.Ki = gains.Ki;
   config.satUpper = 255;
   config.satLower = -255;
   config.antiWindup = config.satUpper;
@@ -487,12 +839,11 @@ PIDConfig DriveController::constVelConfig() {
 
 }
 
-PIDConfig DriveController::constYawConfig() {
+PIDConfig DriveController::constYawConfig(PIDGains gains) {
   PIDConfig config;
 
-  config.Kp = 5;
-  config.Ki = 5;
-  config.Kd = 0;
+  config.Kp = gains.Kp;
+  config.Ki = gains.Ki;
   config.satUpper = 255;
   config.satLower = -255;
   config.antiWindup = config.satUpper/4;
@@ -509,50 +860,33 @@ PIDConfig DriveController::constYawConfig() {
 
 }
 
-bool DriveController::CNMCurrentLocationAVG()
-{
-
-  const int CASIZE = 30;
-
-  float avgCurrentCoordsX[CASIZE];
-  float avgCurrentCoordsY[CASIZE];
-
-    static int index = 0;
-
-    if(index < CASIZE)
-    {
-
-	     avgCurrentCoordsX[index] = currentLocation.x;
-    	 avgCurrentCoordsY[index] = currentLocation.y;
+PIDConfig DriveController::pursuitVelConfig(PIDGains gains) {
+  PIDConfig config = fastVelConfig(gains);
 
-	index++;
+  //the set point follows the curvature so keep the integral across set point changes
+  config.resetOnSetpoint = false;
 
-	return false;
-    }
-    else
-    {
-	float x = 0, y = 0;
-	for(int i = 0; i < CASIZE; i++)
-	{
-	    x += avgCurrentCoordsX[i];
-	    y += avgCurrentCoordsY[i];
-	}
-
-	x = x/CASIZE;
-	y = y/CASIZE;
+  return config;
 
-  Point cnmAVGCurrentLocation;
-	cnmAVGCurrentLocation.x = x;
-	cnmAVGCurrentLocation.y = y;
-  cnmAVGCurrentLocation.theta = currentLocation.theta;
+}
 
-  DriveController::cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
+PIDConfig DriveController::pursuitYawConfig() {
+  PIDConfig config;
 
-  //logicController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
+  config.Kp = 40;
+  config.Ki = 5;
+  config.satUpper = 255;
+  config.satLower = -255;
+  config.antiWindup = config.satUpper/4;
+  config.errorHistLength = 2; //the arc changes every tick so average less
+  config.alwaysIntegral = false;
+  config.resetOnSetpoint = false;
+  config.feedForwardMultiplier = 100; //about 25 pwm of wheel difference at 1 rad/s
+  config.integralDeadZone = 0.01;
+  config.integralErrorHistoryLength = 10000;
+  config.integralMax = config.satUpper/6;
+  config.derivativeAlpha = 0.7;
 
-  //staticTest();
+  return config;
 
-	index = 0;
-	return true;
-    }
 }
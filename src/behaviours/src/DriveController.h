@@ -3,6 +3,10 @@
 
 #include "PID.h"
 #include "Controller.h"
+#include "OccupancyGrid.h"
+#include "PathPlanner.h"
+#include "ReciprocalAvoidance.h"
+#include "ParamStore.h"
 #include <angles/angles.h>
 #include <vector>
 
@@ -23,12 +27,23 @@ public:
   void SetVelocityData(float linearVelocity,float angularVelocity);
   void SetCurrentLocation(Point currentLocation) {this->currentLocation = currentLocation;}
 
-  bool getCurrLocAVG();
-  void cnmSetAvgCurrentLocation(Point cnmAVGCurrentLocation) {cnmCurrentLocation = cnmAVGCurrentLocation;}
+  //obstacle map used to move blocked waypoints and slow down ahead of obstacles
+  void SetOccupancyGrid(const OccupancyGrid* occupancyGrid) {this->occupancyGrid = occupancyGrid;}
 
-  bool CNMCurrentLocationAVG();
+  //planner used to route around known obstacles between waypoints
+  void SetPathPlanner(PathPlanner* pathPlanner) {this->pathPlanner = pathPlanner;}
 
-  //static void cnmSetAvgCurrentLocation2(Point cnmAVGCurrentLocation) {cnmCurrentLocation = cnmAVGCurrentLocation;}
+  //other rovers to give way to while following waypoints
+  void SetReciprocalAvoidance(ReciprocalAvoidance* avoidance) {this->avoidance = avoidance;}
+
+  //waypoint the rover is currently driving to, false if there is none
+  bool GetCurrentWaypoint(Point& waypoint) const;
+
+  //follow the waypoint list continuously instead of stopping to pivot at every waypoint
+  void SetPurePursuit(bool purePursuit) {this->purePursuit = purePursuit;}
+
+  //tuning constants, taken over at the next DoWork when they change
+  void SetParamStore(const ParamStore* params) {this->params = params;}
 
 
 private:
@@ -44,10 +59,69 @@ private:
 
   float rotateOnlyAngleTolerance = 0.05;  //May be too low?
   float finalRotationTolerance = 0.1; //dead code not used
-  const float waypointTolerance = 0.50; //15 cm tolerance. Originally 0.15, .75 worked smooth (sim) for Map based location
-
-  //0.65 MAX value
-  float searchVelocity = 0.35; // meters/second was 0.35 from basecode
+  //from the parameters, see BehaviourParams for the defaults
+  float waypointTolerance;
+  float searchVelocity; //0.65 MAX value
+
+  const ParamStore* params = nullptr;
+  uint32_t paramsVersion = 0;
+  // Takes over the velocity, the tolerance and the PID gains.
+  void applyParams(const BehaviourParams& params);
+
+  const OccupancyGrid* occupancyGrid = nullptr;
+  const float waypointClearance = 0.2; //waypoints with an obstacle this close are moved
+  const float maxWaypointShift = 0.5; //meters a waypoint is moved at most to get clear
+  const float lookAheadDistance = 0.8; //meters of path checked for obstacles
+  const float lookAheadClearance = 0.25; //half the rover width plus margin
+  const float blockedVelocityScale = 0.5; //slow down when the look-ahead is blocked
+
+  // true if the waypoint sits on a known obstacle
+  bool waypointOccupied(Point waypoint);
+  // Moves the waypoint to the closest spot clear of known obstacles, false
+  // if there is none within maxWaypointShift.
+  bool moveWaypointClear(Point& waypoint);
+
+  PathPlanner* pathPlanner = nullptr;
+  const float planClearance = 0.3; //straight lines with an obstacle this close are planned around
+
+  // index in waypoints of the goal the current plan leads to, the planned
+  // waypoints sit above it on the stack. -1 when there is no plan.
+  int planGoalIndex = -1;
+
+  // Plans around known obstacles if the straight line to the next waypoint is blocked
+  void planToWaypoint();
+  // Repairs the current plan with newly seen obstacles
+  void repairPlan();
+  // Replaces the planned waypoints on the stack with the planner output
+  void pushPlannedWaypoints();
+  void clearPlan();
+
+  //pure pursuit path following*********
+  bool purePursuit = true;
+  const float pursuitMaxHeadingError = M_PI / 3; //larger heading errors pivot in place first
+  const float minLookAhead = 0.4; //meters
+  const float maxLookAhead = 1.0; //meters
+  const float lookAheadGain = 1.0; //seconds, look-ahead grows with speed
+  const float maxLateralAcceleration = 0.3; //m/s^2, limits speed in tight turns
+  const float pursuitDeceleration = 0.3; //m/s^2, slows down before the final waypoint
+  const float minPursuitVelocity = 0.1; //m/s
+  const float maxPursuitAngular = 1.2; //rad/s
+
+  // Drives along the waypoint stack towards a look-ahead point
+  void followPath();
+  // Point on the path at the look-ahead distance from the rover
+  Point lookAheadPoint(float lookAhead);
+  // Path length from the rover through the remaining waypoints
+  float remainingPathLength();
+  // Reduces the velocity if the obstacle map has something on the way
+  float obstacleSpeedLimit(float velocity, float heading, float distance);
+
+  ReciprocalAvoidance* avoidance = nullptr;
+
+  // Replaces the velocity and heading the rover wants with the closest ones
+  // that keep clear of the other rovers. Returns false if there is no rover
+  // to give way to.
+  bool avoidRovers(float& velocity, float& heading);
 
   float linearVelocity = 0;
   float angularVelocity = 0;
@@ -62,27 +136,24 @@ private:
   Point centerLocationOdom;
 
 
-  //Averaged GPS center location
-  Point cnmCenterLocation;
-  //Averaged GPS current location
-  Point cnmCurrentLocation;
-
-
 
 
   vector<Point> waypoints;
 
   //PID configs************************
-  PIDConfig fastVelConfig();
-  PIDConfig fastYawConfig();
-  PIDConfig slowVelConfig();
-  PIDConfig slowYawConfig();
-  PIDConfig constVelConfig();
-  PIDConfig constYawConfig();
+  PIDConfig fastVelConfig(PIDGains gains);
+  PIDConfig fastYawConfig(PIDGains gains);
+  PIDConfig slowVelConfig(PIDGains gains);
+  PIDConfig slowYawConfig(PIDGains gains);
+  PIDConfig constVelConfig(PIDGains gains);
+  PIDConfig constYawConfig(PIDGains gains);
+  PIDConfig pursuitVelConfig(PIDGains gains);
+  PIDConfig pursuitYawConfig();
 
   void fastPID(float errorVel,float errorYaw, float setPointVel, float setPointYaw);
   void slowPID(float errorVel,float errorYaw, float setPointVel, float setPointYaw);
   void constPID(float erroVel,float constAngularError, float setPointVel, float setPointYaw);
+  void pursuitPID(float errorVel,float errorAngular, float setPointVel, float setPointAngular);
 
   //each PID movement paradigm needs at minimum two PIDs to acheive good robot motion.
   //one PID is for linear movement and the second for rotational movements
@@ -95,6 +166,9 @@ private:
   PID constVelPID;
   PID constYawPID;
 
+  PID pursuitVelPID;
+  PID pursuitYawPID;
+
   // state machine states
   enum StateMachineStates {
 
@@ -104,6 +178,7 @@ private:
     STATE_MACHINE_WAYPOINTS,
     STATE_MACHINE_ROTATE,
     STATE_MACHINE_SKID_STEER,
+    STATE_MACHINE_PURE_PURSUIT,
   };
 
 
@@ -30,13 +30,7 @@ cTagcount = 0;
 cnmReverse = false;
 isDroppingOff = false;
 CNMCentered = false;
-backUp = false;
-firstReverse = true;
 dropTimerStatered = false;
-reverseTimerStatered = false;
-cnmDropoff180 = false;
-cnm180Finished = false;
-the180TimerStatered = false;
 
 
 }
@@ -61,52 +55,123 @@ Result DropOffController::DoWork() {
   //to resart our search.
   if(reachedCollectionPoint)
   {
-    cout << "DROPOFF - reachedCollectionPoint" << endl;
-    cout << "2" << endl;
-    if (timerTimeElapsed >= 5)
+    isPrecisionDriving = true;
+    result.type = precisionDriving;
+    result.pd.cmdAngularError = 0.0;
+
+    if (dropPhase == DROP_RELEASE)
     {
-      if (finalInterrupt)
+      //stop and open the fingers
+      result.pd.cmdVel = 0.0;
+      result.fingerAngle = M_PI_2; //open fingers
+      result.wristAngle = 0; //raise wrist
+
+      bool opened = hasGripperData && fingerFeedback >= openFingerAngle - gripperTolerance;
+      if ((opened && PhaseTime() >= minReleaseTime) || PhaseTime() >= cnmReleaseTimer)
       {
-        cout << "DROPOFF - Final interrupt switching to next process" << endl;
-        result.type = behavior;
-        result.b = nextProcess;
-        result.reset = true;
-        return result;
-      }
-      else
-      { cout << "DROPOFF - reverse timer started" << endl;
-        finalInterrupt = true;
-        cout << "1" << endl;
+        cout << "DROPOFF - released after " << PhaseTime() << " s" << (opened ? "" : " without gripper feedback") << endl;
+        StartPhase(DROP_REVERSE);
       }
     }
-    else if (timerTimeElapsed >= 0.1)
+    else if (dropPhase == DROP_REVERSE)
     {
-      isPrecisionDriving = true;
-      result.type = precisionDriving;
-      cout << "DROPOFF - opening fingers now" << endl;
-      result.fingerAngle = M_PI_2; //open fingers
-      result.wristAngle = 0; //raise wrist
+      result.fingerAngle = M_PI_2;
+      result.wristAngle = 0;
+      result.pd.cmdVel = reverseVelocity;
 
-      result.pd.cmdVel = -0.3;
-      result.pd.cmdAngularError = 0.0;
+      if (PhaseDistance() >= reverseDistance || PhaseTime() >= cnmReverseTimer)
+      {
+        cout << "DROPOFF - reversed " << PhaseDistance() << " m in " << PhaseTime() << " s" << endl;
+        result.pd.cmdVel = 0.0;
+        StartPhase(DROP_DONE);
+      }
+    }
+    else if (finalInterrupt)
+    {
+      cout << "DROPOFF - Final interrupt switching to next process" << endl;
+      if (nestScheduler != nullptr)
+      {
+        nestScheduler->Done(current_time);
+      }
+      ReportCycleTime();
+      result.type = behavior;
+      result.b = nextProcess;
+      result.reset = true;
+      return result;
+    }
+    else
+    {
+      result.pd.cmdVel = 0.0;
+      finalInterrupt = true;
     }
 
     return result;
   }
 
+  //the nest every rover agrees on, the lanes of the scheduler are laid out around it
+  Point cnmCenterLocation = locationController->GetNestLocation();
+
   double distanceToCenter = hypot(cnmCenterLocation.x - this->currentLocation.x, cnmCenterLocation.y - this->currentLocation.y);
 
+  //the center tags can be seen from outside the zone, so the reservation is
+  //needed before driving in on them as well as along the lane
+  if (nestScheduler != nullptr)
+  {
+    Point relative;
+    relative.x = currentLocation.x - cnmCenterLocation.x;
+    relative.y = currentLocation.y - cnmCenterLocation.y;
+
+    if (!nestScheduler->Admit(relative, current_time))
+    {
+      result.type = waypoint;
+      result.wpts.waypoints.clear();
+      startWaypoint = false;
+      isPrecisionDriving = false;
+      timerTimeElapsed = 0;
+
+      //queue outside the zone, stopped once at the holding point
+      Point hold = nestScheduler->GetHoldingPoint();
+      hold.x += cnmCenterLocation.x;
+      hold.y += cnmCenterLocation.y;
+
+      if (hypot(hold.x - currentLocation.x, hold.y - currentLocation.y) > holdTolerance)
+      {
+        hold.theta = atan2(hold.y - currentLocation.y, hold.x - currentLocation.x);
+        result.wpts.waypoints.push_back(hold);
+      }
+      else
+      {
+        result.type = behavior;
+        result.b = wait;
+        result.reset = false;
+      }
+      return result;
+    }
+  }
+
   //check to see if we are driving to the center location or if we need to drive in a circle and look.
   if (distanceToCenter > collectionPointVisualDistance && !circularCenterSearching && (count == 0)) {
 
     result.type = waypoint;
     result.wpts.waypoints.clear();
-    result.wpts.waypoints.push_back(cnmCenterLocation);
     startWaypoint = false;
     isPrecisionDriving = false;
 
     timerTimeElapsed = 0;
 
+    if (nestScheduler != nullptr)
+    {
+      //come in along the lane so the rover backing out is on another one
+      Point entry = nestScheduler->GetEntryPoint();
+      entry.x += cnmCenterLocation.x;
+      entry.y += cnmCenterLocation.y;
+      if (distanceToCenter > hypot(entry.x - cnmCenterLocation.x, entry.y - cnmCenterLocation.y))
+      {
+        result.wpts.waypoints.push_back(entry);
+      }
+    }
+
+    result.wpts.waypoints.push_back(cnmCenterLocation);
     return result;
 
   }
@@ -180,27 +245,31 @@ Result DropOffController::DoWork() {
 
       if(!dropTimerStatered)
       {
-        cout << "DROPOFF - CNM Centered: " << CNMCentered << "  dropoff timer started!" << endl;
+        cout << "DROPOFF - CNM Centered: " << CNMCentered << "  driving into the nest" << endl;
         cnmDropoffTimerStart = current_time;
         dropTimerStatered = true;
+        StartPhase(DROP_DRIVE_IN);
 
         result.pd.cmdVel = 0.25; // was 1.5 from CNM 2017
         result.pd.cmdAngularError  = 0.0;
       }
 
-      //start timer for dropoff drive
+      //the drive in timer is only a safety timeout
       long int  elapsedDropoff = current_time - cnmDropoffTimerStart;
       float cnmDropoffTimerElapsed = elapsedDropoff/1e3; // Convert from milliseconds to seconds
 
-      if(cnmDropoffTimerElapsed >= cnmDropoffTimer && dropTimerStatered && !readyToDrop)
+      //far enough past the edge of the nest or on top of its center
+      bool droveIn = PhaseDistance() >= params->Get()->dropOffDriveIn || distanceToCenter < nestCenterTolerance;
+
+      if((droveIn || cnmDropoffTimerElapsed >= params->Get()->dropOffTimeout) && dropTimerStatered && !readyToDrop)
       {
-        cout << "DROPOFF - dropoff timer: " << cnmDropoffTimerElapsed << endl;
-        cout << "DROPOFF - Dropoff Drive Timer complete stop here and drop" << endl;
+        cout << "DROPOFF - drove " << PhaseDistance() << " m into the nest in " << cnmDropoffTimerElapsed << " s"
+             << (droveIn ? "" : ", timed out") << " stop here and drop" << endl;
         result.pd.cmdVel = 0.00;
         result.pd.cmdAngularError  = 0.0;
         reachedCollectionPoint =true;
         readyToDrop = true;
-
+        StartPhase(DROP_RELEASE);
       }
       //addition adjustment while driving forward on timer (not used)
       if(readyToDrop)
@@ -232,7 +301,7 @@ Result DropOffController::DoWork() {
 
     //otherwise turn till tags on both sides of image then drive straight
     if (left && right) {
-      result.pd.cmdVel = searchVelocity;
+      result.pd.cmdVel = params->Get()->dropOffVelocity;
       result.pd.cmdAngularError = 0.0;
     }
     else if (right) {
@@ -245,7 +314,7 @@ Result DropOffController::DoWork() {
     }
     else
     {
-      result.pd.cmdVel = searchVelocity;
+      result.pd.cmdVel = params->Get()->dropOffVelocity;
       result.pd.cmdAngularError = 0.0;
     }
 
@@ -369,7 +438,7 @@ Result DropOffController::DoWork() {
       centerApproach = false;
 
       result.type = waypoint;
-      result.wpts.waypoints.push_back(this->cnmCenterLocation);
+      result.wpts.waypoints.push_back(cnmCenterLocation);
       if (isPrecisionDriving) {
         result.type = behavior;
         result.b = prevProcess;
@@ -381,7 +450,7 @@ Result DropOffController::DoWork() {
     }
     else
     {
-      result.pd.cmdVel = searchVelocity;
+      result.pd.cmdVel = params->Get()->dropOffVelocity;
       result.pd.cmdAngularError = 0.0;
     }
 
@@ -394,6 +463,7 @@ Result DropOffController::DoWork() {
     reachedCollectionPoint = true;
     centerApproach = false;
     returnTimer = current_time;
+    StartPhase(DROP_RELEASE);
   }
 
   return result;
@@ -411,6 +481,12 @@ void DropOffController::Reset() {
   result.PIDMode = FAST_PID;
   spinner = 0;
   spinSizeIncrease = 0;
+
+  //a drop off that did not finish leaves the zone to the other rovers
+  if (nestScheduler != nullptr)
+  {
+    nestScheduler->Cancel();
+  }
   prevCount = 0;
   timerTimeElapsed = -1;
 
@@ -433,44 +509,71 @@ void DropOffController::Reset() {
   cnmCenteringNow = false;
 
   CNMCentered = false;
-backUp = false;
 readyToDrop = false;
 cTagcount = 0;
 cnmReverse = false;
 isDroppingOff = false;
-firstReverse = true;
 centerSeen = false;
 dropTimerStatered = false;
-reverseTimerStatered = false;
-cnmDropoff180 = false;
-cnm180Finished = false;
-the180TimerStatered = false;
+dropPhase = DROP_DRIVE_IN;
+for (int i = 0; i < DROP_DONE; i++) { phaseDurations[i] = 0; }
 
 
 }
 
-void DropOffController::SetTargetData(vector<Tag> tags) {
-  countRight = 0;
-  countLeft = 0;
+void DropOffController::StartPhase(DropPhase phase) {
+  //close out the time of the phase we are leaving, the drive in phase is
+  //skipped when the rover loses the center tags before it is centered
+  if (phase > dropPhase && (dropPhase != DROP_DRIVE_IN || dropTimerStatered))
+  {
+    phaseDurations[dropPhase] = PhaseTime();
+  }
 
-  if(targetHeld) {
-    // if a target is detected and we are looking for center tags
-    if (tags.size() > 0 && !reachedCollectionPoint) {
+  dropPhase = phase;
+  phaseStartTime = current_time;
+  phaseStartLocation = currentLocation;
+}
 
-      // this loop is to get the number of center tags
-      for (int i = 0; i < tags.size(); i++) {
-        if (tags[i].getID() == 256) {
+float DropOffController::PhaseTime() {
+  return (current_time - phaseStartTime)/1e3;
+}
 
-          // checks if tag is on the right or left side of the image
-          if (tags[i].getPositionX() + cameraOffsetCorrection > 0) {
-            countRight++;
+float DropOffController::PhaseDistance() {
+  return hypot(currentLocation.x - phaseStartLocation.x, currentLocation.y - phaseStartLocation.y);
+}
 
-          } else {
-            countLeft++;
-          }
-        }
-      }
-    }
+void DropOffController::ReportCycleTime() {
+  float nestTime = phaseDurations[DROP_DRIVE_IN] + phaseDurations[DROP_RELEASE] + phaseDurations[DROP_REVERSE];
+  float cycleTime = cycleStartTime >= 0 ? (current_time - cycleStartTime)/1e3 : nestTime;
+
+  dropOffCount++;
+  totalCycleTime += cycleTime;
+  totalNestTime += nestTime;
+
+  cout << "DROPOFF - drop off " << dropOffCount << " took " << cycleTime << " s from pickup, "
+       << nestTime << " s at the nest (drive in " << phaseDurations[DROP_DRIVE_IN]
+       << " s, release " << phaseDurations[DROP_RELEASE] << " s, reverse " << phaseDurations[DROP_REVERSE]
+       << " s), average " << totalCycleTime / dropOffCount << " s per cycle, "
+       << totalNestTime / dropOffCount << " s at the nest" << endl;
+
+  if (nestScheduler != nullptr)
+  {
+    cout << "DROPOFF - waited " << nestScheduler->GetLastWait() << " s for the nest, "
+         << nestScheduler->GetDropsPerMinute(current_time) << " drops/min at the nest" << endl;
+  }
+
+  cycleStartTime = -1;
+}
+
+void DropOffController::SetCenterTagCounts(int left, int right) {
+  countRight = 0;
+  countLeft = 0;
+
+  // the counts come from the collection zone tracks so a frame or two without
+  // detections does not reset the centering
+  if(targetHeld && !reachedCollectionPoint) {
+    countLeft = left;
+    countRight = right;
   }
 
 }
@@ -497,6 +600,7 @@ bool DropOffController::ShouldInterrupt() {
   if (finalInterrupt) {
     return true;
   }
+  return false;
 }
 
 bool DropOffController::HasWork() {
@@ -523,8 +627,16 @@ void DropOffController::SetCenterLocation(Point center) {
 }
 
 
-void DropOffController::cnmSetCenterLocation(Point center) {
-  cnmCenterLocation = center;
+void DropOffController::SetLocationController(const LocationController* locationController) {
+  this->locationController = locationController;
+}
+
+void DropOffController::SetNestScheduler(NestScheduler* nestScheduler) {
+  this->nestScheduler = nestScheduler;
+}
+
+void DropOffController::SetParamStore(const ParamStore* params) {
+  this->params = params;
 }
 
 void DropOffController::SetCurrentLocation(Point current) {
@@ -533,6 +645,12 @@ void DropOffController::SetCurrentLocation(Point current) {
 
 void DropOffController::SetTargetPickedUp() {
   targetHeld = true;
+
+  //the cycle runs until the cube is dropped, even if the drop off restarts on the way
+  if (cycleStartTime < 0)
+  {
+    cycleStartTime = current_time;
+  }
 }
 
 void DropOffController::SetBlockBlockingUltrasound(bool blockBlock) {
@@ -543,3 +661,10 @@ void DropOffController::SetCurrentTimeInMilliSecs( long int time )
 {
   current_time = time;
 }
+
+void DropOffController::SetGripperData(float fingerAngle, float wristAngle)
+{
+  hasGripperData = true;
+  fingerFeedback = fingerAngle;
+  wristFeedback = wristAngle;
+}
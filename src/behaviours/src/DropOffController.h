@@ -4,6 +4,9 @@
 
 
 #include "Controller.h"
+#include "LocationController.h"
+#include "NestScheduler.h"
+#include "ParamStore.h"
 #include "Tag.h"
 #include <math.h>
 
@@ -23,7 +26,9 @@ public:
   void SetCurrentLocation(Point current);
   void SetTargetPickedUp();
   void SetBlockBlockingUltrasound(bool blockBlock);
-  void SetTargetData(vector<Tag> tags);
+  //number of tracked collection zone tags on the left and right of the camera view
+  void SetCenterTagCounts(int left, int right);
+  float GetCameraOffsetCorrection() {return cameraOffsetCorrection;}
   bool HasTarget() {return targetHeld;}
 
   float GetSpinner() {return spinner;}
@@ -32,10 +37,18 @@ public:
 
   void SetCurrentTimeInMilliSecs( long int time );
 
-  void cnmSetCenterLocation(Point center);
-  bool CNMCurrentLocationAVG();
+  //angles the gripper servos last moved to, from fingerAngle/prev_cmd and wristAngle/prev_cmd
+  void SetGripperData(float fingerAngle, float wristAngle);
 
-  void cnmSetAvgCurrentLocation(Point cnmAVGCurrentLocation);
+  //shared pose service, the averaged nest center comes from here
+  void SetLocationController(const LocationController* locationController);
+
+  //reservations of the collection zone, the rover waits at a holding point
+  //until its reservation comes up and then drives in along its lane
+  void SetNestScheduler(NestScheduler* nestScheduler);
+
+  //tuning constants, the drive in velocity, distance and timeout are read from here
+  void SetParamStore(const ParamStore* params);
 
 
 
@@ -47,21 +60,30 @@ public:
   double cTagcount = 0;
   bool cnmReverse = false;
   bool isDroppingOff = false;
-  bool backUp = false;
-  bool firstReverse = true;
   bool centerSeen = false;
 
   bool dropTimerStatered = false;
-  bool reverseTimerStatered = false;
-  bool cnmDropoff180 = false;
-  bool cnm180Finished = true;
-  bool the180TimerStatered = false;
 
 
 private:
 
   void ProcessData();
 
+  // Once the rover is centered on the nest the drop goes through these
+  // phases. Each one ends when the sensors say it is done, the timers are
+  // only there in case that never happens.
+  enum DropPhase {
+    DROP_DRIVE_IN, //drive into the nest until far enough past the edge or at the center
+    DROP_RELEASE, //stop and open the fingers until the gripper reports them open
+    DROP_REVERSE, //back out of the nest for a fixed odometry distance
+    DROP_DONE
+  };
+
+  void StartPhase(DropPhase phase);
+  float PhaseTime(); //seconds since the phase started
+  float PhaseDistance(); //meters driven since the phase started
+  void ReportCycleTime();
+
   //Constants
 
   const float cameraOffsetCorrection = 0.020; //meters
@@ -71,13 +93,18 @@ private:
   const float collectionPointVisualDistance = 0.2; //in meters
   const float initialSpinSize = 0.05; //in meters aka 10cm
   const float spinSizeIncrement = 0.50; //in meters
-  const float searchVelocity = 0.15; //in meters per second
   const float dropDelay = 0.5; //delay in seconds for dropOff
-  float cnmDropoffTimer = 2.8; //delay in seconds for dropOff
-  float cnmReverseTimer = 5.0; //delay in seconds for Reverse
-  float cnm180Timer = 3.0;
+  float cnmReleaseTimer = 1.5; //timeout in seconds for opening the fingers
+  float cnmReverseTimer = 5.0; //timeout in seconds for Reverse
   float cnmDropoffTimerElapsed = 0; //elapsed time for dropoff timer
-  float cnmReverseTimerElapsed = 0;
+
+  const float nestCenterTolerance = 0.2; //meters, close enough to the localized center to drop
+  const float openFingerAngle = M_PI_2; //radians
+  const float gripperTolerance = 0.1; //radians
+  const float minReleaseTime = 0.3; //seconds for the fingers to swing open once commanded
+  const float reverseDistance = 1.0; //meters, enough to clear the nest from its center
+  const float reverseVelocity = -0.3; //meters per second
+  const float holdTolerance = 0.3; //meters from the holding point to stop and wait
 
 
   //Instance Variables
@@ -97,11 +124,6 @@ private:
   //Timer for dropoff code (dropping the cube in the center)- used for timerTimeElapsed
 long int cnmDropoffTimerStart;
 
-//Timer for reversing out of home code (dropping the cube in the center)- used for timerTimeElapsed
-long int cnmReverseTimerStart;
-
-long int cnm180TimerStart;
-
   //Previous tag count
   int prevCount;
 
@@ -117,10 +139,9 @@ long int cnm180TimerStart;
   //Center and current locations as of the last call to setLocationData
   Point centerLocation;
   Point currentLocation;
-  //Averaged GPS center location
-  Point cnmCenterLocation;
-  //Averaged GPS current location
-  Point cnmCurrentLocation;
+  const LocationController* locationController = nullptr;
+  NestScheduler* nestScheduler = nullptr;
+  const ParamStore* params = nullptr;
 
   //Time since modeTimer was started, in seconds
   float timerTimeElapsed;
@@ -159,6 +180,21 @@ long int cnm180TimerStart;
 
   long int current_time;
 
+  DropPhase dropPhase = DROP_DRIVE_IN;
+  long int phaseStartTime = 0;
+  Point phaseStartLocation;
+  float phaseDurations[DROP_DONE] = {0, 0, 0}; //seconds spent in each phase of this drop
+
+  bool hasGripperData = false;
+  float fingerFeedback = 0;
+  float wristFeedback = 0;
+
+  //drop off cycle, from picking up the cube to backing out of the nest
+  long int cycleStartTime = -1;
+  int dropOffCount = 0;
+  float totalCycleTime = 0; //seconds
+  float totalNestTime = 0; //seconds spent on the phases at the nest
+
   bool interrupt = false;
   bool precisionInterrupt = false;
   bool finalInterrupt = false;
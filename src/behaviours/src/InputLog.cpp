@@ -0,0 +1,426 @@
+#include "InputLog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio> // For rename
+#include <iostream>
+
+RecordedResult::RecordedResult(const Result& result)
+{
+  waiting = result.type == behavior && result.b == BehaviorTrigger::wait;
+  left = result.pd.left;
+  right = result.pd.right;
+  fingerAngle = result.fingerAngle;
+  wristAngle = result.wristAngle;
+}
+
+bool RecordedResult::operator==(const RecordedResult& other) const
+{
+  float mine[4] = {left, right, fingerAngle, wristAngle};
+  float theirs[4] = {other.left, other.right, other.fingerAngle, other.wristAngle};
+  return waiting == other.waiting && memcmp(mine, theirs, sizeof(mine)) == 0;
+}
+
+InputLog::InputLog()
+{
+}
+
+InputLog::~InputLog()
+{
+  Close();
+}
+
+bool InputLog::Open(const string& path)
+{
+  Close();
+
+  //keep the log of the run before, the node may have been restarted after a crash
+  rename(path.c_str(), (path + ".1").c_str());
+  rename((path + ".index").c_str(), (path + ".1.index").c_str());
+
+  fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  indexFd = open((path + ".index").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || indexFd < 0)
+  {
+    cout << "INPUTLOG - can't create " << path << ": " << strerror(errno) << endl;
+    Close();
+    return false;
+  }
+  this->path = path;
+
+  buffer.resize(2 * flushBytes);
+  used = 0;
+  ticks = 0;
+  records = 0;
+  bytesWritten = 0;
+
+  FileHeader header;
+  header.magic = magic;
+  header.version = version;
+  header.stateBytes = sizeof(RoverState);
+  header.spare = 0;
+  PutBytes(&header, sizeof(header));
+  Write();
+  return IsOpen();
+}
+
+void InputLog::Close()
+{
+  if (fd >= 0 && indexFd >= 0)
+  {
+    Write();
+  }
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+  }
+  if (indexFd >= 0)
+  {
+    close(indexFd);
+    indexFd = -1;
+  }
+  used = 0;
+  pendingIndex.clear();
+}
+
+void InputLog::RecordTick(long int time, const Result& result)
+{
+  if (fd < 0)
+  {
+    return;
+  }
+  Record(INPUT_TICK, (int64_t)time, RecordedResult(result));
+  ticks++;
+
+  IndexEntry entry;
+  entry.time = time;
+  entry.end = bytesWritten + used;
+  pendingIndex.push_back(entry);
+  Write();
+}
+
+void InputLog::End(InputType type, size_t start)
+{
+  size_t length = used - start - headerBytes;
+  if (length >= (1u << (32 - typeBits)))
+  {
+    cout << "INPUTLOG - " << GetTypeName(type) << " record of " << length << " bytes left out" << endl;
+    used = start;
+    return;
+  }
+
+  uint32_t header = type | length << typeBits;
+  memcpy(buffer.data() + start, &header, headerBytes);
+  records++;
+
+  if (used >= flushBytes)
+  {
+    Write();
+  }
+}
+
+void InputLog::Write()
+{
+  //the log first so the index never points past it
+  if (used > 0 && !WriteAll(fd, buffer.data(), used))
+  {
+    cout << "INPUTLOG - can't write " << path << ": " << strerror(errno) << ", recording stopped" << endl;
+    Close();
+    return;
+  }
+  bytesWritten += used;
+  used = 0;
+
+  if (!pendingIndex.empty() && !WriteAll(indexFd, (const char*)pendingIndex.data(), pendingIndex.size() * sizeof(IndexEntry)))
+  {
+    cout << "INPUTLOG - can't write the index of " << path << ": " << strerror(errno) << ", recording stopped" << endl;
+    Close();
+    return;
+  }
+  pendingIndex.clear();
+}
+
+bool InputLog::WriteAll(int fd, const char* data, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t written = write(fd, data, length);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    length -= written;
+  }
+  return true;
+}
+
+void InputLog::Put(const string& text)
+{
+  Put((uint32_t)text.size());
+  PutBytes(text.data(), text.size());
+}
+
+void InputLog::Put(const Tag& tag)
+{
+  PutAll((int32_t)tag.getID(), tag.getPositionX(), tag.getPositionY(), tag.getPositionZ(),
+         tag.getOrientationX(), tag.getOrientationY(), tag.getOrientationZ(), tag.getOrientationW());
+}
+
+void InputLog::Put(const AllocationBid& bid)
+{
+  PutAll(bid.location, (int32_t)bid.bid);
+}
+
+void InputLog::Put(const NestReservation& reservation)
+{
+  PutAll(reservation.entry, (int32_t)reservation.start);
+}
+
+void InputLog::Put(const ResourceEntry& entry)
+{
+  PutAll(entry.cellX, entry.cellY, entry.remaining, entry.countClock, entry.countNode,
+         entry.owner, entry.claimClock, entry.claimNode);
+}
+
+void InputLog::Put(const RecordedResult& result)
+{
+  PutAll(result.waiting, result.left, result.right, result.fingerAngle, result.wristAngle);
+}
+
+void InputLog::Put(const pair<string, double>& param)
+{
+  PutAll(param.first, param.second);
+}
+
+const char* InputLog::GetTypeName(InputType type)
+{
+  static const char* names[INPUT_TYPE_COUNT] = {
+    "none", "tick", "time", "sonar", "gripper", "position", "map position", "velocity", "map velocity",
+    "tags", "mode", "fence", "waypoint add", "waypoint remove", "waypoints cleared", "center odom",
+    "center map", "center sample", "localizer", "restore", "params", "search pattern", "rover id",
+    "swarm members", "allocation", "bid", "reservations taken", "reservation", "neighbour pose",
+    "delta taken", "delta"
+  };
+  return type >= 0 && type < INPUT_TYPE_COUNT ? names[type] : "unknown";
+}
+
+bool InputDecoder::Get(bool& value)
+{
+  uint8_t byte;
+  if (!Get(byte))
+  {
+    return false;
+  }
+  value = byte != 0;
+  return true;
+}
+
+bool InputDecoder::Get(string& text)
+{
+  uint32_t length;
+  if (!Get(length) || length > (size_t)(end - next))
+  {
+    return false;
+  }
+  text.assign(next, length);
+  next += length;
+  return true;
+}
+
+bool InputDecoder::Get(Tag& tag)
+{
+  int32_t id;
+  float x, y, z, qx, qy, qz, qw;
+  if (!GetAll(id, x, y, z, qx, qy, qz, qw))
+  {
+    return false;
+  }
+  tag.setID(id);
+  tag.setPosition(make_tuple(x, y, z));
+  tag.setOrientation(::boost::math::quaternion<float>(qx, qy, qz, qw));
+  return true;
+}
+
+bool InputDecoder::Get(AllocationBid& bid)
+{
+  int32_t value;
+  if (!GetAll(bid.location, value))
+  {
+    return false;
+  }
+  bid.bid = value;
+  return true;
+}
+
+bool InputDecoder::Get(NestReservation& reservation)
+{
+  int32_t start;
+  if (!GetAll(reservation.entry, start))
+  {
+    return false;
+  }
+  reservation.start = start;
+  return true;
+}
+
+bool InputDecoder::Get(ResourceEntry& entry)
+{
+  return GetAll(entry.cellX, entry.cellY, entry.remaining, entry.countClock, entry.countNode,
+                entry.owner, entry.claimClock, entry.claimNode);
+}
+
+bool InputDecoder::Get(RecordedResult& result)
+{
+  return GetAll(result.waiting, result.left, result.right, result.fingerAngle, result.wristAngle);
+}
+
+bool InputDecoder::Get(pair<string, double>& param)
+{
+  return GetAll(param.first, param.second);
+}
+
+InputLogReader::InputLogReader()
+{
+}
+
+InputLogReader::~InputLogReader()
+{
+  Close();
+}
+
+bool InputLogReader::Open(const string& path)
+{
+  Close();
+
+  fd = open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) < 0)
+  {
+    cout << "INPUTLOG - can't open " << path << ": " << strerror(errno) << endl;
+    Close();
+    return false;
+  }
+
+  InputLog::FileHeader header;
+  length = status.st_size;
+  if (length >= sizeof(header))
+  {
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+      cout << "INPUTLOG - can't map " << path << ": " << strerror(errno) << endl;
+      Close();
+      return false;
+    }
+    data = (const char*)mapped;
+    memcpy(&header, data, sizeof(header));
+  }
+  if (data == nullptr || header.magic != InputLog::magic || header.version != InputLog::version
+      || header.stateBytes != sizeof(RoverState))
+  {
+    cout << "INPUTLOG - " << path << " is not an input log of this version" << endl;
+    Close();
+    return false;
+  }
+
+  ReadIndex(path + ".index");
+  FindTicks();
+  next = sizeof(InputLog::FileHeader);
+  return true;
+}
+
+void InputLogReader::Close()
+{
+  if (data != nullptr)
+  {
+    munmap((void*)data, length);
+    data = nullptr;
+  }
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+  }
+  length = 0;
+  next = 0;
+  index.clear();
+}
+
+bool InputLogReader::Next(InputRecord& record)
+{
+  if (next + InputLog::headerBytes > length)
+  {
+    return false;
+  }
+
+  uint32_t header;
+  memcpy(&header, data + next, InputLog::headerBytes);
+  InputType type = (InputType)(header & ((1 << InputLog::typeBits) - 1));
+  uint32_t recordLength = header >> InputLog::typeBits;
+  if (type == INPUT_NONE || type >= INPUT_TYPE_COUNT || next + InputLog::headerBytes + recordLength > length)
+  {
+    return false;
+  }
+
+  record.type = type;
+  record.data = data + next + InputLog::headerBytes;
+  record.length = recordLength;
+  next += InputLog::headerBytes + recordLength;
+  return true;
+}
+
+bool InputLogReader::SeekTick(long int tick)
+{
+  if (data == nullptr || tick < 0 || tick > (long int)index.size())
+  {
+    return false;
+  }
+  next = tick == 0 ? sizeof(InputLog::FileHeader) : index[tick - 1].end;
+  return true;
+}
+
+void InputLogReader::ReadIndex(const string& path)
+{
+  int indexFd = open(path.c_str(), O_RDONLY);
+  if (indexFd < 0)
+  {
+    return;
+  }
+
+  InputLog::IndexEntry entry;
+  uint64_t last = sizeof(InputLog::FileHeader);
+  while (read(indexFd, &entry, sizeof(entry)) == sizeof(entry) && entry.end > last && entry.end <= length)
+  {
+    index.push_back(entry);
+    last = entry.end;
+  }
+  close(indexFd);
+}
+
+void InputLogReader::FindTicks()
+{
+  next = index.empty() ? sizeof(InputLog::FileHeader) : index.back().end;
+
+  InputRecord record;
+  while (Next(record))
+  {
+    int64_t time;
+    if (record.type == INPUT_TICK && InputDecoder(record).Get(time))
+    {
+      InputLog::IndexEntry entry;
+      entry.time = time;
+      entry.end = next;
+      index.push_back(entry);
+    }
+  }
+}
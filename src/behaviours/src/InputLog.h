@@ -0,0 +1,319 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Point.h"
+#include "Controller.h" // For Result, it has no include guard of its own
+#include "Tag.h"
+#include "StateSnapshot.h"
+#include "TaskAllocator.h"
+#include "NestScheduler.h"
+#include "ResourceRegistry.h"
+
+using namespace std;
+
+// One type for each call that hands the LogicController something from
+// outside, the values of a record are the arguments of the call.
+enum InputType {
+  INPUT_NONE = 0,
+  INPUT_TICK, //DoWork, with the time and what it returned
+  INPUT_TIME,
+  INPUT_SONAR,
+  INPUT_GRIPPER,
+  INPUT_POSITION,
+  INPUT_MAP_POSITION,
+  INPUT_VELOCITY,
+  INPUT_MAP_VELOCITY,
+  INPUT_TAGS,
+  INPUT_MODE,
+  INPUT_FENCE,
+  INPUT_WAYPOINT_ADD,
+  INPUT_WAYPOINT_REMOVE,
+  INPUT_WAYPOINTS_CLEARED,
+  INPUT_CENTER_ODOM,
+  INPUT_CENTER_MAP,
+  INPUT_CENTER_SAMPLE,
+  INPUT_LOCALIZER,
+  INPUT_RESTORE,
+  INPUT_PARAMS,
+  INPUT_SEARCH_PATTERN,
+  INPUT_ROVER_ID,
+  INPUT_SWARM_MEMBERS,
+  INPUT_ALLOCATION,
+  INPUT_BID,
+  INPUT_RESERVATIONS_TAKEN,
+  INPUT_RESERVATION,
+  INPUT_NEIGHBOUR_POSE,
+  INPUT_DELTA_TAKEN,
+  INPUT_DELTA,
+  INPUT_TYPE_COUNT
+};
+
+// The part of a Result the ROSAdapter acts on, the other fields are not
+// always set by the controllers.
+struct RecordedResult {
+  bool waiting = false; //the rover sits still
+  //wheel commands and gripper angles, -1 leaves the gripper where it is
+  float left = 0;
+  float right = 0;
+  float fingerAngle = -1;
+  float wristAngle = -1;
+
+  RecordedResult() {}
+  RecordedResult(const Result& result);
+  // Bit for bit, a replay has to give exactly the same commands.
+  bool operator==(const RecordedResult& other) const;
+  bool operator!=(const RecordedResult& other) const {return !(*this == other);}
+};
+
+// Records every input of the LogicController into an append only binary
+// log so a run on a rover can be replayed off the rover, see InputReplay.
+//
+// A record is a four byte header, the type and the length of the values,
+// followed by the values as they are in memory. Records are appended to a
+// buffer, which costs a copy of a few dozen bytes, and the buffer is
+// written out with one write() at the end of every behaviour tick, so a
+// crash of the node loses at most the inputs of the tick it crashed in.
+//
+// Next to the log, path.index holds the time and the end offset of every
+// tick so a reader can go to a tick without reading the log up to it. A
+// log that was already there when the node starts is kept as path.1, it is
+// the one to look at after a crash.
+class InputLog
+{
+public:
+  InputLog();
+  ~InputLog();
+
+  // Returns false and leaves the log closed if it can't be created.
+  bool Open(const string& path);
+  // Writes out what is buffered.
+  void Close();
+  bool IsOpen() const {return fd >= 0;}
+
+  // Appends one record with the values in order.
+  template<typename... Values>
+  void Record(InputType type, const Values&... values)
+  {
+    if (fd < 0)
+    {
+      return;
+    }
+    size_t start = used;
+    Reserve(headerBytes);
+    used += headerBytes;
+    PutAll(values...);
+    End(type, start);
+  }
+
+  // Appends the tick record, writes the buffer out and indexes the tick.
+  void RecordTick(long int time, const Result& result);
+
+  long int GetTickCount() const {return ticks;}
+  long int GetRecordCount() const {return records;}
+  long int GetBytesWritten() const {return bytesWritten;}
+
+  static const char* GetTypeName(InputType type);
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stateBytes; //a log of another RoverState layout can't be read
+    uint32_t spare;
+  };
+
+  struct IndexEntry {
+    int64_t time; //ROS time of the tick in milliseconds
+    uint64_t end; //offset in the log just past the tick record
+  };
+
+  static const uint32_t magic = 0x4e495753; //"SWIN" little endian
+  static const uint32_t version = 2; //2 added the run time to the allocation
+  static const int headerBytes = 4;
+  static const int typeBits = 8; //the length is in the upper 24 bits
+
+private:
+
+  void PutAll() {}
+  template<typename Value, typename... Rest>
+  void PutAll(const Value& value, const Rest&... rest)
+  {
+    Put(value);
+    PutAll(rest...);
+  }
+
+  template<typename T>
+  typename enable_if<is_arithmetic<T>::value>::type Put(T value) {PutBytes(&value, sizeof(T));}
+  void Put(bool value) {Put((uint8_t)value);}
+  void Put(const Point& point) {PutBytes(&point, sizeof(Point));}
+  void Put(const string& text);
+  void Put(const Tag& tag);
+  void Put(const RoverState& state) {PutBytes(&state, sizeof(RoverState));}
+  void Put(const AllocationBid& bid);
+  void Put(const NestReservation& reservation);
+  void Put(const ResourceEntry& entry);
+  void Put(const RecordedResult& result);
+  void Put(const pair<string, double>& param);
+  template<typename T>
+  void Put(const vector<T>& values)
+  {
+    Put((uint32_t)values.size());
+    for (const T& value : values)
+    {
+      Put(value);
+    }
+  }
+
+  void PutBytes(const void* data, size_t length)
+  {
+    Reserve(length);
+    memcpy(buffer.data() + used, data, length);
+    used += length;
+  }
+
+  // Grows the buffer, only while the first ticks are recorded.
+  void Reserve(size_t length)
+  {
+    if (used + length > buffer.size())
+    {
+      buffer.resize(max(2 * buffer.size(), used + length));
+    }
+  }
+
+  void End(InputType type, size_t start);
+  // Writes out the buffer and then the index entries of the ticks in it.
+  void Write();
+  bool WriteAll(int fd, const char* data, size_t length);
+
+  const size_t flushBytes = 65536; //written out before a tick if it gets this big
+
+  int fd = -1;
+  int indexFd = -1;
+  string path;
+
+  vector<char> buffer;
+  size_t used = 0;
+  vector<IndexEntry> pendingIndex;
+
+  long int ticks = 0;
+  long int records = 0;
+  long int bytesWritten = 0;
+};
+
+// A record as it is in the log.
+struct InputRecord {
+  InputType type = INPUT_NONE;
+  const char* data = nullptr;
+  uint32_t length = 0;
+};
+
+// Reads the values of a record back in the order they were recorded. Every
+// Get returns false once the record runs out.
+class InputDecoder
+{
+public:
+  InputDecoder(const InputRecord& record) : next(record.data), end(record.data + record.length) {}
+
+  template<typename T>
+  typename enable_if<is_arithmetic<T>::value, bool>::type Get(T& value) {return GetBytes(&value, sizeof(T));}
+  bool Get(bool& value);
+  bool Get(Point& point) {return GetBytes(&point, sizeof(Point));}
+  bool Get(string& text);
+  bool Get(Tag& tag);
+  bool Get(RoverState& state) {return GetBytes(&state, sizeof(RoverState));}
+  bool Get(AllocationBid& bid);
+  bool Get(NestReservation& reservation);
+  bool Get(ResourceEntry& entry);
+  bool Get(RecordedResult& result);
+  bool Get(pair<string, double>& param);
+  template<typename T>
+  bool Get(vector<T>& values)
+  {
+    uint32_t count;
+    //every value takes at least a byte, a bad count can't allocate much
+    if (!Get(count) || count > (size_t)(end - next))
+    {
+      return false;
+    }
+    values.resize(count);
+    for (T& value : values)
+    {
+      if (!Get(value))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool GetAll() {return true;}
+  template<typename Value, typename... Rest>
+  bool GetAll(Value& value, Rest&... rest)
+  {
+    return Get(value) && GetAll(rest...);
+  }
+
+private:
+
+  bool GetBytes(void* data, size_t length)
+  {
+    if (length > (size_t)(end - next))
+    {
+      return false;
+    }
+    memcpy(data, next, length);
+    next += length;
+    return true;
+  }
+
+  const char* next;
+  const char* end;
+};
+
+// Reads a log written by InputLog. The log is mapped read only, records
+// point into the mapping and stay valid until the reader is closed.
+class InputLogReader
+{
+public:
+  InputLogReader();
+  ~InputLogReader();
+
+  // Takes the ticks from path.index, or finds them by reading the log if
+  // the index is missing. Ticks past the end of the log, cut off by a
+  // crash, are left out.
+  bool Open(const string& path);
+  void Close();
+
+  // The next record, false at the end of the log or at a record cut off
+  // by a crash.
+  bool Next(InputRecord& record);
+
+  // Reads on from the first record of the tick, tick 0 is the first one.
+  bool SeekTick(long int tick);
+
+  long int GetTickCount() const {return index.size();}
+  const InputLog::IndexEntry& GetTick(long int tick) const {return index[tick];}
+  uint64_t GetLength() const {return length;}
+
+private:
+
+  // Takes the entries of the index that lie within the log.
+  void ReadIndex(const string& path);
+  // Adds the ticks after the last indexed one by reading the log.
+  void FindTicks();
+
+  int fd = -1;
+  const char* data = nullptr;
+  uint64_t length = 0;
+  uint64_t next = 0;
+  vector<InputLog::IndexEntry> index;
+};
+
+#endif // INPUTLOG_H
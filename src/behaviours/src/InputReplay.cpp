@@ -0,0 +1,263 @@
+#include "InputReplay.h"
+
+InputReplay::InputReplay(LogicController* logicController)
+  : logicController(logicController)
+{
+}
+
+bool InputReplay::Apply(const InputRecord& record, RecordedResult& replayed, RecordedResult& recorded)
+{
+  InputDecoder decoder(record);
+
+  switch (record.type) {
+
+  case INPUT_TICK: {
+    int64_t time;
+    if (!decoder.GetAll(time, recorded)) return false;
+    //no parameter snapshot is held between ticks, as in the behaviour loop
+    logicController->ParamsQuiescent();
+    replayed = RecordedResult(logicController->DoWork());
+    return true;
+  }
+
+  case INPUT_TIME: {
+    int64_t time;
+    if (!decoder.GetAll(time)) return false;
+    logicController->SetCurrentTimeInMilliSecs(time);
+    return true;
+  }
+
+  case INPUT_SONAR: {
+    float left, center, right;
+    if (!decoder.GetAll(left, center, right)) return false;
+    logicController->SetSonarData(left, center, right);
+    return true;
+  }
+
+  case INPUT_GRIPPER: {
+    float fingerAngle, wristAngle;
+    if (!decoder.GetAll(fingerAngle, wristAngle)) return false;
+    logicController->SetGripperData(fingerAngle, wristAngle);
+    return true;
+  }
+
+  case INPUT_POSITION:
+  case INPUT_MAP_POSITION: {
+    Point location;
+    int64_t time;
+    if (!decoder.GetAll(location, time)) return false;
+    if (record.type == INPUT_POSITION)
+    {
+      logicController->SetPositionData(location, time);
+    }
+    else
+    {
+      logicController->SetMapPositionData(location, time);
+    }
+    return true;
+  }
+
+  case INPUT_VELOCITY:
+  case INPUT_MAP_VELOCITY: {
+    float linearVelocity, angularVelocity;
+    if (!decoder.GetAll(linearVelocity, angularVelocity)) return false;
+    if (record.type == INPUT_VELOCITY)
+    {
+      logicController->SetVelocityData(linearVelocity, angularVelocity);
+    }
+    else
+    {
+      logicController->SetMapVelocityData(linearVelocity, angularVelocity);
+    }
+    return true;
+  }
+
+  case INPUT_TAGS: {
+    vector<Tag> tags;
+    if (!decoder.GetAll(tags)) return false;
+    logicController->SetAprilTags(tags);
+    return true;
+  }
+
+  case INPUT_MODE: {
+    bool autonomous;
+    if (!decoder.GetAll(autonomous)) return false;
+    if (autonomous)
+    {
+      logicController->SetModeAuto();
+    }
+    else
+    {
+      logicController->SetModeManual();
+    }
+    return true;
+  }
+
+  case INPUT_FENCE: {
+    int32_t shape;
+    Point center;
+    float width, height;
+    if (!decoder.GetAll(shape, center, width, height)) return false;
+    //the fence shapes are not freed by the node either
+    if (shape == 1)
+    {
+      logicController->setVirtualFenceOn(new RangeCircle(center, width));
+    }
+    else if (shape == 2)
+    {
+      logicController->setVirtualFenceOn(new RangeRectangle(center, width, height));
+    }
+    else
+    {
+      logicController->setVirtualFenceOff();
+    }
+    return true;
+  }
+
+  case INPUT_WAYPOINT_ADD: {
+    Point waypoint;
+    int32_t id;
+    if (!decoder.GetAll(waypoint, id)) return false;
+    logicController->AddManualWaypoint(waypoint, id);
+    return true;
+  }
+
+  case INPUT_WAYPOINT_REMOVE: {
+    int32_t id;
+    if (!decoder.GetAll(id)) return false;
+    logicController->RemoveManualWaypoint(id);
+    return true;
+  }
+
+  case INPUT_WAYPOINTS_CLEARED:
+    logicController->GetClearedWaypoints();
+    return true;
+
+  case INPUT_CENTER_ODOM:
+  case INPUT_CENTER_MAP:
+  case INPUT_CENTER_SAMPLE:
+  case INPUT_LOCALIZER: {
+    Point location;
+    if (!decoder.GetAll(location)) return false;
+    if (record.type == INPUT_CENTER_ODOM)
+    {
+      logicController->SetCenterLocationOdom(location);
+    }
+    else if (record.type == INPUT_CENTER_MAP)
+    {
+      logicController->SetCenterLocationMap(location);
+    }
+    else if (record.type == INPUT_CENTER_SAMPLE)
+    {
+      logicController->AddCenterLocationSample(location);
+    }
+    else
+    {
+      logicController->InitializeLocalizer(location);
+    }
+    return true;
+  }
+
+  case INPUT_RESTORE: {
+    RoverState state;
+    if (!decoder.GetAll(state)) return false;
+    logicController->RestoreState(state);
+    return true;
+  }
+
+  case INPUT_PARAMS: {
+    vector<pair<string, double>> params;
+    if (!decoder.GetAll(params)) return false;
+    //the names that were found on the rover, with the values they had
+    logicController->LoadParams([&params](const string& name, double& value) {
+      for (const pair<string, double>& param : params)
+      {
+        if (param.first == name)
+        {
+          value = param.second;
+          return true;
+        }
+      }
+      return false;
+    });
+    return true;
+  }
+
+  case INPUT_SEARCH_PATTERN: {
+    string name;
+    uint32_t seed;
+    if (!decoder.GetAll(name, seed)) return false;
+    logicController->SetSearchPattern(name, seed);
+    return true;
+  }
+
+  case INPUT_ROVER_ID: {
+    uint32_t id;
+    if (!decoder.GetAll(id)) return false;
+    logicController->SetRoverId(id);
+    return true;
+  }
+
+  case INPUT_SWARM_MEMBERS: {
+    vector<uint32_t> members;
+    if (!decoder.GetAll(members)) return false;
+    logicController->SetSwarmMembers(members);
+    return true;
+  }
+
+  case INPUT_ALLOCATION: {
+    int64_t runTime;
+    if (!decoder.GetAll(runTime)) return false;
+    vector<AllocationBid> bids;
+    logicController->UpdateAllocation(runTime, bids);
+    return true;
+  }
+
+  case INPUT_BID: {
+    uint32_t sender;
+    AllocationBid bid;
+    if (!decoder.GetAll(sender, bid)) return false;
+    logicController->ReceiveBid(sender, bid);
+    return true;
+  }
+
+  case INPUT_RESERVATIONS_TAKEN: {
+    vector<NestReservation> reservations;
+    logicController->TakeNestReservations(reservations);
+    return true;
+  }
+
+  case INPUT_RESERVATION: {
+    uint32_t sender;
+    NestReservation reservation;
+    if (!decoder.GetAll(sender, reservation)) return false;
+    logicController->ReceiveNestReservation(sender, reservation);
+    return true;
+  }
+
+  case INPUT_NEIGHBOUR_POSE: {
+    uint32_t sender;
+    Point pose;
+    float speed;
+    if (!decoder.GetAll(sender, pose, speed)) return false;
+    logicController->ReceiveNeighbourPose(sender, pose, speed);
+    return true;
+  }
+
+  case INPUT_DELTA_TAKEN: {
+    vector<ResourceEntry> delta;
+    logicController->TakeResourceDelta(delta);
+    return true;
+  }
+
+  case INPUT_DELTA: {
+    vector<ResourceEntry> delta;
+    if (!decoder.GetAll(delta)) return false;
+    logicController->MergeResourceDelta(delta);
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef INPUTREPLAY_H
+#define INPUTREPLAY_H
+
+#include "InputLog.h"
+#include "LogicController.h"
+
+// Feeds the records of an InputLog back into a LogicController, making the
+// same calls in the same order as the ROSAdapter made them on the rover.
+//
+// The LogicController gets its time, its random seeds and everything it
+// knows about the world through those calls, so the replay gives the same
+// Result on every tick as the recorded run did, as fast as the controllers
+// can go. The LogicController must be a fresh one, in static storage like
+// the one of the node, and must not be recording itself.
+class InputReplay
+{
+public:
+  InputReplay(LogicController* logicController);
+
+  // Makes the call the record was made from. For a tick, DoWork runs and
+  // replayed is what it returned now and recorded what it returned in the
+  // recorded run. Returns false if the record can't be decoded.
+  bool Apply(const InputRecord& record, RecordedResult& replayed, RecordedResult& recorded);
+
+private:
+
+  LogicController* logicController;
+};
+
+#endif // INPUTREPLAY_H
@@ -0,0 +1,247 @@
+#include "LocalPlanner.h"
+
+#include <algorithm> // For min and max
+#include <chrono> // For timing the plans
+#include <cmath> // For trig functions
+#include <iostream> // For the timing report
+
+LocalPlanner::LocalPlanner()
+{
+  echoX.assign(maxEchoes, 0);
+  echoY.assign(maxEchoes, 0);
+  echoTime.assign(maxEchoes, 0);
+  obstacleX.reserve(maxEchoes);
+  obstacleY.reserve(maxEchoes);
+
+  int samples = velocitySamples * angularSamples;
+  sampleVelocity.assign(samples, 0);
+  sampleAngular.assign(samples, 0);
+  probeHeading.assign(samples, 0);
+  probeCurvature.assign(samples, 0);
+  freeDistance.assign(samples, 0);
+  score.assign(samples, 0);
+  probeX.assign(samples * probeSteps, 0);
+  probeY.assign(samples * probeSteps, 0);
+  minDistanceSquared.assign(samples * probeSteps, 0);
+}
+
+void LocalPlanner::Clear()
+{
+  nextEcho = 0;
+  echoCount = 0;
+  lastAngular = 0;
+}
+
+void LocalPlanner::AddSonarReadings(Point pose, float left, float center, float right, long int time)
+{
+  AddEcho(pose, sonarForwardOffset, sonarSideOffset, sonarSideYaw, left, time);
+  AddEcho(pose, sonarForwardOffset, 0, 0, center, time);
+  AddEcho(pose, sonarForwardOffset, -sonarSideOffset, -sonarSideYaw, right, time);
+}
+
+void LocalPlanner::AddEcho(Point pose, float offsetX, float offsetY, float yaw, float range, long int time)
+{
+  if (range >= sonarMaxRange - 0.01)
+  {
+    return;
+  }
+
+  float c = cos(pose.theta);
+  float s = sin(pose.theta);
+  float originX = pose.x + c * offsetX - s * offsetY;
+  float originY = pose.y + s * offsetX + c * offsetY;
+
+  //the echo can come from anywhere in the cone, spread a few points across it
+  for (int ray = -1; ray <= 1; ray++)
+  {
+    float heading = pose.theta + yaw + ray * sonarHalfCone * echoSpread;
+    echoX[nextEcho] = originX + range * cos(heading);
+    echoY[nextEcho] = originY + range * sin(heading);
+    echoTime[nextEcho] = time;
+
+    nextEcho = (nextEcho + 1) % maxEchoes;
+    echoCount = min(echoCount + 1, maxEchoes);
+  }
+}
+
+bool LocalPlanner::Plan(Point pose, float linearVelocity, float angularVelocity, long int time,
+                        float goalBearing, float goalDistance, float& velocity, float& angular)
+{
+  auto start = chrono::steady_clock::now();
+
+  float reach = probeLength + roverRadius;
+
+  //recent echoes close enough to matter, in the rover frame
+  float c = cos(pose.theta);
+  float s = sin(pose.theta);
+  obstacleX.clear();
+  obstacleY.clear();
+  for (int i = 0; i < echoCount; i++)
+  {
+    if (time - echoTime[i] > echoLifetime)
+    {
+      continue;
+    }
+
+    float dx = echoX[i] - pose.x;
+    float dy = echoY[i] - pose.y;
+    if (dx * dx + dy * dy < reach * reach)
+    {
+      obstacleX.push_back(c * dx + s * dy);
+      obstacleY.push_back(-s * dx + c * dy);
+    }
+  }
+
+  //velocities reachable within the window
+  float minV = max(0.0f, linearVelocity - linearAcceleration * windowTime);
+  float maxV = min(maxVelocity, max(0.0f, linearVelocity) + linearAcceleration * windowTime);
+  float minW = max(-maxAngular, angularVelocity - angularAcceleration * windowTime);
+  float maxW = min(maxAngular, angularVelocity + angularAcceleration * windowTime);
+  minV = min(minV, maxV);
+  minW = min(minW, maxW);
+
+  const int samples = velocitySamples * angularSamples;
+  for (int v = 0; v < velocitySamples; v++)
+  {
+    for (int w = 0; w < angularSamples; w++)
+    {
+      int i = v * angularSamples + w;
+      sampleVelocity[i] = minV + (maxV - minV) * v / (velocitySamples - 1);
+      sampleAngular[i] = minW + (maxW - minW) * w / (angularSamples - 1);
+    }
+  }
+
+  float horizon = windowTime;
+
+  //probe the path each sample heads along for a fixed length, moving samples
+  //along their arc and turns in place along the heading they end up at
+  float* vs = sampleVelocity.data();
+  float* ws = sampleAngular.data();
+  float* heading0 = probeHeading.data();
+  float* curvature = probeCurvature.data();
+  for (int i = 0; i < samples; i++)
+  {
+    bool turnInPlace = vs[i] < minProgressVelocity;
+    heading0[i] = turnInPlace ? ws[i] * horizon : 0;
+    curvature[i] = turnInPlace ? 0 : ws[i] / vs[i];
+  }
+
+  for (int k = 0; k < probeSteps; k++)
+  {
+    float length = (k + 1) * probeLength / probeSteps;
+    float* xs = probeX.data() + k * samples;
+    float* ys = probeY.data() + k * samples;
+    for (int i = 0; i < samples; i++)
+    {
+      bool straight = fabs(curvature[i]) < 1e-3;
+      float kappa = straight ? 1 : curvature[i];
+      float theta = heading0[i] + curvature[i] * length;
+      xs[i] = straight ? length * cos(heading0[i]) : (sin(theta) - sin(heading0[i])) / kappa;
+      ys[i] = straight ? length * sin(heading0[i]) : (cos(heading0[i]) - cos(theta)) / kappa;
+    }
+  }
+
+  //closest echo to each probe point
+  float* m = minDistanceSquared.data();
+  float far = probeLength * probeLength * 4;
+  for (int i = 0; i < samples * probeSteps; i++)
+  {
+    m[i] = far;
+  }
+  for (int j = 0; j < obstacleX.size(); j++)
+  {
+    float ox = obstacleX[j];
+    float oy = obstacleY[j];
+    for (int k = 0; k < probeSteps; k++)
+    {
+      const float* xs = probeX.data() + k * samples;
+      const float* ys = probeY.data() + k * samples;
+      float* mk = m + k * samples;
+      for (int i = 0; i < samples; i++)
+      {
+        float dx = xs[i] - ox;
+        float dy = ys[i] - oy;
+        float d = dx * dx + dy * dy;
+        mk[i] = d < mk[i] ? d : mk[i];
+      }
+    }
+  }
+
+  //distance along the probe before the rover would touch an echo
+  float* free = freeDistance.data();
+  float radiusSquared = roverRadius * roverRadius;
+  for (int i = 0; i < samples; i++)
+  {
+    free[i] = probeLength;
+  }
+  for (int k = probeSteps - 1; k >= 0; k--)
+  {
+    const float* mk = m + k * samples;
+    float length = k * probeLength / probeSteps;
+    for (int i = 0; i < samples; i++)
+    {
+      free[i] = mk[i] < radiusSquared ? length : free[i];
+    }
+  }
+
+  //score on the heading to the goal at the end of the horizon, the free
+  //distance and the speed
+  float goalX = goalDistance * cos(goalBearing);
+  float goalY = goalDistance * sin(goalBearing);
+  float* scores = score.data();
+  for (int i = 0; i < samples; i++)
+  {
+    bool turnInPlace = vs[i] < minProgressVelocity;
+    bool moving = !turnInPlace || fabs(ws[i]) >= minProgressAngular;
+
+    //a moving rover has to be able to stop before the echo
+    bool admissible = moving && (turnInPlace || vs[i] * vs[i] <= 2 * brakingDeceleration * free[i]);
+
+    float theta = ws[i] * horizon;
+    bool straight = fabs(ws[i]) < 1e-3;
+    float radius = straight ? 0 : vs[i] / (straight ? 1 : ws[i]);
+    float endX = straight ? vs[i] * horizon : radius * sin(theta);
+    float endY = straight ? 0 : radius * (1 - cos(theta));
+
+    float toGoalX = goalX - endX;
+    float toGoalY = goalY - endY;
+    float toGoal = sqrt(toGoalX * toGoalX + toGoalY * toGoalY) + 1e-3;
+    float alignment = (toGoalX * cos(theta) + toGoalY * sin(theta)) / toGoal;
+
+    //keep turning the same way as last time so the rover does not dither
+    float consistent = ws[i] * lastAngular > 0 ? 1 : 0;
+
+    float value = headingWeight * (1 + alignment) / 2
+                + clearanceWeight * free[i] / probeLength
+                + velocityWeight * vs[i] / maxVelocity
+                + consistencyWeight * consistent;
+    scores[i] = admissible ? value : -1;
+  }
+
+  int best = max_element(score.begin(), score.end()) - score.begin();
+  bool found = score[best] >= 0;
+  if (found)
+  {
+    velocity = sampleVelocity[best];
+    angular = sampleAngular[best];
+    lastAngular = angular;
+  }
+
+  RecordTime(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+
+  return found;
+}
+
+void LocalPlanner::RecordTime(double microseconds)
+{
+  totalTime += microseconds;
+  timedPlans++;
+
+  if (timedPlans == timingReportInterval)
+  {
+    cout << "LOCAL PLANNER - average plan time over " << timedPlans << " plans: "
+         << totalTime / timedPlans << " us, " << obstacleX.size() << " echoes in reach" << endl;
+    totalTime = 0;
+    timedPlans = 0;
+  }
+}
@@ -0,0 +1,116 @@
+#ifndef LOCALPLANNER_H
+#define LOCALPLANNER_H
+
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Dynamic window local planner for getting around obstacles.
+//
+// Recent sonar echoes are kept as points in the odometry frame. Each plan
+// samples a grid of (velocity, angular velocity) pairs reachable from the
+// current velocities and rolls every pair forward along its arc (or, for a
+// turn in place, along the heading it turns to) to find how far the rover
+// could go before touching an echo. Samples are scored on the heading
+// towards the goal after the window, that free distance and the speed.
+// Samples that could not stop before an echo are rejected.
+//
+// Probe points and scores are kept as separate arrays per quantity so the
+// loops over samples are straight array arithmetic the compiler can
+// vectorize.
+class LocalPlanner
+{
+public:
+  LocalPlanner();
+
+  // Adds the echoes of one sonar reading taken at the given odometry pose.
+  // Ranges at the sonar maximum are not echoes and are ignored.
+  void AddSonarReadings(Point pose, float left, float center, float right, long int time);
+
+  void Clear();
+
+  // Picks the best arc from the given odometry pose and velocities. The
+  // goal is given relative to the rover, bearing in radians from the
+  // heading (positive to the left) and distance in meters. Returns false
+  // if every sampled arc collides.
+  bool Plan(Point pose, float linearVelocity, float angularVelocity, long int time,
+            float goalBearing, float goalDistance, float& velocity, float& angular);
+
+  int GetEchoCount() const {return echoCount;}
+
+private:
+
+  void AddEcho(Point pose, float offsetX, float offsetY, float yaw, float range, long int time);
+  void RecordTime(double microseconds);
+
+  //sonar geometry relative to the rover center, same as the occupancy grid
+  const float sonarForwardOffset = 0.15; //meters
+  const float sonarSideOffset = 0.07; //meters
+  const float sonarSideYaw = 0.436; //radians the side sonars are turned out
+  const float sonarHalfCone = 0.478; //radians
+  const float sonarMaxRange = 3.0; //meters, reported when nothing echoes
+  const float echoSpread = 0.5; //fraction of the cone the echo points are spread over
+
+  const int maxEchoes = 300; //about 3 seconds of echoes from all sonars
+  const long int echoLifetime = 3000; //milliseconds
+
+  //dynamic window
+  const float maxVelocity = 0.35; //m/s, the search velocity
+  const float maxAngular = 1.2; //rad/s
+  const float linearAcceleration = 0.5; //m/s^2
+  const float angularAcceleration = 2.0; //rad/s^2
+  const float windowTime = 0.5; //seconds of acceleration the window spans
+  const float brakingDeceleration = 0.5; //m/s^2
+  const int velocitySamples = 12;
+  const int angularSamples = 41;
+
+  //probes
+  const float probeLength = 1.5; //meters of path checked for echoes
+  const int probeSteps = 15; //10cm apart
+
+  //standing still never gets around an obstacle
+  const float minProgressVelocity = 0.05; //m/s, slower samples count as turning in place
+  const float minProgressAngular = 0.3; //rad/s
+
+  const float roverRadius = 0.22; //meters, half the rover diagonal
+
+  const float headingWeight = 1.0;
+  const float clearanceWeight = 0.6;
+  const float velocityWeight = 0.3;
+  const float consistencyWeight = 0.05;
+
+  const int timingReportInterval = 100; //plans between timing reports
+
+  // ring buffer of echoes in the odometry frame
+  vector<float> echoX;
+  vector<float> echoY;
+  vector<long int> echoTime;
+  int nextEcho = 0;
+  int echoCount = 0;
+
+  // echoes in the rover frame for the current plan
+  vector<float> obstacleX;
+  vector<float> obstacleY;
+
+  // one entry per sample
+  vector<float> sampleVelocity;
+  vector<float> sampleAngular;
+  vector<float> probeHeading; //heading the probe starts at
+  vector<float> probeCurvature;
+  vector<float> freeDistance;
+  vector<float> score;
+
+  // probe points, step major: step k of sample i is at k * samples + i
+  vector<float> probeX;
+  vector<float> probeY;
+  vector<float> minDistanceSquared;
+
+  float lastAngular = 0;
+
+  double totalTime = 0; //microseconds
+  int timedPlans = 0;
+};
+
+#endif // LOCALPLANNER_H
@@ -1,60 +1,243 @@
 #include "LocationController.h"
-#include "LogicController.h"
 
+#include <cmath> // For hypot and sqrt
 
-LocationController::LocationController()
+RunningAverage::RunningAverage()
+{
+  Reset();
+}
+
+void RunningAverage::Reset()
+{
+  for (int i = 0; i < windowSize; i++)
+  {
+    samplesX[i] = 0;
+    samplesY[i] = 0;
+  }
+
+  sumX = 0;
+  sumY = 0;
+  next = 0;
+  count = 0;
+}
+
+void RunningAverage::AddSample(float x, float y)
+{
+  if (count > 0)
+  {
+    //clamp jumps to the gate around the current average
+    float dx = x - GetX();
+    float dy = y - GetY();
+    float jump = hypot(dx, dy);
+    if (jump > outlierGate)
+    {
+      x = GetX() + dx * outlierGate / jump;
+      y = GetY() + dy * outlierGate / jump;
+    }
+  }
+
+  if (count == windowSize)
+  {
+    //drop the oldest sample from the sum
+    sumX -= samplesX[next];
+    sumY -= samplesY[next];
+  }
+  else
+  {
+    count++;
+  }
+
+  samplesX[next] = x;
+  samplesY[next] = y;
+  sumX += x;
+  sumY += y;
+  next = (next + 1) % windowSize;
+}
+
+float RunningAverage::GetX() const
+{
+  return count > 0 ? sumX / count : 0;
+}
+
+float RunningAverage::GetY() const
 {
+  return count > 0 ? sumY / count : 0;
+}
+
 
+LocationController::LocationController()
+{
+  Reset();
 }
 
 LocationController::~LocationController(){ /*Destructor*/  }
 
-bool LocationController::CNMCurrentLocationAVG()
+void LocationController::Reset()
 {
+  currentLocation.x = 0;
+  currentLocation.y = 0;
+  currentLocation.theta = 0;
+  currentLocationMap = currentLocation;
+  odomTime = 0;
+  mapTime = 0;
+  linearVelocity = 0;
+  angularVelocity = 0;
+
+  odomAverage.Reset();
+  mapAverage.Reset();
+  ResetCenter();
+  nestLocation = {0, 0, 0};
+  localizer.Reset();
+}
 
-  const int CASIZE = 30;
+void LocationController::SetOdomLocation(Point current, long int time)
+{
+  currentLocation = current;
+  odomTime = time;
+  odomAverage.AddSample(current.x, current.y);
+  localizer.Predict(current);
+}
 
-  float avgCurrentCoordsX[CASIZE];
-  float avgCurrentCoordsY[CASIZE];
+void LocationController::SetMapLocation(Point current, long int time)
+{
+  currentLocationMap = current;
+  mapTime = time;
+  mapAverage.AddSample(current.x, current.y);
+}
 
-    static int index = 0;
+void LocationController::SetVelocity(float linearVelocity, float angularVelocity)
+{
+  this->linearVelocity = linearVelocity;
+  this->angularVelocity = angularVelocity;
+}
 
-    if(index < CASIZE)
-    {
+Point LocationController::GetOdomLocationAt(long int time) const
+{
+  return Extrapolate(currentLocation, odomTime, time);
+}
 
-	     avgCurrentCoordsX[index] = currentLocationMap.x;
-    	 avgCurrentCoordsY[index] = currentLocationMap.y;
+Point LocationController::GetMapLocationAt(long int time) const
+{
+  return Extrapolate(currentLocationMap, mapTime, time);
+}
 
-	index++;
+Point LocationController::OdomToMap(Point odomPoint) const
+{
+  //the rover is at both poses at once, so rotate the point about the odom
+  //pose by the heading difference and move it onto the map pose
+  float rotation = currentLocationMap.theta - currentLocation.theta;
+  float dx = odomPoint.x - currentLocation.x;
+  float dy = odomPoint.y - currentLocation.y;
+
+  Point mapPoint;
+  mapPoint.x = currentLocationMap.x + cos(rotation) * dx - sin(rotation) * dy;
+  mapPoint.y = currentLocationMap.y + sin(rotation) * dx + cos(rotation) * dy;
+  mapPoint.theta = odomPoint.theta + rotation;
+  return mapPoint;
+}
 
-	return false;
-    }
-    else
-    {
-	float x = 0, y = 0;
-	for(int i = 0; i < CASIZE; i++)
-	{
-	    x += avgCurrentCoordsX[i];
-	    y += avgCurrentCoordsY[i];
-	}
+Point LocationController::MapToOdom(Point mapPoint) const
+{
+  //the same rotation about the poses the other way round
+  float rotation = currentLocation.theta - currentLocationMap.theta;
+  float dx = mapPoint.x - currentLocationMap.x;
+  float dy = mapPoint.y - currentLocationMap.y;
+
+  Point odomPoint;
+  odomPoint.x = currentLocation.x + cos(rotation) * dx - sin(rotation) * dy;
+  odomPoint.y = currentLocation.y + sin(rotation) * dx + cos(rotation) * dy;
+  odomPoint.theta = mapPoint.theta + rotation;
+  return odomPoint;
+}
 
-	x = x/CASIZE;
-	y = y/CASIZE;
+Point LocationController::Extrapolate(Point pose, long int from, long int to) const
+{
+  long int age = to - from;
+  if (age <= 0)
+  {
+    return pose;
+  }
+  if (age > maxExtrapolationTime)
+  {
+    age = maxExtrapolationTime;
+  }
+
+  float dt = age / 1e3;
+  float dtheta = angularVelocity * dt;
+
+  //integrate along the arc using the heading at the middle of the interval
+  float heading = pose.theta + dtheta / 2;
+  pose.x += linearVelocity * dt * cos(heading);
+  pose.y += linearVelocity * dt * sin(heading);
+  pose.theta = atan2(sin(pose.theta + dtheta), cos(pose.theta + dtheta));
+
+  return pose;
+}
 
-  Point cnmAVGCurrentLocation;
-	cnmAVGCurrentLocation.x = x;
-	cnmAVGCurrentLocation.y = y;
-  cnmAVGCurrentLocation.theta = currentLocation.theta;
+void LocationController::AddCenterSample(Point centerSample)
+{
+  centerSamples++;
+
+  //Welford update of the mean and squared distance from the mean
+  float dx = centerSample.x - centerLocation.x;
+  float dy = centerSample.y - centerLocation.y;
+  centerLocation.x += dx / centerSamples;
+  centerLocation.y += dy / centerSamples;
+  centerM2 += dx * (centerSample.x - centerLocation.x) + dy * (centerSample.y - centerLocation.y);
+}
 
-  //logicController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
+void LocationController::ResetCenter()
+{
+  centerLocation.x = 0;
+  centerLocation.y = 0;
+  centerLocation.theta = 0;
+  centerM2 = 0;
+  centerSamples = 0;
+}
 
-  //staticTest();
+void LocationController::RestoreCenter(Point centerLocation, double centerM2, int centerSamples)
+{
+  this->centerLocation = centerLocation;
+  this->centerM2 = centerM2;
+  this->centerSamples = centerSamples;
+}
 
-	index = 0;
-	return true;
-    }
+Point LocationController::GetAverageOdomLocation() const
+{
+  Point average;
+  average.x = odomAverage.GetX();
+  average.y = odomAverage.GetY();
+  average.theta = currentLocation.theta;
+  return average;
 }
 
-void LocationController::setCurrentLocation(Point current) {
-  currentLocationMap = current;
+Point LocationController::GetAverageMapLocation() const
+{
+  Point average;
+  average.x = mapAverage.GetX();
+  average.y = mapAverage.GetY();
+  average.theta = currentLocation.theta;
+  return average;
+}
+
+float LocationController::GetCenterUncertainty() const
+{
+  if (centerSamples < 2)
+  {
+    return -1;
+  }
+
+  //standard error of the mean of the center samples
+  double variance = centerM2 / (centerSamples - 1);
+  return sqrt(variance / centerSamples);
+}
+
+void LocationController::InitializeLocalizer(Point centerLocationOdom)
+{
+  localizer.Initialize(currentLocation, centerLocationOdom);
+}
+
+void LocationController::AddNestSightings(const vector<Point>& nestTags)
+{
+  localizer.Update(nestTags);
 }
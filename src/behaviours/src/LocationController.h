@@ -1,53 +1,150 @@
 #ifndef LOCATIONCONTROLLER_H
 #define LOCATIONCONTROLLER_H
 
-#include "Controller.h"
-#include "LogicController.h"
+#include <vector>
 
-class LocationController : virtual Controller
+#include "Point.h"
+#include "ParticleFilter.h"
+
+// Windowed average of a 2D position that is updated in constant time.
+// The sum of the last windowSize samples is kept next to a ring buffer so
+// adding a sample only subtracts the oldest one. Samples that jump further
+// than outlierGate from the current average are clamped to the gate so a
+// single bad GPS fix cannot drag the average away.
+class RunningAverage
 {
 public:
-  LocationController();
-  ~LocationController();
+  RunningAverage();
 
+  void Reset();
+  void AddSample(float x, float y);
 
+  bool IsFull() const {return count == windowSize;}
+  int GetCount() const {return count;}
+  float GetX() const;
+  float GetY() const;
 
-  void setCurrentLocation(Point currentLocation);
+  static const int windowSize = 30;
 
-  bool CNMCurrentLocationAVG();
+private:
+  const float outlierGate = 1.5; //meters
+
+  float samplesX[windowSize];
+  float samplesY[windowSize];
+  float sumX = 0;
+  float sumY = 0;
+  int next = 0;
+  int count = 0;
+};
 
-  //Resets internal state to defaults
-  void Reset(){};
+// Single pose estimation service for the behaviours. It is updated once per
+// sensor message by the LogicController and shared read only with every
+// controller that needs a position so they all see the same pose.
+//
+// Besides the latest odom and map poses it keeps a running average of both
+// and the estimate of the collection zone (nest) center collected while the
+// rover waits at the start, together with its uncertainty. Once the
+// rover leaves the start a particle filter uses sightings of the nest to
+// keep the nest position in the odom frame corrected for odometry drift.
+class LocationController
+{
+public:
+  LocationController();
+  ~LocationController();
 
-  //Determines what action should be taken based on current
-  //internal state and data
-  Result DoWork(){};
+  //Resets internal state to defaults
+  void Reset();
+
+  // Pose in the odom frame, from the odometry handler. The time is the
+  // message stamp in milliseconds.
+  void SetOdomLocation(Point currentLocation, long int time);
+
+  // Pose in the map frame (GPS fused), from the map handler
+  void SetMapLocation(Point currentLocationMap, long int time);
+
+  // Latest linear and angular velocity of the rover, used to extrapolate
+  // the poses to the time a controller acts on them.
+  void SetVelocity(float linearVelocity, float angularVelocity);
+
+  // Adds a map frame observation of the nest center. The center estimate
+  // is the mean of all samples and its uncertainty the standard error.
+  void AddCenterSample(Point centerSample);
+  void ResetCenter();
+  // Puts back a center estimate saved before the node restarted.
+  void RestoreCenter(Point centerLocation, double centerM2, int centerSamples);
+
+  Point GetOdomLocation() const {return currentLocation;}
+  Point GetMapLocation() const {return currentLocationMap;}
+
+  // Poses extrapolated from their message stamp to the given time with a
+  // constant velocity and turn rate model. The extrapolation is limited
+  // to maxExtrapolationTime so a stalled sensor does not run away.
+  Point GetOdomLocationAt(long int time) const;
+  Point GetMapLocationAt(long int time) const;
+
+  // Moves a point from the odom frame to the map frame with the offset
+  // between the latest poses in the two frames.
+  Point OdomToMap(Point odomPoint) const;
+  Point MapToOdom(Point mapPoint) const;
+
+  // Windowed averages, the heading is always the latest odom heading
+  Point GetAverageOdomLocation() const;
+  Point GetAverageMapLocation() const;
+  bool HasAverage() const {return mapAverage.IsFull();}
+
+  // Mean of the map frame poses taken at the start, the rover's own start
+  // position, not the nest.
+  Point GetCenterLocation() const {return centerLocation;}
+  float GetCenterUncertainty() const;
+  int GetCenterSampleCount() const {return centerSamples;}
+  double GetCenterM2() const {return centerM2;}
+
+  // Nest center in the map frame, 1.3 m in front of the start pose, set
+  // when the rover leaves the start. Every rover places the same nest
+  // here, so locations sent to the other rovers are relative to it, and
+  // the coverage and pheromone maps and the resource registry are laid out
+  // around it.
+  void SetNestLocation(Point nestLocation) {this->nestLocation = nestLocation;}
+  Point GetNestLocation() const {return nestLocation;}
+
+  // Starts the localizer with the nest position in the current odom frame.
+  void InitializeLocalizer(Point centerLocationOdom);
+  void SeedLocalizer(unsigned int seed) {localizer.Seed(seed);}
+
+  // Nest tags seen in one camera frame, in the rover frame (x forward, y left)
+  void AddNestSightings(const vector<Point>& nestTags);
+
+  // Nest position in the odom frame corrected by the localizer
+  Point GetLocalizedCenterLocation() const {return localizer.GetNestInOdom();}
+  bool IsLocalizerInitialized() const {return localizer.IsInitialized();}
 
-  //Returns whether or not an interrupt must be thrown
-  bool ShouldInterrupt(){};
+private:
 
-  //Returns whether or not a controller should be polled for a Result
-  bool HasWork(){};
+  Point Extrapolate(Point pose, long int from, long int to) const;
 
-private:
+  const long int maxExtrapolationTime = 250; //milliseconds
 
   // Numeric Variables for rover positioning
   Point currentLocation;
   Point currentLocationMap;
-  Point currentLocationAverage;
+  long int odomTime = 0;
+  long int mapTime = 0;
 
-  Point centerLocation;
-  Point centerLocationMap;
-  Point centerLocationOdom;
+  float linearVelocity = 0;
+  float angularVelocity = 0;
 
-//Create Logic controller
-  //LogicController logicController;
+  RunningAverage odomAverage;
+  RunningAverage mapAverage;
+
+  // nest center in the map frame, running mean and sum of squared
+  // differences (Welford) so the variance is available at any time
+  Point centerLocation;
+  double centerM2 = 0;
+  int centerSamples = 0;
 
-protected:
+  Point nestLocation = {0, 0, 0};
 
-  //Looks at external data and determines if an interrupt must be thrown
-  //or if the controller should be polled
-  void ProcessData(){};
+  ParticleFilter localizer;
 };
 
 #endif // LOCATIONCONTROLLER_H
@@ -2,6 +2,28 @@
 
 LogicController::LogicController() {
 
+  //every controller reads the same pose estimate
+  searchController.SetLocationController(&locationController);
+  dropOffController.SetLocationController(&locationController);
+  obstacleController.SetLocationController(&locationController);
+
+  //and the same obstacle map
+  obstacleController.SetOccupancyGrid(&occupancyGrid);
+  searchController.SetOccupancyGrid(&occupancyGrid);
+  driveController.SetOccupancyGrid(&occupancyGrid);
+  pathPlanner.SetOccupancyGrid(&occupancyGrid);
+  driveController.SetPathPlanner(&pathPlanner);
+  driveController.SetReciprocalAvoidance(&reciprocalAvoidance);
+
+  searchController.SetCoverageMap(&coverageMap);
+  searchController.SetPheromoneMap(&pheromoneMap);
+  searchController.SetResourceRegistry(&resourceRegistry);
+  dropOffController.SetNestScheduler(&nestScheduler);
+
+  driveController.SetParamStore(&paramStore);
+  dropOffController.SetParamStore(&paramStore);
+  obstacleController.SetParamStore(&paramStore);
+
   logicState = LOGIC_STATE_INTERRUPT;
   processState = PROCCESS_STATE_SEARCHING;
 
@@ -105,6 +127,11 @@ Result LogicController::DoWork() {
         }
       }
 
+      //a drop off just finished, search from where the cubes were
+      if (result.b == nextProcess && processState == PROCCESS_STATE_SEARCHING) {
+        searchController.SetDroppedOff();
+      }
+
       //update the priorites of the controllers based upon the new process state.
       if (result.b == nextProcess || result.b == prevProcess) {
         ProcessData();
@@ -175,6 +202,11 @@ Result LogicController::DoWork() {
   //now using proccess logic allow the controller to communicate data between eachother
   controllerInterconnect();
 
+  if (inputLog != nullptr)
+  {
+    inputLog->RecordTick(current_time, result);
+  }
+
   //give the ROSAdapter the final decision on how it should drive
   return result;
 }
@@ -287,67 +319,293 @@ void LogicController::controllerInterconnect()
     driveController.Reset();
   }
 
-/*
-  if(driveController.getCurrLocAVG())
-  {
-    locationController.CNMCurrentLocationAVG();
-  }
-*/
-
 }
 
 // Recieves position in the world inertial frame (should rename to SetOdomPositionData)
-void LogicController::SetPositionData(Point currentLocation)
+// time is the stamp of the odometry message in milliseconds
+void LogicController::SetPositionData(Point currentLocation, long int time)
 {
+  record(INPUT_POSITION, currentLocation, (int64_t)time);
+  locationController.SetOdomLocation(currentLocation, time);
   //searchController.SetCurrentLocation(currentLocation);
   //dropOffController.SetCurrentLocation(currentLocation);
   obstacleController.setCurrentLocation(currentLocation);
+  tagTracker.SetCurrentLocation(currentLocation);
   //driveController.SetCurrentLocation(currentLocation);
   manualWaypointController.SetCurrentLocation(currentLocation);
 }
 
 // Recieves position in the world frame with global data (GPS)
-void LogicController::SetMapPositionData(Point currentLocation)
+// time is the stamp of the map message in milliseconds
+void LogicController::SetMapPositionData(Point currentLocation, long int time)
 {
+  record(INPUT_MAP_POSITION, currentLocation, (int64_t)time);
+  locationController.SetMapLocation(currentLocation, time);
   range_controller.setCurrentLocation(currentLocation);
   dropOffController.SetCurrentLocation(currentLocation);
-  driveController.SetCurrentLocation(currentLocation);
   searchController.SetCurrentLocation(currentLocation);
-  //locationController.setCurrentLocation(currentLocation);
+
+  //only count ground as searched while looking for cubes
+  if (processState == PROCCESS_STATE_SEARCHING)
+  {
+    coverageMap.MarkFootprint(currentLocation);
+  }
+
+  //drive controller gets the pose extrapolated to the control tick in SetCurrentTimeInMilliSecs
 }
 
 void LogicController::SetVelocityData(float linearVelocity, float angularVelocity)
 {
+  record(INPUT_VELOCITY, linearVelocity, angularVelocity);
+  locationController.SetVelocity(linearVelocity, angularVelocity);
   driveController.SetVelocityData(linearVelocity,angularVelocity);
+  obstacleController.setVelocity(linearVelocity, angularVelocity);
 }
 
 void LogicController::SetMapVelocityData(float linearVelocity, float angularVelocity)
 {
-
+  record(INPUT_MAP_VELOCITY, linearVelocity, angularVelocity);
 }
 
 void LogicController::SetAprilTags(vector<Tag> tags)
 {
+  record(INPUT_TAGS, tags);
+  tagTracker.Update(tags);
+
+  //remember where cubes were seen. Only cubes found while searching are a
+  //site, the one being picked up or carried and the ones already dropped in
+  //the nest are not.
+  if (processState == PROCCESS_STATE_SEARCHING)
+  {
+    Point rover = locationController.GetOdomLocation();
+    Point nest = locationController.GetNestLocation();
+    vector<Point> cubes;
+    for (const TagTrack& track : tagTracker.GetTracks())
+    {
+      if (track.id != 0 || track.hits < cubeSightingHits
+          || hypot(track.x - rover.x, track.y - rover.y) <= cubeSightingMinDistance)
+      {
+        continue;
+      }
+
+      Point cube;
+      cube.x = track.x;
+      cube.y = track.y;
+      cube.theta = 0;
+      cube = locationController.OdomToMap(cube);
+      if (hypot(cube.x - nest.x, cube.y - nest.y) < cubeSightingNestRadius)
+      {
+        continue;
+      }
+
+      //hits only goes up once per camera frame so each track deposits once
+      //even if the cube stays in view
+      if (track.hits == cubeSightingHits)
+      {
+        pheromoneMap.Deposit(cube, cubeSightingAmount, current_time);
+      }
+      cubes.push_back(cube);
+    }
+
+    //the registry keeps the most cubes seen at once in each cell, seeing
+    //the same cubes again on a later pass does not add to the count
+    resourceRegistry.ObserveCubes(cubes);
+  }
+
+  //sightings of the center correct the odometry drift of the localizer
+  vector<Point> nestTags;
+  for (const Tag& tag : tags)
+  {
+    if (tag.getID() == 256)
+    {
+      nestTags.push_back(tagTracker.CameraToRover(tag));
+    }
+  }
+  locationController.AddNestSightings(nestTags);
+
   pickUpController.SetTagData(tags);
   obstacleController.setTagData(tags);
-  dropOffController.SetTargetData(tags);
+}
+
+void LogicController::SetRoverId(uint32_t id)
+{
+  record(INPUT_ROVER_ID, id);
+  roverId = id;
+  resourceRegistry.SetNode(id);
+  taskAllocator.SetNode(id);
+  nestScheduler.SetNode(id);
+
+  //the same inputs give the same particles, and every rover its own
+  locationController.SeedLocalizer(id);
+}
+
+void LogicController::SetSwarmMembers(const vector<uint32_t>& members)
+{
+  record(INPUT_SWARM_MEMBERS, members);
+  if (!searchPartition.SetMembers(members))
+  {
+    return;
+  }
+
+  float start, width;
+  bool hasRegion = searchPartition.GetRegion(roverId, start, width);
+  searchController.SetSearchRegion(hasRegion, start, width);
+}
+
+bool LogicController::GetSearchRegion(float& start, float& width)
+{
+  return searchPartition.GetRegion(roverId, start, width);
+}
+
+bool LogicController::UpdateAllocation(long int runTime, vector<AllocationBid>& bids)
+{
+  record(INPUT_ALLOCATION, (int64_t)runTime);
+  if (!resourceRegistry.HasOrigin())
+  {
+    return false;
+  }
+
+  //the market is relative to the nest, like the swarm bus
+  Point center = locationController.GetNestLocation();
+  vector<AllocationTask> tasks;
+
+  vector<Point> clusters;
+  vector<int> remaining;
+  resourceRegistry.GetAvailable(clusters, remaining);
+  for (int i = 0; i < clusters.size(); i++)
+  {
+    AllocationTask task;
+    task.location.x = clusters[i].x - center.x;
+    task.location.y = clusters[i].y - center.y;
+    task.location.theta = 0;
+    task.value = 0.4 + 0.15 * min(remaining[i], 4);
+    task.cluster = true;
+    tasks.push_back(task);
+  }
+
+  Point location = locationController.GetMapLocation();
+  location.x -= center.x;
+  location.y -= center.y;
+  bool carrying = processState == PROCCESS_STATE_TARGET_PICKEDUP || processState == PROCCESS_STATE_DROP_OFF;
+
+  taskAllocator.SetTasks(tasks);
+  taskAllocator.SetState(location, carrying, roundLength - runTime / 1e3);
+  if (taskAllocator.Update(current_time))
+  {
+    Point cluster;
+    if (taskAllocator.GetCluster(cluster))
+    {
+      cluster.x += center.x;
+      cluster.y += center.y;
+      searchController.SetAllocatedCluster(true, cluster);
+    }
+    else
+    {
+      searchController.SetAllocatedCluster(false, cluster);
+    }
+  }
+
+  return taskAllocator.TakeBids(current_time, bids);
+}
+
+void LogicController::ReceiveBid(uint32_t sender, const AllocationBid& bid)
+{
+  record(INPUT_BID, sender, bid);
+  taskAllocator.Receive(sender, bid, current_time);
+}
+
+bool LogicController::TakeNestReservations(vector<NestReservation>& reservations)
+{
+  record(INPUT_RESERVATIONS_TAKEN);
+  return nestScheduler.TakeReservations(current_time, reservations);
+}
+
+void LogicController::ReceiveNestReservation(uint32_t sender, const NestReservation& reservation)
+{
+  record(INPUT_RESERVATION, sender, reservation);
+  nestScheduler.Receive(sender, reservation, current_time);
+}
+
+void LogicController::ReceiveNeighbourPose(uint32_t sender, Point pose, float speed)
+{
+  record(INPUT_NEIGHBOUR_POSE, sender, pose, speed);
+  Point center = locationController.GetNestLocation();
+  pose.x += center.x;
+  pose.y += center.y;
+  reciprocalAvoidance.SetNeighbour(sender, pose, speed);
+}
+
+bool LogicController::TakeResourceDelta(vector<ResourceEntry>& delta)
+{
+  record(INPUT_DELTA_TAKEN);
+  return resourceRegistry.TakeDelta(current_time, delta);
+}
+
+void LogicController::MergeResourceDelta(const vector<ResourceEntry>& delta)
+{
+  record(INPUT_DELTA, delta);
+  resourceRegistry.Merge(delta);
+}
+
+void LogicController::updateTrackedTags()
+{
+  int left, right;
+
+  //the center tags are counted from their tracks so a missed frame does not reset the centering
+  tagTracker.CountVisibleTracks(256, dropOffController.GetCameraOffsetCorrection(), left, right);
+  dropOffController.SetCenterTagCounts(left, right);
+
+  //if the center is in view don't try to pick up a cube, the pickup controller
+  //resets itself when it sees the center in a camera frame. A cube the pickup
+  //controller gave up on is passed over for the next closest one.
+  TagTrack cube;
+  if ((left + right) == 0 && tagTracker.GetClosestTrack(0, cube, pickUpController.GetIgnoredTrack()))
+  {
+    float forward, lateral;
+    tagTracker.GetRelativePosition(cube, forward, lateral);
+    pickUpController.SetTrackedTarget(forward, lateral, cube.trackID);
+  }
 }
 
 void LogicController::SetSonarData(float left, float center, float right)
 {
+  record(INPUT_SONAR, left, center, right);
+
+  //a held cube blocks the center sonar
+  bool useCenter = processState == PROCCESS_STATE_SEARCHING;
+  occupancyGrid.Update(locationController.GetMapLocation(), left, center, right, useCenter);
+
+  //hand the cells that changed to the planner so it can repair its route
+  pathPlanner.UpdateCells(occupancyGrid.GetChangedCells(), occupancyGrid.ChangedCellsOverflowed());
+  occupancyGrid.ClearChangedCells();
+
+  //the local planner steers around obstacles towards the waypoint drive was heading for
+  Point goal;
+  bool hasGoal = driveController.GetCurrentWaypoint(goal);
+  obstacleController.SetGoal(goal, hasGoal);
+
   pickUpController.SetSonarData(center);
   obstacleController.setSonarData(left,center,right);
 }
 
+void LogicController::SetGripperData(float fingerAngle, float wristAngle)
+{
+  record(INPUT_GRIPPER, fingerAngle, wristAngle);
+  pickUpController.SetGripperData(fingerAngle, wristAngle);
+  dropOffController.SetGripperData(fingerAngle, wristAngle);
+}
+
 // Called once by RosAdapter in guarded init
 void LogicController::SetCenterLocationOdom(Point centerLocationOdom)
 {
+  record(INPUT_CENTER_ODOM, centerLocationOdom);
   searchController.SetCenterLocation(centerLocationOdom);  //used in Base Code
   dropOffController.SetCenterLocation(centerLocationOdom); //used in Base Code
 }
 
 void LogicController::AddManualWaypoint(Point manualWaypoint, int waypoint_id)
 {
+  record(INPUT_WAYPOINT_ADD, manualWaypoint, (int32_t)waypoint_id);
   manualWaypointController.AddManualWaypoint(manualWaypoint, waypoint_id);
   //TODO: added switch into PROCESS_STATE_MANUAL
   //processState = PROCESS_STATE_MANUAL;
@@ -356,43 +614,85 @@ void LogicController::AddManualWaypoint(Point manualWaypoint, int waypoint_id)
 
 void LogicController::RemoveManualWaypoint(int waypoint_id)
 {
+  record(INPUT_WAYPOINT_REMOVE, (int32_t)waypoint_id);
   manualWaypointController.RemoveManualWaypoint(waypoint_id);
 }
 
 std::vector<int> LogicController::GetClearedWaypoints()
 {
+  record(INPUT_WAYPOINTS_CLEARED);
   return manualWaypointController.ReachedWaypoints();
 }
 
 void LogicController::setVirtualFenceOn( RangeShape* range )
 {
+  RangeCircle* circle = dynamic_cast<RangeCircle*>(range);
+  RangeRectangle* rectangle = dynamic_cast<RangeRectangle*>(range);
+  if (circle != nullptr)
+  {
+    record(INPUT_FENCE, (int32_t)1, range->getCenter(), circle->getRadius(), 0.0f);
+  }
+  else if (rectangle != nullptr)
+  {
+    record(INPUT_FENCE, (int32_t)2, range->getCenter(), rectangle->getWidth(), rectangle->getHeight());
+  }
+
   range_controller.setRangeShape(range);
   range_controller.setEnabled(true);
 }
 
 void LogicController::setVirtualFenceOff()
 {
+  Point none = {0, 0, 0};
+  record(INPUT_FENCE, (int32_t)0, none, 0.0f, 0.0f);
   range_controller.setEnabled(false);
 }
 
 void LogicController::SetCenterLocationMap(Point centerLocationMap)
 {
+  record(INPUT_CENTER_MAP, centerLocationMap);
+
   //searchController.SetCenterLocation(centerLocationMap); //CNM added since Base Code
   //dropOffController.SetCenterLocation(centerLocationMap); //CNM added since Base Code
+
+  locationController.SetNestLocation(centerLocationMap);
+
+  //the coverage and pheromone maps are laid out around the center
+  coverageMap.SetOrigin(centerLocationMap);
+  pheromoneMap.SetOrigin(centerLocationMap);
+  resourceRegistry.SetOrigin(centerLocationMap);
 }
 
 
 
 
+void LogicController::SetSearchPattern(string name, unsigned int seed)
+{
+  record(INPUT_SEARCH_PATTERN, name, (uint32_t)seed);
+  searchController.SetSearchPattern(name, seed);
+}
+
 void LogicController::SetCurrentTimeInMilliSecs( long int time )
 {
+  record(INPUT_TIME, (int64_t)time);
   current_time = time;
   dropOffController.SetCurrentTimeInMilliSecs( time );
   pickUpController.SetCurrentTimeInMilliSecs( time );
   obstacleController.setCurrentTimeInMilliSecs( time );
+  searchController.SetCurrentTimeInMilliSecs( time );
+  reciprocalAvoidance.SetCurrentTime( time );
+
+  //the map pose can be up to one EKF period old when the tick runs, so the
+  //drive controller acts on the pose extrapolated to the tick time instead
+  driveController.SetCurrentLocation( locationController.GetMapLocationAt( time ) );
+
+  //predict the tracked tags to this control tick
+  tagTracker.SetCurrentTimeInMilliSecs( time );
+  updateTrackedTags();
 }
 
 void LogicController::SetModeAuto() {
+  record(INPUT_MODE, true);
   if(processState == PROCESS_STATE_MANUAL) {
     // only do something if we are in manual mode
     this->Reset();
@@ -401,30 +701,81 @@ void LogicController::SetModeAuto() {
 }
 void LogicController::SetModeManual()
 {
+  record(INPUT_MODE, false);
   if(processState != PROCESS_STATE_MANUAL) {
     logicState = LOGIC_STATE_INTERRUPT;
     processState = PROCESS_STATE_MANUAL;
     ProcessData();
     control_queue = priority_queue<PrioritizedController>();
     driveController.Reset();
+
+    //a rover driven by hand doesn't use its nest reservation
+    nestScheduler.Cancel();
   }
 }
 
-void LogicController::cnmSetCenterLocationMAP(Point cnmCenterLocation)
+void LogicController::AddCenterLocationSample(Point centerSample)
+{
+  record(INPUT_CENTER_SAMPLE, centerSample);
+  locationController.AddCenterSample(centerSample);
+}
+
+void LogicController::InitializeLocalizer(Point centerLocationOdom)
+{
+  record(INPUT_LOCALIZER, centerLocationOdom);
+  locationController.InitializeLocalizer(centerLocationOdom);
+}
+
+void LogicController::SaveState(RoverState& state)
 {
-  searchController.cnmSetCenterLocation(cnmCenterLocation); //CNM added since Base Code
-  dropOffController.cnmSetCenterLocation(cnmCenterLocation); //CNM added since Base Code
+  state.centerLocation = locationController.GetCenterLocation();
+  state.centerM2 = locationController.GetCenterM2();
+  state.centerSamples = locationController.GetCenterSampleCount();
+  state.processState = processState;
 }
 
-void LogicController::cnmSetAvgCurrentLocation(Point cnmAVGCurrentLocation)
+void LogicController::RestoreState(const RoverState& state)
 {
+  record(INPUT_RESTORE, state);
+
+  //the calls below are part of the restore, a replay makes them again
+  InputLog* restoreLog = inputLog;
+  inputLog = nullptr;
+
+  locationController.RestoreCenter(state.centerLocation, state.centerM2, state.centerSamples);
+  SetCenterLocationMap(state.centerLocationMap);
+
+  //odometry starts over if the whole rover restarted, the map frame does not
+  Point centerLocationOdom = locationController.MapToOdom(state.centerLocationMap);
+  SetCenterLocationOdom(centerLocationOdom);
+  InitializeLocalizer(centerLocationOdom);
+  inputLog = restoreLog;
+
+  //where a drop off had got to is lost, start it over with the cube
+  if (state.processState == PROCCESS_STATE_TARGET_PICKEDUP || state.processState == PROCCESS_STATE_DROP_OFF)
+  {
+    processState = PROCCESS_STATE_TARGET_PICKEDUP;
+    dropOffController.SetTargetPickedUp();
+    obstacleController.setTargetHeld();
+    logicState = LOGIC_STATE_INTERRUPT;
+    ProcessData();
+  }
+}
 
-  searchController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
-  driveController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
-  /*dropOffController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
-  obstacleController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
-  manualWaypointController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
-  */
+int LogicController::LoadParams(const ParamStore::Lookup& lookup)
+{
+  //the lookup can't be recorded, the values it found can
+  vector<pair<string, double>> found;
+  int changed = paramStore.Load([&](const string& name, double& value) {
+    if (!lookup(name, value))
+    {
+      return false;
+    }
+    found.push_back(make_pair(name, value));
+    return true;
+  });
+  record(INPUT_PARAMS, found);
+  return changed;
 }
 
 void staticTest(){
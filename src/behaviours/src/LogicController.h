@@ -12,6 +12,19 @@
 
 //CNM added Controllers
 #include "LocationController.h"
+#include "TagTracker.h"
+#include "OccupancyGrid.h"
+#include "CoverageMap.h"
+#include "PheromoneMap.h"
+#include "ResourceRegistry.h"
+#include "TaskAllocator.h"
+#include "SearchPartition.h"
+#include "NestScheduler.h"
+#include "ReciprocalAvoidance.h"
+#include "PathPlanner.h"
+#include "StateSnapshot.h"
+#include "ParamStore.h"
+#include "InputLog.h"
 
 
 #include <vector>
@@ -46,15 +59,38 @@ public:
 
   void SetAprilTags(vector<Tag> tags);
   void SetSonarData(float left, float center, float right);
-  void SetPositionData(Point currentLocation);
-  void SetMapPositionData(Point currentLocationMap);
+  //angles the finger and wrist servos last moved to, in radians
+  void SetGripperData(float fingerAngle, float wristAngle);
+  void SetPositionData(Point currentLocation, long int time);
+  void SetMapPositionData(Point currentLocationMap, long int time);
   void SetVelocityData(float linearVelocity, float angularVelocity);
   void SetMapVelocityData(float linearVelocity, float angularVelocity);
   void SetCenterLocationOdom(Point centerLocationOdom);
   void SetCenterLocationMap(Point centerLocationMap);
 
-  void cnmSetCenterLocationMAP(Point cnmCenterLocation);
-  void cnmSetAvgCurrentLocation(Point cnmAVGCurrentLocation);
+  // Adds a map frame sample of the nest center to the pose service
+  // while the rover waits at the start.
+  void AddCenterLocationSample(Point centerSample);
+  Point GetCenterLocation() {return locationController.GetCenterLocation();}
+  float GetCenterUncertainty() {return locationController.GetCenterUncertainty();}
+  int GetCenterSampleCount() {return locationController.GetCenterSampleCount();}
+  // The nest every rover agrees on, locations on the swarm bus are
+  // relative to it.
+  Point GetNestLocation() {return locationController.GetNestLocation();}
+
+  // Starts the nest localizer once the center has been placed in the odom
+  // frame. Afterwards GetLocalizedCenterLocation follows odometry drift.
+  void InitializeLocalizer(Point centerLocationOdom);
+  Point GetLocalizedCenterLocation() {return locationController.GetLocalizedCenterLocation();}
+
+  // Fills in the center estimate and the process state for the snapshot
+  // that lets the rover carry on after the node restarts.
+  void SaveState(RoverState& state);
+
+  // Puts the center back, places it in the current odom frame through the
+  // map pose, starts the localizer there and goes back to returning the
+  // cube if one was held. Needs both poses and auto mode.
+  void RestoreState(const RoverState& state);
 
   //static void staticTest();
 
@@ -91,12 +127,56 @@ public:
 
   void SetCurrentTimeInMilliSecs( long int time );
 
+  // Reads the tuning constants through the lookup, see ParamStore. Returns
+  // the number of values that changed.
+  int LoadParams(const ParamStore::Lookup& lookup);
+  // Between behaviour loop ticks, where no controller holds a snapshot of
+  // the parameters, so the replaced ones can be freed.
+  void ParamsQuiescent() {paramStore.Quiescent();}
+
+  // Select the search pattern by name, from the search_pattern parameter.
+  void SetSearchPattern(string name, unsigned int seed);
+
+  // Name hash of this rover, identifies its writes to the resource registry
+  // and its bids.
+  void SetRoverId(uint32_t id);
+
+  // Name hashes of the live rovers in the swarm, the arena is split into
+  // one search wedge for each.
+  void SetSwarmMembers(const vector<uint32_t>& members);
+  bool GetSearchRegion(float& start, float& width);
+
+  // Puts the known clusters on the market, rebuilds the bundle of this
+  // rover and returns the bids to report if any are due. The run time is
+  // the milliseconds since the rover left the start, the bids weigh the
+  // time left in the round.
+  bool UpdateAllocation(long int runTime, vector<AllocationBid>& bids);
+  void ReceiveBid(uint32_t sender, const AllocationBid& bid);
+
+  // Reservations of the collection zone, see NestScheduler.
+  bool TakeNestReservations(vector<NestReservation>& reservations);
+  void ReceiveNestReservation(uint32_t sender, const NestReservation& reservation);
+
+  // Pose beacon of another rover, relative to the nest, with its forward
+  // speed in meters per second.
+  void ReceiveNeighbourPose(uint32_t sender, Point pose, float speed);
+
+  // Registry cells to send to the other rovers if a delta is due, and the
+  // cells received from them.
+  bool TakeResourceDelta(vector<ResourceEntry>& delta);
+  void MergeResourceDelta(const vector<ResourceEntry>& delta);
+
   // Tell the logic controller whether rovers should automatically
   // resstrict their foraging range. If so provide the shape of the
   // allowed range.
   void setVirtualFenceOn( RangeShape* range );
   void setVirtualFenceOff( );
 
+  // Records every call that gives the logic controller an input, and what
+  // DoWork returns, so the run can be replayed with InputReplay. Null to
+  // stop recording.
+  void SetInputLog(InputLog* inputLog) {this->inputLog = inputLog;}
+
 protected:
   void ProcessData();
 
@@ -129,14 +209,70 @@ private:
   ManualWaypointController manualWaypointController;
 
   //CNM added controllers
-  //LocationController locationController;
+  //single pose service shared read only with the controllers
+  LocationController locationController;
+
+  //tuning constants, read by the controllers through snapshots
+  ParamStore paramStore;
+
+  //tracks cubes and collection zone tags across camera frames
+  TagTracker tagTracker;
+
+  //obstacles seen by the sonars, shared read only with the controllers
+  OccupancyGrid occupancyGrid;
+
+  //ground the camera has looked at while searching
+  CoverageMap coverageMap;
+
+  //cubes seen but not picked up, where to go back to after a drop off
+  PheromoneMap pheromoneMap;
+
+  //cube clusters seen by the whole swarm and who is collecting them
+  ResourceRegistry resourceRegistry;
+
+  //auctions the clusters between the rovers
+  TaskAllocator taskAllocator;
+  const float roundLength = 1800; //seconds, bids need the time left
+
+  //search wedges of the rovers around the nest
+  SearchPartition searchPartition;
+  uint32_t roverId = 0;
+
+  //time slotted access to the collection zone
+  NestScheduler nestScheduler;
+
+  //routes the drive controller around obstacles in the occupancy grid
+  PathPlanner pathPlanner;
+
+  //keeps the drive controller clear of the other rovers
+  ReciprocalAvoidance reciprocalAvoidance;
 
   std::vector<PrioritizedController> prioritizedControllers;
   priority_queue<PrioritizedController> control_queue;
 
   void controllerInterconnect();
 
+  //passes the predicted tag tracks to the controllers that use them
+  void updateTrackedTags();
+
+  //cube tracks are recorded in the pheromone map once confirmed
+  const int cubeSightingHits = 3;
+  const float cubeSightingAmount = 1.0;
+  const float cubeSightingMinDistance = 0.5; //meters from the rover, closer cubes are being picked up
+  const float cubeSightingNestRadius = 1.0; //meters around the nest where cubes have been dropped off
+
   long int current_time = 0;
+
+  InputLog* inputLog = nullptr;
+
+  template<typename... Values>
+  void record(InputType type, const Values&... values)
+  {
+    if (inputLog != nullptr)
+    {
+      inputLog->Record(type, values...);
+    }
+  }
 };
 
 #endif // LOGICCONTROLLER_H
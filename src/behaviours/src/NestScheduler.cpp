@@ -0,0 +1,288 @@
+#include "NestScheduler.h"
+
+#include <algorithm> // For max and min
+#include <cmath> // For atan2, hypot and round
+
+NestScheduler::NestScheduler()
+{
+  reservation.start = 0;
+  reservation.lane = 0;
+}
+
+bool NestScheduler::Admit(Point location, long int time)
+{
+  if (firstRequest < 0)
+  {
+    firstRequest = time;
+  }
+  Expire(time);
+
+  if (admitted)
+  {
+    return true;
+  }
+
+  //too late to use it, the next rover may already be coming
+  if (hasReservation && time > reservation.start + zoneTime / 2)
+  {
+    reservations.erase(node);
+    hasReservation = false;
+    holdStart = -1;
+  }
+
+  if (!hasReservation)
+  {
+    Reserve(location, time);
+    if (!hasReservation)
+    {
+      return false;
+    }
+  }
+
+  //let in as far ahead of the start as the drive to the zone takes
+  Point entry = GetEntryPoint();
+  long int drive = (long int)(hypot(entry.x - location.x, entry.y - location.y) / speed * 1e3);
+  if (time + drive >= reservation.start)
+  {
+    admitted = true;
+    lastWait = holdStart >= 0 ? (time - holdStart) / 1e3 : 0;
+    return true;
+  }
+
+  Point hold = GetHoldingPoint();
+  if (holdStart < 0 && hypot(location.x - hold.x, location.y - hold.y) < holdTolerance)
+  {
+    holdStart = time;
+  }
+  return false;
+}
+
+Point NestScheduler::GetHoldingPoint() const
+{
+  return LanePoint(reservation.lane, holdRadius + QueuePosition() * holdSpacing);
+}
+
+Point NestScheduler::GetEntryPoint() const
+{
+  return LanePoint(reservation.lane, entryRadius);
+}
+
+void NestScheduler::Done(long int time)
+{
+  Cancel();
+  drops.push_back(time);
+}
+
+void NestScheduler::Cancel()
+{
+  if (hasReservation)
+  {
+    reservations.erase(node);
+
+    NestReservation release;
+    release.entry = LanePoint(reservation.lane, 0);
+    release.start = (reservation.start / 1000) & 0xff;
+    released.push_back(release);
+    changed = true;
+  }
+
+  hasReservation = false;
+  admitted = false;
+  holdStart = -1;
+}
+
+void NestScheduler::Receive(uint32_t sender, const NestReservation& received, long int time)
+{
+  if (sender == node)
+  {
+    return;
+  }
+
+  if (hypot(received.entry.x, received.entry.y) < entryRadius / 2)
+  {
+    if (reservations.erase(sender) > 0)
+    {
+      drops.push_back(time);
+    }
+    return;
+  }
+
+  Reservation other;
+  other.start = DecodeStart(received.start, time);
+  other.lane = LaneOf(received.entry);
+  reservations[sender] = other;
+
+  //ties go to the larger node, a rover already on its way in keeps going
+  bool overlap = other.start < reservation.start + zoneTime && reservation.start < other.start + zoneTime;
+  if (hasReservation && !admitted && overlap && sender > node)
+  {
+    reservations.erase(node);
+    hasReservation = false;
+    holdStart = -1;
+  }
+}
+
+bool NestScheduler::TakeReservations(long int time, vector<NestReservation>& reservations)
+{
+  if (!changed && lastSent >= 0 && time - lastSent < refreshInterval)
+  {
+    return false;
+  }
+
+  reservations = released;
+  released.clear();
+  if (hasReservation)
+  {
+    NestReservation sent;
+    sent.entry = GetEntryPoint();
+    sent.start = (reservation.start / 1000) & 0xff;
+    reservations.push_back(sent);
+  }
+
+  changed = false;
+  lastSent = time;
+  return !reservations.empty();
+}
+
+float NestScheduler::GetDropsPerMinute(long int time)
+{
+  while (!drops.empty() && time - drops.front() > throughputWindow)
+  {
+    drops.pop_front();
+  }
+
+  if (firstRequest < 0)
+  {
+    return 0;
+  }
+  long int window = min(throughputWindow, time - firstRequest);
+  return window > 0 ? drops.size() * 60000.0 / window : 0;
+}
+
+long int NestScheduler::DecodeStart(int lowByte, long int time)
+{
+  //the second within two minutes either side of now
+  long int now = time / 1000;
+  return (now + (int8_t)(uint8_t)(lowByte - (now & 0xff))) * 1000;
+}
+
+Point NestScheduler::LanePoint(int lane, float radius)
+{
+  float bearing = 2 * M_PI * lane / laneCount;
+
+  Point point;
+  point.x = radius * cos(bearing);
+  point.y = radius * sin(bearing);
+  point.theta = bearing + M_PI; //facing the nest
+  return point;
+}
+
+int NestScheduler::LaneOf(Point point)
+{
+  int lane = (int)round(atan2(point.y, point.x) / (2 * M_PI / laneCount));
+  return (lane + laneCount) % laneCount;
+}
+
+bool NestScheduler::Free(long int start, int lane) const
+{
+  for (const auto& other : reservations)
+  {
+    if (other.first == node)
+    {
+      continue;
+    }
+
+    //a rover on the same lane has to have backed out of it as well
+    long int gap = other.second.lane == lane ? laneClearTime : 0;
+    if (start < other.second.start + zoneTime + gap && other.second.start < start + zoneTime + gap)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void NestScheduler::Reserve(Point location, long int time)
+{
+  bool found = false;
+  Reservation best;
+  float bestDistance = 0;
+
+  for (int lane = 0; lane < laneCount; lane++)
+  {
+    Point entry = LanePoint(lane, entryRadius);
+    float distance = hypot(entry.x - location.x, entry.y - location.y);
+
+    //whole seconds so the start goes over the bus exactly
+    long int arrival = time + (long int)(distance / speed * 1e3);
+    arrival = (arrival + 999) / 1000 * 1000;
+
+    //the earliest free start is the arrival or right after another reservation
+    long int start = -1;
+    if (Free(arrival, lane))
+    {
+      start = arrival;
+    }
+    for (const auto& other : reservations)
+    {
+      long int gap = other.second.lane == lane ? laneClearTime : 0;
+      long int after = (other.second.start + zoneTime + gap + 999) / 1000 * 1000;
+      if (other.first != node && after >= arrival && (start < 0 || after < start) && Free(after, lane))
+      {
+        start = after;
+      }
+    }
+
+    if (start >= 0 && (!found || start < best.start || (start == best.start && distance < bestDistance)))
+    {
+      found = true;
+      best.start = start;
+      best.lane = lane;
+      bestDistance = distance;
+    }
+  }
+
+  if (!found)
+  {
+    return;
+  }
+
+  hasReservation = true;
+  reservation = best;
+  reservations[node] = reservation;
+  changed = true;
+}
+
+int NestScheduler::QueuePosition() const
+{
+  if (!hasReservation)
+  {
+    return 0;
+  }
+
+  int position = 0;
+  for (const auto& other : reservations)
+  {
+    if (other.first != node && other.second.lane == reservation.lane && other.second.start < reservation.start)
+    {
+      position++;
+    }
+  }
+  return position;
+}
+
+void NestScheduler::Expire(long int time)
+{
+  //a reservation that was never released ends once its time is up
+  for (auto other = reservations.begin(); other != reservations.end(); )
+  {
+    if (other->first != node && other->second.start + zoneTime + laneClearTime < time)
+    {
+      other = reservations.erase(other);
+    }
+    else
+    {
+      other++;
+    }
+  }
+}
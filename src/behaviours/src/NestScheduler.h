@@ -0,0 +1,119 @@
+#ifndef NESTSCHEDULER_H
+#define NESTSCHEDULER_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// A reservation as it goes over the swarm bus: the entry point of the lane
+// relative to the nest and the low byte of the second the reservation
+// starts. An entry point at the nest center releases the reservation after
+// a drop off.
+struct NestReservation {
+  Point entry;
+  int start;
+};
+
+// Reservation table for the collection zone, shared over the swarm bus.
+//
+// The nest is approached along a few fixed lanes. Each returning rover
+// reserves the zone for the time it takes to drive in, drop off and back
+// out, starting at the earliest time it can get there that does not
+// overlap a reservation of another rover. A rover coming in on the same
+// lane as the one before it also leaves that rover time to back out of
+// the lane. Until its reservation comes up the rover waits at a holding
+// point on its lane outside the zone, further out the more rovers are
+// queued ahead of it on the same lane, and it is let in when it is as far
+// from the start of its reservation as it is from the zone.
+//
+// Two rovers that reserve overlapping times find out from each other's
+// reports, the larger node keeps its reservation and the other reserves
+// again. A rover that misses its reservation reserves again, and a
+// reservation that is never released ends on its own.
+//
+// Times are ROS time so the rovers agree on them, and are sent rounded up
+// to whole seconds. Points are relative to the nest.
+class NestScheduler
+{
+public:
+  NestScheduler();
+
+  // Name hash of this rover, breaks ties between reservations.
+  void SetNode(uint32_t node) {this->node = node;}
+
+  // Called while driving a cube back. Reserves the zone if there is no
+  // reservation and returns true once this rover may drive in.
+  bool Admit(Point location, long int time);
+
+  // Where to wait for the reservation and where the lane meets the zone.
+  Point GetHoldingPoint() const;
+  Point GetEntryPoint() const;
+
+  // The cube was dropped off, frees the zone.
+  void Done(long int time);
+  // The drop off was given up, frees the zone without counting a drop.
+  void Cancel();
+
+  // A reservation another rover reported on the bus.
+  void Receive(uint32_t sender, const NestReservation& reservation, long int time);
+
+  // Reservations to report if this rover's changed or a refresh is due.
+  // Returns false otherwise.
+  bool TakeReservations(long int time, vector<NestReservation>& reservations);
+
+  // Seconds the last admitted rover spent at its holding point, and drop
+  // offs per minute at the nest by the whole swarm.
+  float GetLastWait() const {return lastWait;}
+  float GetDropsPerMinute(long int time);
+
+  static const int laneCount = 8;
+
+private:
+
+  struct Reservation {
+    long int start; //milliseconds
+    int lane;
+  };
+
+  static long int DecodeStart(int lowByte, long int time);
+  static Point LanePoint(int lane, float radius);
+  static int LaneOf(Point point);
+
+  bool Free(long int start, int lane) const;
+  void Reserve(Point location, long int time);
+  int QueuePosition() const;
+  void Expire(long int time);
+
+  static const long int zoneTime = 8000; //milliseconds to drive in, drop off and back out
+  static const long int laneClearTime = 4000; //milliseconds to back out of the lane
+  const float entryRadius = 1.0; //meters, where a lane meets the zone
+  const float holdRadius = 2.0; //meters, the first holding point of a lane
+  const float holdSpacing = 0.8; //meters between the rovers queued on a lane
+  const float holdTolerance = 0.3; //meters, close enough to count as waiting
+  const float speed = 0.25; //meters per second the rovers average
+  const long int refreshInterval = 1000; //milliseconds
+  const long int throughputWindow = 300000; //milliseconds
+
+  uint32_t node = 0;
+  map<uint32_t, Reservation> reservations; //of the whole swarm by node
+
+  bool hasReservation = false;
+  Reservation reservation;
+  bool admitted = false;
+  long int holdStart = -1;
+  float lastWait = 0; //seconds
+
+  vector<NestReservation> released;
+  bool changed = false;
+  long int lastSent = -1;
+
+  long int firstRequest = -1;
+  deque<long int> drops; //times of the drop offs in the throughput window
+};
+
+#endif // NESTSCHEDULER_H
@@ -1,5 +1,6 @@
 #include "ObstacleController.h"
 //#include "SearchController.h"
+#include <angles/angles.h>
 
 ObstacleController::ObstacleController()
 {
@@ -17,23 +18,90 @@ void ObstacleController::Reset() {
   obstacleDetected = false;
   obstacleInterrupt = false;
   delay = current_time;
+  turnDirection = 0;
+  hasGoal = false;
 }
 
 // Avoid crashing into objects detected by the ultraound
 void ObstacleController::avoidObstacle() {
   
-    //always turn left to avoid obstacles
-    if (right < 0.8 || center < 0.8 || left < 0.8) {
+    //the same distance the sonars were checked against in ProcessData
+    if (right < triggerDistance || center < triggerDistance || left < triggerDistance) {
       result.type = precisionDriving;
+      result.pd.setPointYaw = 0;
 
-      result.pd.cmdAngular = -K_angular;
+      //drive the best collision free arc towards where the rover was going
+      float velocity, angular;
+      if (planAroundObstacle(velocity, angular))
+      {
+        result.pd.cmdVel = velocity;
+        result.pd.cmdAngular = angular;
+
+        //the set point only feeds forward, round it so the integral is not reset every tick
+        result.pd.setPointVel = round(velocity / 0.05) * 0.05;
+        return;
+      }
+
+      //boxed in, turn away from the side the map knows more obstacles on
+      if (turnDirection == 0)
+      {
+        turnDirection = chooseTurnDirection();
+      }
+      result.pd.cmdAngular = turnDirection * K_angular;
 
       result.pd.setPointVel = 0.0;
       result.pd.cmdVel = 0.0;
-      result.pd.setPointYaw = 0;
     }
 }
 
+bool ObstacleController::planAroundObstacle(float& velocity, float& angular) {
+
+  if (locationController == nullptr)
+  {
+    return false;
+  }
+
+  //the goal is in the map frame, the planner works relative to the rover
+  Point pose = locationController->GetMapLocation();
+  if (!hasGoal)
+  {
+    //nowhere in particular to go, get past the obstacle in the direction we were heading
+    goal.x = pose.x + defaultGoalDistance * cos(pose.theta);
+    goal.y = pose.y + defaultGoalDistance * sin(pose.theta);
+    hasGoal = true;
+  }
+
+  float goalBearing = angles::shortest_angular_distance(pose.theta, atan2(goal.y - pose.y, goal.x - pose.x));
+  float goalDistance = hypot(goal.x - pose.x, goal.y - pose.y);
+
+  return localPlanner.Plan(currentLocation, linearVelocity, angularVelocity, current_time, goalBearing, goalDistance, velocity, angular);
+}
+
+// Counts the occupied cells ahead on each side of the rover in the
+// obstacle map. Defaults to the old fixed turn when the map can't tell.
+float ObstacleController::chooseTurnDirection() {
+
+  if (occupancyGrid == nullptr || locationController == nullptr)
+  {
+    return -1;
+  }
+
+  Point pose = locationController->GetMapLocation();
+  int occupiedLeft = occupancyGrid->CountOccupied(pose, 0, M_PI_2, mapLookRange);
+  int occupiedRight = occupancyGrid->CountOccupied(pose, -M_PI_2, 0, mapLookRange);
+
+  cout << "OBSTACLE - occupied cells left: " << occupiedLeft << " right: " << occupiedRight << endl;
+
+  //positive angular commands turn left
+  if (occupiedLeft != occupiedRight)
+  {
+    return occupiedLeft < occupiedRight ? 1 : -1;
+  }
+
+  //nothing known yet, turn away from the closer sonar
+  return left > right ? 1 : -1;
+}
+
 // A collection zone was seen in front of the rover and we are not carrying a target
 // so avoid running over the collection zone and possibly pushing cubes out.
 void ObstacleController::avoidCollectionZone() {
@@ -101,6 +169,9 @@ void ObstacleController::setSonarData(float sonarleft, float sonarcenter, float
   center = sonarcenter;
 
   ProcessData();
+
+  //after ProcessData so a center sonar blocked by a held cube reads as no echo
+  localPlanner.AddSonarReadings(currentLocation, left, center, right, current_time);
 }
 
 void ObstacleController::setCurrentLocation(Point currentLocation) {
@@ -147,6 +218,7 @@ void ObstacleController::ProcessData() {
   }
 
   //if any sonar is below the trigger distance set physical obstacle true
+  triggerDistance = params->Get()->triggerDistance;
   if (left < triggerDistance || right < triggerDistance || center < triggerDistance)
   {
     phys = true;
@@ -256,6 +328,23 @@ void ObstacleController::setCurrentTimeInMilliSecs( long int time )
   current_time = time;
 }
 
+void ObstacleController::setVelocity(float linearVelocity, float angularVelocity)
+{
+  this->linearVelocity = linearVelocity;
+  this->angularVelocity = angularVelocity;
+}
+
+void ObstacleController::SetGoal(Point goal, bool hasGoal)
+{
+  //keep the goal the rover had when it met the obstacle, drive controller
+  //drops its waypoints while the obstacle is avoided
+  if (obstacleAvoided)
+  {
+    this->goal = goal;
+    this->hasGoal = hasGoal;
+  }
+}
+
 void ObstacleController::setTargetHeld() {
   targetHeld = true;
 
@@ -279,3 +368,18 @@ void ObstacleController::setTargetHeldClear()
     ignore_center_sonar = false;
   }
 }
+
+void ObstacleController::SetLocationController(const LocationController* locationController)
+{
+  this->locationController = locationController;
+}
+
+void ObstacleController::SetOccupancyGrid(const OccupancyGrid* occupancyGrid)
+{
+  this->occupancyGrid = occupancyGrid;
+}
+
+void ObstacleController::SetParamStore(const ParamStore* params)
+{
+  this->params = params;
+}
@@ -4,6 +4,10 @@
 #include "Controller.h"
 #include "Tag.h"
 #include "SearchController.h"
+#include "LocationController.h"
+#include "OccupancyGrid.h"
+#include "LocalPlanner.h"
+#include "ParamStore.h"
 
 class ObstacleController : virtual Controller
 {
@@ -22,6 +26,18 @@ public:
   void setIgnoreCenterSonar();
   void setCurrentTimeInMilliSecs( long int time );
   void setTargetHeld ();
+  void setVelocity(float linearVelocity, float angularVelocity);
+
+  //map frame waypoint the rover was driving to, the local planner steers
+  //around the obstacle towards it. Kept while an obstacle is being avoided.
+  void SetGoal(Point goal, bool hasGoal);
+
+  //shared pose service and obstacle map used to pick the turn direction
+  void SetLocationController(const LocationController* locationController);
+  void SetOccupancyGrid(const OccupancyGrid* occupancyGrid);
+
+  //tuning constants, the sonar trigger distance is read from here
+  void SetParamStore(const ParamStore* params);
 
   // Checks if a target is held and if so resets the state of the obestacle controller otherwise does nothing
   void setTargetHeldClear();
@@ -40,6 +56,12 @@ private:
   // Try not to run into a physical object
   void avoidObstacle();
 
+  // Turn towards the side with fewer known obstacles
+  float chooseTurnDirection();
+
+  // Best collision free arc towards the goal from the local planner
+  bool planAroundObstacle(float& velocity, float& angular);
+
   // Are there AprilTags in the camera view that mark the collection zone
   // and are those AprilTags oriented towards or away from the camera.
   bool checkForCollectionZoneTags( vector<Tag> );
@@ -48,7 +70,7 @@ private:
   const float reactivate_center_sonar_threshold = 0.8; //reactive center sonar if it goes back above this distance, assuming it is deactivated
   const int targetCountPivot = 6; ///unused variable
   const float obstacleDistancePivot = 0.2526; ///unused variable
-  const float triggerDistance = 0.8;
+  const float mapLookRange = 1.5; //meters of the obstacle map considered when picking a side
 
   /*
      * Member variables
@@ -86,6 +108,21 @@ private:
   bool can_set_waypoint = false;
 
   float camera_offset_correction = 0.020; //meters;
+
+  const LocationController* locationController = nullptr;
+  const OccupancyGrid* occupancyGrid = nullptr;
+  const ParamStore* params = nullptr;
+  float triggerDistance = 0.8; //meters, from the parameters at the last sonar update
+
+  float turnDirection = 0; //chosen once per obstacle so the rover does not dither
+
+  LocalPlanner localPlanner;
+  float linearVelocity = 0;
+  float angularVelocity = 0;
+
+  Point goal; //map frame
+  bool hasGoal = false;
+  const float defaultGoalDistance = 2.0; //meters ahead when there was no waypoint
 };
 
 #endif // OBSTACLECONTOLLER_H
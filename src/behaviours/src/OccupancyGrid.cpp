@@ -0,0 +1,298 @@
+#include "OccupancyGrid.h"
+
+#include <algorithm> // For sort
+#include <chrono> // For timing the updates
+#include <cmath> // For trig functions
+#include <iostream> // For the timing report
+
+constexpr float OccupancyGrid::cellSize;
+
+// Floor division so negative cells land in the right tile
+static inline int FloorDiv(int value, int divisor)
+{
+  return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+OccupancyGrid::OccupancyGrid()
+{
+  tiles.reserve(maxTiles);
+  pendingUpdates.reserve(1024);
+  changedCells.reserve(maxChangedCells);
+}
+
+void OccupancyGrid::Reset()
+{
+  tiles.clear();
+  lru.clear();
+  ClearChangedCells();
+}
+
+void OccupancyGrid::Update(Point sensorPose, float left, float center, float right, bool useCenter)
+{
+  auto start = chrono::steady_clock::now();
+
+  pendingUpdates.clear();
+
+  MarchSonar(sensorPose, sonarForwardOffset, sonarSideOffset, sonarSideYaw, left);
+  MarchSonar(sensorPose, sonarForwardOffset, -sonarSideOffset, -sonarSideYaw, right);
+  if (useCenter)
+  {
+    MarchSonar(sensorPose, sonarForwardOffset, 0, 0, center);
+  }
+
+  ApplyUpdates();
+
+  RecordTime(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+}
+
+void OccupancyGrid::MarchSonar(Point sensorPose, float offsetX, float offsetY, float yaw, float range)
+{
+  float c = cos(sensorPose.theta);
+  float s = sin(sensorPose.theta);
+  float originX = sensorPose.x + c * offsetX - s * offsetY;
+  float originY = sensorPose.y + s * offsetX + c * offsetY;
+
+  bool echo = range < sonarMaxRange - 0.01;
+  float freeRange = echo ? range - cellSize / 2 : maxFreeRange;
+  float step = cellSize / 2;
+
+  for (int ray = 0; ray < raysPerCone; ray++)
+  {
+    float heading = sensorPose.theta + yaw - sonarHalfCone + 2 * sonarHalfCone * ray / (raysPerCone - 1);
+    float dx = cos(heading);
+    float dy = sin(heading);
+
+    for (float r = 0; r < freeRange; r += step)
+    {
+      CellIndex cell = ToCell(originX + dx * r, originY + dy * r);
+      pendingUpdates.push_back({cell.x, cell.y, missLogOdds});
+    }
+
+    if (echo)
+    {
+      CellIndex cell = ToCell(originX + dx * range, originY + dy * range);
+      pendingUpdates.push_back({cell.x, cell.y, hitLogOdds});
+    }
+  }
+}
+
+void OccupancyGrid::ApplyUpdates()
+{
+  //rays overlap near the sonars, so every cell is updated once per reading
+  //and a hit wins over a miss in the same cell
+  sort(pendingUpdates.begin(), pendingUpdates.end(), [](const CellUpdate& a, const CellUpdate& b) {
+    return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.delta > b.delta);
+  });
+
+  Tile* tile = nullptr;
+  int tileX = 0;
+  int tileY = 0;
+
+  for (int i = 0; i < pendingUpdates.size(); i++)
+  {
+    const CellUpdate& update = pendingUpdates[i];
+    if (i > 0 && update.x == pendingUpdates[i - 1].x && update.y == pendingUpdates[i - 1].y)
+    {
+      continue;
+    }
+
+    int tx = FloorDiv(update.x, tileSize);
+    int ty = FloorDiv(update.y, tileSize);
+    if (tile == nullptr || tx != tileX || ty != tileY)
+    {
+      tile = &GetOrCreateTile(tx, ty);
+      tileX = tx;
+      tileY = ty;
+    }
+
+    int8_t& cell = tile->cells[(update.y - ty * tileSize) * tileSize + (update.x - tx * tileSize)];
+    bool wasOccupied = cell >= occupiedThreshold;
+
+    int value = cell + update.delta;
+    cell = max(-maxLogOdds, min(maxLogOdds, value));
+
+    if ((cell >= occupiedThreshold) != wasOccupied)
+    {
+      if (changedCells.size() < maxChangedCells)
+      {
+        CellIndex changed;
+        changed.x = update.x;
+        changed.y = update.y;
+        changedCells.push_back(changed);
+      }
+      else
+      {
+        changedCellsOverflowed = true;
+      }
+    }
+  }
+}
+
+bool OccupancyGrid::IsOccupied(float x, float y) const
+{
+  return IsCellOccupied(ToCell(x, y));
+}
+
+bool OccupancyGrid::IsCellOccupied(CellIndex cell) const
+{
+  return GetCell(cell.x, cell.y) >= occupiedThreshold;
+}
+
+bool OccupancyGrid::IsOccupiedNear(float x, float y, float radius) const
+{
+  CellIndex low = ToCell(x - radius, y - radius);
+  CellIndex high = ToCell(x + radius, y + radius);
+
+  for (int cx = low.x; cx <= high.x; cx++)
+  {
+    for (int cy = low.y; cy <= high.y; cy++)
+    {
+      float dx = (cx + 0.5) * cellSize - x;
+      float dy = (cy + 0.5) * cellSize - y;
+      if (dx * dx + dy * dy <= radius * radius && GetCell(cx, cy) >= occupiedThreshold)
+      {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool OccupancyGrid::IsPathClear(Point from, Point to, float clearance) const
+{
+  float length = hypot(to.x - from.x, to.y - from.y);
+  int steps = max(1, (int)ceil(length / cellSize));
+
+  for (int i = 0; i <= steps; i++)
+  {
+    float x = from.x + (to.x - from.x) * i / steps;
+    float y = from.y + (to.y - from.y) * i / steps;
+    if (IsOccupiedNear(x, y, clearance))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int OccupancyGrid::CountOccupied(Point pose, float minAngle, float maxAngle, float range) const
+{
+  CellIndex low = ToCell(pose.x - range, pose.y - range);
+  CellIndex high = ToCell(pose.x + range, pose.y + range);
+  int count = 0;
+
+  for (int cx = low.x; cx <= high.x; cx++)
+  {
+    for (int cy = low.y; cy <= high.y; cy++)
+    {
+      if (GetCell(cx, cy) < occupiedThreshold)
+      {
+        continue;
+      }
+
+      float dx = (cx + 0.5) * cellSize - pose.x;
+      float dy = (cy + 0.5) * cellSize - pose.y;
+      if (dx * dx + dy * dy > range * range)
+      {
+        continue;
+      }
+
+      float bearing = atan2(dy, dx) - pose.theta;
+      bearing = atan2(sin(bearing), cos(bearing));
+      if (bearing >= minAngle && bearing <= maxAngle)
+      {
+        count++;
+      }
+    }
+  }
+
+  return count;
+}
+
+void OccupancyGrid::ClearChangedCells()
+{
+  changedCells.clear();
+  changedCellsOverflowed = false;
+}
+
+CellIndex OccupancyGrid::ToCell(float x, float y) const
+{
+  CellIndex cell;
+  cell.x = (int)floor(x / cellSize);
+  cell.y = (int)floor(y / cellSize);
+  return cell;
+}
+
+Point OccupancyGrid::ToPoint(CellIndex cell) const
+{
+  Point point;
+  point.x = (cell.x + 0.5) * cellSize;
+  point.y = (cell.y + 0.5) * cellSize;
+  point.theta = 0;
+  return point;
+}
+
+int8_t OccupancyGrid::GetCell(int x, int y) const
+{
+  int tx = FloorDiv(x, tileSize);
+  int ty = FloorDiv(y, tileSize);
+
+  auto found = tiles.find(MakeKey(tx, ty));
+  if (found == tiles.end())
+  {
+    return 0;
+  }
+
+  return found->second.cells[(y - ty * tileSize) * tileSize + (x - tx * tileSize)];
+}
+
+OccupancyGrid::Tile& OccupancyGrid::GetOrCreateTile(int tileX, int tileY)
+{
+  TileKey key = MakeKey(tileX, tileY);
+
+  auto found = tiles.find(key);
+  if (found != tiles.end())
+  {
+    //mark as most recently used
+    lru.splice(lru.begin(), lru, found->second.lru);
+    return found->second;
+  }
+
+  if (tiles.size() >= maxTiles)
+  {
+    //forget the tile that has gone longest without a sonar update
+    tiles.erase(lru.back());
+    lru.pop_back();
+  }
+
+  lru.push_front(key);
+  Tile& tile = tiles[key];
+  for (int i = 0; i < tileSize * tileSize; i++)
+  {
+    tile.cells[i] = 0;
+  }
+  tile.lru = lru.begin();
+
+  return tile;
+}
+
+OccupancyGrid::TileKey OccupancyGrid::MakeKey(int tileX, int tileY)
+{
+  return ((TileKey)tileX << 32) | (uint32_t)tileY;
+}
+
+void OccupancyGrid::RecordTime(double microseconds)
+{
+  totalTime += microseconds;
+  timedUpdates++;
+
+  if (timedUpdates == timingReportInterval)
+  {
+    cout << "OCCUPANCY - average update time over " << timedUpdates << " updates: "
+         << totalTime / timedUpdates << " us, " << tiles.size() << " tiles" << endl;
+    totalTime = 0;
+    timedUpdates = 0;
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Integer index of a grid cell, cell (x, y) covers
+// [x * cellSize, (x + 1) * cellSize) on each axis.
+struct CellIndex {
+  int x = 0;
+  int y = 0;
+};
+
+// Sparse occupancy map of obstacles seen by the sonars, in the map frame.
+//
+// The world is split into square tiles of tileSize x tileSize cells that
+// are allocated the first time a sonar reaches them and looked up through
+// a hash of the tile coordinates, so a query is a hash lookup and an
+// array index. Each cell is a signed byte of log-odds so a whole tile is
+// a few cache lines. The number of tiles is capped and the least recently
+// updated tile is dropped when a new one is needed, which bounds memory
+// however far the rover drives.
+//
+// Sonar readings are integrated by marching a few rays across the sonar
+// cone: cells before the echo become more likely free and cells at the
+// echo more likely occupied.
+class OccupancyGrid
+{
+public:
+  OccupancyGrid();
+
+  void Reset();
+
+  // Integrates one set of sonar ranges taken at the given map frame pose.
+  // The center sonar is skipped when it is blocked by a held cube.
+  void Update(Point sensorPose, float left, float center, float right, bool useCenter);
+
+  // Queries, all in map frame meters. Unknown cells count as free.
+  bool IsOccupied(float x, float y) const;
+  bool IsOccupiedNear(float x, float y, float radius) const;
+
+  // True if no occupied cell is within clearance of the segment.
+  bool IsPathClear(Point from, Point to, float clearance) const;
+
+  // Number of occupied cells within range of the pose whose bearing
+  // relative to the pose heading is between minAngle and maxAngle.
+  int CountOccupied(Point pose, float minAngle, float maxAngle, float range) const;
+
+  // Cells that became occupied or free since the last ClearChangedCells.
+  // If too many changed for the list, ChangedCellsOverflowed is set and
+  // the consumer should treat the whole map as changed.
+  const vector<CellIndex>& GetChangedCells() const {return changedCells;}
+  bool ChangedCellsOverflowed() const {return changedCellsOverflowed;}
+  void ClearChangedCells();
+
+  CellIndex ToCell(float x, float y) const;
+  Point ToPoint(CellIndex cell) const; //center of the cell
+  bool IsCellOccupied(CellIndex cell) const;
+
+  int GetTileCount() const {return tiles.size();}
+
+  static constexpr float cellSize = 0.1; //meters
+  static const int tileSize = 16; //cells per tile side
+
+private:
+
+  typedef int64_t TileKey;
+
+  struct Tile {
+    int8_t cells[tileSize * tileSize];
+    list<TileKey>::iterator lru;
+  };
+
+  struct CellUpdate {
+    int x;
+    int y;
+    int delta;
+  };
+
+  void MarchSonar(Point sensorPose, float offsetX, float offsetY, float yaw, float range);
+  void ApplyUpdates();
+
+  int8_t GetCell(int x, int y) const;
+  Tile& GetOrCreateTile(int tileX, int tileY);
+  static TileKey MakeKey(int tileX, int tileY);
+
+  void RecordTime(double microseconds);
+
+  //sonar geometry relative to the rover center
+  const float sonarForwardOffset = 0.15; //meters
+  const float sonarSideOffset = 0.07; //meters
+  const float sonarSideYaw = 0.436; //radians the side sonars are turned out
+  const float sonarHalfCone = 0.478; //radians
+  const int raysPerCone = 5;
+  const float sonarMaxRange = 3.0; //meters, reported when nothing echoes
+  const float maxFreeRange = 2.0; //meters cleared when there is no echo
+
+  //log-odds in integer steps, a hit outweighs several misses
+  const int hitLogOdds = 24;
+  const int missLogOdds = -6;
+  const int maxLogOdds = 96;
+  const int occupiedThreshold = 36;
+
+  const int maxTiles = 512; //16KB of cells per 64 tiles
+  const int maxChangedCells = 4096;
+  const int timingReportInterval = 100; //updates between timing reports
+
+  unordered_map<TileKey, Tile> tiles;
+  list<TileKey> lru; //front is the most recently updated tile
+
+  vector<CellUpdate> pendingUpdates; //reused for every update
+  vector<CellIndex> changedCells;
+  bool changedCellsOverflowed = false;
+
+  double totalTime = 0; //microseconds
+  int timedUpdates = 0;
+};
+
+#endif // OCCUPANCYGRID_H
@@ -8,6 +8,18 @@ PID::PID(PIDConfig config)
   integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
 }
 
+void PID::SetConfiguration(PIDConfig config)
+{
+  this->config = config;
+
+  //a PID that never resets on a set point change would index an empty history
+  integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+  if (step >= integralErrorHistArray.size())
+  {
+    step = 0;
+  }
+}
+
 float PID::PIDOut(float calculatedError, float setPoint)
 {
 
@@ -139,28 +151,10 @@ float PID::PIDOut(float calculatedError, float setPoint)
   }
 
   //Derivative
-  if (Error.size() < 4 )//(fabs(P) < config.antiWindup)
-  {
-    float avgPrevError = 0;
-    for (int i = 1; i < Error.size(); i++)
-    {
-      avgPrevError += Error[i];
-    }
-    if (Error.size() > 1)
-    {
-      avgPrevError /= Error.size()-1;
-    }
-    else
-    {
-      avgPrevError = Error[0];
-    }
-
-
-    D = config.Kd * ((Error[0]+Error[1])/2 - (Error[2]+Error[3])/2) * hz;
-
-    //cout << "PID Error[0]:  " << Error[0] << ", Error[1]:  " << Error[1] << ", Error[2]:  " << Error[2] << ", Error[3]:  " << Error[3] << endl;
-
-  }
+  //the derivative was only taken while fewer than the four errors it uses
+  //were kept, reading past the history into whatever the heap held there.
+  //With a full history it was never used, which is how the gains were
+  //tuned, so it is left out and D stays 0.
 
   float PIDOut = P + I + D + FF;
 
@@ -9,7 +9,6 @@ using namespace std;
 struct PIDConfig {
   float Kp = 0;
   float Ki = 0;
-  float Kd = 0;
   float satUpper = 255;
   float satLower = -255;
   float antiWindup = satUpper/2;
@@ -36,7 +35,9 @@ public:
 
   float PIDOut(float calculatedError, float setPoint);
 
-  void SetConfiguration(PIDConfig config) {this->config = config;}
+  // Keeps the error history, sizes the integral history to the new
+  // configuration.
+  void SetConfiguration(PIDConfig config);
 
 private:
 
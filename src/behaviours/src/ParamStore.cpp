@@ -0,0 +1,108 @@
+#include "ParamStore.h"
+
+#include <iostream>
+
+ParamStore::ParamStore()
+{
+  current.store(new BehaviourParams());
+  quiescentCount.store(0);
+
+  Add("drive/search_velocity", offsetof(BehaviourParams, searchVelocity), 0, 0.65);
+  Add("drive/waypoint_tolerance", offsetof(BehaviourParams, waypointTolerance), 0.05, 2);
+
+  //gains of the wheel speed and heading PIDs of the drive controller
+  Add("drive/fast_vel/kp", offsetof(BehaviourParams, fastVel.Kp), 0, 1000);
+  Add("drive/fast_vel/ki", offsetof(BehaviourParams, fastVel.Ki), 0, 1000);
+  Add("drive/fast_yaw/kp", offsetof(BehaviourParams, fastYaw.Kp), 0, 1000);
+  Add("drive/fast_yaw/ki", offsetof(BehaviourParams, fastYaw.Ki), 0, 1000);
+  Add("drive/slow_vel/kp", offsetof(BehaviourParams, slowVel.Kp), 0, 1000);
+  Add("drive/slow_vel/ki", offsetof(BehaviourParams, slowVel.Ki), 0, 1000);
+  Add("drive/slow_yaw/kp", offsetof(BehaviourParams, slowYaw.Kp), 0, 1000);
+  Add("drive/slow_yaw/ki", offsetof(BehaviourParams, slowYaw.Ki), 0, 1000);
+  Add("drive/const_vel/kp", offsetof(BehaviourParams, constVel.Kp), 0, 1000);
+  Add("drive/const_vel/ki", offsetof(BehaviourParams, constVel.Ki), 0, 1000);
+  Add("drive/const_yaw/kp", offsetof(BehaviourParams, constYaw.Kp), 0, 1000);
+  Add("drive/const_yaw/ki", offsetof(BehaviourParams, constYaw.Ki), 0, 1000);
+
+  Add("drop_off/velocity", offsetof(BehaviourParams, dropOffVelocity), 0, 0.65);
+  Add("drop_off/timeout", offsetof(BehaviourParams, dropOffTimeout), 0.5, 20);
+  Add("drop_off/drive_in_distance", offsetof(BehaviourParams, dropOffDriveIn), 0.1, 2);
+
+  Add("obstacle/trigger_distance", offsetof(BehaviourParams, triggerDistance), 0.2, 3);
+}
+
+ParamStore::~ParamStore()
+{
+  for (const Retired& old : retired)
+  {
+    delete old.params;
+  }
+  delete current.load();
+}
+
+void ParamStore::Add(const string& name, size_t offset, float min, float max)
+{
+  info.push_back(ParamInfo{name, offset, min, max});
+}
+
+float& ParamStore::Field(BehaviourParams& params, size_t offset)
+{
+  return *(float*)((char*)&params + offset);
+}
+
+int ParamStore::Load(const Lookup& lookup)
+{
+  Reclaim();
+
+  const BehaviourParams* old = Get();
+  BehaviourParams* next = new BehaviourParams(*old);
+
+  int changed = 0;
+  for (const ParamInfo& param : info)
+  {
+    double value;
+    if (!lookup(param.name, value))
+    {
+      continue;
+    }
+
+    float& field = Field(*next, param.offset);
+    if ((float)value < param.min || (float)value > param.max)
+    {
+      cout << "PARAMS - " << param.name << " " << value << " is outside " << param.min << " to " << param.max
+           << ", kept " << field << endl;
+      continue;
+    }
+    if ((float)value != field)
+    {
+      cout << "PARAMS - " << param.name << " " << field << " -> " << value << endl;
+      field = value;
+      changed++;
+    }
+  }
+
+  if (changed == 0)
+  {
+    delete next;
+    return 0;
+  }
+
+  next->version = old->version + 1;
+  current.store(next);
+  retired.push_back(Retired{old, quiescentCount.load()});
+  return changed;
+}
+
+void ParamStore::Reclaim()
+{
+  //a reader that loaded the old snapshot did so before it was replaced,
+  //once it has been quiescent since then it has let go of it
+  uint64_t count = quiescentCount.load();
+  auto freed = retired.begin();
+  while (freed != retired.end() && freed->quiescentCount < count)
+  {
+    delete freed->params;
+    ++freed;
+  }
+  retired.erase(retired.begin(), freed);
+}
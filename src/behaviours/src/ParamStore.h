@@ -0,0 +1,109 @@
+#ifndef PARAMSTORE_H
+#define PARAMSTORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The PIDs have no derivative term, see PID::PIDOut.
+struct PIDGains {
+  float Kp;
+  float Ki;
+};
+
+// Tuning constants of the controllers. The defaults are the values the
+// controllers used to have built in, config/behaviours.yaml lists them
+// under the names they are registered with in ParamStore.
+struct BehaviourParams {
+  uint32_t version = 0; //goes up with every change
+
+  //DriveController
+  float searchVelocity = 0.35; //meters per second
+  float waypointTolerance = 0.50; //meters
+  PIDGains fastVel = {60, 10};
+  PIDGains fastYaw = {60, 15};
+  PIDGains slowVel = {100, 8};
+  PIDGains slowYaw = {70, 16};
+  PIDGains constVel = {60, 10};
+  PIDGains constYaw = {5, 5};
+
+  //DropOffController
+  float dropOffVelocity = 0.15; //meters per second
+  float dropOffTimeout = 2.8; //seconds for driving into the nest
+  float dropOffDriveIn = 0.7; //meters driven into the nest after centering
+
+  //ObstacleController
+  float triggerDistance = 0.8; //meters
+};
+
+// Registry of the tuning constants, read through immutable snapshots.
+//
+// Each parameter is registered with its name and the range it may take.
+// Load() looks every name up, builds a new BehaviourParams from the old
+// one with the values that changed and swaps it in with one atomic store.
+// Readers take the current snapshot with one atomic load and no lock, and
+// always see a whole version, never half of an update.
+//
+// A replaced snapshot is not freed right away since a reader may still be
+// using it. The reader, the behaviour loop, calls Quiescent() between
+// ticks, where it holds no snapshot, and must not keep one across it. A
+// snapshot replaced before the loop has passed that point once more is
+// no longer in use and the next Load() frees it (quiescent state based
+// reclamation with a single reader). The reader only ever does an atomic
+// load and an atomic increment, the writer does the rest.
+class ParamStore
+{
+public:
+  // Sets value and returns true if the name has a value.
+  typedef function<bool(const string& name, double& value)> Lookup;
+
+  ParamStore();
+  ~ParamStore();
+
+  // Sequentially consistent with Quiescent() so the writer can't miss a
+  // reader that took the old snapshot, still a plain load on x86.
+  const BehaviourParams* Get() const {return current.load();}
+
+  // Takes the values the lookup has, values out of range are refused and
+  // logged. Publishes a new snapshot if anything changed and returns the
+  // number of changed values. Called from one thread at a time.
+  int Load(const Lookup& lookup);
+
+  // The reader holds no snapshot.
+  void Quiescent() {quiescentCount.fetch_add(1);}
+
+  // Replaced snapshots not freed yet.
+  int GetRetiredCount() const {return retired.size();}
+
+  struct ParamInfo {
+    string name;
+    size_t offset; //of the float in BehaviourParams
+    float min;
+    float max;
+  };
+  const vector<ParamInfo>& GetInfo() const {return info;}
+
+private:
+
+  struct Retired {
+    const BehaviourParams* params;
+    uint64_t quiescentCount; //when it was replaced
+  };
+
+  void Add(const string& name, size_t offset, float min, float max);
+  static float& Field(BehaviourParams& params, size_t offset);
+  // Frees the replaced snapshots the reader can no longer hold.
+  void Reclaim();
+
+  atomic<const BehaviourParams*> current;
+  atomic<uint64_t> quiescentCount;
+  vector<Retired> retired;
+  vector<ParamInfo> info;
+};
+
+#endif // PARAMSTORE_H
@@ -0,0 +1,322 @@
+#include "ParticleFilter.h"
+
+#include <algorithm> // For max_element
+#include <chrono> // For timing the updates
+#include <cmath> // For trig functions
+#include <iostream> // For the timing report
+
+ParticleFilter::ParticleFilter(int particleCount)
+  : particleCount(particleCount), generator(random_device()())
+{
+  x.resize(particleCount);
+  y.resize(particleCount);
+  phi.resize(particleCount);
+  weight.resize(particleCount);
+  logLikelihood.resize(particleCount);
+  resampleX.resize(particleCount);
+  resampleY.resize(particleCount);
+  resamplePhi.resize(particleCount);
+  noiseTable.resize(particleCount * noiseTableFactor);
+  FillNoiseTable();
+
+  Reset();
+}
+
+void ParticleFilter::Seed(unsigned int seed)
+{
+  generator.seed(seed);
+  FillNoiseTable();
+}
+
+void ParticleFilter::FillNoiseTable()
+{
+  normal_distribution<float> normal(0, 1);
+  for (float& sample : noiseTable)
+  {
+    sample = normal(generator);
+  }
+}
+
+void ParticleFilter::Reset()
+{
+  initialized = false;
+  lastOdom.x = lastOdom.y = lastOdom.theta = 0;
+  nestLocation = lastOdom;
+  estimate = lastOdom;
+}
+
+void ParticleFilter::Initialize(Point odomLocation, Point nestLocation)
+{
+  this->nestLocation = nestLocation;
+  lastOdom = odomLocation;
+
+  //the world frame starts out equal to the odom frame
+  normal_distribution<float> normal(0, 1);
+  for (int i = 0; i < particleCount; i++)
+  {
+    x[i] = odomLocation.x + initialSpread * normal(generator);
+    y[i] = odomLocation.y + initialSpread * normal(generator);
+    phi[i] = initialHeadingSpread * normal(generator);
+    weight[i] = 1.0 / particleCount;
+  }
+
+  UpdateEstimate();
+  initialized = true;
+}
+
+void ParticleFilter::Predict(Point odomLocation)
+{
+  if (!initialized)
+  {
+    return;
+  }
+
+  float dx = odomLocation.x - lastOdom.x;
+  float dy = odomLocation.y - lastOdom.y;
+  float dtheta = atan2(sin(odomLocation.theta - lastOdom.theta), cos(odomLocation.theta - lastOdom.theta));
+  float distance = hypot(dx, dy);
+  lastOdom = odomLocation;
+
+  //don't diffuse the particles while the rover is parked
+  if (distance < 1e-4 && fabs(dtheta) < 1e-4)
+  {
+    return;
+  }
+
+  auto start = chrono::steady_clock::now();
+
+  float translationSigma = translationNoise * distance + minimumNoise;
+  float headingSigma = rotationNoise * fabs(dtheta) + headingPerMeterNoise * distance + minimumNoise;
+
+  const float* noiseX = noiseTable.data() + NoiseOffset();
+  const float* noiseY = noiseTable.data() + NoiseOffset();
+  const float* noisePhi = noiseTable.data() + NoiseOffset();
+  float* px = x.data();
+  float* py = y.data();
+  float* pphi = phi.data();
+
+  //rotate the odom step by the heading error of each particle, R(phi) ~ [1 -phi; phi 1]
+  for (int i = 0; i < particleCount; i++)
+  {
+    px[i] += dx - pphi[i] * dy + translationSigma * noiseX[i];
+    py[i] += dy + pphi[i] * dx + translationSigma * noiseY[i];
+    pphi[i] += headingSigma * noisePhi[i];
+  }
+
+  UpdateEstimate();
+
+  RecordTime(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+}
+
+void ParticleFilter::Update(const vector<Point>& nestTags)
+{
+  if (!initialized || nestTags.empty())
+  {
+    return;
+  }
+
+  auto start = chrono::steady_clock::now();
+
+  float c = cos(lastOdom.theta);
+  float s = sin(lastOdom.theta);
+
+  float* ll = logLikelihood.data();
+  const float* px = x.data();
+  const float* py = y.data();
+  const float* pphi = phi.data();
+  float* w = weight.data();
+
+  for (int i = 0; i < particleCount; i++)
+  {
+    ll[i] = 0;
+  }
+
+  int used = 0;
+  for (const Point& tag : nestTags)
+  {
+    if (hypot(tag.x, tag.y) > maxTagRange)
+    {
+      continue;
+    }
+    used++;
+
+    //offset of the tag from the rover with the odom heading
+    float wx = c * tag.x - s * tag.y;
+    float wy = s * tag.x + c * tag.y;
+    float nx = nestLocation.x;
+    float ny = nestLocation.y;
+
+    for (int i = 0; i < particleCount; i++)
+    {
+      float tx = px[i] + wx - pphi[i] * wy - nx;
+      float ty = py[i] + wy + pphi[i] * wx - ny;
+      float d = sqrt(tx * tx + ty * ty);
+
+      //zero penalty anywhere on the edge of the nest
+      float penalty = fmax(nestInnerRadius - d, 0.0f) + fmax(d - nestOuterRadius, 0.0f);
+      ll[i] += penalty * penalty;
+    }
+  }
+
+  if (used == 0)
+  {
+    return;
+  }
+
+  //the tags of one frame share most of their error, so average them
+  //instead of treating them as independent measurements
+  float scale = -1.0 / (2 * measurementSigma * measurementSigma * used);
+  for (int i = 0; i < particleCount; i++)
+  {
+    ll[i] *= scale;
+  }
+
+  float best = *max_element(logLikelihood.begin(), logLikelihood.end());
+
+  float sum = 0;
+  for (int i = 0; i < particleCount; i++)
+  {
+    w[i] *= exp(ll[i] - best);
+    sum += w[i];
+  }
+
+  if (!(sum > 0))
+  {
+    //every particle was ruled out, keep the cloud and start over on the weights
+    for (int i = 0; i < particleCount; i++)
+    {
+      w[i] = 1.0 / particleCount;
+    }
+  }
+  else
+  {
+    float inverse = 1.0 / sum;
+    for (int i = 0; i < particleCount; i++)
+    {
+      w[i] *= inverse;
+    }
+  }
+
+  if (GetEffectiveSampleSize() < particleCount / 2)
+  {
+    Resample();
+  }
+
+  UpdateEstimate();
+
+  RecordTime(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+}
+
+float ParticleFilter::GetEffectiveSampleSize() const
+{
+  float sumSquares = 0;
+  for (int i = 0; i < particleCount; i++)
+  {
+    sumSquares += weight[i] * weight[i];
+  }
+
+  return sumSquares > 0 ? 1.0 / sumSquares : 0;
+}
+
+Point ParticleFilter::GetEstimate() const
+{
+  Point world = estimate;
+  world.theta = lastOdom.theta + estimate.theta;
+  return world;
+}
+
+Point ParticleFilter::GetNestInOdom() const
+{
+  if (!initialized)
+  {
+    return nestLocation;
+  }
+
+  //odom = O + R(-phi) (world - P)
+  float c = cos(estimate.theta);
+  float s = sin(estimate.theta);
+  float dx = nestLocation.x - estimate.x;
+  float dy = nestLocation.y - estimate.y;
+
+  Point nest;
+  nest.x = lastOdom.x + c * dx + s * dy;
+  nest.y = lastOdom.y - s * dx + c * dy;
+  nest.theta = nestLocation.theta;
+  return nest;
+}
+
+void ParticleFilter::Resample()
+{
+  //systematic resampling, one random offset and evenly spaced pointers
+  uniform_real_distribution<float> uniform(0, 1.0 / particleCount);
+  float pointer = uniform(generator);
+  float step = 1.0 / particleCount;
+  float cumulative = weight[0];
+  int source = 0;
+
+  for (int i = 0; i < particleCount; i++)
+  {
+    while (pointer > cumulative && source < particleCount - 1)
+    {
+      source++;
+      cumulative += weight[source];
+    }
+
+    resampleX[i] = x[source];
+    resampleY[i] = y[source];
+    resamplePhi[i] = phi[source];
+    pointer += step;
+  }
+
+  x.swap(resampleX);
+  y.swap(resampleY);
+  phi.swap(resamplePhi);
+
+  for (int i = 0; i < particleCount; i++)
+  {
+    weight[i] = step;
+  }
+}
+
+void ParticleFilter::UpdateEstimate()
+{
+  float sumX = 0;
+  float sumY = 0;
+  float sumPhi = 0;
+  float sumWeight = 0;
+
+  for (int i = 0; i < particleCount; i++)
+  {
+    sumX += weight[i] * x[i];
+    sumY += weight[i] * y[i];
+    sumPhi += weight[i] * phi[i];
+    sumWeight += weight[i];
+  }
+
+  if (sumWeight > 0)
+  {
+    estimate.x = sumX / sumWeight;
+    estimate.y = sumY / sumWeight;
+    estimate.theta = sumPhi / sumWeight; //heading error, not a heading
+  }
+}
+
+int ParticleFilter::NoiseOffset()
+{
+  uniform_int_distribution<int> offset(0, noiseTable.size() - particleCount);
+  return offset(generator);
+}
+
+void ParticleFilter::RecordTime(double microseconds)
+{
+  totalTime += microseconds;
+  timedUpdates++;
+
+  if (timedUpdates == timingReportInterval)
+  {
+    cout << "LOCALIZER - average update time over " << timedUpdates << " updates: "
+         << totalTime / timedUpdates << " us with " << particleCount << " particles" << endl;
+    totalTime = 0;
+    timedUpdates = 0;
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef PARTICLEFILTER_H
+#define PARTICLEFILTER_H
+
+#include <vector>
+#include <random>
+
+#include "Point.h"
+
+using namespace std;
+
+// Particle filter that corrects odometry drift using the collection zone
+// (nest) as the only landmark.
+//
+// The world frame is the odom frame at the moment the filter is started,
+// where the nest position is known. Each particle is a hypothesis of the
+// true rover position in that frame together with the heading error of
+// odometry (phi). Heading drift stays small, so odom motion is rotated
+// into a particle with the small angle approximation and no trig is done
+// per particle.
+//
+// Particles are stored as a struct of arrays and the motion and weight
+// loops only do straight line float arithmetic so the compiler can
+// vectorize them. Motion noise is read from a precomputed table of normal
+// samples starting at a random offset instead of drawing a sample per
+// particle.
+class ParticleFilter
+{
+public:
+  ParticleFilter(int particleCount = 2000);
+
+  void Reset();
+
+  // Starts the random numbers over from the seed, so a replay of the same
+  // inputs gives the same particles. Seeded from random_device otherwise.
+  void Seed(unsigned int seed);
+
+  // Spreads the particles around the current odom pose and fixes the nest
+  // position in the world frame.
+  void Initialize(Point odomLocation, Point nestLocation);
+  bool IsInitialized() const {return initialized;}
+
+  // Moves every particle by the odometry change since the last call.
+  void Predict(Point odomLocation);
+
+  // Weights the particles with one camera frame of nest tag sightings.
+  // Each sighting is the position of a tag on the ground in the rover
+  // frame (x forward, y left).
+  void Update(const vector<Point>& nestTags);
+
+  // Weighted mean of the particles in the world frame.
+  Point GetEstimate() const;
+
+  // Position of the nest in the current odom frame. This is what the
+  // controllers that work in odom coordinates should drive to.
+  Point GetNestInOdom() const;
+
+  float GetEffectiveSampleSize() const;
+  int GetParticleCount() const {return particleCount;}
+
+private:
+
+  void FillNoiseTable();
+  void Resample();
+  void UpdateEstimate();
+  int NoiseOffset();
+  void RecordTime(double microseconds);
+
+  const float initialSpread = 0.05; //meters, standard deviation of the starting cloud
+  const float initialHeadingSpread = 0.02; //radians
+  const float translationNoise = 0.05; //meters of position noise per meter driven
+  const float rotationNoise = 0.02; //radians of heading noise per radian turned
+  const float headingPerMeterNoise = 0.01; //radians of heading noise per meter driven
+  const float minimumNoise = 0.001; //keeps the cloud from collapsing while parked
+
+  //tags sit on the edge of a 1.016m square so a sighting is between the
+  //inscribed and circumscribed radius from the nest center
+  const float nestInnerRadius = 0.45;
+  const float nestOuterRadius = 0.75;
+  const float measurementSigma = 0.08; //meters
+  const float maxTagRange = 1.0; //meters, further sightings are too noisy to use
+
+  const int noiseTableFactor = 4; //noise table holds this many samples per particle
+  const int timingReportInterval = 100; //updates between timing reports
+
+  int particleCount;
+  bool initialized = false;
+
+  // particle state, struct of arrays
+  vector<float> x;
+  vector<float> y;
+  vector<float> phi;
+  vector<float> weight;
+
+  // scratch buffers reused for every update so the filter never allocates
+  vector<float> logLikelihood;
+  vector<float> resampleX;
+  vector<float> resampleY;
+  vector<float> resamplePhi;
+
+  vector<float> noiseTable;
+  mt19937 generator;
+
+  Point lastOdom;
+  Point nestLocation;
+  Point estimate;
+
+  double totalTime = 0; //microseconds
+  int timedUpdates = 0;
+};
+
+#endif // PARTICLEFILTER_H
@@ -0,0 +1,419 @@
+#include "PathPlanner.h"
+
+#include <algorithm> // For min and max
+#include <chrono> // For timing the searches
+#include <cmath> // For hypot
+#include <iostream> // For the planner log
+
+constexpr float PathPlanner::cellSize;
+
+PathPlanner::PathPlanner()
+{
+  g.assign(windowSize * windowSize, infinity);
+  rhs.assign(windowSize * windowSize, infinity);
+  blocked.assign(windowSize * windowSize, -1);
+}
+
+void PathPlanner::Clear()
+{
+  hasPlan = false;
+  replanNeeded = false;
+  changedNodes.clear();
+  waypoints.clear();
+}
+
+bool PathPlanner::Plan(Point start, Point goal)
+{
+  auto startTime = chrono::steady_clock::now();
+
+  Clear();
+  if (occupancyGrid == nullptr)
+  {
+    return false;
+  }
+
+  //center the window between the rover and the goal
+  originX = (start.x + goal.x) / 2 - windowSize * cellSize / 2;
+  originY = (start.y + goal.y) / 2 - windowSize * cellSize / 2;
+  this->goal = goal;
+
+  if (!ToNode(start, startNode) || !ToNode(goal, goalNode))
+  {
+    cout << "PLANNER - goal too far for the planning window" << endl;
+    return false;
+  }
+
+  g.assign(g.size(), infinity);
+  rhs.assign(rhs.size(), infinity);
+  blocked.assign(blocked.size(), -1);
+  open = priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> >();
+  km = 0;
+  lastStartNode = startNode;
+
+  rhs[goalNode] = 0;
+  open.push(QueueEntry(CalculateKey(goalNode), goalNode));
+
+  hasPlan = ComputeShortestPath() && ExtractPath();
+
+  cout << "PLANNER - planned " << waypoints.size() << " waypoints in "
+       << chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count() << " ms" << endl;
+
+  return hasPlan;
+}
+
+void PathPlanner::UpdateCells(const vector<CellIndex>& changedCells, bool overflowed)
+{
+  if (!hasPlan)
+  {
+    return;
+  }
+
+  if (overflowed)
+  {
+    replanNeeded = true;
+    return;
+  }
+
+  //every coarse cell whose inflated footprint contains a changed cell
+  int reach = (int)ceil((inflationRadius + OccupancyGrid::cellSize) / cellSize);
+  for (const CellIndex& cell : changedCells)
+  {
+    int node;
+    if (!ToNode(occupancyGrid->ToPoint(cell), node))
+    {
+      continue;
+    }
+
+    int column = node % windowSize;
+    int row = node / windowSize;
+    for (int r = max(0, row - reach); r <= min(windowSize - 1, row + reach); r++)
+    {
+      for (int c = max(0, column - reach); c <= min(windowSize - 1, column + reach); c++)
+      {
+        int affected = r * windowSize + c;
+
+        //cells the search has not looked at yet are evaluated when it does
+        if (blocked[affected] < 0)
+        {
+          continue;
+        }
+
+        int8_t now = EvaluateBlocked(affected) ? 1 : 0;
+        if (now != blocked[affected])
+        {
+          blocked[affected] = now;
+          changedNodes.push_back(affected);
+        }
+      }
+    }
+  }
+}
+
+bool PathPlanner::Repair(Point start)
+{
+  if (!hasPlan)
+  {
+    return false;
+  }
+
+  int node;
+  if (replanNeeded || !ToNode(start, node))
+  {
+    //the rover left the window or too much changed, start over
+    return Plan(start, goal);
+  }
+
+  auto startTime = chrono::steady_clock::now();
+
+  startNode = node;
+  km += Heuristic(lastStartNode, startNode);
+  lastStartNode = startNode;
+
+  //edges into and out of a changed cell changed cost
+  int neighbours[8];
+  for (int changed : changedNodes)
+  {
+    UpdateVertex(changed);
+    int count = Neighbours(changed, neighbours);
+    for (int i = 0; i < count; i++)
+    {
+      UpdateVertex(neighbours[i]);
+    }
+  }
+  int repaired = changedNodes.size();
+  changedNodes.clear();
+
+  hasPlan = ComputeShortestPath() && ExtractPath();
+
+  cout << "PLANNER - repaired " << repaired << " cells in "
+       << chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count()
+       << " ms, path " << (hasPlan ? "found" : "lost") << endl;
+
+  return hasPlan;
+}
+
+bool PathPlanner::ComputeShortestPath()
+{
+  int neighbours[8];
+  int expansions = 0;
+
+  while (!open.empty())
+  {
+    QueueEntry top = open.top();
+    int u = top.second;
+
+    //skip entries of cells that became consistent after they were queued
+    if (g[u] == rhs[u])
+    {
+      open.pop();
+      continue;
+    }
+
+    if (!(top.first < CalculateKey(startNode)) && rhs[startNode] == g[startNode])
+    {
+      break;
+    }
+
+    if (++expansions > maxExpansions)
+    {
+      cout << "PLANNER - search gave up after " << maxExpansions << " expansions" << endl;
+      return false;
+    }
+
+    open.pop();
+    Key newKey = CalculateKey(u);
+
+    if (top.first < newKey)
+    {
+      open.push(QueueEntry(newKey, u));
+    }
+    else if (g[u] > rhs[u])
+    {
+      g[u] = rhs[u];
+      int count = Neighbours(u, neighbours);
+      for (int i = 0; i < count; i++)
+      {
+        UpdateVertex(neighbours[i]);
+      }
+    }
+    else
+    {
+      g[u] = infinity;
+      UpdateVertex(u);
+      int count = Neighbours(u, neighbours);
+      for (int i = 0; i < count; i++)
+      {
+        UpdateVertex(neighbours[i]);
+      }
+    }
+  }
+
+  return rhs[startNode] < infinity;
+}
+
+void PathPlanner::UpdateVertex(int node)
+{
+  if (node != goalNode)
+  {
+    int neighbours[8];
+    int count = Neighbours(node, neighbours);
+    float best = infinity;
+    for (int i = 0; i < count; i++)
+    {
+      best = min(best, Cost(node, neighbours[i]) + g[neighbours[i]]);
+    }
+    rhs[node] = min(best, infinity);
+  }
+
+  if (g[node] != rhs[node])
+  {
+    open.push(QueueEntry(CalculateKey(node), node));
+  }
+}
+
+PathPlanner::Key PathPlanner::CalculateKey(int node) const
+{
+  float best = min(g[node], rhs[node]);
+  return Key(best + Heuristic(startNode, node) + km, best);
+}
+
+float PathPlanner::Heuristic(int a, int b) const
+{
+  //octile distance, exact on an empty 8 connected grid
+  int dx = abs(a % windowSize - b % windowSize);
+  int dy = abs(a / windowSize - b / windowSize);
+  return cellSize * (max(dx, dy) + (M_SQRT2 - 1) * min(dx, dy));
+}
+
+float PathPlanner::Cost(int a, int b)
+{
+  if (Blocked(a) || Blocked(b))
+  {
+    return infinity;
+  }
+
+  int dx = b % windowSize - a % windowSize;
+  int dy = b / windowSize - a / windowSize;
+  if (dx != 0 && dy != 0)
+  {
+    //don't cut the corner of a blocked cell
+    if (Blocked(a + dx) || Blocked(a + dy * windowSize))
+    {
+      return infinity;
+    }
+    return cellSize * M_SQRT2;
+  }
+
+  return cellSize;
+}
+
+bool PathPlanner::Blocked(int node)
+{
+  //the rover is already there and the goal was asked for, so always let
+  //the search reach them even when they are close to an obstacle
+  if (node == startNode || node == goalNode)
+  {
+    return false;
+  }
+
+  if (blocked[node] < 0)
+  {
+    blocked[node] = EvaluateBlocked(node) ? 1 : 0;
+  }
+  return blocked[node] == 1;
+}
+
+bool PathPlanner::EvaluateBlocked(int node) const
+{
+  Point center = ToPoint(node);
+  return occupancyGrid->IsOccupiedNear(center.x, center.y, inflationRadius);
+}
+
+bool PathPlanner::ExtractPath()
+{
+  //follow the cost field down from the rover to the goal
+  vector<int> path;
+  path.push_back(startNode);
+  int current = startNode;
+  int neighbours[8];
+
+  while (current != goalNode)
+  {
+    if (path.size() > windowSize * windowSize)
+    {
+      return false;
+    }
+
+    int count = Neighbours(current, neighbours);
+    int next = -1;
+    float best = infinity;
+    for (int i = 0; i < count; i++)
+    {
+      float value = Cost(current, neighbours[i]) + g[neighbours[i]];
+      if (value < best)
+      {
+        best = value;
+        next = neighbours[i];
+      }
+    }
+
+    if (next < 0)
+    {
+      return false;
+    }
+
+    path.push_back(next);
+    current = next;
+  }
+
+  //keep only the cells where the line of sight breaks
+  waypoints.clear();
+  int anchor = 0;
+  while (anchor < path.size() - 1)
+  {
+    int furthest = anchor + 1;
+    for (int i = path.size() - 1; i > anchor + 1; i--)
+    {
+      if (LineOfSight(path[anchor], path[i]))
+      {
+        furthest = i;
+        break;
+      }
+    }
+
+    if (furthest < path.size() - 1)
+    {
+      waypoints.push_back(ToPoint(path[furthest]));
+    }
+    anchor = furthest;
+  }
+
+  return true;
+}
+
+bool PathPlanner::LineOfSight(int a, int b)
+{
+  Point from = ToPoint(a);
+  Point to = ToPoint(b);
+  int steps = max(1, (int)ceil(hypot(to.x - from.x, to.y - from.y) / (cellSize / 2)));
+
+  for (int i = 1; i < steps; i++)
+  {
+    Point sample;
+    sample.x = from.x + (to.x - from.x) * i / steps;
+    sample.y = from.y + (to.y - from.y) * i / steps;
+
+    int node;
+    if (!ToNode(sample, node) || Blocked(node))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool PathPlanner::ToNode(Point point, int& node) const
+{
+  int column = (int)floor((point.x - originX) / cellSize);
+  int row = (int)floor((point.y - originY) / cellSize);
+
+  if (column < 0 || column >= windowSize || row < 0 || row >= windowSize)
+  {
+    return false;
+  }
+
+  node = row * windowSize + column;
+  return true;
+}
+
+Point PathPlanner::ToPoint(int node) const
+{
+  Point point;
+  point.x = originX + (node % windowSize + 0.5) * cellSize;
+  point.y = originY + (node / windowSize + 0.5) * cellSize;
+  point.theta = 0;
+  return point;
+}
+
+int PathPlanner::Neighbours(int node, int* neighbours) const
+{
+  int column = node % windowSize;
+  int row = node / windowSize;
+  int count = 0;
+
+  for (int dy = -1; dy <= 1; dy++)
+  {
+    for (int dx = -1; dx <= 1; dx++)
+    {
+      int c = column + dx;
+      int r = row + dy;
+      if ((dx != 0 || dy != 0) && c >= 0 && c < windowSize && r >= 0 && r < windowSize)
+      {
+        neighbours[count++] = r * windowSize + c;
+      }
+    }
+  }
+
+  return count;
+}
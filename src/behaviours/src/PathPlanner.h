@@ -0,0 +1,102 @@
+#ifndef PATHPLANNER_H
+#define PATHPLANNER_H
+
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+#include "Point.h"
+#include "OccupancyGrid.h"
+
+using namespace std;
+
+// Incremental grid planner (D* Lite) over the obstacle map.
+//
+// A plan covers a square window of coarse cells around the start and the
+// goal. A coarse cell is blocked if the occupancy grid has an obstacle
+// within the inflation radius of its center, evaluated the first time the
+// search touches the cell. The search runs from the goal to the rover so
+// when the rover moves or new obstacles show up only the part of the cost
+// field that changed is repaired instead of planning from scratch.
+//
+// The resulting cell path is shortened to the few waypoints that keep a
+// clear line of sight between them.
+class PathPlanner
+{
+public:
+  PathPlanner();
+
+  void SetOccupancyGrid(const OccupancyGrid* occupancyGrid) {this->occupancyGrid = occupancyGrid;}
+
+  // Plans from scratch. Returns false if there is no path inside the window.
+  bool Plan(Point start, Point goal);
+
+  // Cells of the occupancy grid whose state changed. Coarse cells that
+  // flip between blocked and free are queued for the next Repair.
+  void UpdateCells(const vector<CellIndex>& changedCells, bool overflowed);
+  bool HasPendingChanges() const {return !changedNodes.empty() || replanNeeded;}
+
+  // Moves the start to the current rover position and repairs the plan
+  // with the queued changes. Returns false if there is no longer a path.
+  bool Repair(Point start);
+
+  void Clear();
+  bool HasPlan() const {return hasPlan;}
+
+  // Waypoints from the rover to the goal in driving order. The goal itself
+  // is not included.
+  const vector<Point>& GetWaypoints() const {return waypoints;}
+
+  static constexpr float cellSize = 0.2; //meters
+  static const int windowSize = 128; //cells per side of the planning window
+
+private:
+
+  typedef pair<float, float> Key;
+  typedef pair<Key, int> QueueEntry;
+
+  bool ComputeShortestPath();
+  void UpdateVertex(int node);
+  Key CalculateKey(int node) const;
+  float Heuristic(int a, int b) const;
+  float Cost(int a, int b);
+  bool Blocked(int node);
+  bool EvaluateBlocked(int node) const;
+  bool ExtractPath();
+  bool LineOfSight(int a, int b);
+
+  bool ToNode(Point point, int& node) const;
+  Point ToPoint(int node) const;
+  int Neighbours(int node, int* neighbours) const;
+
+  const float inflationRadius = 0.3; //meters, half the rover width plus margin
+  const int maxExpansions = 40000; //bounds the time of one search
+  const float infinity = 1e9;
+
+  const OccupancyGrid* occupancyGrid = nullptr;
+
+  bool hasPlan = false;
+  bool replanNeeded = false;
+
+  // window origin (corner) in the map frame
+  float originX = 0;
+  float originY = 0;
+
+  int startNode = 0;
+  int goalNode = 0;
+  int lastStartNode = 0;
+  float km = 0; //key modifier for the moving start
+  Point goal;
+
+  vector<float> g;
+  vector<float> rhs;
+  vector<int8_t> blocked; //-1 not evaluated yet, 0 free, 1 blocked
+
+  // lazy deletion queue, stale entries are skipped when popped
+  priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > open;
+
+  vector<int> changedNodes;
+  vector<Point> waypoints;
+};
+
+#endif // PATHPLANNER_H
@@ -0,0 +1,176 @@
+#include "PheromoneMap.h"
+
+#include <algorithm> // For min and max
+#include <cmath> // For exp and hypot
+
+constexpr float PheromoneMap::cellSize;
+
+PheromoneMap::PheromoneMap()
+{
+  strength.assign(cellsPerSide * cellsPerSide, 0);
+  depositTime.assign(cellsPerSide * cellsPerSide, 0);
+  activePosition.assign(cellsPerSide * cellsPerSide, -1);
+}
+
+void PheromoneMap::SetOrigin(Point origin)
+{
+  this->origin = origin;
+  hasOrigin = true;
+
+  for (int index : active)
+  {
+    strength[index] = 0;
+    activePosition[index] = -1;
+  }
+  active.clear();
+}
+
+void PheromoneMap::Deposit(Point point, float amount, long int time)
+{
+  int index;
+  if (!hasOrigin || !ToIndex(point.x, point.y, index))
+  {
+    return;
+  }
+
+  //cubes that have been dropped off
+  if (hypot(point.x - origin.x, point.y - origin.y) < nestRadius)
+  {
+    return;
+  }
+
+  strength[index] = max(0.0f, min(maxCellStrength, Decayed(index, time) + amount));
+  depositTime[index] = time;
+
+  if (strength[index] > 0 && activePosition[index] < 0)
+  {
+    activePosition[index] = active.size();
+    active.push_back(index);
+  }
+}
+
+float PheromoneMap::GetStrength(Point point, long int time) const
+{
+  int index;
+  if (!hasOrigin || !ToIndex(point.x, point.y, index))
+  {
+    return 0;
+  }
+
+  return Decayed(index, time);
+}
+
+void PheromoneMap::Evaporate(Point point, float fraction, long int time)
+{
+  int center;
+  if (!hasOrigin || !ToIndex(point.x, point.y, center))
+  {
+    return;
+  }
+
+  int row = center / cellsPerSide;
+  int column = center % cellsPerSide;
+  for (int r = max(0, row - 1); r <= min(cellsPerSide - 1, row + 1); r++)
+  {
+    for (int c = max(0, column - 1); c <= min(cellsPerSide - 1, column + 1); c++)
+    {
+      int index = r * cellsPerSide + c;
+      strength[index] = Decayed(index, time) * fraction;
+      depositTime[index] = time;
+    }
+  }
+}
+
+bool PheromoneMap::BestSite(Point from, long int time, Point& site)
+{
+  float bestScore = 0;
+  bool found = false;
+
+  for (int i = 0; i < active.size(); i++)
+  {
+    int index = active[i];
+
+    //decayed away, drop it from the list by moving the last cell into the hole
+    if (Decayed(index, time) < 0.01 * minSiteStrength)
+    {
+      int last = active.back();
+      active[i] = last;
+      activePosition[last] = i;
+      active.pop_back();
+      strength[index] = 0;
+      activePosition[index] = -1;
+      i--;
+      continue;
+    }
+
+    float siteStrength = SiteStrength(index, time);
+    if (siteStrength < minSiteStrength)
+    {
+      continue;
+    }
+
+    Point center = CellCenter(index);
+    float score = siteStrength / (1 + hypot(center.x - from.x, center.y - from.y) / travelDistanceScale);
+    if (score > bestScore)
+    {
+      bestScore = score;
+      site = center;
+      site.theta = atan2(center.y - from.y, center.x - from.x);
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+float PheromoneMap::Decayed(int index, long int time) const
+{
+  if (strength[index] <= 0)
+  {
+    return 0;
+  }
+
+  return strength[index] * exp(-(time - depositTime[index]) / 1e3 / decayTime);
+}
+
+float PheromoneMap::SiteStrength(int index, long int time) const
+{
+  //a cluster spreads over a few cells
+  int row = index / cellsPerSide;
+  int column = index % cellsPerSide;
+  float sum = 0;
+  for (int r = max(0, row - 1); r <= min(cellsPerSide - 1, row + 1); r++)
+  {
+    for (int c = max(0, column - 1); c <= min(cellsPerSide - 1, column + 1); c++)
+    {
+      sum += Decayed(r * cellsPerSide + c, time);
+    }
+  }
+
+  return sum;
+}
+
+Point PheromoneMap::CellCenter(int index) const
+{
+  float half = cellsPerSide * cellSize / 2;
+  Point center;
+  center.x = origin.x - half + (index % cellsPerSide + 0.5) * cellSize;
+  center.y = origin.y - half + (index / cellsPerSide + 0.5) * cellSize;
+  center.theta = 0;
+  return center;
+}
+
+bool PheromoneMap::ToIndex(float x, float y, int& index) const
+{
+  float half = cellsPerSide * cellSize / 2;
+  int column = (int)floor((x - origin.x + half) / cellSize);
+  int row = (int)floor((y - origin.y + half) / cellSize);
+
+  if (column < 0 || column >= cellsPerSide || row < 0 || row >= cellsPerSide)
+  {
+    return false;
+  }
+
+  index = row * cellsPerSide + column;
+  return true;
+}
@@ -0,0 +1,76 @@
+#ifndef PHEROMONEMAP_H
+#define PHEROMONEMAP_H
+
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Site fidelity memory of where this rover has seen cubes it did not pick
+// up, as a pheromone grid in the map frame around the nest.
+//
+// Every cube sighting deposits pheromone on its cell and every pickup takes
+// one cube's worth away again, so a cell holds roughly the number of cubes
+// known to be left there. Pheromone decays exponentially because other
+// rovers may have collected the cubes since. The decay is never applied to
+// the whole grid: each cell keeps the time of its last deposit and is
+// decayed from then when it is read, and only the cells that have been
+// deposited on are searched for the best site.
+class PheromoneMap
+{
+public:
+  PheromoneMap();
+
+  // Clears the map and centers it on the given map frame point, normally
+  // the nest. Nothing is deposited until an origin has been set.
+  void SetOrigin(Point origin);
+  bool HasOrigin() const {return hasOrigin;}
+
+  // Adds pheromone to the cell containing the point, negative amounts take
+  // it away. Cubes seen in the nest are not recorded.
+  void Deposit(Point point, float amount, long int time);
+
+  // Pheromone of the cell containing the point at the given time.
+  float GetStrength(Point point, long int time) const;
+
+  // Scales the pheromone around the point, used when a site turned out to
+  // be empty so the rover does not keep coming back.
+  void Evaporate(Point point, float fraction, long int time);
+
+  // Most promising site to return to from the given point: the cell with
+  // the most pheromone around it, discounted by the distance to drive
+  // there. Returns false if nothing is above the minimum strength.
+  bool BestSite(Point from, long int time, Point& site);
+
+  int GetActiveCells() const {return active.size();}
+
+  static constexpr float cellSize = 0.5; //meters
+  static const int cellsPerSide = 48; //24m square around the origin, same as the coverage map
+
+private:
+
+  bool ToIndex(float x, float y, int& index) const;
+  Point CellCenter(int index) const;
+  float Decayed(int index, long int time) const;
+  float SiteStrength(int index, long int time) const; //pheromone of the cell and its neighbours
+
+  const float decayTime = 600; //seconds for the pheromone to fall to 1/e
+  const float maxCellStrength = 4; //limits cubes counted twice after their track was lost
+  const float minSiteStrength = 0.9; //about one cube left
+  const float travelDistanceScale = 5.0; //meters, a site this far away counts half
+  const float nestRadius = 1.0; //meters, dropped cubes are not a site
+
+  bool hasOrigin = false;
+  Point origin;
+
+  vector<float> strength; //pheromone at the time of the last deposit
+  vector<long int> depositTime; //milliseconds
+
+  // cells with pheromone and the position of each cell in that list (-1
+  // if not in it), cells are dropped from the list once decayed away
+  vector<int> active;
+  vector<int> activePosition;
+};
+
+#endif // PHEROMONEMAP_H
@@ -43,7 +43,12 @@ void PickUpController::SetTagData(vector<Tag> tags)
       if (tags[i].getID() == 0)
       {
 
-        targetFound = true;
+        //the camera frame can't tell a cube that was given up on from the
+        //others, the tracked target can
+        if (GetIgnoredTrack() < 0)
+        {
+          targetFound = true;
+        }
 
         //absolute distance to block from camera lens
         double test = hypot(hypot(tags[i].getPositionX(), tags[i].getPositionY()), tags[i].getPositionZ());
@@ -73,34 +78,48 @@ void PickUpController::SetTagData(vector<Tag> tags)
       }
     }
 
-    float cameraOffsetCorrection = 0.023; //meters;
-
-    // using a^2 + b^2 = c^2 to find the distance to the block
-    // 0.195 is the height of the camera lens above the ground in cm.
-    //
-    // a is the linear distance from the robot to the block, c is the
-    // distance from the camera lens, and b is the height of the
-    // camera above the ground.
-    blockDistanceFromCamera = hypot(hypot(tags[target].getPositionX(), tags[target].getPositionY()), tags[target].getPositionZ());
-
-    if ( (blockDistanceFromCamera*blockDistanceFromCamera - 0.195*0.195) > 0 )
-    {
-      blockDistance = sqrt(blockDistanceFromCamera*blockDistanceFromCamera - 0.195*0.195);
-    }
-    else
+    //distance from the camera lens to the closest block in this frame. The distance and heading
+    //used for driving come from the tag tracker, see SetTrackedTarget()
+    if (closest < std::numeric_limits<double>::max())
     {
-      float epsilon = 0.00001; // A small non-zero positive number
-      blockDistance = epsilon;
+      blockDistanceFromCamera = closest;
     }
 
-    //cout << "blockDistance  TAGDATA:  " << blockDistance << endl;
+  }
 
-    blockYawError = atan((tags[target].getPositionX() + cameraOffsetCorrection)/blockDistance)*1.05; //angle to block from bottom center of chassis on the horizontal.
+}
 
-    cout << "blockYawError TAGDATA:  " << blockYawError << endl;
+// Position of the closest tracked block relative to the camera. The tag tracker keeps predicting this
+// position from odometry when the block drops out of a few camera frames, so the approach does not
+// time out on a single missed detection.
+void PickUpController::SetTrackedTarget(float forward, float lateral, int trackID)
+{
+  float cameraOffsetCorrection = 0.023; //meters;
 
+  //don't drive back to a cube that could not be picked up
+  if (trackID == GetIgnoredTrack())
+  {
+    return;
   }
 
+  targetTrack = trackID;
+  targetFound = true;
+  nTargetsSeen = 1;
+
+  //the track is still alive, set target_timer
+  target_timer = current_time;
+
+  // distance from the camera to the block on the ground
+  blockDistance = hypot(forward, lateral);
+
+  if (blockDistance <= 0)
+  {
+    float epsilon = 0.00001; // A small non-zero positive number
+    blockDistance = epsilon;
+  }
+
+  blockYawError = atan((lateral + cameraOffsetCorrection)/blockDistance)*1.05; //angle to block from bottom center of chassis on the horizontal.
+
 }
 
 
@@ -113,6 +132,7 @@ bool PickUpController::SetSonarData(float rangeCenter)
     result.type = behavior;
     result.b = nextProcess;
     result.reset = true;
+    RecordPickUp();
     targetHeld = true;
     return true;
   }
@@ -143,11 +163,12 @@ void PickUpController::ProcessData()
   // If the block is very close to the camera then the robot has
   // successfully lifted a target. Enter the target held state to
   // return to the center.
-  if (blockDistanceFromCamera < 0.14 && Td < 3.9)
+  if (blockDistanceFromCamera < 0.14 && Td < heldConfirmWindow)
   {
     result.type = behavior;
     result.b = nextProcess;
     result.reset = true;
+    RecordPickUp();
     targetHeld = true;
   }
   //Lower wrist and open fingers if no locked target -- this is the
@@ -228,20 +249,19 @@ Result PickUpController::DoWork()
     // Td = [T]ime [D]ifference IN SECONDS
     float Td = Tdifference/1e3;
 
-    // The following nested if statement implements a time based pickup routine.
+    // The following nested if statement implements the pickup routine.
     // The sequence of events is:
-    // 1. Target aquisition phase: Align the robot with the closest visible target cube, if near enough to get a target lock then start the pickup timer (Td)
-    // 2. Approach Target phase: until *grasp_time_begin* seconds
-    // 3. Stop and close fingers (hopefully on a block - we won't be able to see it remember): at *grasp_time_begin* seconds
-    // 4. Raise the gripper - does the rover see a block or did it miss it: at *raise_time_begin* seconds
-    // 5. If we get here the target was not seen in the robots gripper so drive backwards and and try to get a new lock on a target: at *target_require_begin* seconds
-    // 6. If we get here we give up and release control with a task failed flag: for *target_pickup_task_time_limit* seconds
+    // 1. Target aquisition phase: Align the robot with the closest visible target cube, if near enough to get a target lock then start the pickup sequence
+    // 2. Approach Target phase: for *approachTime* seconds
+    // 3. Stop and close fingers (hopefully on a block - we won't be able to see it remember): until the gripper reports them closed
+    // 4. Raise the gripper - does the rover see a block or did it miss it: until the gripper reports the wrist up
+    // 5. If the grasp came up empty open the fingers, lower the wrist and try to get a new lock on a target
+    // 6. If we lose the target or fail *maxAttempts* times we give up and release control with a task failed flag: for *target_pickup_task_time_limit* seconds
+    // See SequencePickUp() for steps 2 to 5.
 
     // If we don't see any blocks or cubes turn towards the location of the last cube we saw.
     // I.E., try to re-aquire the last cube we saw.
 
-    float grasp_time_begin = 1.5; //meters //ORIGINALLY 1.5 // 1.2 value from CNM 2017
-    float raise_time_begin = 2.0; //meters //ORIGINALLY 2.0 // 1.5 value from CNM 2017
     float lower_gripper_time_begin = 4.0; //meters //ORIGINALLY 4.0
     float target_reaquire_begin= 4.2; //meters //ORIGINALLY 4.2 // 2.5 value from CNM 2017
     float target_pickup_task_time_limit = 4.8; //meters //ORIGINALLY 4.8 // 5.0 value from CNM 2017
@@ -301,26 +321,26 @@ Result PickUpController::DoWork()
 
       return result;
     }
-    else if (!lockTarget) //if a target hasn't been locked lock it and enter a counting state while slowly driving forward.
+    else if (!lockTarget) //if a target hasn't been locked lock it and start the pickup sequence while slowly driving forward.
     {
       lockTarget = true;
       result.pd.cmdVel = 0.18;
       result.pd.cmdAngularError= 0.0;
       timeOut = true;
       ignoreCenterSonar = true;
+
+      if (pickUpStartTime < 0)
+      {
+        pickUpStartTime = current_time;
+      }
+      attempts++;
+      totalAttempts++;
+      StartPhase(PICKUP_APPROACH);
+      return result;
     }
-    else if (Td > raise_time_begin) //raise the wrist
+    else
     {
-      result.pd.cmdVel = -0.25; //meters //ORIGINALLY -0.15 // -0.25 value from CNM 2017
-      result.pd.cmdAngularError= 0.0;
-      result.wristAngle = 0;
-    }
-    else if (Td > grasp_time_begin) //close the fingers and stop driving
-    {
-      result.pd.cmdVel = 0.0;
-      result.pd.cmdAngularError= 0.0;
-      result.fingerAngle = 0;
-      return result;
+      return SequencePickUp();
     }
 
 
@@ -355,6 +375,171 @@ Result PickUpController::DoWork()
   return result;
 }
 
+// Steps through a pickup of the locked target, each gripper step ends when
+// the gripper feedback says it is done or its timeout runs out.
+Result PickUpController::SequencePickUp()
+{
+  result.pd.cmdAngularError = 0.0;
+
+  switch (pickUpPhase)
+  {
+  case PICKUP_APPROACH:
+  {
+    //slowly drive the open fingers around the cube
+    result.pd.cmdVel = 0.18;
+
+    if (PhaseTime() >= approachTime)
+    {
+      StartPhase(PICKUP_GRASP);
+    }
+    break;
+  }
+
+  case PICKUP_GRASP:
+  {
+    //close the fingers and stop driving
+    result.pd.cmdVel = 0.0;
+    result.fingerAngle = 0;
+
+    bool settled = (current_time - fingerSettledTime)/1e3 >= fingerSettleTime;
+
+    if (fingerReportsPosition && settled && PhaseTime() >= fingerSettleTime)
+    {
+      //the fingers stopped moving, they closed on nothing if they closed all the way
+      if (fingerFeedback <= emptyGraspAngle)
+      {
+        FailAttempt("fingers closed on nothing");
+      }
+      else
+      {
+        StartPhase(PICKUP_RAISE);
+      }
+    }
+    else if (!fingerReportsPosition && hasGripperData && fingerFeedback <= gripperTolerance && PhaseTime() >= minCloseTime)
+    {
+      StartPhase(PICKUP_RAISE);
+    }
+    else if (PhaseTime() >= graspTimeout)
+    {
+      StartPhase(PICKUP_RAISE);
+    }
+    break;
+  }
+
+  case PICKUP_RAISE:
+  {
+    //raise the wrist, once up the sonar or camera should see the cube
+    result.pd.cmdVel = -0.25; //meters //ORIGINALLY -0.15 // -0.25 value from CNM 2017
+    result.wristAngle = raisedWristAngle;
+
+    //a wrist reported up is only known to be up when the feedback is measured,
+    //otherwise the camera gets the whole confirmation window from the lock
+    bool raised = hasGripperData && fabs(wristFeedback - raisedWristAngle) <= gripperTolerance && PhaseTime() >= minRaiseTime;
+    float lockTime = (current_time - millTimer)/1e3;
+    if (raised && raisedTime < 0)
+    {
+      raisedTime = current_time;
+    }
+
+    if (!fingerReportsPosition)
+    {
+      if (lockTime >= heldConfirmWindow)
+      {
+        FailAttempt("cube not seen within the confirmation window");
+      }
+    }
+    else if (fingerFeedback <= emptyGraspAngle)
+    {
+      FailAttempt("cube slipped out of the fingers");
+    }
+    else if (raised && (current_time - raisedTime)/1e3 >= heldConfirmTime)
+    {
+      FailAttempt("cube not seen after raising the wrist");
+    }
+    else if (PhaseTime() >= raiseTimeout)
+    {
+      FailAttempt("cube not seen before the raise timed out");
+    }
+    break;
+  }
+
+  case PICKUP_RETRY:
+  {
+    //back up with the fingers open and the wrist down
+    result.pd.cmdVel = -0.15;
+    result.fingerAngle = openFingerAngle;
+    result.wristAngle = loweredWristAngle;
+
+    bool opened = hasGripperData && fingerFeedback >= openFingerAngle - gripperTolerance && PhaseTime() >= minCloseTime;
+
+    if (opened || PhaseTime() >= retryTimeout)
+    {
+      if (attempts >= maxAttempts)
+      {
+        cout << "PICKUP - giving up on the cube after " << attempts << " attempts" << endl;
+        ignoredTrack = targetTrack;
+        ignoreUntil = current_time + ignoreTime * 1e3;
+        Reset();
+        interupted = true;
+        result.pd.cmdVel = 0.0;
+        result.pd.cmdAngularError= 0.0;
+        ignoreCenterSonar = true;
+      }
+      else
+      {
+        //look for the cube again and lock on to it
+        lockTarget = false;
+        timeOut = false;
+        ignoreCenterSonar = true;
+      }
+    }
+    break;
+  }
+  }
+
+  return result;
+}
+
+void PickUpController::StartPhase(PickUpPhase phase)
+{
+  pickUpPhase = phase;
+  phaseStartTime = current_time;
+  raisedTime = -1;
+}
+
+float PickUpController::PhaseTime()
+{
+  return (current_time - phaseStartTime)/1e3;
+}
+
+void PickUpController::FailAttempt(string reason)
+{
+  failedGrasps++;
+  cout << "PICKUP - attempt " << attempts << " failed: " << reason << " after " << PhaseTime() << " s" << endl;
+  StartPhase(PICKUP_RETRY);
+}
+
+void PickUpController::RecordPickUp()
+{
+  if (targetHeld)
+  {
+    return;
+  }
+
+  float pickUpTime = pickUpStartTime >= 0 ? (current_time - pickUpStartTime)/1e3 : 0;
+  totalPickUps++;
+  totalPickUpTime += pickUpTime;
+
+  cout << "PICKUP - picked up a cube in " << pickUpTime << " s and " << attempts << " attempts, success rate "
+       << totalPickUps << "/" << totalAttempts << " attempts (" << 100.0 * totalPickUps / max(totalAttempts, 1)
+       << "%), " << failedGrasps << " failed grasps, average " << totalPickUpTime / totalPickUps << " s per pickup" << endl;
+}
+
+int PickUpController::GetIgnoredTrack() const
+{
+  return current_time < ignoreUntil ? ignoredTrack : -1;
+}
+
 bool PickUpController::HasWork()
 {
   return targetFound;
@@ -381,6 +566,10 @@ void PickUpController::Reset() {
   result.reset = false;
 
   ignoreCenterSonar = false;
+
+  pickUpPhase = PICKUP_APPROACH;
+  pickUpStartTime = -1;
+  attempts = 0;
 }
 
 void PickUpController::SetUltraSoundData(bool blockBlock){
@@ -391,3 +580,22 @@ void PickUpController::SetCurrentTimeInMilliSecs( long int time )
 {
   current_time = time;
 }
+
+void PickUpController::SetGripperData(float fingerAngle, float wristAngle)
+{
+  //a finger angle part way between open and closed means the feedback follows the fingers
+  if (fingerAngle > gripperTolerance && fingerAngle < openFingerAngle - gripperTolerance)
+  {
+    fingerReportsPosition = true;
+  }
+
+  if (fabs(fingerAngle - previousFingerFeedback) > 0.01)
+  {
+    fingerSettledTime = current_time;
+  }
+
+  hasGripperData = true;
+  previousFingerFeedback = fingerAngle;
+  fingerFeedback = fingerAngle;
+  wristFeedback = wristAngle;
+}
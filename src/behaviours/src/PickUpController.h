@@ -15,6 +15,15 @@ public:
 
   // Give the controller a list of visible april tags.
   void SetTagData(vector<Tag> tags);
+
+  // Give the controller the closest tracked block relative to the camera,
+  // forward along the ground and lateral to the right, in meters, and the
+  // ID of its track.
+  void SetTrackedTarget(float forward, float lateral, int trackID);
+
+  // Track of the cube the controller last gave up on, -1 once it may be
+  // tried again. The controller does not go back to it in the meantime.
+  int GetIgnoredTrack() const;
   bool ShouldInterrupt() override;
   bool HasWork() override;
 
@@ -33,11 +42,74 @@ public:
 
   void SetCurrentTimeInMilliSecs( long int time );
 
+  //angles the gripper servos last moved to, from fingerAngle/prev_cmd and wristAngle/prev_cmd
+  void SetGripperData(float fingerAngle, float wristAngle);
+
 protected:
 
   void ProcessData();
 
 private:
+
+  // Steps of a pickup once a target is locked. The gripper steps end as
+  // soon as the gripper reports it got there, the times are only timeouts.
+  enum PickUpPhase {
+    PICKUP_APPROACH, //drive the open fingers around the cube
+    PICKUP_GRASP, //stop and close the fingers
+    PICKUP_RAISE, //back up and raise the wrist until the cube is seen held
+    PICKUP_RETRY //open the fingers and lower the wrist for another attempt
+  };
+
+  Result SequencePickUp();
+  void StartPhase(PickUpPhase phase);
+  float PhaseTime(); //seconds since the phase started
+  void FailAttempt(string reason);
+  void RecordPickUp();
+
+  // true once the fingers have been seen between open and closed, then the
+  // feedback is the finger and wrist position and an empty grasp can be
+  // told from a held cube. The rover arduino reports the last servo command
+  // instead, which says nothing about where the gripper got to.
+  bool fingerReportsPosition = false;
+
+  bool hasGripperData = false;
+  float fingerFeedback = 0;
+  float wristFeedback = 0;
+  float previousFingerFeedback = 0;
+  long int fingerSettledTime = 0; //last time the finger feedback changed
+
+  PickUpPhase pickUpPhase = PICKUP_APPROACH;
+  long int phaseStartTime = 0;
+  long int raisedTime = -1; //first time the wrist was measured up in this raise
+
+  const float approachTime = 1.5; //seconds driving forward after the lock //ORIGINALLY 1.5 // 1.2 value from CNM 2017
+  const float graspTimeout = 0.5; //seconds
+  const float raiseTimeout = 2.0; //seconds
+  const float retryTimeout = 0.8; //seconds
+  const float minCloseTime = 0.3; //seconds for the fingers to close once the command is acknowledged
+  const float minRaiseTime = 0.3; //seconds for the wrist to swing up once the command is acknowledged
+  const float heldConfirmTime = 0.7; //seconds the sonar and camera get to see the cube once raised, the camera lags up to 0.61 s
+  const float heldConfirmWindow = 3.9; //seconds from the lock the camera gets to see the cube held without gripper feedback
+  const float fingerSettleTime = 0.2; //seconds without finger movement before the grasp is judged
+  const float openFingerAngle = M_PI_2;
+  const float raisedWristAngle = 0;
+  const float loweredWristAngle = 1.25;
+  const float gripperTolerance = 0.1; //radians
+  const float emptyGraspAngle = 0.15; //radians, fingers closed further than this hold nothing
+  const int maxAttempts = 3; //attempts on one cube before going back to searching
+  const float ignoreTime = 4.8; //seconds a cube that was given up on is not tried again, the pickup task time limit
+
+  //pickup statistics
+  long int pickUpStartTime = -1; //first lock on the current cube
+  int attempts = 0; //attempts on the current cube
+  int targetTrack = -1; //track of the current cube
+  int ignoredTrack = -1; //track of the cube given up on
+  long int ignoreUntil = 0;
+  int totalAttempts = 0;
+  int totalPickUps = 0;
+  int failedGrasps = 0;
+  float totalPickUpTime = 0; //seconds
+
   //Set true when the target block is less than targetDist so we continue attempting to pick it up rather than
   //switching to another block that is in view. In other words, the robot focuses on one particular target so
   //it doesn't get confused by having a whole bunch of targets in its view.
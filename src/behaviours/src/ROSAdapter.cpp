@@ -13,6 +13,7 @@
 #include <std_msgs/Float32.h>
 #include <std_msgs/Int16.h>
 #include <std_msgs/UInt8.h>
+#include <std_msgs/Empty.h>
 #include <std_msgs/String.h>
 #include <std_msgs/MultiArrayLayout.h>
 #include <std_msgs/MultiArrayDimension.h>
@@ -20,18 +21,30 @@
 #include <sensor_msgs/Range.h>
 #include <geometry_msgs/Pose2D.h>
 #include <geometry_msgs/Twist.h>
+#include <geometry_msgs/QuaternionStamped.h>
 #include <nav_msgs/Odometry.h>
 #include <apriltags_ros/AprilTagDetectionArray.h>
 #include <std_msgs/Float32MultiArray.h>
 #include "swarmie_msgs/Waypoint.h"
+#include "swarmie_msgs/SwarmPacket.h"
+#include "swarmie_msgs/ResourceDelta.h"
+#include "swarmie_msgs/SwarmHeartbeat.h"
 
 // Include Controllers
 #include "LogicController.h"
 #include <vector>
 #include <iterator>
+#include <functional>
 
 #include "Point.h"
 #include "Tag.h"
+#include "SwarmBus.h"
+#include "SwarmMembership.h"
+#include "SwarmTransport.h"
+#include "SwarmCodec.h"
+#include "StateSnapshot.h"
+#include "StartupGate.h"
+#include "InputLog.h"
 
 // To handle shutdown signals so the node quits
 // properly in response to "rosnode kill"
@@ -39,6 +52,8 @@
 #include <signal.h>
 
 #include <exception> // For exception handling
+#include <chrono>
+#include <cstring> // For memset
 
 #include <fstream>
 #include <iostream>
@@ -62,7 +77,6 @@ public:
 
 private:
   std::string msg;
-  //std_msgs::String Msg;     //sortOrder
 };
 
 // Random number generator
@@ -72,6 +86,8 @@ random_numbers::RandomNumberGenerator* rng;
 LogicController logicController;
 
 void humanTime();
+// Milliseconds since the rover left the start, carried across a restart.
+long int getRunTime(long int now);
 
 // Behaviours Logic Functions
 void sendDriveCommand(double linearVel, double angularVel);
@@ -80,11 +96,7 @@ void closeFingers();// Close fingers to 0 degrees
 void raiseWrist();  // Return wrist back to 0 degrees
 void lowerWrist();  // Lower wrist to 50 degrees
 void resultHandler();
-void CNMFirstBoot();        //StartOrder
-void sortOrder();     //SortOrder
 
-Point updateCenterLocation();
-void transformMapCentertoOdom();
 
 
 // Numeric Variables for rover positioning
@@ -94,8 +106,10 @@ geometry_msgs::Pose2D currentLocationAverage;   //???
 
 geometry_msgs::Pose2D centerLocation;           //location of center location
 geometry_msgs::Pose2D centerLocationMap;        //location of center on map
-geometry_msgs::Pose2D centerLocationOdom;       //location of center ODOM
-geometry_msgs::Pose2D centerLocationMapRef;
+bool odomReceived = false;
+bool mapReceived = false;
+float mapVarianceX = 0; //position covariance of the EKF pose
+float mapVarianceY = 0;
 
 int currentMode = 0;
 const float behaviourLoopTimeStep = 0.1; // time between the behaviour loop calls
@@ -111,13 +125,15 @@ float angularVelocity = 0;
 
 float prevWrist = 0;
 float prevFinger = 0;
+
+// angles the gripper servos last moved to as reported by the arduino
+float fingerFeedback = 0;
+float wristFeedback = 0;
 long int startTime = 0;
 float minutesTime = 0;
 float hoursTime = 0;
 
 
-float drift_tolerance = 0.5; // meters
-
 Result result;
 
 geometry_msgs::Twist velocity;
@@ -140,13 +156,14 @@ ros::Publisher waypointFeedbackPublisher;
 ros::Publisher manualWaypointPublisher;
 
 //CNM publishers
-ros::Publisher startOrderPub;		//startOrder
-ros::Publisher sortOrderPub;		//SortOrder
-ros::Publisher broadcastPub;
+// Publishes the membership heartbeats of this rover on "membership"
+ros::Publisher membershipPublisher;
+// Publishes the batched swarm reports of this rover on "swarm"
+ros::Publisher swarmPublisher;
+// Publishes the changed cells of the resource registry on "resources"
+ros::Publisher resourcePublisher;
 //ros::Publisher obstacleWaypointPub;
 //ros::Publisher miscWaypointPub;
-//TODO: testing functionality of reusing variable name
-ros::Publisher namedSwarmiePub;
 
 // Subscribers
 ros::Subscriber joySubscriber;
@@ -159,10 +176,12 @@ ros::Subscriber virtualFenceSubscriber;
 // swarmie_msgs::Waypoint messages.
 
 ros::Subscriber manualWaypointSubscriber;
-ros::Subscriber startOrderSub;			//startOrder
-ros::Subscriber sortOrderSub;			//SortOrder
-ros::Subscriber myNameSub;
-ros::Subscriber broadcastSub;
+ros::Subscriber fingerAngleSubscriber;
+ros::Subscriber wristAngleSubscriber;
+ros::Subscriber membershipSubscriber;
+ros::Subscriber swarmSubscriber;
+ros::Subscriber resourceSubscriber;
+ros::Subscriber paramReloadSubscriber;
 //ros::Subscriber obstacleWaypointSub;
 //ros::Subscriber broadcastObstacleSub;
 //ros::Subscriber miscWaypointSub;
@@ -173,13 +192,10 @@ ros::Timer stateMachineTimer;
 ros::Timer publish_status_timer;
 ros::Timer publish_heartbeat_timer;
 
-// records time for delays in sequanced actions, 1 second resolution.
-time_t timerStartTime;
-
-// An initial delay to allow the rover to gather enough position data to
-// average its location.
-unsigned int startDelayInSeconds = 30;
-float timerTimeElapsed = 0;
+// Holds the rover at the start until the EKF pose has converged, the
+// center has been averaged, the transforms are up and the membership has
+// given it a role, instead of a fixed delay.
+StartupGate startupGate;
 
 //Transforms
 tf::TransformListener *tfListener;
@@ -199,30 +215,72 @@ void behaviourStateMachine(const ros::TimerEvent&);
 void publishStatusTimerEventHandler(const ros::TimerEvent& event);
 void publishHeartBeatTimerEventHandler(const ros::TimerEvent& event);
 void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight);
+void fingerAngleHandler(const geometry_msgs::QuaternionStamped::ConstPtr& message);
+void wristAngleHandler(const geometry_msgs::QuaternionStamped::ConstPtr& message);
 
 //CNM handlers
-void startOrderHandler(const std_msgs::String& msg);			//startOrder
-void sortOrderHandler(const std_msgs::String& msg);	//SortOrder
-
-void myMessageHandler(const swarmie_msgs::Waypoint& my_msg);
+void membershipHandler(const swarmie_msgs::SwarmHeartbeat& message);
+void swarmHandler(const swarmie_msgs::SwarmPacket& message);
+
+// Pose beacons, cube sightings and role claims shared with the other rovers,
+// created once the name is known since packets carry a hash of it.
+SwarmBus* swarmBus;
+void publishSwarmReports();
+
+void resourceDeltaHandler(const swarmie_msgs::ResourceDelta& message);
+void publishResourceDelta();
+
+// Which rovers are alive, who leads and the role of this rover, replaces
+// the names exchanged once on startOrder and sortOrder.
+SwarmMembership* swarmMembership;
+void publishMembershipHeartbeat();
+
+// UDP multicast between the rovers instead of the swarm, membership and
+// resources topics when the swarm_transport parameter is "udp", so the
+// swarm keeps talking when the link to the ROS master drops. Null when the
+// topics are used.
+SwarmTransport* swarmTransport = nullptr;
+ros::Timer swarmTransportTimer;
+const float swarmTransportPollInterval = 0.02; //seconds
+void pollSwarmTransport(const ros::TimerEvent&);
+
+// What swarmHandler does with a packet once it is off the topic or the
+// transport.
+void receiveSwarmPacket(const SwarmPacket& packet);
+
+// Role, run time, nest and process state kept in a memory mapped file so a
+// node that crashed and restarted carries on where it was instead of
+// waiting out the start delay again. Null when the snapshot_file parameter
+// is empty or the file can't be opened.
+StateSnapshot* stateSnapshot = nullptr;
+RoverState savedState;
+bool haveSavedState = false;
+bool restoredSnapshot = false;
+const long int snapshotInterval = 1000; //milliseconds between saves
+const long int maxSnapshotAge = 300000; //milliseconds, older ones are from an earlier run
+void saveSnapshot();
+bool restoreSnapshot();
+
+// Every input of the logic controller and what it returned on each tick,
+// so the run can be replayed off the rover with behaviours_replay. Null
+// when the input_log parameter is empty or the log can't be created.
+InputLog* inputLog = nullptr;
+
+// Tuning constants of the controllers, from config/behaviours.yaml loaded
+// into /behaviours for the whole swarm, where the private parameters of
+// the node win. A message on /behaviours/reload makes every rover read
+// them again, so a fleet can be tuned live with rosparam set.
+void loadParams();
+void paramReloadHandler(const std_msgs::Empty& message);
 
 // Converts the time passed as reported by ROS (which takes Gazebo simulation rate into account) into milliseconds as an integer.
 long int getROSTimeInMilliSecs();
 
 /* CNM added code --------------------------------------------------------------
 ------------------------------------------------------------------------------*/
-Point cnmCenterLocation;
-bool resetMap = false;
-void CNMAVGCenter();       //Averages derived center locations
-bool purgeMap = false;
 
 //AJH added variables:
 
-bool roleReady = true;
-bool firstUpdate = true;
-bool secondUpdate = true;
-bool thirdUpdate = true;
-
 enum class Role{
     //teamsize == 3
     gather1, //searches close to center, gathers drop offs from searchers, helps searchers
@@ -236,39 +294,15 @@ enum class Role{
 //variable to hold my role 
 Role myRole;
 int myStartTime;
-vector<ros::Publisher> comms;
 
-swarmie_msgs::Waypoint wmsg;
-swarmie_msgs::Waypoint my_msg;
 std_msgs::String msg;
-std_msgs::String Msg;    //sortOrder
 
-bool hasTested = false;
-vector<std::string> swarmieNames;
-void assignSwarmieRoles(int startTime);
-void updateBehavior(int currentTime);
-void testStuff();
+void assignSwarmieRoles(int role);
 int myID;
 ros::NodeHandle *cnm_NH;
 
-//ARRAYS FOR CENTER
-const int ASIZE = 100;
-int centerIndex = 0;
-bool maxedCenterArray = false;
-
-const int CASIZE = 30;
-
-float avgCurrentCoordsX[CASIZE];
-float avgCurrentCoordsY[CASIZE];
-
-//Point cnmCurrentLocation;
-void CNMCurrentLocationAVG();      //Averages current location on map
-
-void CNMProjectCenter();
-
-//Actual Center Array
-float CenterXCoordinates[ASIZE];
-float CenterYCoordinates[ASIZE];
+//the nest center and the averaged location are kept by the LocationController pose service
+void logCenterLocation();
 
 //INITIAL NEST SEARCH
 bool cnmFirstBootProtocol = true;
@@ -277,12 +311,6 @@ bool cnmInitialPositioningComplete = false;
 bool cnmHasMovedForward = false;
 bool cnmHasTurned180 = false;
 
-//VAIRABLES FOR //startOrder
-bool testCount = true;		//bool for window to increment
-float cnmStartOrder = 0;           //startCheck
-bool sortTrigger = true;
-bool sortTrigger1 = true;
-bool sortTrigger2 = true;
 
 // IP address test @@@@
 #include <arpa/inet.h>
@@ -316,6 +344,53 @@ int main(int argc, char **argv) {
   // Register the SIGINT event handler so the node can shutdown properly
   signal(SIGINT, sigintEventHandler);
 
+  ros::NodeHandle privateNH("~");
+  const char* home = getenv("HOME");
+
+  //before the first input reaches the logic controller
+  string inputLogFile;
+  privateNH.param<string>("input_log", inputLogFile, string(home != nullptr ? home : ".") + "/.ros/" + publishedName + "_behaviours.inputs");
+  if (!inputLogFile.empty())
+  {
+    inputLog = new InputLog();
+    if (inputLog->Open(inputLogFile))
+    {
+      logicController.SetInputLog(inputLog);
+      cout << "Recording the inputs to " << inputLogFile << endl;
+    }
+    else
+    {
+      delete inputLog;
+      inputLog = nullptr;
+    }
+  }
+
+  // search pattern from the node's private parameters, seeded per rover so
+  // the random patterns differ between rovers
+  string searchPattern;
+  privateNH.param<string>("search_pattern", searchPattern, "lawnmower");
+  logicController.SetSearchPattern(searchPattern, std::hash<string>()(publishedName));
+
+  string snapshotFile;
+  privateNH.param<string>("snapshot_file", snapshotFile, string(home != nullptr ? home : ".") + "/.ros/" + publishedName + "_behaviours.snapshot");
+  if (!snapshotFile.empty())
+  {
+    stateSnapshot = new StateSnapshot();
+    if (stateSnapshot->Open(snapshotFile))
+    {
+      //only read here, whether it is recent enough is known once ROS time runs
+      auto loadStart = chrono::steady_clock::now();
+      haveSavedState = stateSnapshot->Load(savedState);
+      cout << "Snapshot " << snapshotFile << (haveSavedState ? " loaded in " : " is empty, checked in ")
+           << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - loadStart).count() << " us" << endl;
+    }
+    else
+    {
+      delete stateSnapshot;
+      stateSnapshot = nullptr;
+    }
+  }
+
   joySubscriber = mNH.subscribe((publishedName + "/joystick"), 10, joyCmdHandler);
   modeSubscriber = mNH.subscribe((publishedName + "/mode"), 1, modeHandler);
   targetSubscriber = mNH.subscribe((publishedName + "/targets"), 10, targetHandler);
@@ -323,17 +398,18 @@ int main(int argc, char **argv) {
   mapSubscriber = mNH.subscribe((publishedName + "/odom/ekf"), 10, mapHandler);
   virtualFenceSubscriber = mNH.subscribe(("/virtualFence"), 10, virtualFenceHandler);
   manualWaypointSubscriber = mNH.subscribe((publishedName + "/waypoints/cmd"), 10, manualWaypointHandler);
+  fingerAngleSubscriber = mNH.subscribe((publishedName + "/fingerAngle/prev_cmd"), 10, fingerAngleHandler);
+  wristAngleSubscriber = mNH.subscribe((publishedName + "/wristAngle/prev_cmd"), 10, wristAngleHandler);
   message_filters::Subscriber<sensor_msgs::Range> sonarLeftSubscriber(mNH, (publishedName + "/sonarLeft"), 10);
   message_filters::Subscriber<sensor_msgs::Range> sonarCenterSubscriber(mNH, (publishedName + "/sonarCenter"), 10);
   message_filters::Subscriber<sensor_msgs::Range> sonarRightSubscriber(mNH, (publishedName + "/sonarRight"), 10);
 
   //CNM CODE
-  startOrderSub = mNH.subscribe("startOrder", 1000, &startOrderHandler);			//startOrder
-  sortOrderSub = mNH.subscribe("sortOrder", 1000, &sortOrderHandler);				//sortOrder
-  //AJH: each swarmie has an individual and broadcast subscriber, because some messages are targeted
-  //but some messages will need to be sent out to all swarmies at once
-  myNameSub =  mNH.subscribe(("dear"+publishedName), 10, &myMessageHandler);
-  broadcastSub = mNH.subscribe("broadcast", 10, &myMessageHandler); 
+  membershipSubscriber = mNH.subscribe("membership", 10, &membershipHandler);
+  //one topic for all swarm reports, it replaces the broadcast and dear<name> Waypoint topics
+  swarmSubscriber = mNH.subscribe("swarm", 10, &swarmHandler);
+  paramReloadSubscriber = mNH.subscribe("/behaviours/reload", 1, &paramReloadHandler);
+  resourceSubscriber = mNH.subscribe("resources", 10, &resourceDeltaHandler);
 
   //broadcastResourceSub = mNH.subscribe(("broadcast/resource"), 1000, &resourceFenceHandler);
   //obstacleWaypointSub  = mNH.subscribe((publishedName+"/obstacle"), 100, &obstacleMsgHandler);
@@ -343,12 +419,38 @@ int main(int argc, char **argv) {
 
 
   //CNM CODE
-  startOrderPub = mNH.advertise<std_msgs::String>("startOrder", 1000);			//startOrder
-  sortOrderPub = mNH.advertise<std_msgs::String>("sortOrder", 1000);			//sortOrder
-  //AJH: each swarmie publishes to a single swarmie based on roles, etc.
-  //the variable 'currentRecipientName' holds the name of the swarmie we're trying to send to
-  //manualWaypointPublisher = mNH.advertise<swarmie_msgs::Waypoint>((publishedName + "/waypoints/cmd"), 10, true);
-  broadcastPub = mNH.advertise<swarmie_msgs::Waypoint>("broadcast", 100, true);
+  swarmMembership = new SwarmMembership(publishedName);
+  membershipPublisher = mNH.advertise<swarmie_msgs::SwarmHeartbeat>("membership", 10);
+  swarmBus = new SwarmBus(SwarmBus::NameHash(publishedName));
+  swarmPublisher = mNH.advertise<swarmie_msgs::SwarmPacket>("swarm", 10);
+  resourcePublisher = mNH.advertise<swarmie_msgs::ResourceDelta>("resources", 10);
+
+  string transport;
+  privateNH.param<string>("swarm_transport", transport, "ros");
+  if (transport == "udp")
+  {
+    string group, interfaceAddress;
+    int port;
+    privateNH.param<string>("swarm_multicast_group", group, "239.255.42.99");
+    privateNH.param<int>("swarm_multicast_port", port, 5405);
+    privateNH.param<string>("swarm_multicast_interface", interfaceAddress, "");
+
+    swarmTransport = new SwarmTransport(SwarmBus::NameHash(publishedName));
+    //registry deltas are only sent once, the rest is sent again anyway
+    swarmTransport->SetReliable(SWARM_CHANNEL_RESOURCES, true);
+    if (swarmTransport->Open(group, port, interfaceAddress))
+    {
+      swarmTransportTimer = mNH.createTimer(ros::Duration(swarmTransportPollInterval), pollSwarmTransport);
+      cout << "Swarm messages over UDP multicast on " << group << ":" << port << endl;
+    }
+    else
+    {
+      //fall back to the topics
+      delete swarmTransport;
+      swarmTransport = nullptr;
+    }
+  }
+  logicController.SetRoverId(SwarmBus::NameHash(publishedName));
   //obstacleWaypointPub = mNH.advertise<geometry_msgs::Point>(("broadcast/obstacle"), 10, true);
   //zombie waypoints
   //miscWaypointPub = mNH.advertise<geometry_msgs::Point>(("broadcast/misc"),10,true);
@@ -363,6 +465,9 @@ int main(int argc, char **argv) {
   manualWaypointPublisher = mNH.advertise<swarmie_msgs::Waypoint>((publishedName + "/waypoints/cmd"), 10, true);
   waypointFeedbackPublisher = mNH.advertise<swarmie_msgs::Waypoint>((publishedName + "/waypoints"), 1, true);
 
+  //before the behaviour loop starts
+  loadParams();
+
   publish_status_timer = mNH.createTimer(ros::Duration(status_publish_interval), publishStatusTimerEventHandler);
   stateMachineTimer = mNH.createTimer(ros::Duration(behaviourLoopTimeStep), behaviourStateMachine);
 
@@ -379,7 +484,7 @@ int main(int argc, char **argv) {
   infoLogPublisher.publish(msg);
 
   stringstream ss;
-  ss << "Rover start delay set to " << startDelayInSeconds << " seconds";
+  ss << "Rover starts when the pose, center, tf and role are ready, at most " << startupGate.maxWait / 1000 << " seconds";
   msg.data = ss.str();
   infoLogPublisher.publish(msg);
 
@@ -389,8 +494,6 @@ int main(int argc, char **argv) {
     logicController.SetModeManual();
   }
 
-  timerStartTime = time(0);
-
 
 //ss << "IP Address running"<< ip<< "Identity";
 //        msg.data = ss.str();
@@ -399,6 +502,13 @@ int main(int argc, char **argv) {
 
   ros::spin();
 
+  //what was recorded since the last tick
+  if (inputLog != nullptr)
+  {
+    logicController.SetInputLog(nullptr);
+    inputLog->Close();
+  }
+
   return EXIT_SUCCESS;
 }
 
@@ -410,96 +520,65 @@ int main(int argc, char **argv) {
 void behaviourStateMachine(const ros::TimerEvent&)
 {
 
-if (timerTimeElapsed > 31)
-{
-    CNMFirstBoot();               //StartOrder
-}
-
-if (timerTimeElapsed > 33)
-{
-    sortOrder();
-}
-
-//TODO: AJH if a swarmie crashes & reboots, we want them to have a copy of their role & 
-// the time that they were working 
-if(timerTimeElapsed > 45 && roleReady)
-{
-  roleReady = false;
-  assignSwarmieRoles(timerTimeElapsed);
-}
-
-//TODO: AJH this is just for testing! I would never in good conscience hard code 
-//a comparison to a published name. That would be silly.
-if(timerTimeElapsed > 53 && publishedName == "ajax" && firstUpdate) 
-{
-  firstUpdate = false;
-  testStuff();
-}
-//TODO: testing initial comms, comment this back in when done
-/*
-//at ~5 minutes, update our roles
-if((4 < (timerTimeElapsed/60) <= 5) && firstUpdate){
-  firstUpdate = false;
-  updateBehavior(timerTimeElapsed);
-}
-
-//at ~10 minutes, update our roles
-if((9 < (timerTimeElapsed/60) <= 10) && secondUpdate){
-  secondUpdate = false;
-  updateBehavior(timerTimeElapsed);
-}
-
-//at ~15 minutes, update our roles
-if((14 < (timerTimeElapsed/60) <= 15) && thirdUpdate){
-  thirdUpdate = false;
-  updateBehavior(timerTimeElapsed);
-}
-*/
-
-/*if (sortTrigger1 == false)
-{
-  if (sortTrigger2)
-  {
-     sortTrigger2 = false;
-        std_msgs::String msg;
-        msg.data = "sortTriggerHandler running ";
-        infoLogPublisher.publish(msg);
-  }
-}*/
   std_msgs::String stateMachineMsg;
 
-  // time since timerStartTime was set to current time
-  timerTimeElapsed = time(0) - timerStartTime;
+  //callbacks run one at a time, none of them holds a parameter snapshot now
+  logicController.ParamsQuiescent();
 
   // init code goes here. (code that runs only once at start of
   // auto mode but wont work in main goes here)
   if (!initilized)
   {
-    int i = centerIndex;
-    //try averaging our gps location here:
-    if( i < ASIZE)
+    long int now = getROSTimeInMilliSecs();
+    if (!startupGate.IsStarted())
+    {
+      startupGate.Start(now);
+    }
+
+    if (mapReceived)
     {
-      CenterXCoordinates[centerIndex] = currentLocationMap.x;
-      CenterYCoordinates[centerIndex] = currentLocationMap.y;
-
-      //stringstream ss;
-      //ss << "reading position X: " <<   centerLocationMap.x << " Y: " << centerLocationMap.y << "  i: " << i << endl;
-      //msg.data = ss.str();
-      //infoLogPublisher.publish(msg);
-      centerIndex++;
+      startupGate.SetPoseCovariance(mapVarianceX, mapVarianceY);
     }
-    if (timerTimeElapsed > startDelayInSeconds)
+    startupGate.SetCenterSamples(logicController.GetCenterSampleCount(), logicController.GetCenterUncertainty());
+    startupGate.SetTransformAvailable(tfListener->canTransform(publishedName + "/odom", publishedName + "/camera_link", ros::Time(0)));
+    startupGate.SetRole(swarmMembership->GetRole());
+
+    if (restoreSnapshot())
     {
+      restoredSnapshot = true;
+      startupGate.SkipCenterAndRole();
+    }
+    bool ready = startupGate.Update(now);
+
+    //try averaging our gps location here, once the EKF has settled:
+    if (startupGate.ShouldSampleCenter() && !restoredSnapshot)
+    {
+      Point centerSample;
+      centerSample.x = currentLocationMap.x;
+      centerSample.y = currentLocationMap.y;
+      centerSample.theta = currentLocationMap.theta;
+      logicController.AddCenterLocationSample(centerSample);
+    }
+
+    if (!ready)
+    {
+      return;
+    }
 
+    // initialization has run
+    initilized = true;
+    msg.data = "Startup: " + startupGate.Describe();
+    infoLogPublisher.publish(msg);
 
-      // initialization has run
-      initilized = true;
+    if (!restoredSnapshot)
+    {
       //TODO: this just sets center to 0 over and over and needs to change
       Point centerOdom;
       centerOdom.x = 1.3 * cos(currentLocation.theta);
       centerOdom.y = 1.3 * sin(currentLocation.theta);
       centerOdom.theta = centerLocation.theta;
       logicController.SetCenterLocationOdom(centerOdom);
+      logicController.InitializeLocalizer(centerOdom);
 
       Point centerMap;
       centerMap.x = currentLocationMap.x + (1.3 * cos(currentLocation.theta));
@@ -529,25 +608,17 @@ if((14 < (timerTimeElapsed/60) <= 15) && thirdUpdate){
 	    }
       CNMProjectCenter();
       */
-      centerIndex = 0;
-      CNMProjectCenter();
+      logCenterLocation();
 
       centerLocationMap.x = centerMap.x;
       centerLocationMap.y = centerMap.y;
 
-      centerLocationOdom.x = centerOdom.x;
-      centerLocationOdom.y = centerOdom.y;
-
       startTime = getROSTimeInMilliSecs();
     }
-
-    else
-    {
-      return;
-    }
-
   }
 
+  saveSnapshot();
+
   // Robot is in automode
   if (currentMode == 2 || currentMode == 3)
   {
@@ -557,8 +628,8 @@ if((14 < (timerTimeElapsed/60) <= 15) && thirdUpdate){
     //update the time used by all the controllers
     logicController.SetCurrentTimeInMilliSecs( getROSTimeInMilliSecs() );
 
-    //update center location
-    logicController.SetCenterLocationOdom( updateCenterLocation() );
+    //update center location, corrected for odometry drift by the localizer
+    logicController.SetCenterLocationOdom( logicController.GetLocalizedCenterLocation() );
 
     //ask logic controller for the next set of actuator commands
     result = logicController.DoWork();
@@ -652,6 +723,10 @@ if((14 < (timerTimeElapsed/60) <= 15) && thirdUpdate){
     }
   }
 
+  publishMembershipHeartbeat();
+  publishSwarmReports();
+  publishResourceDelta();
+
   // publish state machine string for user, only if it has changed, though
   if (strcmp(stateMachineMsg.data.c_str(), prev_state_machine) != 0)
   {
@@ -665,6 +740,15 @@ void sendDriveCommand(double left, double right)
   velocity.linear.x = left,
       velocity.angular.z = right;
 
+  //time to first motion, reported on every boot
+  if ((left != 0 || right != 0) && startupGate.IsReady() && startupGate.GetTimeToMotion() < 0)
+  {
+    startupGate.Moved(getROSTimeInMilliSecs());
+    msg.data = "Startup: " + startupGate.Describe();
+    infoLogPublisher.publish(msg);
+    cout << msg.data << endl;
+  }
+
   // publish the drive commands
   driveControlPublish.publish(velocity);
 }
@@ -729,6 +813,25 @@ void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_ms
 
 }
 
+// The arduino reports the angle each gripper servo last moved to as the roll of a quaternion
+float gripperAngle(const geometry_msgs::QuaternionStamped::ConstPtr& message) {
+  tf::Quaternion q(message->quaternion.x, message->quaternion.y, message->quaternion.z, message->quaternion.w);
+  tf::Matrix3x3 m(q);
+  double roll, pitch, yaw;
+  m.getRPY(roll, pitch, yaw);
+  return roll;
+}
+
+void fingerAngleHandler(const geometry_msgs::QuaternionStamped::ConstPtr& message) {
+  fingerFeedback = gripperAngle(message);
+  logicController.SetGripperData(fingerFeedback, wristFeedback);
+}
+
+void wristAngleHandler(const geometry_msgs::QuaternionStamped::ConstPtr& message) {
+  wristFeedback = gripperAngle(message);
+  logicController.SetGripperData(fingerFeedback, wristFeedback);
+}
+
 void odometryHandler(const nav_msgs::Odometry::ConstPtr& message){
   //Get (x,y) location directly from pose
   currentLocation.x = message->pose.pose.position.x;
@@ -740,6 +843,7 @@ void odometryHandler(const nav_msgs::Odometry::ConstPtr& message){
   double roll, pitch, yaw;
   m.getRPY(roll, pitch, yaw);
   currentLocation.theta = yaw;
+  odomReceived = true;
 
   linearVelocity = message->twist.twist.linear.x;
   angularVelocity = message->twist.twist.angular.z;
@@ -749,7 +853,7 @@ void odometryHandler(const nav_msgs::Odometry::ConstPtr& message){
   currentLoc.x = currentLocation.x;
   currentLoc.y = currentLocation.y;
   currentLoc.theta = currentLocation.theta;
-  logicController.SetPositionData(currentLoc);
+  logicController.SetPositionData(currentLoc, message->header.stamp.sec*1e3 + message->header.stamp.nsec/1e6);
   logicController.SetVelocityData(linearVelocity, angularVelocity);
 }
 
@@ -811,6 +915,9 @@ void mapHandler(const nav_msgs::Odometry::ConstPtr& message) {
   double roll, pitch, yaw;
   m.getRPY(roll, pitch, yaw);
   currentLocationMap.theta = yaw;
+  mapVarianceX = message->pose.covariance[0];
+  mapVarianceY = message->pose.covariance[7];
+  mapReceived = true;
 
   linearVelocity = message->twist.twist.linear.x;
   angularVelocity = message->twist.twist.angular.z;
@@ -819,7 +926,7 @@ void mapHandler(const nav_msgs::Odometry::ConstPtr& message) {
   curr_loc.x = currentLocationMap.x;
   curr_loc.y = currentLocationMap.y;
   curr_loc.theta = currentLocation.theta; // was currentLocationMap
-  logicController.SetMapPositionData(curr_loc);
+  logicController.SetMapPositionData(curr_loc, message->header.stamp.sec*1e3 + message->header.stamp.nsec/1e6);
   logicController.SetMapVelocityData(linearVelocity, angularVelocity);
 }
 
@@ -905,70 +1012,108 @@ long int getROSTimeInMilliSecs()
 }
 
 
-Point updateCenterLocation()
+void loadParams()
 {
-  transformMapCentertoOdom();
+  int changed = logicController.LoadParams([](const string& name, double& value) {
+    return ros::param::get("~" + name, value) || ros::param::get("/behaviours/" + name, value);
+  });
 
-  Point tmp;
-  tmp.x = centerLocationOdom.x;
-  tmp.y = centerLocationOdom.y;
-
-  return tmp;
+  stringstream ss;
+  ss << "Parameters loaded, " << changed << " changed";
+  msg.data = ss.str();
+  infoLogPublisher.publish(msg);
 }
 
-void transformMapCentertoOdom()
+void paramReloadHandler(const std_msgs::Empty& message)
 {
+  loadParams();
+}
 
-  // map frame
-  geometry_msgs::PoseStamped mapPose;
-
-  // setup msg to represent the center location in map frame
-  mapPose.header.stamp = ros::Time::now();
-
-  mapPose.header.frame_id = publishedName + "/map";
-  mapPose.pose.orientation = tf::createQuaternionMsgFromRollPitchYaw(0, 0, centerLocationMap.theta);
-  mapPose.pose.position.x = centerLocationMap.x;
-  mapPose.pose.position.y = centerLocationMap.y;
-  geometry_msgs::PoseStamped odomPose;
-  string x = "";
+// Saves the snapshot every snapshotInterval once the rover is working.
+void saveSnapshot()
+{
+  static long int lastSave = 0;
+  long int now = getROSTimeInMilliSecs();
+  if (stateSnapshot == nullptr || now - lastSave < snapshotInterval)
+  {
+    return;
+  }
+  lastSave = now;
+
+  RoverState state;
+  memset(&state, 0, sizeof(state));
+  state.savedTime = now;
+  state.runTime = getRunTime(now);
+  state.centerLocationMap.x = centerLocationMap.x;
+  state.centerLocationMap.y = centerLocationMap.y;
+  state.centerLocationMap.theta = centerLocationMap.theta;
+  state.role = swarmMembership->GetRole();
+  state.epoch = swarmMembership->GetEpoch();
+  logicController.SaveState(state);
+
+  auto saveStart = chrono::steady_clock::now();
+  stateSnapshot->Save(state);
+  long int saveTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - saveStart).count();
+  if (saveTime > 1000)
+  {
+    cout << "SNAPSHOT - save took " << saveTime << " us" << endl;
+  }
+}
 
-  try
-  { //attempt to get the transform of the center point in map frame to odom frame.
-    tfListener->waitForTransform(publishedName + "/map", publishedName + "/odom", ros::Time::now(), ros::Duration(1.0));
-    tfListener->transformPose(publishedName + "/odom", mapPose, odomPose);
+// Picks up from the snapshot of a node that ran shortly before, once the
+// poses are in and the rover is in auto mode. The snapshot is used at most
+// once, a stale one or one from the future (the simulation was restarted)
+// is dropped and the rover starts as usual.
+bool restoreSnapshot()
+{
+  if (!haveSavedState || !odomReceived || !mapReceived || (currentMode != 2 && currentMode != 3))
+  {
+    return false;
   }
+  haveSavedState = false;
 
-  catch(tf::TransformException& ex) {
-    ROS_INFO("Received an exception trying to transform a point from \"map\" to \"odom\": %s", ex.what());
-    x = "Exception thrown " + (string)ex.what();
-    std_msgs::String msg;
+  long int now = getROSTimeInMilliSecs();
+  long int age = now - savedState.savedTime;
+  if (age < 0 || age > maxSnapshotAge)
+  {
     stringstream ss;
-    ss << "Exception in mapAverage() " + (string)ex.what();
+    ss << "Snapshot from " << age / 1000 << " s ago not used";
     msg.data = ss.str();
     infoLogPublisher.publish(msg);
-    cout << msg.data << endl;
+    return false;
   }
 
-  // Use the position and orientation provided by the ros transform.
-  centerLocationMapRef.x = odomPose.pose.position.x; //set centerLocation in odom frame
-  centerLocationMapRef.y = odomPose.pose.position.y;
-
- // cout << "x ref : "<< centerLocationMapRef.x << " y ref : " << centerLocationMapRef.y << endl;
+  auto restoreStart = chrono::steady_clock::now();
+  logicController.RestoreState(savedState);
+  centerLocationMap.x = savedState.centerLocationMap.x;
+  centerLocationMap.y = savedState.centerLocationMap.y;
+  centerLocationMap.theta = savedState.centerLocationMap.theta;
 
-  float xdiff = centerLocationMapRef.x - centerLocationOdom.x;
-  float ydiff = centerLocationMapRef.y - centerLocationOdom.y;
+  //the round went on while the node was down
+  long int runTime = savedState.runTime + age;
+  hoursTime = runTime / 3600000;
+  minutesTime = runTime / 60000 % 60;
+  startTime = now - runTime % 60000;
 
-  float diff = hypot(xdiff, ydiff);
-
-  if (diff > drift_tolerance)
+  //until the membership settles again, it assigns the roles from then on
+  if (savedState.role >= 0)
   {
-    centerLocationOdom.x += xdiff/diff;
-    centerLocationOdom.y += ydiff/diff;
+    assignSwarmieRoles(savedState.role);
   }
+  logCenterLocation();
 
-  //cout << "center x diff : " << centerLocationMapRef.x - centerLocationOdom.x << " center y diff : " << centerLocationMapRef.y - centerLocationOdom.y << endl;
-  //cout << hypot(centerLocationMapRef.x - centerLocationOdom.x, centerLocationMapRef.y - centerLocationOdom.y) << endl;
+  stringstream ss;
+  ss << "Restored from a snapshot " << age << " ms old in "
+     << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - restoreStart).count() << " us, "
+     << runTime / 1000 << " s into the run, role " << savedState.role << ", epoch " << savedState.epoch
+     << ", process state " << savedState.processState;
+  msg.data = ss.str();
+  infoLogPublisher.publish(msg);
+  return true;
+}
 
+long int getRunTime(long int now) {
+  return (long int)(hoursTime * 60 + minutesTime) * 60000 + (now - startTime);
 }
 
 void humanTime() {
@@ -995,358 +1140,327 @@ void humanTime() {
   //cout << "System has been Running for :: " << hoursTime << " : hours " << minutesTime << " : minutes " << timeDiff << "." << frac << " : seconds" << endl; //you can remove or comment this out it just gives indication something is happening to the log file
 }
 
-void startOrderHandler(const std_msgs::String& msg)		//startOrder
-{
-
-  string msg_name = msg.data;
-  swarmieNames.push_back(msg.data);
-  if(msg_name == publishedName){
-    Msg.data = string("That's my published name! I am " + publishedName);
-    //infoLogPublisher.publish(Msg);
-  }
-  else{
-    Msg.data = string("Boo, that's not my published name! I'm not " + msg_name + ", I'm " + publishedName);
-    //infoLogPublisher.publish(Msg);
+// Passes the pose beacons of the other rovers to the collision avoidance,
+// their bids to the task auction and their nest reservations to the nest
+// scheduler, and logs the rest of what they report.
+void swarmHandler(const swarmie_msgs::SwarmPacket& message) {
+  SwarmPacket packet;
+  packet.sender = message.sender;
+  packet.seq = message.seq;
+  packet.incarnation = message.incarnation;
+  for (const swarmie_msgs::SwarmReport& received : message.reports)
+  {
+    SwarmReport report;
+    report.type = received.type;
+    report.x = received.x;
+    report.y = received.y;
+    report.heading = received.heading;
+    report.value = received.value;
+    packet.reports.push_back(report);
   }
 
+  receiveSwarmPacket(packet);
 }
 
-void CNMFirstBoot()
-{
-    //FIRST TIME IN THIS FUNCTION
-    if(testCount)		//startOrder
+void receiveSwarmPacket(const SwarmPacket& packet) {
+  vector<SwarmState> states;
+  if (!swarmBus->Receive(packet, states))
+  {
+    return;
+  }
+
+  for (const SwarmState& state : states)
+  {
+    if (state.type == SwarmReport::POSE)
     {
-      testCount = false;
-      /*  std_msgs::String msg;
-        msg.data = "first boot running ";
-          infoLogPublisher.publish(msg);*/
-      msg.data = (publishedName);
-	    startOrderPub.publish(msg);
+      logicController.ReceiveNeighbourPose(state.sender, state.location, state.value / 100.0);
+      continue;
+    }
+    if (state.type == SwarmReport::BID)
+    {
+      AllocationBid bid;
+      bid.location = state.location;
+      bid.bid = state.value;
+      logicController.ReceiveBid(state.sender, bid);
+      continue;
+    }
+    if (state.type == SwarmReport::RESERVATION)
+    {
+      NestReservation reservation;
+      reservation.entry = state.location;
+      reservation.start = state.value;
+      logicController.ReceiveNestReservation(state.sender, reservation);
+      continue;
     }
-}
 
-void sortOrder()
-{
-  if(sortTrigger)
-  {
-    sortTrigger = false;
-    //std::string str(ip);
-    stringstream name_ss;
-    for(int i = 0; i < swarmieNames.size(); i++)
+    stringstream rcvd;
+    if (state.type == SwarmReport::RESOURCE)
+    {
+      rcvd << "rcv'd " << state.value << " cubes from " << state.sender << " at: (" << state.location.x << ", " << state.location.y << ")";
+    }
+    else if (state.type == SwarmReport::OBSTACLE)
+    {
+      rcvd << "rcv'd obstacle from " << state.sender << " at: (" << state.location.x << ", " << state.location.y << ") radius " << state.value << " cm";
+    }
+    else
     {
-      if(i != 0){name_ss << ",";}
-      name_ss << swarmieNames.at(i);
+      continue;
     }
-    string allNames = name_ss.str();
-    msg.data = allNames;
-    //msg.data = ip;
-    //infoLogPublisher.publish(msg);
-    sortOrderPub.publish(msg);
-    //msg.data = "sortTrigger is running ";
-    //infoLogPublisher.publish(msg);
+    msg.data = rcvd.str();
+    infoLogPublisher.publish(msg);
   }
 }
 
-void sortOrderHandler(const std_msgs::String& msg)
-{
-
-//TODO: is this the handler that receives the initial start message?
-   //if so, what the hell is our initial start message?
-
-   //Hijacking this event handler for my own nefarious purposes
-   //in theory, we only get one message from each swarmie on boot up
-   //and in this case, that should just be our all the hostnames we have received thus far
-   //so for this event handler, we just want to compare the received list of hostnames & see if it is
-   //larger than our list. if it is, copy the received list and discard ours.
-   //after that, we'll sort the list so we have an ordered list of swarmies
-
-  //splitting our message stream:
-  string allNames = msg.data;
-  vector<string> results;
-
-  stringstream ss(allNames);
-  string item;
-  char delim = ',';
-  while (getline(ss, item, delim)) {
-      results.push_back(item);
-  }
-
-  /*
-  string buf; // Have a buffer string
-  stringstream ss(allNames); // Insert the string into a stream
-  
-  while (ss >> buf)
+// Queues this tick's reports and publishes a packet when the bus has one
+// due. Locations are sent relative to the nest since every rover has its
+// own map frame origin.
+void publishSwarmReports() {
+  if (initilized)
   {
-    results.push_back(buf);
-  }
-  */    
-
-   //std_msgs::String msgList;
-   //stringstream ffs;
-   //ffs << publishedName <<"'s list has " << swarmieNames.size() << " elements, rcv'd list has " << results.size();
-
-   if(results.size() >= swarmieNames.size()){
-     swarmieNames = results;
-   }
-   //msgList.data = ffs.str();
-   //infoLogPublisher.publish(msgList);
-
-   //AJH this might be breaking the whole damn thing eta: egads, I was right!!! 
-   //but only because I don't know the difference between i & j
-   //this will sort our list every time we add a name, so for now it's okay,
-   //but it will not work in the case that a swarmie enters the arena part-way
-   //thru the competition
-   for(int i = 0; i < swarmieNames.size(); i++){
-      //this loops through the entire list i times, which I think is
-      //sufficient to sort the whole thing?
-      //should be i^2 comparisons,
-      //but maybe double check the math at some point? questions? ...bueller?
-      for(int j = 0; j < swarmieNames.size()-1; j++){
-      //if swarmieNames[j] is 'bigger' than swarmieNames[j+1], switch
-        if(swarmieNames.at(j) > swarmieNames.at(j+1)){
-          string temp = swarmieNames.at(j);
-          swarmieNames.at(j) = swarmieNames.at(j+1);
-          swarmieNames.at(j+1) = temp;
-       }
-     }
-   }
-
-}
-
-//store up to 30 fence locations
-RangeController myFences[30]; 
-
-void myMessageHandler(const swarmie_msgs::Waypoint& my_msg){
-  stringstream rcvd;
+    Point center = logicController.GetNestLocation();
 
-  msg.data = rcvd.str();
-  infoLogPublisher.publish(msg);
-  //AJH: do stuff
-  int msg_type = my_msg.action; //static_cast<int>(my_msg.data[0]); // Shape type  
-    
-  if (msg_type == swarmie_msgs::Waypoint::ACTION_REACHED)
-  {
-    logicController.setVirtualFenceOff();
-  }
-  else
-  {
-    // Elements 2 and 3 are the x and y coordinates of the range center
-    Point center;
-    //center.x = my_msg.data[1]; // Range center x
-    //center.y = my_msg.data[2]; // Range center y
+    Point pose;
+    pose.x = currentLocationMap.x - center.x;
+    pose.y = currentLocationMap.y - center.y;
+    pose.theta = currentLocationMap.theta;
+    swarmBus->ReportPose(pose, linearVelocity);
 
-    // If the shape type is "circle" then element 4 is the radius, if rectangle then width
-    switch ( my_msg.action )
+    vector<AllocationBid> bids;
+    if (logicController.UpdateAllocation(getRunTime(getROSTimeInMilliSecs()), bids))
     {
-      case swarmie_msgs::Waypoint::ACTION_ADD: //resource message
+      for (const AllocationBid& bid : bids)
       {
-        float radius = 1.5;
-        //TODO: AJH for now, just see if we can effectively pull usable info out of these messages
-        rcvd << "rcv'd resource msg points: (" << my_msg.x << ", " << my_msg.y << ")";
-        msg.data = rcvd.str();
-        infoLogPublisher.publish(msg);
-        //logicController.setVirtualFenceOn( new RangeCircle(center, radius) );
-        //logicController.setInterconnectedCOntroller thing here
-        break;
+        swarmBus->ReportBid(bid.location, bid.bid);
       }
-      case swarmie_msgs::Waypoint::ACTION_REMOVE: //obstacle message
+    }
+
+    vector<NestReservation> reservations;
+    if (logicController.TakeNestReservations(reservations))
+    {
+      for (const NestReservation& reservation : reservations)
       {
-        //build inside-out fence around obstacle
-        //logicController.setVirtualFenceOn( new RangeCircle(center, radius) );
-        //logicController.setInterconnectedCOntroller thing here
-        //KAILY:
-        //check our obstacle gridpoints:
-        rcvd << "rcv'd obstacle msg points: (" << my_msg.x << ", " << my_msg.y << ")";
-        msg.data = rcvd.str();
-        infoLogPublisher.publish(msg);
-        /*float gridPoints[2][3] = {{1.000, 1.250, 1.500}, {1.000, 1.250, 1.500}};
-        int size = *(&gridPoints + 1) - gridPoints;
-        for(int i=0; i < size; i++) {
-          int nSize = *(&gridPoints[i] + 1) - gridPoints[i];
-          for(int j=0; j < nSize; j++) {
-            //do stuff with Range...
-          }
-        }
-         */
-        //point obstacleLocation = currentLocation + 0.8; // or however you send 0.8 directly in front of your currentLocation
-        Point obstacleLoc;
-        obstacleLoc.x = center.x;
-        obstacleLoc.y = center.y;
-        //logicController.setVirtualFenceOn( new RangeCircle(obstacleLoc, 0.5));
-        //RangeController::RangeCircle(obstacleLoc, 0.5);
-        break;
-      }
-      default:
-      { // Unknown msg type specified
-        throw ROSAdapterRangeShapeInvalidTypeException("Unknown Shape type in ROSAdapter.cpp:virtualFenceHandler()");
-        //throw new Exception("Unknown message type in ROSAdapter.cpp:myMessageHandler()");
+        swarmBus->ReportReservation(reservation.entry, reservation.start);
       }
+    }
   }
 
+  SwarmPacket packet;
+  if (!swarmBus->Flush(getROSTimeInMilliSecs(), packet))
+  {
+    return;
   }
-}
-
-void CNMProjectCenter()
-{
-    //NOTES ON THIS FUNCTION:
-    //- Takes current point and projects it out to where the center SHOULD be
-    //- Calls CNMAVGCenter to avg new center location searchController new avg center
 
-    if(resetMap)
-    {
-	    resetMap = false;
-	    maxedCenterArray = false;
-	    centerIndex = 0;
-    }
-
-    //NORMALIZE ANGLEf
-    double normCurrentAngle = angles::normalize_angle_positive(currentLocationMap.theta);
-
-    //CenterXCoordinates[centerIndex] = currentLocation.x + (CENTEROFFSET * (cos(normCurrentAngle)));
-    CenterXCoordinates[centerIndex] = currentLocationMap.x;
-    //CenterYCoordinates[centerIndex] = currentLocation.y + (CENTEROFFSET * (sin(normCurrentAngle)));
-    CenterYCoordinates[centerIndex] = currentLocationMap.y;
-
-    CNMAVGCenter();
-}
-
-
-void CNMAVGCenter()
-{
+  if (swarmTransport != nullptr)
+  {
+    int length = SwarmCodec::Encode(packet, swarmTransport->GetSendBuffer(), SwarmTransport::maxPayloadBytes);
+    swarmTransport->Send(SWARM_CHANNEL_PACKET, length);
+    return;
+  }
 
-  if(resetMap)
+  swarmie_msgs::SwarmPacket message;
+  message.sender = packet.sender;
+  message.seq = packet.seq;
+  message.incarnation = packet.incarnation;
+  for (const SwarmReport& report : packet.reports)
   {
-    resetMap = false;
-    maxedCenterArray = false;
-    centerIndex = 0;
+    swarmie_msgs::SwarmReport sent;
+    sent.type = report.type;
+    sent.x = report.x;
+    sent.y = report.y;
+    sent.heading = report.heading;
+    sent.value = report.value;
+    message.reports.push_back(sent);
   }
+  swarmPublisher.publish(message);
+}
 
+void membershipHandler(const swarmie_msgs::SwarmHeartbeat& message) {
+  SwarmHeartbeat heartbeat;
+  heartbeat.name = message.name;
+  heartbeat.joined = message.joined;
+  heartbeat.epoch = message.epoch;
+  heartbeat.roles = message.roles;
+  swarmMembership->Receive(heartbeat, getROSTimeInMilliSecs());
+}
 
-    std_msgs::String msg;
-    msg.data = "Averaging Center Location";
-    infoLogPublisher.publish(msg);
+// Sends a heartbeat when one is due, takes on a new role as soon as the
+// leader's assignment gives this rover a different slot and splits the
+// search area again whenever the assignment changes.
+void publishMembershipHeartbeat() {
+  static int role = -1;
+  static uint32_t epoch = 0;
+  long int time = getROSTimeInMilliSecs();
 
-    if(centerIndex >= ASIZE)
+  SwarmHeartbeat heartbeat;
+  if (swarmMembership->Update(time, heartbeat))
+  {
+    if (swarmTransport != nullptr)
     {
-        if(!maxedCenterArray) {  maxedCenterArray = true; }
-        centerIndex = 0;
+      int length = SwarmCodec::Encode(heartbeat, swarmTransport->GetSendBuffer(), SwarmTransport::maxPayloadBytes);
+      swarmTransport->Send(SWARM_CHANNEL_HEARTBEAT, length);
     }
     else
     {
-        centerIndex++;
-    }
-
-    float avgX = 0;
-    float avgY = 0;
-
-    for(int i = 0; i < ASIZE; i++)
-    {
-       avgX += CenterXCoordinates[i];
-       avgY += CenterYCoordinates[i];
+      swarmie_msgs::SwarmHeartbeat message;
+      message.name = heartbeat.name;
+      message.joined = heartbeat.joined;
+      message.epoch = heartbeat.epoch;
+      message.roles = heartbeat.roles;
+      membershipPublisher.publish(message);
     }
+  }
 
-        avgX = (avgX / ASIZE);
-        avgY = (avgY / ASIZE);
-
-    //UPDATE CENTER LOCATION
-    //---------------------------------------------
-    cnmCenterLocation.x = (avgX);
-    cnmCenterLocation.y = (avgY);
-    logicController.cnmSetCenterLocationMAP(cnmCenterLocation);
+  if (swarmMembership->GetRole() != role && swarmMembership->GetRole() >= 0)
+  {
+    role = swarmMembership->GetRole();
 
     stringstream ss;
-    ss << "Center Position X: " <<   cnmCenterLocation.x << " Y: " << cnmCenterLocation.y << "  Index: " << centerIndex << endl;
+    ss << "Role " << role << " of " << swarmMembership->GetSwarmSize() << " from leader " << swarmMembership->GetLeader()
+       << ", " << (time - swarmMembership->GetLastChangeTime()) << " ms after the membership changed";
     msg.data = ss.str();
     infoLogPublisher.publish(msg);
 
-    //AJH now that we have our initial start stuff done,
-    //we are ready to start moving
-    //isReady = true;
-
-}
-
-void CNMCurrentLocationAVG()
-{
-
-  static int index = 0;
-
-  std_msgs::String msg;
-  msg.data = "Averaging Current Location";
-  infoLogPublisher.publish(msg);
-
+    assignSwarmieRoles(role);
+  }
 
+  if (swarmMembership->GetEpoch() != epoch && swarmMembership->GetRole() >= 0)
+  {
+    epoch = swarmMembership->GetEpoch();
 
-    if(index < CASIZE)
+    vector<uint32_t> members;
+    for (const string& name : swarmMembership->GetAssignment())
     {
-
-	     avgCurrentCoordsX[index] = currentLocationMap.x;
-    	 avgCurrentCoordsY[index] = currentLocationMap.y;
-
-	     index++;
-
-	     //return false;
+      members.push_back(SwarmBus::NameHash(name));
     }
+    logicController.SetSwarmMembers(members);
 
-    else
+    float start, width;
+    if (logicController.GetSearchRegion(start, width))
     {
-	      float x = 0, y = 0;
-	      for(int i = 0; i < CASIZE; i++)
-	      {
-	        x += avgCurrentCoordsX[i];
-	        y += avgCurrentCoordsY[i];
-	      }
-
-	    x = x/CASIZE;
-	    y = y/CASIZE;
-
-      Point cnmAVGCurrentLocation;
-	    cnmAVGCurrentLocation.x = x;
-	    cnmAVGCurrentLocation.y = y;
-      cnmAVGCurrentLocation.theta = currentLocation.theta;
-
-      logicController.cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
+      stringstream ss;
+      ss << "Search wedge from " << angles::to_degrees(start) << " degrees, " << angles::to_degrees(width) << " degrees wide";
+      msg.data = ss.str();
+      infoLogPublisher.publish(msg);
+    }
+  }
+}
 
+// Merges the registry cells of another rover, the merge is idempotent so
+// repeated and reordered deltas are harmless.
+void resourceDeltaHandler(const swarmie_msgs::ResourceDelta& message) {
+  if (message.sender == SwarmBus::NameHash(publishedName))
+  {
+    return;
+  }
 
-      stringstream ff;
-      ff << "Current Postion Average is X: "<< cnmAVGCurrentLocation.x << "  Y: " << cnmAVGCurrentLocation.y << "  Theta: " << currentLocation.theta << endl;
-           Msg.data = ff.str();
-           infoLogPublisher.publish(Msg);
+  vector<ResourceEntry> delta;
+  for (const swarmie_msgs::ResourceEntry& received : message.entries)
+  {
+    ResourceEntry entry;
+    entry.cellX = received.cell_x;
+    entry.cellY = received.cell_y;
+    entry.remaining = received.remaining;
+    entry.countClock = received.count_clock;
+    entry.countNode = received.count_node;
+    entry.owner = received.owner;
+    entry.claimClock = received.claim_clock;
+    entry.claimNode = received.claim_node;
+    delta.push_back(entry);
+  }
+  logicController.MergeResourceDelta(delta);
+}
 
+void publishResourceDelta() {
+  vector<ResourceEntry> delta;
+  if (!logicController.TakeResourceDelta(delta))
+  {
+    return;
+  }
 
-	    index = 0;
-	    //return true;
+  if (swarmTransport != nullptr)
+  {
+    //as many datagrams as the delta needs
+    for (int first = 0; first < delta.size(); )
+    {
+      int count;
+      int length = SwarmCodec::Encode(delta, first, count, swarmTransport->GetSendBuffer(), SwarmTransport::maxPayloadBytes);
+      swarmTransport->Send(SWARM_CHANNEL_RESOURCES, length);
+      first += count;
     }
+    return;
+  }
 
+  swarmie_msgs::ResourceDelta message;
+  message.sender = SwarmBus::NameHash(publishedName);
+  for (const ResourceEntry& entry : delta)
+  {
+    swarmie_msgs::ResourceEntry sent;
+    sent.cell_x = entry.cellX;
+    sent.cell_y = entry.cellY;
+    sent.remaining = entry.remaining;
+    sent.count_clock = entry.countClock;
+    sent.count_node = entry.countNode;
+    sent.owner = entry.owner;
+    sent.claim_clock = entry.claimClock;
+    sent.claim_node = entry.claimNode;
+    message.entries.push_back(sent);
+  }
+  resourcePublisher.publish(message);
 }
 
-void assignSwarmieRoles(int currentTime){
-
-    //vector<string> swarmieNames = names;
-    int numSwarmies = swarmieNames.size();
-    //comms = array<ros::Publisher,numSwarmies>;
-    //build one publisher per swarmie
-    for(int i = 0; i < numSwarmies; i++){
-      string& name = swarmieNames.at(i);
-      //cnm_NH points to mNH, so we dereference it here to build our comms publishers
-      namedSwarmiePub = cnm_NH->advertise<swarmie_msgs::Waypoint>(("dear" + name), 100, true);
-      //std_msgs::String test;
-      //test.data = ("test from " + publishedName + " in assign roles");
-      //namedSwarmiePub.publish(test);
-      comms.push_back(namedSwarmiePub);
-      msg.data = ("I created a publisher for " + name);
-      if(name == publishedName)
+// Passes what the other rovers sent over the swarm transport to the same
+// places the topic handlers do.
+void pollSwarmTransport(const ros::TimerEvent&) {
+  swarmTransport->Poll(getROSTimeInMilliSecs(), [](const SwarmDatagram& datagram) {
+    if (datagram.channel == SWARM_CHANNEL_PACKET)
+    {
+      SwarmPacket packet;
+      if (SwarmCodec::Decode(datagram.data, datagram.length, packet))
       {
-        myID = i;
-        stringstream temp;
-        temp << "That's me! I created a publisher to myself. My ID is " << myID << "!";
-        msg.data = temp.str();
+        receiveSwarmPacket(packet);
+      }
+    }
+    else if (datagram.channel == SWARM_CHANNEL_HEARTBEAT)
+    {
+      SwarmHeartbeat heartbeat;
+      if (SwarmCodec::Decode(datagram.data, datagram.length, heartbeat))
+      {
+        swarmMembership->Receive(heartbeat, getROSTimeInMilliSecs());
+      }
+    }
+    else if (datagram.channel == SWARM_CHANNEL_RESOURCES)
+    {
+      vector<ResourceEntry> delta;
+      if (SwarmCodec::Decode(datagram.data, datagram.length, delta))
+      {
+        logicController.MergeResourceDelta(delta);
       }
-      infoLogPublisher.publish(msg);
     }
+  });
+}
+
+void logCenterLocation()
+{
+    std_msgs::String msg;
+    stringstream ss;
+    Point center = logicController.GetCenterLocation();
+    ss << "Center Position X: " << center.x << " Y: " << center.y
+       << "  Uncertainty: " << logicController.GetCenterUncertainty() << " m" << endl;
+    msg.data = ss.str();
+    infoLogPublisher.publish(msg);
+
+    //AJH now that we have our initial start stuff done,
+    //we are ready to start moving
+    //isReady = true;
+}
+
+void assignSwarmieRoles(int role){
 
-    //method variables
-    //int numSwarmies = comms.size(); // set once @ 1min; unchanged after
-    myStartTime = currentTime;
+    //the slot the membership leader gave this rover, it changes when rovers join or leave
+    int numSwarmies = swarmMembership->GetSwarmSize();
+    myID = role;
+    myStartTime = getROSTimeInMilliSecs() / 1000;
+    swarmBus->ReportRole(myID);
 
     //fire initial behavior starts now
     //assign my role based on myID and swarmie team size:
@@ -1436,51 +1550,3 @@ void assignSwarmieRoles(int currentTime){
     }
     return;
 }
-
-void updateBehavior(int currentTime){
-    //update behavior roles for searchers and hybrids,
-    //update gatherer behavior as necessary (if timer > 15 minutes-startTime)
-    //AJH TODO: timer needs to be in seconds, because that is what we are passing it
-    msg.data = ("Updating role - the current time is: " + currentTime);
-    infoLogPublisher.publish(msg);
-    switch(myRole){
-      //if gather, set initial fence area around home & begin searching/waiting for input there
-      //gatherers should be on call for the searchers (if they find a resource, etc.)
-      case Role::gather1: 
-        break;
-      //searchers should get their initial grid areas, which are calculated based on team size and 
-      //divided based on location
-      //see map on slack 
-      case Role::searcher1:
-      case Role::searcher2:
-      case Role::searcher3:
-        break;
-      //hybrids will search areas and be on call for other swarmies' resource calls.
-      //they search a smaller subset of areas than regular searchers receive
-      case Role::hybrid1:
-      case Role::hybrid2:
-        break;
-      default:
-        //swarmie > 6 defaults to search?
-        break;
-    }
-
-    return;
-}
-
-void testStuff(){
-  //std_msgs::Float32MultiArray temp_msg;
-  int type = 1;
-  float x = 73.000;
-  float y = 91.00;
-  my_msg.action = type;
-  my_msg.x = x;
-  my_msg.y = y;
-  for(int i = 0; i < comms.size(); i++){
-    //ros::Publisher& pub = comms.at(i);
-    //pub.publish(my_msg); 
-    comms.at(i).publish(my_msg);
-    //msg.data = "testing publishers...";
-    //infoLogPublisher.publish(msg);
-  }
-}
@@ -61,6 +61,7 @@ class RangeCircle : public RangeShape {
   RangeCircle( Point center, float radius ); 
   
   bool isInside( Point coords ) override;
+  float getRadius() const { return radius; }
 
  private: 
   float radius = 0.0;
@@ -76,6 +77,8 @@ class RangeRectangle : public RangeShape {
   RangeRectangle( Point center, float width, float height ); 
   
   bool isInside( Point coords ) override;
+  float getWidth() const { return width; }
+  float getHeight() const { return height; }
 
  protected: 
   float width = 0.0;
@@ -145,7 +148,7 @@ class RangeController : virtual Controller {
   Point current_location;
   
   // Whether the range restriction is enabled or not
-  bool enabled;
+  bool enabled = false;
 
   // Remember whether we are already returning to the allowed forage range
   bool requested_return_to_valid_range = false;
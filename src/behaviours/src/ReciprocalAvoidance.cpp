@@ -0,0 +1,288 @@
+#include "ReciprocalAvoidance.h"
+
+#include <cmath> // For cos, hypot, sin and sqrt
+
+ReciprocalAvoidance::ReciprocalAvoidance() : grid(neighbourDistance)
+{
+}
+
+void ReciprocalAvoidance::SetNeighbour(uint32_t id, Point pose, float speed)
+{
+  Neighbour& neighbour = neighbours[id];
+  neighbour.pose = pose;
+  neighbour.speed = speed;
+  neighbour.heard = current_time;
+  grid.Update(id, pose);
+}
+
+void ReciprocalAvoidance::RemoveNeighbour(uint32_t id)
+{
+  neighbours.erase(id);
+  grid.Remove(id);
+}
+
+bool ReciprocalAvoidance::Avoid(Point pose, float speed, float maxSpeed, float& vx, float& vy)
+{
+  activeCount = 0;
+  nearby.clear();
+  lines.clear();
+  grid.Query(pose, nearby);
+
+  Vector position = {pose.x, pose.y};
+  Vector velocity = {speed * (float)cos(pose.theta), speed * (float)sin(pose.theta)};
+
+  for (uint32_t id : nearby)
+  {
+    Neighbour& neighbour = neighbours[id];
+    long int age = current_time - neighbour.heard;
+    if (age > staleTime)
+    {
+      RemoveNeighbour(id);
+      continue;
+    }
+
+    //where the neighbour should be by now
+    float seconds = age / 1e3;
+    Vector otherVelocity = {neighbour.speed * (float)cos(neighbour.pose.theta), neighbour.speed * (float)sin(neighbour.pose.theta)};
+    Vector otherPosition = {neighbour.pose.x + otherVelocity.x * seconds, neighbour.pose.y + otherVelocity.y * seconds};
+
+    if (hypot(otherPosition.x - position.x, otherPosition.y - position.y) > neighbourDistance)
+    {
+      continue;
+    }
+
+    lines.push_back(Constraint(position, velocity, otherPosition, otherVelocity));
+  }
+
+  activeCount = lines.size();
+  if (lines.empty())
+  {
+    return false;
+  }
+
+  Vector preferred = {vx, vy};
+  Vector result;
+  int failed = LinearProgram2(lines, maxSpeed, preferred, false, result);
+  if (failed < (int)lines.size())
+  {
+    //no velocity satisfies every neighbour, break them as little as possible
+    LinearProgram3(lines, failed, maxSpeed, result);
+  }
+
+  vx = result.x;
+  vy = result.y;
+  return true;
+}
+
+ReciprocalAvoidance::Line ReciprocalAvoidance::Constraint(Vector position, Vector velocity, Vector otherPosition, Vector otherVelocity) const
+{
+  Vector relativePosition = {otherPosition.x - position.x, otherPosition.y - position.y};
+  Vector relativeVelocity = {velocity.x - otherVelocity.x, velocity.y - otherVelocity.y};
+  float distanceSq = Dot(relativePosition, relativePosition);
+  float combinedRadius = 2 * radius;
+  float combinedRadiusSq = combinedRadius * combinedRadius;
+
+  Line line;
+  Vector u;
+
+  if (distanceSq > combinedRadiusSq)
+  {
+    //vector from the cutoff center of the velocity obstacle to the relative velocity
+    Vector w = {relativeVelocity.x - relativePosition.x / timeHorizon, relativeVelocity.y - relativePosition.y / timeHorizon};
+    float wLengthSq = Dot(w, w);
+    float dotProduct = Dot(w, relativePosition);
+
+    if (dotProduct < 0 && dotProduct * dotProduct > combinedRadiusSq * wLengthSq)
+    {
+      //closest to the cutoff circle
+      float wLength = sqrt(wLengthSq);
+      Vector unitW = {w.x / wLength, w.y / wLength};
+      line.direction = {unitW.y, -unitW.x};
+      u = {(combinedRadius / timeHorizon - wLength) * unitW.x, (combinedRadius / timeHorizon - wLength) * unitW.y};
+    }
+    else
+    {
+      //closest to one of the legs of the cone
+      float leg = sqrt(distanceSq - combinedRadiusSq);
+      if (Det(relativePosition, w) > 0)
+      {
+        line.direction = {(relativePosition.x * leg - relativePosition.y * combinedRadius) / distanceSq,
+                          (relativePosition.x * combinedRadius + relativePosition.y * leg) / distanceSq};
+      }
+      else
+      {
+        line.direction = {-(relativePosition.x * leg + relativePosition.y * combinedRadius) / distanceSq,
+                          -(-relativePosition.x * combinedRadius + relativePosition.y * leg) / distanceSq};
+      }
+
+      float along = Dot(relativeVelocity, line.direction);
+      u = {along * line.direction.x - relativeVelocity.x, along * line.direction.y - relativeVelocity.y};
+    }
+  }
+  else
+  {
+    //already overlapping, get apart within one tick
+    Vector w = {relativeVelocity.x - relativePosition.x / timeStep, relativeVelocity.y - relativePosition.y / timeStep};
+    float wLength = hypot(w.x, w.y);
+    Vector unitW = {w.x / wLength, w.y / wLength};
+    line.direction = {unitW.y, -unitW.x};
+    u = {(combinedRadius / timeStep - wLength) * unitW.x, (combinedRadius / timeStep - wLength) * unitW.y};
+  }
+
+  //this rover takes half of the change
+  line.point = {velocity.x + 0.5f * u.x, velocity.y + 0.5f * u.y};
+  return line;
+}
+
+bool ReciprocalAvoidance::LinearProgram1(const vector<Line>& lines, int line, float radius, Vector preferred, bool directionOpt, Vector& result)
+{
+  //part of the line inside the speed circle
+  float dotProduct = Dot(lines[line].point, lines[line].direction);
+  float discriminant = dotProduct * dotProduct + radius * radius - Dot(lines[line].point, lines[line].point);
+  if (discriminant < 0)
+  {
+    return false;
+  }
+
+  float sqrtDiscriminant = sqrt(discriminant);
+  float tLeft = -dotProduct - sqrtDiscriminant;
+  float tRight = -dotProduct + sqrtDiscriminant;
+
+  //cut down to the part allowed by the lines before it
+  for (int i = 0; i < line; i++)
+  {
+    Vector offset = {lines[line].point.x - lines[i].point.x, lines[line].point.y - lines[i].point.y};
+    float denominator = Det(lines[line].direction, lines[i].direction);
+    float numerator = Det(lines[i].direction, offset);
+
+    if (fabs(denominator) <= epsilon)
+    {
+      //parallel, either all or nothing of the line is allowed
+      if (numerator < 0)
+      {
+        return false;
+      }
+      continue;
+    }
+
+    float t = numerator / denominator;
+    if (denominator >= 0)
+    {
+      tRight = fmin(tRight, t);
+    }
+    else
+    {
+      tLeft = fmax(tLeft, t);
+    }
+
+    if (tLeft > tRight)
+    {
+      return false;
+    }
+  }
+
+  float t;
+  if (directionOpt)
+  {
+    t = Dot(preferred, lines[line].direction) > 0 ? tRight : tLeft;
+  }
+  else
+  {
+    Vector offset = {preferred.x - lines[line].point.x, preferred.y - lines[line].point.y};
+    t = fmax(tLeft, fmin(tRight, Dot(lines[line].direction, offset)));
+  }
+
+  result = {lines[line].point.x + t * lines[line].direction.x, lines[line].point.y + t * lines[line].direction.y};
+  return true;
+}
+
+int ReciprocalAvoidance::LinearProgram2(const vector<Line>& lines, float radius, Vector preferred, bool directionOpt, Vector& result)
+{
+  float preferredLength = hypot(preferred.x, preferred.y);
+  if (directionOpt)
+  {
+    //preferred is a unit direction, go as far along it as possible
+    result = {preferred.x * radius, preferred.y * radius};
+  }
+  else if (preferredLength > radius)
+  {
+    result = {preferred.x * radius / preferredLength, preferred.y * radius / preferredLength};
+  }
+  else
+  {
+    result = preferred;
+  }
+
+  for (int i = 0; i < (int)lines.size(); i++)
+  {
+    Vector offset = {lines[i].point.x - result.x, lines[i].point.y - result.y};
+    if (Det(lines[i].direction, offset) > 0)
+    {
+      //the result breaks this constraint, move it onto the line
+      Vector previous = result;
+      if (!LinearProgram1(lines, i, radius, preferred, directionOpt, result))
+      {
+        result = previous;
+        return i;
+      }
+    }
+  }
+
+  return lines.size();
+}
+
+void ReciprocalAvoidance::LinearProgram3(const vector<Line>& lines, int beginLine, float radius, Vector& result)
+{
+  float distance = 0;
+
+  for (int i = beginLine; i < (int)lines.size(); i++)
+  {
+    Vector offset = {lines[i].point.x - result.x, lines[i].point.y - result.y};
+    if (Det(lines[i].direction, offset) <= distance)
+    {
+      continue;
+    }
+
+    //the result breaks this constraint by more than the worst one so far,
+    //minimize the worst violation over the lines before it
+    vector<Line> projected;
+    for (int j = 0; j < i; j++)
+    {
+      Line line;
+      float determinant = Det(lines[i].direction, lines[j].direction);
+
+      if (fabs(determinant) <= epsilon)
+      {
+        if (Dot(lines[i].direction, lines[j].direction) > 0)
+        {
+          //same direction
+          continue;
+        }
+        //opposite direction
+        line.point = {0.5f * (lines[i].point.x + lines[j].point.x), 0.5f * (lines[i].point.y + lines[j].point.y)};
+      }
+      else
+      {
+        Vector between = {lines[i].point.x - lines[j].point.x, lines[i].point.y - lines[j].point.y};
+        float t = Det(lines[j].direction, between) / determinant;
+        line.point = {lines[i].point.x + t * lines[i].direction.x, lines[i].point.y + t * lines[i].direction.y};
+      }
+
+      Vector direction = {lines[j].direction.x - lines[i].direction.x, lines[j].direction.y - lines[i].direction.y};
+      float length = hypot(direction.x, direction.y);
+      line.direction = {direction.x / length, direction.y / length};
+      projected.push_back(line);
+    }
+
+    Vector previous = result;
+    Vector normal = {-lines[i].direction.y, lines[i].direction.x};
+    if (LinearProgram2(projected, radius, normal, true, result) < (int)projected.size())
+    {
+      //only rounding errors get here, keep what there was
+      result = previous;
+    }
+
+    offset = {lines[i].point.x - result.x, lines[i].point.y - result.y};
+    distance = Det(lines[i].direction, offset);
+  }
+}
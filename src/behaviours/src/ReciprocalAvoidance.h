@@ -0,0 +1,104 @@
+#ifndef RECIPROCALAVOIDANCE_H
+#define RECIPROCALAVOIDANCE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Point.h"
+#include "SpatialHash.h"
+
+using namespace std;
+
+// Keeps the rovers from driving into each other using optimal reciprocal
+// collision avoidance (ORCA).
+//
+// Every rover beacons its pose and forward speed over the swarm bus. For
+// each neighbour close enough to reach within the time horizon the
+// velocities that would bring the two rovers within a rover width of each
+// other form a cone, and this rover takes half of the change needed to get
+// out of it, trusting the neighbour to take the other half. Each neighbour
+// rules out a half-plane of velocities, and a small linear program picks
+// the velocity closest to the one the drive controller wants that is in
+// all of them and under the top speed. If the rovers are already too close
+// for that the velocity that breaks the fewest constraints is used instead.
+//
+// Neighbours are extrapolated from their last beacon and forgotten when
+// they stop beaconing. They are kept in a spatial hash with cells as wide
+// as the neighbour distance, so finding the neighbours of the rover only
+// looks at the rovers nearby however many there are in the arena.
+//
+// Points and velocities are in the map frame, times in milliseconds.
+class ReciprocalAvoidance
+{
+public:
+  ReciprocalAvoidance();
+
+  void SetCurrentTime(long int time) {current_time = time;}
+
+  // Pose and signed forward speed another rover beaconed.
+  void SetNeighbour(uint32_t id, Point pose, float speed);
+  void RemoveNeighbour(uint32_t id);
+
+  // Replaces the preferred velocity (vx, vy) of the rover at the given pose
+  // and forward speed with the closest one that keeps clear of the
+  // neighbours and is under maxSpeed. Returns false and leaves the velocity
+  // alone if there is no neighbour to give way to.
+  bool Avoid(Point pose, float speed, float maxSpeed, float& vx, float& vy);
+
+  int GetNeighbourCount() const {return neighbours.size();}
+
+  // Neighbours the last call to Avoid() had to give way to.
+  int GetActiveCount() const {return activeCount;}
+
+  const float radius = 0.3; //meters, half the rover length plus margin for turning in place
+  const float timeHorizon = 2.5; //seconds looked ahead for collisions
+  const float neighbourDistance = 2.5; //meters, further than two rovers close in the time horizon
+  const long int staleTime = 1000; //milliseconds without a beacon before a neighbour is dropped
+
+private:
+
+  struct Vector {
+    float x;
+    float y;
+  };
+
+  // Velocities on the left of the line through point along direction are
+  // allowed.
+  struct Line {
+    Vector point;
+    Vector direction;
+  };
+
+  struct Neighbour {
+    Point pose;
+    float speed;
+    long int heard;
+  };
+
+  static float Det(Vector a, Vector b) {return a.x * b.y - a.y * b.x;}
+  static float Dot(Vector a, Vector b) {return a.x * b.x + a.y * b.y;}
+
+  // The linear programs of van den Berg et al., "Reciprocal n-body
+  // collision avoidance", 2011.
+  static bool LinearProgram1(const vector<Line>& lines, int line, float radius, Vector preferred, bool directionOpt, Vector& result);
+  static int LinearProgram2(const vector<Line>& lines, float radius, Vector preferred, bool directionOpt, Vector& result);
+  static void LinearProgram3(const vector<Line>& lines, int beginLine, float radius, Vector& result);
+
+  // Half-plane of velocities that keeps clear of one neighbour.
+  Line Constraint(Vector position, Vector velocity, Vector otherPosition, Vector otherVelocity) const;
+
+  const float timeStep = 0.1; //seconds between control ticks, used when already overlapping
+  static constexpr float epsilon = 1e-5; //parallel lines
+
+  long int current_time = 0;
+  unordered_map<uint32_t, Neighbour> neighbours;
+  SpatialHash grid;
+  int activeCount = 0;
+
+  //reused every tick
+  vector<uint32_t> nearby;
+  vector<Line> lines;
+};
+
+#endif // RECIPROCALAVOIDANCE_H
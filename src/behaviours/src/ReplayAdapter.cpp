@@ -0,0 +1,198 @@
+// Replays an input log of the behaviours node into a LogicController off
+// the rover, as fast as it goes, and checks that every tick gives the same
+// Result as on the rover.
+//
+// A bug seen on a rover can be stepped through in a debugger, a change to
+// the controllers can be checked against a real run (git bisect run takes
+// the exit status) and the slow ticks of a run can be profiled. The
+// controllers print as they do on the rover, that output is left out
+// unless --verbose is given.
+//
+// usage: behaviours_replay <log> [--until <tick>] [--dump <tick>] [--verbose]
+//
+//   --until  stops after the tick, to break in a debugger right there
+//   --dump   lists the records of the tick instead of replaying
+//
+// Exits with 0 if every result is the same, 1 if one differs and 2 if the
+// log can't be read.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "InputLog.h"
+#include "InputReplay.h"
+#include "LogicController.h"
+
+using namespace std;
+
+// Static storage like the one in ROSAdapter, so members the constructors
+// leave alone start out the same.
+LogicController logicController;
+
+string describe(const RecordedResult& result)
+{
+  char text[128];
+  snprintf(text, sizeof(text), "%s left %.2f right %.2f finger %.2f wrist %.2f", result.waiting ? "waiting," : "driving,",
+           result.left, result.right, result.fingerAngle, result.wristAngle);
+  return text;
+}
+
+int dump(InputLogReader& reader, long int tick)
+{
+  if (!reader.SeekTick(tick) || tick >= reader.GetTickCount())
+  {
+    printf("the log has %ld ticks\n", reader.GetTickCount());
+    return 2;
+  }
+
+  printf("tick %ld at %ld ms\n", tick, (long int)reader.GetTick(tick).time);
+  InputRecord record;
+  while (reader.Next(record))
+  {
+    if (record.type != INPUT_TICK)
+    {
+      printf("  %-20s %u bytes\n", InputLog::GetTypeName(record.type), record.length);
+      continue;
+    }
+
+    int64_t time;
+    RecordedResult result;
+    InputDecoder(record).GetAll(time, result);
+    printf("  %-20s %s\n", InputLog::GetTypeName(record.type), describe(result).c_str());
+    break;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  string path;
+  long int until = -1;
+  long int dumpTick = -1;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--until") == 0 && i + 1 < argc)
+    {
+      until = atol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+    {
+      dumpTick = atol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--verbose") == 0)
+    {
+      verbose = true;
+    }
+    else
+    {
+      path = argv[i];
+    }
+  }
+  if (path.empty())
+  {
+    printf("usage: %s <log> [--until <tick>] [--dump <tick>] [--verbose]\n", argv[0]);
+    return 2;
+  }
+
+  InputLogReader reader;
+  if (!reader.Open(path))
+  {
+    return 2;
+  }
+  if (dumpTick >= 0)
+  {
+    return dump(reader, dumpTick);
+  }
+
+  streambuf* controllerLog = cout.rdbuf();
+  if (!verbose)
+  {
+    cout.rdbuf(nullptr);
+  }
+
+  InputReplay replay(&logicController);
+  vector<float> tickTimes; //microseconds of the inputs and DoWork of each tick
+  tickTimes.reserve(reader.GetTickCount());
+  long int mismatches = 0;
+  long int firstMismatch = -1;
+  RecordedResult mismatchReplayed, mismatchRecorded;
+  bool unreadable = false;
+
+  auto start = chrono::steady_clock::now();
+  auto tickStart = start;
+  InputRecord record;
+  while ((until < 0 || (long int)tickTimes.size() <= until) && reader.Next(record))
+  {
+    RecordedResult replayed, recorded;
+    if (!replay.Apply(record, replayed, recorded))
+    {
+      unreadable = true;
+      break;
+    }
+    if (record.type != INPUT_TICK)
+    {
+      continue;
+    }
+
+    auto now = chrono::steady_clock::now();
+    tickTimes.push_back(chrono::duration<float, micro>(now - tickStart).count());
+    tickStart = now;
+
+    if (replayed != recorded)
+    {
+      if (firstMismatch < 0)
+      {
+        firstMismatch = tickTimes.size() - 1;
+        mismatchReplayed = replayed;
+        mismatchRecorded = recorded;
+      }
+      mismatches++;
+    }
+  }
+  double replayTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout.rdbuf(controllerLog);
+
+  long int ticks = tickTimes.size();
+  if (unreadable)
+  {
+    printf("a %s record after tick %ld can't be read, stopped there\n", InputLog::GetTypeName(record.type), ticks - 1);
+  }
+  if (ticks == 0)
+  {
+    printf("%s: no ticks\n", path.c_str());
+    return unreadable ? 2 : 0;
+  }
+
+  double runTime = (reader.GetTick(ticks - 1).time - reader.GetTick(0).time) / 1e3;
+  printf("%s: %ld of %ld ticks, %.1f s of the run replayed in %.3f s, %.0f times as fast\n", path.c_str(), ticks,
+         reader.GetTickCount(), runTime, replayTime, runTime / replayTime);
+
+  long int slowest = max_element(tickTimes.begin(), tickTimes.end()) - tickTimes.begin();
+  double total = 0;
+  for (float time : tickTimes)
+  {
+    total += time;
+  }
+  vector<float> sorted = tickTimes;
+  sort(sorted.begin(), sorted.end());
+  printf("tick time: mean %.1f us, median %.1f us, 99th percentile %.1f us, slowest %.1f us at tick %ld (%ld ms)\n",
+         total / ticks, sorted[ticks / 2], sorted[ticks * 99 / 100], tickTimes[slowest], slowest,
+         (long int)reader.GetTick(slowest).time);
+
+  if (mismatches == 0)
+  {
+    printf("every result is the same as on the rover\n");
+    return unreadable ? 2 : 0;
+  }
+  printf("%ld ticks differ, the first is tick %ld (%ld ms)\n  rover:  %s\n  replay: %s\n", mismatches, firstMismatch,
+         (long int)reader.GetTick(firstMismatch).time, describe(mismatchRecorded).c_str(),
+         describe(mismatchReplayed).c_str());
+  return 1;
+}
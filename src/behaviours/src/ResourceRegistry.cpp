@@ -0,0 +1,401 @@
+#include "ResourceRegistry.h"
+
+#include <algorithm> // For max and min
+#include <cmath> // For floor and hypot
+
+constexpr float ResourceRegistry::cellSize;
+
+ResourceRegistry::ResourceRegistry()
+{
+}
+
+void ResourceRegistry::SetOrigin(Point origin)
+{
+  //the cells stay, they are relative to the nest whatever its map location
+  this->origin = origin;
+  hasOrigin = true;
+}
+
+void ResourceRegistry::ObserveCubes(const vector<Point>& cubes)
+{
+  unordered_map<uint32_t, int> seen;
+  for (const Point& cube : cubes)
+  {
+    uint32_t key;
+    if (ToKey(cube, key))
+    {
+      seen[key]++;
+    }
+  }
+
+  for (const auto& count : seen)
+  {
+    if (count.second > GetCell(count.first).entry.remaining)
+    {
+      SetRemaining(count.first, count.second);
+    }
+  }
+}
+
+void ResourceRegistry::RemoveCube(Point point)
+{
+  uint32_t key;
+  if (ToKey(point, key) && cells.count(key) > 0 && cells[key].entry.remaining > 0)
+  {
+    SetRemaining(key, cells[key].entry.remaining - 1);
+  }
+}
+
+void ResourceRegistry::SetEmpty(Point point)
+{
+  uint32_t key;
+  if (ToKey(point, key) && cells.count(key) > 0 && cells[key].entry.remaining > 0)
+  {
+    SetRemaining(key, 0);
+  }
+}
+
+bool ResourceRegistry::Claim(Point point)
+{
+  uint32_t key;
+  if (!ToKey(point, key) || cells.count(key) == 0)
+  {
+    return false;
+  }
+
+  uint32_t owner = cells[key].entry.owner;
+  if (owner != 0 && owner != node)
+  {
+    return false;
+  }
+
+  if (owner != node)
+  {
+    SetOwner(key, node);
+  }
+  return true;
+}
+
+void ResourceRegistry::Release(Point point)
+{
+  uint32_t key;
+  if (ToKey(point, key) && cells.count(key) > 0 && cells[key].entry.owner == node)
+  {
+    SetOwner(key, 0);
+  }
+}
+
+bool ResourceRegistry::IsClaimedByMe(Point point) const
+{
+  uint32_t key;
+  if (!ToKey(point, key))
+  {
+    return false;
+  }
+
+  auto cell = cells.find(key);
+  return cell != cells.end() && cell->second.entry.owner == node;
+}
+
+int ResourceRegistry::GetRemaining(Point point) const
+{
+  uint32_t key;
+  if (!ToKey(point, key))
+  {
+    return 0;
+  }
+
+  auto cell = cells.find(key);
+  return cell == cells.end() ? 0 : cell->second.entry.remaining;
+}
+
+bool ResourceRegistry::NearestUnclaimed(Point from, Point& cluster) const
+{
+  if (!hasOrigin || buckets.empty())
+  {
+    return false;
+  }
+
+  int fromX = BucketOf((int)floor((from.x - origin.x) / cellSize));
+  int fromY = BucketOf((int)floor((from.y - origin.y) / cellSize));
+  float bucketWidth = bucketCells * cellSize;
+
+  float bestDistance = 0;
+  bool found = false;
+
+  for (int ring = 0; ; ring++)
+  {
+    //past every bucket that was ever used
+    if (fromX - ring < minBucketX && fromX + ring > maxBucketX && fromY - ring < minBucketY && fromY + ring > maxBucketY)
+    {
+      break;
+    }
+
+    for (int bx = fromX - ring; bx <= fromX + ring; bx++)
+    {
+      //the top and bottom rows of the ring are whole, the sides only their ends
+      int step = (bx == fromX - ring || bx == fromX + ring) ? 1 : max(1, 2 * ring);
+      for (int by = fromY - ring; by <= fromY + ring; by += step)
+      {
+        auto bucket = buckets.find(BucketKey(bx, by));
+        if (bucket == buckets.end())
+        {
+          continue;
+        }
+
+        for (uint32_t key : bucket->second)
+        {
+          const ResourceEntry& entry = cells.at(key).entry;
+          Point center = CellCenter(entry.cellX, entry.cellY);
+          float distance = hypot(center.x - from.x, center.y - from.y);
+          if (!found || distance < bestDistance)
+          {
+            bestDistance = distance;
+            cluster = center;
+            found = true;
+          }
+        }
+      }
+    }
+
+    //every bucket in the next ring is at least this far away
+    if (found && bestDistance <= ring * bucketWidth)
+    {
+      break;
+    }
+  }
+
+  if (found)
+  {
+    cluster.theta = atan2(cluster.y - from.y, cluster.x - from.x);
+  }
+  return found;
+}
+
+void ResourceRegistry::GetAvailable(vector<Point>& clusters, vector<int>& remaining) const
+{
+  clusters.clear();
+  remaining.clear();
+
+  for (const auto& cell : cells)
+  {
+    const ResourceEntry& entry = cell.second.entry;
+    if (entry.remaining > 0 && (entry.owner == 0 || entry.owner == node))
+    {
+      clusters.push_back(CellCenter(entry.cellX, entry.cellY));
+      remaining.push_back(entry.remaining);
+    }
+  }
+}
+
+bool ResourceRegistry::TakeDelta(long int time, vector<ResourceEntry>& delta)
+{
+  if (lastDelta >= 0 && time - lastDelta < deltaInterval)
+  {
+    return false;
+  }
+
+  delta.clear();
+
+  int taken = min((int)dirty.size(), maxDirtyEntries);
+  for (int i = 0; i < taken; i++)
+  {
+    Cell& cell = cells[dirty[i]];
+    cell.dirty = false;
+    delta.push_back(cell.entry);
+  }
+  dirty.erase(dirty.begin(), dirty.begin() + taken);
+
+  //repeat a few cells so the ones in lost deltas get through eventually
+  int repeats = min((int)order.size(), antiEntropyEntries);
+  for (int i = 0; i < repeats; i++)
+  {
+    nextAntiEntropy = (nextAntiEntropy + 1) % order.size();
+    const ResourceEntry& entry = cells[order[nextAntiEntropy]].entry;
+
+    bool sent = false;
+    for (int j = 0; j < taken; j++)
+    {
+      sent = sent || (delta[j].cellX == entry.cellX && delta[j].cellY == entry.cellY);
+    }
+    if (!sent)
+    {
+      delta.push_back(entry);
+    }
+  }
+
+  if (delta.empty())
+  {
+    return false;
+  }
+
+  lastDelta = time;
+  return true;
+}
+
+int ResourceRegistry::Merge(const vector<ResourceEntry>& delta)
+{
+  int changed = 0;
+
+  for (const ResourceEntry& remote : delta)
+  {
+    clock = max(clock, max(remote.countClock, remote.claimClock));
+
+    uint32_t key = Key(remote.cellX, remote.cellY);
+    ResourceEntry& local = GetCell(key).entry;
+    bool updated = false;
+
+    //the later write wins, ties go to the larger node so every rover picks the same one
+    if (remote.countClock > local.countClock || (remote.countClock == local.countClock && remote.countNode > local.countNode))
+    {
+      local.remaining = remote.remaining;
+      local.countClock = remote.countClock;
+      local.countNode = remote.countNode;
+      updated = true;
+    }
+
+    if (remote.claimClock > local.claimClock || (remote.claimClock == local.claimClock && remote.claimNode > local.claimNode))
+    {
+      local.owner = remote.owner;
+      local.claimClock = remote.claimClock;
+      local.claimNode = remote.claimNode;
+      updated = true;
+    }
+
+    if (updated)
+    {
+      UpdateIndex(key);
+      changed++;
+    }
+  }
+
+  return changed;
+}
+
+bool ResourceRegistry::ToKey(Point point, uint32_t& key) const
+{
+  if (!hasOrigin)
+  {
+    return false;
+  }
+
+  float cellX = floor((point.x - origin.x) / cellSize);
+  float cellY = floor((point.y - origin.y) / cellSize);
+  if (fabs(cellX) > INT16_MAX || fabs(cellY) > INT16_MAX)
+  {
+    return false;
+  }
+
+  key = Key((int)cellX, (int)cellY);
+  return true;
+}
+
+uint32_t ResourceRegistry::Key(int cellX, int cellY)
+{
+  return ((uint32_t)(uint16_t)cellX << 16) | (uint16_t)cellY;
+}
+
+ResourceRegistry::Cell& ResourceRegistry::GetCell(uint32_t key)
+{
+  auto cell = cells.find(key);
+  if (cell != cells.end())
+  {
+    return cell->second;
+  }
+
+  Cell& added = cells[key];
+  added.entry.cellX = (int16_t)(key >> 16);
+  added.entry.cellY = (int16_t)(key & 0xffff);
+  order.push_back(key);
+  return added;
+}
+
+void ResourceRegistry::SetRemaining(uint32_t key, int remaining)
+{
+  ResourceEntry& entry = GetCell(key).entry;
+  entry.remaining = (uint8_t)max(0, min(255, remaining));
+  entry.countClock = ++clock;
+  entry.countNode = node;
+  MarkDirty(key);
+  UpdateIndex(key);
+}
+
+void ResourceRegistry::SetOwner(uint32_t key, uint32_t owner)
+{
+  ResourceEntry& entry = GetCell(key).entry;
+  entry.owner = owner;
+  entry.claimClock = ++clock;
+  entry.claimNode = node;
+  MarkDirty(key);
+  UpdateIndex(key);
+}
+
+void ResourceRegistry::MarkDirty(uint32_t key)
+{
+  Cell& cell = cells[key];
+  if (!cell.dirty)
+  {
+    cell.dirty = true;
+    dirty.push_back(key);
+  }
+}
+
+bool ResourceRegistry::Available(const ResourceEntry& entry) const
+{
+  return entry.remaining > 0 && entry.owner == 0;
+}
+
+void ResourceRegistry::UpdateIndex(uint32_t key)
+{
+  const ResourceEntry& entry = cells[key].entry;
+  int bucketX = BucketOf(entry.cellX);
+  int bucketY = BucketOf(entry.cellY);
+  uint32_t bucketKey = BucketKey(bucketX, bucketY);
+
+  if (Available(entry))
+  {
+    buckets[bucketKey].insert(key);
+
+    if (minBucketX > maxBucketX)
+    {
+      minBucketX = maxBucketX = bucketX;
+      minBucketY = maxBucketY = bucketY;
+    }
+    minBucketX = min(minBucketX, bucketX);
+    maxBucketX = max(maxBucketX, bucketX);
+    minBucketY = min(minBucketY, bucketY);
+    maxBucketY = max(maxBucketY, bucketY);
+  }
+  else
+  {
+    auto bucket = buckets.find(bucketKey);
+    if (bucket != buckets.end())
+    {
+      bucket->second.erase(key);
+      if (bucket->second.empty())
+      {
+        buckets.erase(bucket);
+      }
+    }
+  }
+}
+
+uint32_t ResourceRegistry::BucketKey(int bucketX, int bucketY)
+{
+  return Key(bucketX, bucketY);
+}
+
+int ResourceRegistry::BucketOf(int cell)
+{
+  //rounds towards minus infinity so the buckets either side of the nest are the same size
+  return cell >= 0 ? cell / bucketCells : -((-cell + bucketCells - 1) / bucketCells);
+}
+
+Point ResourceRegistry::CellCenter(int cellX, int cellY) const
+{
+  Point center;
+  center.x = origin.x + (cellX + 0.5) * cellSize;
+  center.y = origin.y + (cellY + 0.5) * cellSize;
+  center.theta = 0;
+  return center;
+}
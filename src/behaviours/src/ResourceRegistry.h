@@ -0,0 +1,139 @@
+#ifndef RESOURCEREGISTRY_H
+#define RESOURCEREGISTRY_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// One cluster cell of the registry as it is sent to the other rovers, a
+// plain copy of swarmie_msgs/ResourceEntry. The remaining count and the
+// claim are separate last writer wins registers, each stamped with the
+// Lamport clock and the node that wrote it last.
+struct ResourceEntry {
+  int16_t cellX = 0; //cells from the nest
+  int16_t cellY = 0;
+
+  uint8_t remaining = 0; //cubes estimated to be left
+  uint32_t countClock = 0;
+  uint32_t countNode = 0;
+
+  uint32_t owner = 0; //node that claimed the cluster, 0 if unclaimed
+  uint32_t claimClock = 0;
+  uint32_t claimNode = 0;
+};
+
+// Where the swarm has seen cubes, replicated between the rovers without a
+// leader.
+//
+// The registry is a grow-only map from cluster cells around the nest to
+// two last writer wins registers, so merging is commutative, associative
+// and idempotent and every rover converges to the same state whatever order
+// the deltas arrive in or how often they are repeated. Local changes mark
+// their cell dirty and TakeDelta() sends the dirty cells, plus a few cells
+// from a round robin over the whole map so cells lost with a dropped packet
+// are repaired without acknowledgements.
+//
+// Cells that have cubes left and no owner are kept in a bucket grid, the
+// nearest one is found by searching the buckets in rings around the rover
+// until no closer bucket can exist, which does not depend on the number of
+// cells known.
+class ResourceRegistry
+{
+public:
+  ResourceRegistry();
+
+  // Name hash of this rover, written into the registers it changes.
+  void SetNode(uint32_t node) {this->node = node;}
+
+  // Map frame location of the nest, the cells are relative to it so the
+  // rovers agree on them. Nothing is recorded until an origin is set.
+  void SetOrigin(Point origin);
+  bool HasOrigin() const {return hasOrigin;}
+
+  // Map frame positions of the cubes in view at the same time. Each cell
+  // they fall in keeps the most cubes ever seen in it at once, so a cube
+  // seen again on a later pass is not counted twice.
+  void ObserveCubes(const vector<Point>& cubes);
+
+  // A cube was picked up in the cell containing the map frame point.
+  void RemoveCube(Point point);
+
+  // The cell was searched and no cubes were left.
+  void SetEmpty(Point point);
+
+  // Claims the cluster for this rover. Returns false if another rover
+  // holds it. A concurrent claim by another rover can still win the merge,
+  // check IsClaimedByMe() before committing to a long drive.
+  bool Claim(Point point);
+  void Release(Point point);
+  bool IsClaimedByMe(Point point) const;
+
+  // Center of the nearest cell with cubes left that nobody has claimed.
+  bool NearestUnclaimed(Point from, Point& cluster) const;
+
+  // Centers of the cells with cubes left that nobody else has claimed, and
+  // how many cubes each has.
+  void GetAvailable(vector<Point>& clusters, vector<int>& remaining) const;
+
+  // Cubes estimated to be left in the cell containing the point.
+  int GetRemaining(Point point) const;
+  int GetCells() const {return cells.size();}
+
+  // Cells to send to the other rovers if a delta is due. Returns false
+  // otherwise.
+  bool TakeDelta(long int time, vector<ResourceEntry>& delta);
+
+  // Merges cells received from another rover, returns how many changed.
+  int Merge(const vector<ResourceEntry>& delta);
+
+  static constexpr float cellSize = 1.0; //meters, about one cluster
+
+private:
+
+  struct Cell {
+    ResourceEntry entry;
+    bool dirty = false;
+  };
+
+  bool ToKey(Point point, uint32_t& key) const;
+  static uint32_t Key(int cellX, int cellY);
+  Cell& GetCell(uint32_t key);
+  void SetRemaining(uint32_t key, int remaining);
+  void SetOwner(uint32_t key, uint32_t owner);
+  void MarkDirty(uint32_t key);
+
+  // spatial index of the available cells
+  bool Available(const ResourceEntry& entry) const;
+  void UpdateIndex(uint32_t key);
+  static uint32_t BucketKey(int bucketX, int bucketY);
+  static int BucketOf(int cell);
+  Point CellCenter(int cellX, int cellY) const;
+
+  const long int deltaInterval = 1000; //milliseconds
+  const int maxDirtyEntries = 16; //per delta, the rest wait for the next one
+  const int antiEntropyEntries = 4; //unchanged cells repeated per delta
+  static const int bucketCells = 4; //cells per side of an index bucket
+
+  uint32_t node = 0;
+  uint32_t clock = 0; //Lamport clock
+
+  bool hasOrigin = false;
+  Point origin;
+
+  unordered_map<uint32_t, Cell> cells;
+  vector<uint32_t> order; //every key once, for the round robin
+  vector<uint32_t> dirty;
+  int nextAntiEntropy = 0;
+  long int lastDelta = -1;
+
+  unordered_map<uint32_t, unordered_set<uint32_t>> buckets; //available cells by bucket
+  int minBucketX = 0, maxBucketX = -1;
+  int minBucketY = 0, maxBucketY = -1;
+};
+
+#endif // RESOURCEREGISTRY_H
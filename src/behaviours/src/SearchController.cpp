@@ -4,15 +4,9 @@
 #include "SearchController.h"
 #include <angles/angles.h>
 
-int cnmSearchLoop = 0;
 bool cnmObstacleAvoided = false;
 
 SearchController::SearchController() {
-    rng = new random_numbers::RandomNumberGenerator();
-    searchCounter = .5;
-    //searchCounter = 4;
-    searchDist = .35;
-    //searchDist = 2;
     currentLocation.x = 0;
     currentLocation.y = 0;
     currentLocation.theta = 0;
@@ -21,36 +15,17 @@ SearchController::SearchController() {
     centerLocation.y = 0;
     centerLocation.theta = 0;
     
-    //Added 3-7-2018, cnmCurrentLocation for averaging
-    cnmCurrentLocation.x = 0;
-    cnmCurrentLocation.y = 0;
-    cnmCurrentLocation.theta = 0;
     result.PIDMode = FAST_PID;
     
     result.fingerAngle = M_PI/2;
     result.wristAngle = M_PI/4;
     
-    //Added 3-5-2018
-    searchState = OCTAGON;
-    
-    //Added 3-6-2018
-    sectorRadius = 2.5;
-    
-    //Added 3-6-2018
-    squareHeight = 5;
-    
-    //Added 3-7-2018
-    delete rng; //??
+    //lawnmower search is the default, it covers the most ground in search_bench
+    searchPattern.reset(CreateSearchPattern("lawnmower", coverageMap, 0));
     
     //Added 3-10-2018 For obstacle handling
-    //cnmObstacleAvoided = false;
     obstacleAvoidanceCount = 0;
     totalObstacleAvoidanceCount = 0;
-    hasIncremented = true;
-    //cnmObstacleAvoided = false;
-    
-    //Added 3-10-2018
-    searchStep = 0;
 }
 
 void SearchController::Reset() 
@@ -65,16 +40,15 @@ Result SearchController::DoWork()
     // Print info everytime the search loop is used
     cout << "SEARCH SquareSearchStartPositionler is doing work"  << endl;
     
-    //Added 3-7-2018
-    //Setup get cnm current location avgerage
-    static bool averaged = false;
-    averaged = SearchController::CNMCurrentLocationAVG();
+    //Averaged GPS current location from the shared pose service
+    Point cnmCurrentLocation = locationController->GetAverageMapLocation();
     
-    if(averaged)
+    if (searchStartTime == 0)
     {
-        averaged = false;
-        cout << "AVERAGED - Averaged Current location complete" << endl;
+        searchStartTime = current_time;
+        lastReportTime = current_time;
     }
+    succesfullPickup = false;
     
     //clear intitial waypoints if any
     if (!result.wpts.waypoints.empty()) 
@@ -86,389 +60,181 @@ Result SearchController::DoWork()
         }
     }
     result.type = waypoint;
-    Point  searchLocation;
     
-    //Added 3-10-2018 for obstacle handling
-    if(!cnmObstacleAvoided)
-    {
-        cnmSearchLoop++;
-        searchStep++;
-    }
-    else
-    {
-        if(++obstacleAvoidanceCount > 3)
-        {
-            cnmSearchLoop++;
-            searchStep++;
-            obstacleAvoidanceCount = 0;
-            if(++totalObstacleAvoidanceCount > 10)
-                searchState = RANDOM;
-        }
-    }
+    //the patterns and search wedges are laid out around the nest in the map frame
+    Point cnmCenterLocation = locationController->GetNestLocation();
     
-    
-    
-    //find which corner of the square to go 
-    //to first based on 180deg of current heading
     if (first_waypoint)
     {
         cout << "SEARCH - finding where to go first"  << endl;
         first_waypoint = false;
-        switch(searchState)
+        searchPattern->Start(cnmCurrentLocation, cnmCenterLocation);
+    }
+    
+    //Added 3-10-2018 for obstacle handling
+    //an obstacle interrupted the drive to the last waypoint, try it again a
+    //few times before moving on to the next one
+    bool nextWaypoint = true;
+    if (cnmObstacleAvoided && hasWaypoint)
+    {
+        nextWaypoint = false;
+        totalObstacleAvoidanceCount++;
+        
+        if (++obstacleAvoidanceCount > maxObstacleAvoidances)
         {
-            case SQUARE: 
-            {
-                cnmSearchLoop 
-                = SearchController::SquareSearchStartPosition();
-                break;
-            }
-            case OCTAGON:
-            {
-                cnmSearchLoop 
-                = SearchController::OctagonSearchStartPosition();
-                break;
-            }
-            case STAR:
-            {
-                cnmSearchLoop 
-                = SearchController::StarSearchStartPosition();
-                break;
-            }
-            case SECTOR:
-            {
-                cnmSearchLoop 
-                = SearchController::SectorSearchStartPosition();
-                break;
-            }
-            case RANDOM:
+            nextWaypoint = true;
+            obstacleAvoidanceCount = 0;
+            searchPattern->Blocked(searchLocation);
+            
+            if (totalObstacleAvoidanceCount > maxTotalObstacleAvoidances && searchPattern->FallBackWhenBlocked())
             {
-                searchLocation.theta = currentLocation.theta + M_PI;
-                searchLocation.x = currentLocation.x 
-                + (0.5 * cos(searchLocation.theta));
-                searchLocation.y = currentLocation.y 
-                + (0.5 * sin(searchLocation.theta)); 
+                cout << "SEARCH - too many obstacles for the " << searchPattern->Name() << " search, switching to random" << endl;
+                searchPattern.reset(CreateSearchPattern("random", coverageMap, current_time));
             }
         }
     }
+    else
+    {
+        obstacleAvoidanceCount = 0;
+        totalObstacleAvoidanceCount = 0;
+    }
     
-    switch(searchState)
+    if (nextWaypoint)
     {
-        case SQUARE:
+        searchLocation = NextWaypoint(cnmCurrentLocation, cnmCenterLocation);
+        waypointOffset.x = searchLocation.x - cnmCenterLocation.x;
+        waypointOffset.y = searchLocation.y - cnmCenterLocation.y;
+        hasWaypoint = true;
+    }
+    else
+    {
+        searchLocation.x = cnmCenterLocation.x + waypointOffset.x;
+        searchLocation.y = cnmCenterLocation.y + waypointOffset.y;
+        searchLocation.theta = HeadingTo(cnmCurrentLocation, searchLocation);
+    }
+    
+    //Added 3-10-2018 Succseful setting of new wayppoint
+    //means obstacle can be reset.
+    cnmObstacleAvoided = false;
+    
+    Point waypoint = AvoidOccupied(searchLocation);
+    
+    result.wpts.waypoints.clear();
+    result.wpts.waypoints.insert(result.wpts.waypoints.begin(), waypoint);
+    
+    return result;
+    
+}
+
+//Next waypoint of the site visit after a drop off, or of the search pattern
+Point SearchController::NextWaypoint(Point cnmCurrentLocation, Point cnmCenterLocation)
+{
+    if (returnToSite)
+    {
+        returnToSite = false;
+        if (pheromoneMap != nullptr && pheromoneMap->BestSite(cnmCurrentLocation, current_time, siteLocation))
         {
-            if (cnmSearchLoop < 0 || cnmSearchLoop > 3) 
-            {
-                cnmSearchLoop = 0;
-                cout << "SEARCH - search loop out of bounds, reset"  << endl;
-            }
-            if (cnmSearchLoop == 0) //corner in quaderant 1
-            {
-                cout << "SEARCH - going to first corner of square"  << endl;
-                searchLocation = SetDestination(cnmCurrentLocation,
-                                                currentLocation, 
-                                                squareHeight/2,
-                                                squareHeight/2);
-                //cnmSearchLoop = 1;
-            }
-            else if (cnmSearchLoop == 1) //corner in quaderant 2
-            {
-                cout << "SEARCH - going to second corner of square"  << endl;
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -squareHeight/2,
-                                                squareHeight/2);
-                //cnmSearchLoop = 2;
-                
-            }
-            else if (cnmSearchLoop == 2) //corner in quaderant 3
-            {
-                cout << "SEARCH - going to third corner of square"  << endl;
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -squareHeight/2,
-                                                -squareHeight/2);
-                //cnmSearchLoop = 3;
-                
-            }
-            else if (cnmSearchLoop == 3) //corner in quaderant 4
-            {
-                cout << "SEARCH - going to forth corner of square"  << endl;
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                +squareHeight/2,
-                                                -squareHeight/2);
-                //cnmSearchLoop = 0;
-                
-            }
-            
-            if (searchStep > 2)
-            {
-                squareHeight+=searchDist;
-                totalObstacleAvoidanceCount = 0;
-                searchStep = 0;
-            }  
-            break;  
-        }//END SQUARE CASE
+            cout << "SEARCH - returning to site x: " << siteLocation.x << " y: " << siteLocation.y
+                 << " with " << pheromoneMap->GetStrength(siteLocation, current_time) << " cubes left" << endl;
+            siteWaypointsLeft = siteCircleWaypoints;
+            return siteLocation;
+        }
         
-        case OCTAGON: //Counter Clockwise Octagon
+        //nothing of our own left, collect the cluster the auction gave us
+        if (resourceRegistry != nullptr && hasAllocatedCluster && resourceRegistry->Claim(allocatedCluster))
         {
-            if (cnmSearchLoop < 0 || cnmSearchLoop > 8) 
-            {
-                cnmSearchLoop = 0;
-                cout << "SEARCH - search loop out of bounds, reset"  << endl;
-            }
-            if (cnmSearchLoop == 0)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter/2,
-                                                searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 1)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -searchCounter/2,
-                                                searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 2)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -searchCounter,
-                                                searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 3)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -searchCounter,
-                                                -searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 4)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -searchCounter/2,
-                                                -searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 5)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter/2,
-                                                -searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 6)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter,
-                                                -searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 7)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter,
-                                                searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 8)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter/2,
-                                                searchCounter);
-                //cnmSearchLoop++;
-                //searchCounter += searchDist;
-            }
-            if (searchStep > 7)
-            {
-                searchCounter+=searchDist;
-                totalObstacleAvoidanceCount = 0;
-                searchStep = 0;
-            } 
-            break;
-        }//END OCTAGON CASE
+            siteLocation = allocatedCluster;
+            cout << "SEARCH - allocated cluster x: " << siteLocation.x << " y: " << siteLocation.y
+                 << " with " << resourceRegistry->GetRemaining(siteLocation) << " cubes left" << endl;
+            siteClaimed = true;
+            siteWaypointsLeft = siteCircleWaypoints;
+            return siteLocation;
+        }
         
-        case STAR: //6 point star consisting of two triangles
+        //or the nearest one another rover has seen
+        if (resourceRegistry != nullptr && resourceRegistry->NearestUnclaimed(cnmCurrentLocation, siteLocation)
+            && resourceRegistry->Claim(siteLocation))
         {
-            if (cnmSearchLoop < 0 || cnmSearchLoop > 7)
-            {
-                cnmSearchLoop = 0;
-                cout << "SEARCH - search loop out of bounds, reset"  << endl;
-            }
-            if (cnmSearchLoop == 0)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                0,
-                                                searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 1)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter,
-                                                -searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 2)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -searchCounter,
-                                                -searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 3)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                0,
-                                                searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 4)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter,
-                                                searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 5)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                0,
-                                                -searchCounter);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 6)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -searchCounter,
-                                                searchCounter/2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 7)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                searchCounter,
-                                                searchCounter/2);
-                //cnmSearchLoop++;
-                //searchCounter += searchDist;
-            }
-            if (searchStep > 6)
-            {
-                searchCounter+=searchDist;
-                totalObstacleAvoidanceCount = 0;
-                searchStep = 0;
-            } 
-            break;
-        }//END STAR CASE
+            cout << "SEARCH - claimed cluster x: " << siteLocation.x << " y: " << siteLocation.y
+                 << " with " << resourceRegistry->GetRemaining(siteLocation) << " cubes left" << endl;
+            siteClaimed = true;
+            siteWaypointsLeft = siteCircleWaypoints;
+            return siteLocation;
+        }
+    }
+    
+    //another rover's claim on the same cluster won the merge, leave it to them
+    if (siteClaimed && !resourceRegistry->IsClaimedByMe(siteLocation))
+    {
+        cout << "SEARCH - lost the claim on cluster x: " << siteLocation.x << " y: " << siteLocation.y << endl;
+        siteClaimed = false;
+        siteWaypointsLeft = 0;
+    }
+    
+    if (siteWaypointsLeft > 0)
+    {
+        //circle the site starting on the far side from the nest
+        float angle = HeadingTo(cnmCenterLocation, siteLocation) + 2 * M_PI * (siteCircleWaypoints - siteWaypointsLeft) / siteCircleWaypoints;
+        siteWaypointsLeft--;
+        
+        Point waypoint;
+        waypoint.x = siteLocation.x + siteCircleRadius * cos(angle);
+        waypoint.y = siteLocation.y + siteCircleRadius * sin(angle);
+        waypoint.theta = HeadingTo(cnmCurrentLocation, waypoint);
         
-        case SECTOR:
+        //nothing was picked up on the way round, don't come back here
+        if (siteWaypointsLeft == 0)
         {
-            if (cnmSearchLoop < 0 || cnmSearchLoop > 5)
+            if (pheromoneMap != nullptr)
             {
-                cnmSearchLoop = 0;
-                cout << "SEARCH - search loop out of bounds, reset"  << endl;
+                pheromoneMap->Evaporate(siteLocation, emptySiteFraction, current_time);
             }
-            if (cnmSearchLoop == 0)
+            if (resourceRegistry != nullptr)
             {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                sectorRadius,
-                                                sectorRadius*2);
-                //cnmSearchLoop++;
+                resourceRegistry->SetEmpty(siteLocation);
+                resourceRegistry->Release(siteLocation);
             }
-            else if (cnmSearchLoop == 1)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -sectorRadius,
-                                                sectorRadius*2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 2)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                sectorRadius,
-                                                -sectorRadius*2);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 3)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                sectorRadius*2,
-                                                0);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 4)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -sectorRadius*2,
-                                                0);
-                //cnmSearchLoop++;
-            }
-            else if (cnmSearchLoop == 5)
-            {
-                searchLocation = SetDestination(centerLocation,
-                                                cnmCurrentLocation, 
-                                                -sectorRadius,
-                                                -sectorRadius*2);
-                //cnmSearchLoop++;
-            }
-            break;
-        }//END SECTOR CASE
-        
-        case RANDOM:
-        {
-            searchLocation.theta //45 degrees in radians
-            = rng->gaussian(currentLocation.theta, 0.785398); 
-            searchLocation.x 
-            = currentLocation.x + (0.5 * cos(searchLocation.theta));
-            searchLocation.y 
-            = currentLocation.y + (0.5 * sin(searchLocation.theta));
-        }//END RANDOM CASE
-    }//END SWITCH 
-    
-    result.wpts.waypoints.clear();
-    result.wpts.waypoints.insert(result.wpts.waypoints.begin(), searchLocation);
-    
-    return result;
+            siteClaimed = false;
+        }
+        return waypoint;
+    }
     
+    return InRegion(searchPattern->Next(cnmCurrentLocation, cnmCenterLocation), cnmCurrentLocation, cnmCenterLocation);
 }
 
-Point SearchController::SetDestination(Point centerLocation,
-                                       Point currentLocation, 
-                                       double xDelta,
-                                       double yDelta)
+//Moves a search pattern waypoint into the search wedge of this rover
+Point SearchController::InRegion(Point waypoint, Point cnmCurrentLocation, Point cnmCenterLocation)
 {
-    searchLocation.x = centerLocation.x + xDelta;
-    searchLocation.y = centerLocation.y + yDelta;
-    searchLocation.theta = atan2((searchLocation.y - currentLocation.y),
-                                 (searchLocation.x - currentLocation.x));
-                                 
-    //Added 3-10-2018 Succseful setting of new wayppoint
-    //means obstacle can be reset.
-    cnmObstacleAvoided = false;  
-    return searchLocation;  
+    if (!hasRegion || regionWidth >= 2 * M_PI)
+    {
+        return waypoint;
+    }
+    
+    //bearing counter clockwise from the start of the wedge, 0 to 2 pi
+    float bearing = HeadingTo(cnmCenterLocation, waypoint) - regionStart;
+    bearing -= 2 * M_PI * floor(bearing / (2 * M_PI));
+    
+    float margin = min(regionMargin, regionWidth / 4);
+    if (searchPattern->AroundNest())
+    {
+        //the whole circle of the pattern fits into the wedge
+        bearing = margin + bearing * (regionWidth - 2 * margin) / (2 * M_PI);
+    }
+    else if (bearing > regionWidth)
+    {
+        //outside, go to the nearer edge
+        bearing = bearing - regionWidth < 2 * M_PI - bearing ? regionWidth - margin : margin;
+    }
+    else
+    {
+        return waypoint;
+    }
+    
+    float distance = hypot(waypoint.x - cnmCenterLocation.x, waypoint.y - cnmCenterLocation.y);
+    waypoint.x = cnmCenterLocation.x + distance * cos(regionStart + bearing);
+    waypoint.y = cnmCenterLocation.y + distance * sin(regionStart + bearing);
+    waypoint.theta = HeadingTo(cnmCurrentLocation, waypoint);
+    return waypoint;
 }
 
 //Added 3-10-18 For Obstacle Avoidance Tracking
@@ -477,12 +243,6 @@ void SearchController::cnmSetObstacleAvoidanceState()
     cnmObstacleAvoided = true;
 }
 
-//Added 3-7-2018
-void SearchController::cnmSetCenterLocation(Point newLocation)
-{
-    cnmCenterLocation = newLocation;
-}
-
 void SearchController::SetCenterLocation(Point centerLocation) 
 {
     
@@ -503,28 +263,20 @@ void SearchController::SetCurrentLocation(Point currentLocation)
     this->currentLocation = currentLocation;
 }
 
-//Added 3-6-2018
-void SearchController::SetSearchState(SearchState searchState)
-{
-    this->searchState = searchState;
-}
-
-//Added 3-6-2018
-void SearchController::SetSectorRadius(double sectorRadius)
-{
-    this->sectorRadius = sectorRadius;
-}
-
-//Added 3-6-2018
-void SearchController::SetSquareHeight(double squareHeight)
-{
-    this->squareHeight = squareHeight;
-}
-
-//Added 3-6-2018
-void SearchController::SetSearchCounter(double searchCounter)
+bool SearchController::SetSearchPattern(string name, unsigned int seed)
 {
-    this->searchCounter = searchCounter;
+    SearchPattern* pattern = CreateSearchPattern(name, coverageMap, seed);
+    if (pattern == nullptr)
+    {
+        cout << "SEARCH - unknown search pattern " << name << ", keeping the " << searchPattern->Name() << " search" << endl;
+        return false;
+    }
+    
+    cout << "SEARCH - using the " << pattern->Name() << " search" << endl;
+    searchPattern.reset(pattern);
+    first_waypoint = true;
+    hasWaypoint = false;
+    return true;
 }
 
 void SearchController::ProcessData() {}
@@ -543,188 +295,137 @@ bool SearchController::HasWork()
 
 void SearchController::SetSuccesfullPickup() 
 {
+    //called every tick while the target is held, count it once
+    if (!succesfullPickup)
+    {
+        cubesFound++;
+        
+        //the held cube is no longer at the site, the site visit is over
+        Point pose = locationController->GetMapLocation();
+        pose.x += pickUpDistance * cos(pose.theta);
+        pose.y += pickUpDistance * sin(pose.theta);
+        if (pheromoneMap != nullptr)
+        {
+            pheromoneMap->Deposit(pose, pickUpAmount, current_time);
+        }
+        if (resourceRegistry != nullptr)
+        {
+            resourceRegistry->RemoveCube(pose);
+            if (siteClaimed)
+            {
+                resourceRegistry->Release(siteLocation);
+            }
+        }
+        siteClaimed = false;
+        siteWaypointsLeft = 0;
+    }
     succesfullPickup = true;
 }
 
-//decides which quaderant to send the rover based on it current heading + 180deg
-int SearchController::SquareSearchStartPosition()
+void SearchController::SetPheromoneMap(PheromoneMap* pheromoneMap)
 {
-    int searchLoop =0;
-    
-    if (currentLocation.theta + M_PI <= angles::from_degrees(80))
-    {
-        searchLoop = 0;
-    }
-    else if (currentLocation.theta  + M_PI  <= angles::from_degrees(170))
-    {
-        searchLoop = 1;
-    }
-    else if (currentLocation.theta  + M_PI  <= angles::from_degrees(260))
-    {
-        searchLoop = 2;
-    }
-    else if (currentLocation.theta  + M_PI <= angles::from_degrees(350))
-    {
-        searchLoop = 3;
-    }
-    
-    return searchLoop;
+    this->pheromoneMap = pheromoneMap;
 }
 
+void SearchController::SetResourceRegistry(ResourceRegistry* resourceRegistry)
+{
+    this->resourceRegistry = resourceRegistry;
+}
 
-//decides which sector to send the rover based on its opposite heading
-int SearchController::OctagonSearchStartPosition()
+void SearchController::SetAllocatedCluster(bool allocated, Point cluster)
 {
-    int searchLoop = 0;
-    
-    if (currentLocation.theta + M_PI<= angles::from_degrees(45))
-    {
-        searchLoop = 7;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(90))
-    {
-        searchLoop = 0;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(135))
-    {
-        searchLoop = 1;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(180))
-    {
-        searchLoop = 2;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(225))
-    {
-        searchLoop = 3;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(275))
-    {
-        searchLoop = 4;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(315))
-    {
-        searchLoop = 5;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(360))
-    {
-        searchLoop = 6;
-    }
-    
-    return searchLoop;
+    hasAllocatedCluster = allocated;
+    allocatedCluster = cluster;
 }
 
+void SearchController::SetSearchRegion(bool hasRegion, float start, float width)
+{
+    this->hasRegion = hasRegion;
+    regionStart = start;
+    regionWidth = width;
+}
 
-//decides which sector to send the rover based on its opposite heading
-int SearchController::StarSearchStartPosition()
+void SearchController::SetDroppedOff()
 {
-    int searchLoop = 0;
-    
-    if (currentLocation.theta + M_PI<= angles::from_degrees(45))
-    {
-        searchLoop = 1;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(135))
-    {
-        searchLoop = 0;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(275))
+    returnToSite = true;
+}
+
+void SearchController::SetLocationController(const LocationController* locationController)
+{
+    this->locationController = locationController;
+}
+
+void SearchController::SetOccupancyGrid(const OccupancyGrid* occupancyGrid)
+{
+    this->occupancyGrid = occupancyGrid;
+}
+
+//Keeps the search pattern shape but stops short of known obstacles
+Point SearchController::AvoidOccupied(Point waypoint)
+{
+    if (occupancyGrid == nullptr)
     {
-        searchLoop = 2;
+        return waypoint;
     }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(360))
+    
+    Point cnmCenterLocation = locationController->GetNestLocation();
+    for (int i = 0; i < maxWaypointPulls; i++)
     {
-        searchLoop = 1;
+        if (!occupancyGrid->IsOccupiedNear(waypoint.x, waypoint.y, waypointClearance))
+        {
+            return waypoint;
+        }
+        
+        float dx = cnmCenterLocation.x - waypoint.x;
+        float dy = cnmCenterLocation.y - waypoint.y;
+        float distance = hypot(dx, dy);
+        if (distance < waypointPullStep)
+        {
+            break;
+        }
+        
+        cout << "SEARCH - waypoint x: " << waypoint.x << " y: " << waypoint.y << " is occupied, moving it in" << endl;
+        waypoint.x += dx * waypointPullStep / distance;
+        waypoint.y += dy * waypointPullStep / distance;
     }
     
-    return searchLoop;
+    return waypoint;
 }
 
-//decides which sector to send the rover based on its opposite heading
-int SearchController::SectorSearchStartPosition()
+void SearchController::SetCoverageMap(CoverageMap* coverageMap)
 {
-    int searchLoop = 0;
+    this->coverageMap = coverageMap;
     
-    if (currentLocation.theta + M_PI<= angles::from_degrees(45))
-    {
-        searchLoop = 3;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(90))
+    //a frontier search set before there was a map has nothing to go by
+    if (string(searchPattern->Name()) == "frontier")
     {
-        searchLoop = 0;
+        searchPattern.reset(CreateSearchPattern("frontier", coverageMap, 0));
     }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(135))
-    {
-        searchLoop = 1;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(225))
-    {
-        searchLoop = 4;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(270))
-    {
-        searchLoop = 5;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(315))
-    {
-        searchLoop = 2;
-    }
-    else if (currentLocation.theta + M_PI<= angles::from_degrees(360))
-    {
-        searchLoop = 3;
-    }
-    
-    return searchLoop;
-}
-    
-//Added 3-7-2018
-void SearchController::cnmSetAvgCurrentLocation(Point cnmAVGCurrentLocation)
-{
-    cnmCurrentLocation = cnmAVGCurrentLocation;
 }
 
-//Added 3-7-2018
-bool SearchController::CNMCurrentLocationAVG()
+void SearchController::SetCurrentTimeInMilliSecs(long int time)
 {
-
-    const int CASIZE = 30;
-
-    float avgCurrentCoordsX[CASIZE];
-    float avgCurrentCoordsY[CASIZE];
-
-    static int index = 0;
-
-    if(index < CASIZE)
+    current_time = time;
+    
+    if (searchStartTime > 0 && current_time - lastReportTime >= reportInterval)
     {
-
-  	    avgCurrentCoordsX[index] = currentLocation.x;
-      	avgCurrentCoordsY[index] = currentLocation.y;
-
-  	    index++;
-
-  	    return false;
+        lastReportTime = current_time;
+        ReportSearchRate();
     }
-    else
-    {
-      	float x = 0, y = 0;
-      	
-      	for(int i = 0; i < CASIZE; i++)
-      	{
-      	    x += avgCurrentCoordsX[i];
-      	    y += avgCurrentCoordsY[i];
-      	}
-
-      	x = x/CASIZE;
-      	y = y/CASIZE;
-
-        Point cnmAVGCurrentLocation;
-      	cnmAVGCurrentLocation.x = x;
-      	cnmAVGCurrentLocation.y = y;
-        cnmAVGCurrentLocation.theta = currentLocation.theta;
-
-        SearchController::cnmSetAvgCurrentLocation(cnmAVGCurrentLocation);
+}
 
-      	index = 0;
-      	return true;
+//Coverage and cubes found per minute since the search started so the
+//patterns can be compared across runs
+void SearchController::ReportSearchRate()
+{
+    float minutes = (current_time - searchStartTime) / 60e3;
+    if (minutes <= 0)
+    {
+        return;
     }
+    
+    float covered = coverageMap != nullptr ? coverageMap->GetCoveredArea() : 0;
+    cout << "SEARCH - " << searchPattern->Name() << " search after " << minutes << " min, coverage: "
+         << covered << " m^2 (" << covered / minutes << " m^2/min), cubes found: "
+         << cubesFound << " (" << cubesFound / minutes << "/min)" << endl;
 }
-
@@ -2,8 +2,14 @@
 #define SEARCH_CONTROLLER
 
 #include <geometry_msgs/Pose2D.h> //CNM added 3/7/18
-#include <random_numbers/random_numbers.h>
+#include <memory>
 #include "Controller.h"
+#include "LocationController.h"
+#include "OccupancyGrid.h"
+#include "CoverageMap.h"
+#include "SearchPattern.h"
+#include "PheromoneMap.h"
+#include "ResourceRegistry.h"
 
 /**
  * This class implements the search control algorithm for the rovers. The code
@@ -31,59 +37,38 @@ public:
   void SetCenterLocation(Point centerLocation);
   void SetSuccesfullPickup();
   
-  //Added CNM 3-7-2018
-  void cnmSetCenterLocation(Point cnmCenterLocation);
-  void cnmSetAvgCurrentLocation(Point cnmAVGCurrentLocation); 
-  // {cnmCurrentLocation = cnmAVGCurrentLocation;}
-  bool CNMCurrentLocationAVG();
-
-  //sets the value for initial point in search pattern
-  int SquareSearchStartPosition();
-  
-  //Added 3-5-2018
-  //Finds the value for the initial point for the octagon search pattern
-  int OctagonSearchStartPosition();
-  
-  //Added 3-5-2018
-  //Finds the value for the initial point for the star search pattern
-  int StarSearchStartPosition();
-  
-  //Added 3-6-2018
-  //Finds the value for the initial point for the sector search pattern
-  int SectorSearchStartPosition();
-  
-  //Added 3-5-2018
-  //Creating point to move to
-  Point SetDestination(Point centerLocation,
-                       Point currentLocation, 
-                       double xDelta,
-                       double yDelta);
-                       
-  
-  //Added 3-5-2018
-  //Creates states to use to determine the correct search pattern.
-  enum SearchState {
-  SQUARE,
-  OCTAGON,
-  STAR,
-  SECTOR,
-  RANDOM
-  }; 
-  
-  SearchState searchState; 
-                       
-  //Added 3-6-2018
-  //Setting Search State
-  void SetSearchState(SearchState searchState);
-  
-  //Added 3-6-2018
-  void SetSectorRadius(double sectorRadius);
+  //shared pose service, the averaged current location comes from here
+  void SetLocationController(const LocationController* locationController);
+
+  //obstacle map, search waypoints inside known obstacles are moved
+  void SetOccupancyGrid(const OccupancyGrid* occupancyGrid);
+
+  //coverage of the camera, the FRONTIER search drives to its frontier
+  void SetCoverageMap(CoverageMap* coverageMap);
+
+  //cubes seen but not picked up, a pickup takes its cube away again
+  void SetPheromoneMap(PheromoneMap* pheromoneMap);
+
+  //cube clusters seen by the whole swarm, claimed when no site of our own is left
+  void SetResourceRegistry(ResourceRegistry* resourceRegistry);
+
+  //cluster this rover won in the task auction, visited before the nearest one
+  void SetAllocatedCluster(bool allocated, Point cluster);
+
+  //wedge around the nest this rover searches, see SearchPartition. The
+  //search pattern waypoints are kept inside it.
+  void SetSearchRegion(bool hasRegion, float start, float width);
   
-  //Added 3-6-2018
-  void SetSquareHeight(double squareHeight);
+  //a cube was dropped off, go back to the most promising site before
+  //carrying on with the search pattern
+  void SetDroppedOff();
   
-  //Added 3-6-2018
-  void SetSearchCounter(double searchCounter);
+  //time is used for the search rate reports and the pheromone decay
+  void SetCurrentTimeInMilliSecs(long int time);
+
+  //selects the search pattern by name, see CreateSearchPattern(). Unknown
+  //names keep the current pattern. The seed is used by the random patterns.
+  bool SetSearchPattern(string name, unsigned int seed);
   
   //Added 3-10-18 For Obstacle Handling
   void cnmSetObstacleAvoidanceState();
@@ -96,21 +81,69 @@ protected:
 
 private:
 
-  //Added CNM 3-7-2018
-  //Averaged GPS center location
-  Point cnmCenterLocation;
-  //Averaged GPS current location
-  Point cnmCurrentLocation;
+  const LocationController* locationController = nullptr;
+  const OccupancyGrid* occupancyGrid = nullptr;
+
+  // Pulls a waypoint towards the center until it is clear of known obstacles
+  Point AvoidOccupied(Point waypoint);
+  const float waypointClearance = 0.3; //meters
+  const float waypointPullStep = 0.25; //meters
+  const int maxWaypointPulls = 8;
+
+  CoverageMap* coverageMap = nullptr;
+
+  //generates the search waypoints, lawnmower search unless set otherwise
+  unique_ptr<SearchPattern> searchPattern;
+
+  //the last waypoint as an offset from the nest so a repeated waypoint
+  //follows the nest estimate
+  Point waypointOffset;
+  bool hasWaypoint = false;
+
+  //obstacle interruptions before the rover gives up on a waypoint
+  const int maxObstacleAvoidances = 3;
+  //interruptions since a waypoint was last reached before a fixed pattern
+  //falls back to a random walk
+  const int maxTotalObstacleAvoidances = 10;
+
+  PheromoneMap* pheromoneMap = nullptr;
+  ResourceRegistry* resourceRegistry = nullptr;
+  
+  //site fidelity, after a drop off drive to the best site then circle it
+  //so the camera sweeps the ground around it
+  Point NextWaypoint(Point cnmCurrentLocation, Point cnmCenterLocation);
+  bool returnToSite = false;
+  Point siteLocation;
+  bool siteClaimed = false; //the site came from the registry and is claimed
+  bool hasAllocatedCluster = false;
+  Point allocatedCluster;
+  int siteWaypointsLeft = 0;
+  const int siteCircleWaypoints = 4;
+  const float siteCircleRadius = 1.0; //meters, the camera looks about this far ahead
+  const float emptySiteFraction = 0.25; //pheromone left at a site that had no cubes
+  const float pickUpAmount = -1.0; //one cube less at the pickup site
+  const float pickUpDistance = 0.25; //meters from the rover center to a held cube
+  
+  //search wedge of this rover
+  Point InRegion(Point waypoint, Point cnmCurrentLocation, Point cnmCenterLocation);
+  bool hasRegion = false;
+  float regionStart = 0;
+  float regionWidth = 2 * M_PI;
+  const float regionMargin = 0.1; //radians kept off the wedge edges
+  
+  //search rate reports
+  void ReportSearchRate();
+  const long int reportInterval = 60000; //milliseconds
+  long int current_time = 0;
+  long int searchStartTime = 0;
+  long int lastReportTime = 0;
+  int cubesFound = 0;
   
-  random_numbers::RandomNumberGenerator* rng;
   Point currentLocation;
   Point centerLocation;
   Point searchLocation;
   int attemptCount = 0;
   
-  //incrememnt values for distance
-  double searchCounter;
-  double searchDist;
   //struct for returning data to ROS adapter
   Result result;
 
@@ -119,18 +152,10 @@ private:
   bool first_waypoint = true;
   bool succesfullPickup = false;
   
-  //Added 3-6-18
-  double squareHeight;
-  double sectorRadius;
-  
   //Added 3-10-18 for abstacle handling
   //bool obstacleAvoided;
   int obstacleAvoidanceCount;
   int totalObstacleAvoidanceCount;
-  bool hasIncremented;
-  
-  //Added 3-10-18
-  int searchStep;
   
 };
 
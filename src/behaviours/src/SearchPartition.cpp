@@ -0,0 +1,146 @@
+#include "SearchPartition.h"
+
+#include <algorithm> // For lower_bound and sort
+#include <cmath> // For atan2 and remainder
+
+SearchPartition::SearchPartition()
+{
+}
+
+uint32_t SearchPartition::Mix(uint32_t member)
+{
+  //the name hashes of rovers with similar names are close together, the
+  //murmur3 finalizer spreads them over the whole range
+  member ^= member >> 16;
+  member *= 0x85ebca6b;
+  member ^= member >> 13;
+  member *= 0xc2b2ae35;
+  member ^= member >> 16;
+  return member;
+}
+
+float SearchPartition::Anchor(uint32_t member)
+{
+  return 2 * M_PI * (Mix(member) / 4294967296.0);
+}
+
+bool SearchPartition::SetMembers(const vector<uint32_t>& members)
+{
+  vector<uint32_t> sorted = members;
+  sort(sorted.begin(), sorted.end());
+
+  vector<uint32_t> left;
+  for (const Member& member : this->members)
+  {
+    if (!binary_search(sorted.begin(), sorted.end(), member.id))
+    {
+      left.push_back(member.id);
+    }
+  }
+
+  bool changed = !left.empty();
+  for (uint32_t member : left)
+  {
+    Leave(member);
+  }
+
+  for (uint32_t member : sorted)
+  {
+    if (Find(member) < 0)
+    {
+      Join(member);
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+void SearchPartition::Join(uint32_t member)
+{
+  if (Find(member) >= 0)
+  {
+    return;
+  }
+
+  Member joined;
+  joined.id = member;
+  joined.key = Mix(member);
+  joined.anchor = Anchor(member);
+  joined.start = 0;
+
+  members.insert(lower_bound(members.begin(), members.end(), joined, ByKey), joined);
+  Recompute();
+}
+
+void SearchPartition::Leave(uint32_t member)
+{
+  int index = Find(member);
+  if (index < 0)
+  {
+    return;
+  }
+
+  members.erase(members.begin() + index);
+  Recompute();
+}
+
+bool SearchPartition::GetRegion(uint32_t member, float& start, float& width) const
+{
+  int index = Find(member);
+  if (index < 0)
+  {
+    return false;
+  }
+
+  start = members[index].start;
+  width = this->width;
+  return true;
+}
+
+int SearchPartition::Find(uint32_t member) const
+{
+  Member key;
+  key.id = member;
+  key.key = Mix(member);
+  auto position = lower_bound(members.begin(), members.end(), key, ByKey);
+  if (position == members.end() || position->id != member)
+  {
+    return -1;
+  }
+  return position - members.begin();
+}
+
+bool SearchPartition::ByKey(const Member& a, const Member& b)
+{
+  //the anchor follows the key, ties are left to the id
+  return a.key < b.key || (a.key == b.key && a.id < b.id);
+}
+
+void SearchPartition::Recompute()
+{
+  if (members.empty())
+  {
+    width = 0;
+    return;
+  }
+
+  width = 2 * M_PI / members.size();
+
+  //each rover would like the rotation that centers its wedge on its anchor,
+  //the circular mean of those keeps the wedges closest to their anchors
+  float sumSin = 0;
+  float sumCos = 0;
+  for (int i = 0; i < (int)members.size(); i++)
+  {
+    float rotation = members[i].anchor - (i + 0.5) * width;
+    sumSin += sin(rotation);
+    sumCos += cos(rotation);
+  }
+  float rotation = atan2(sumSin, sumCos);
+
+  for (int i = 0; i < (int)members.size(); i++)
+  {
+    members[i].start = remainder(rotation + i * width, 2 * M_PI);
+  }
+}
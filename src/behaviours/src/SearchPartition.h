@@ -0,0 +1,61 @@
+#ifndef SEARCHPARTITION_H
+#define SEARCHPARTITION_H
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Splits the arena around the nest into one search wedge per rover.
+//
+// Each rover has a fixed anchor bearing from the nest derived from its
+// name hash, and the rovers are kept sorted by anchor. The wedges are all
+// the same width and go round the nest in anchor order, rotated so they
+// sit as close to their anchors as possible. Every rover computes the same
+// wedges from the same members without talking, and since the order only
+// depends on the anchors a rover that joins or leaves only pushes the
+// boundaries of the others by a fraction of a wedge instead of reshuffling
+// who searches where.
+//
+// Bearings are in radians in the map frame, a wedge runs counter clockwise
+// from its start for its width.
+class SearchPartition
+{
+public:
+  SearchPartition();
+
+  // Members of the swarm by name hash. Only the rovers that joined or left
+  // since the last call are inserted or removed. Returns true if the
+  // wedges changed.
+  bool SetMembers(const vector<uint32_t>& members);
+
+  void Join(uint32_t member);
+  void Leave(uint32_t member);
+
+  // Wedge of the given member, false if it is not in the swarm.
+  bool GetRegion(uint32_t member, float& start, float& width) const;
+
+  int GetSize() const {return members.size();}
+
+  // Bearing from the nest the member would like its wedge around.
+  static float Anchor(uint32_t member);
+
+private:
+
+  struct Member {
+    uint32_t id;
+    uint32_t key; //mixed id, sets the anchor
+    float anchor;
+    float start;
+  };
+
+  static uint32_t Mix(uint32_t member);
+  static bool ByKey(const Member& a, const Member& b);
+  int Find(uint32_t member) const;
+  void Recompute();
+
+  vector<Member> members; //sorted by anchor
+  float width = 0;
+};
+
+#endif // SEARCHPARTITION_H
@@ -0,0 +1,224 @@
+#include "SearchPattern.h"
+
+#include <algorithm> // For min and max
+#include <iostream>
+
+SearchPattern* CreateSearchPattern(const string& name, CoverageMap* coverageMap, unsigned int seed)
+{
+  if (name == "square") return PolygonPattern::Square();
+  if (name == "octagon") return PolygonPattern::Octagon();
+  if (name == "star") return PolygonPattern::Star();
+  if (name == "sector") return PolygonPattern::Sector();
+  if (name == "spiral") return new SpiralPattern();
+  if (name == "levy") return new LevyWalkPattern(seed);
+  if (name == "lawnmower") return new LawnmowerPattern();
+  if (name == "frontier") return new FrontierPattern(coverageMap);
+  if (name == "random") return new RandomPattern(seed);
+
+  return nullptr;
+}
+
+float HeadingTo(Point from, Point to)
+{
+  return atan2(to.y - from.y, to.x - from.x);
+}
+
+// Waypoint at an offset from the nest, heading away from the rover.
+static Point Offset(Point current, Point center, float x, float y)
+{
+  Point waypoint;
+  waypoint.x = center.x + x;
+  waypoint.y = center.y + y;
+  waypoint.theta = HeadingTo(current, waypoint);
+  return waypoint;
+}
+
+static Point Vertex(float x, float y)
+{
+  Point vertex;
+  vertex.x = x;
+  vertex.y = y;
+  vertex.theta = 0;
+  return vertex;
+}
+
+PolygonPattern::PolygonPattern(const char* name, vector<Point> vertices, float scale, float growth)
+  : name(name), vertices(vertices), scale(scale), growth(growth)
+{
+}
+
+//corners in quadrants 1 to 4
+PolygonPattern* PolygonPattern::Square()
+{
+  return new PolygonPattern("square", {Vertex(0.5, 0.5), Vertex(-0.5, 0.5), Vertex(-0.5, -0.5), Vertex(0.5, -0.5)}, 5.0, 0.35);
+}
+
+//counter clockwise
+PolygonPattern* PolygonPattern::Octagon()
+{
+  return new PolygonPattern("octagon", {Vertex(0.5, 1), Vertex(-0.5, 1), Vertex(-1, 0.5), Vertex(-1, -0.5),
+                                        Vertex(-0.5, -1), Vertex(0.5, -1), Vertex(1, -0.5), Vertex(1, 0.5)}, 0.5, 0.35);
+}
+
+PolygonPattern* PolygonPattern::Star()
+{
+  return new PolygonPattern("star", {Vertex(0, 1), Vertex(1, -0.5), Vertex(-1, -0.5), Vertex(0, 1),
+                                     Vertex(1, 0.5), Vertex(0, -1), Vertex(-1, 0.5), Vertex(1, 0.5)}, 0.5, 0.35);
+}
+
+//fixed size, scaled by the sector radius
+PolygonPattern* PolygonPattern::Sector()
+{
+  return new PolygonPattern("sector", {Vertex(1, 2), Vertex(-1, 2), Vertex(1, -2),
+                                       Vertex(2, 0), Vertex(-2, 0), Vertex(-1, -2)}, 2.5, 0);
+}
+
+void PolygonPattern::Start(Point current, Point center)
+{
+  float opposite = current.theta + M_PI;
+  float closest = 2 * M_PI;
+
+  for (int i = 0; i < vertices.size(); i++)
+  {
+    float bearing = atan2(vertices[i].y, vertices[i].x);
+    float difference = fabs(remainder(bearing - opposite, 2 * M_PI));
+    if (difference < closest)
+    {
+      closest = difference;
+      index = i;
+    }
+  }
+}
+
+Point PolygonPattern::Next(Point current, Point center)
+{
+  Point waypoint = Offset(current, center, vertices[index].x * scale, vertices[index].y * scale);
+
+  if (++index >= vertices.size())
+  {
+    index = 0;
+    scale += growth;
+  }
+
+  return waypoint;
+}
+
+void SpiralPattern::Start(Point current, Point center)
+{
+  //join the spiral on the side of the nest the rover is on
+  startAngle = HeadingTo(center, current);
+  angle = 0;
+}
+
+Point SpiralPattern::Next(Point current, Point center)
+{
+  //step along the spiral by about the waypoint spacing, the arc length of
+  //a small turn is the radius times the angle
+  angle += waypointSpacing / Radius();
+
+  if (Radius() > maxRadius)
+  {
+    angle = 0;
+  }
+
+  float radius = Radius();
+  return Offset(current, center, radius * cos(startAngle + angle), radius * sin(startAngle + angle));
+}
+
+Point LevyWalkPattern::Next(Point current, Point center)
+{
+  //inverse transform sampling of a power law with exponent mu, limited so
+  //the rover does not leave the arena on one step
+  float step = minStep * pow(1 - uniform(generator), -1 / (levyExponent - 1));
+  step = min(step, maxStep);
+
+  float heading = 2 * M_PI * uniform(generator);
+
+  Point waypoint;
+  waypoint.x = current.x + step * cos(heading);
+  waypoint.y = current.y + step * sin(heading);
+
+  if (hypot(waypoint.x - center.x, waypoint.y - center.y) > maxRadius)
+  {
+    //head back within a quarter turn of the nest
+    heading = HeadingTo(current, center) + M_PI_2 * (uniform(generator) - 0.5);
+    waypoint.x = current.x + step * cos(heading);
+    waypoint.y = current.y + step * sin(heading);
+  }
+
+  waypoint.theta = heading;
+  return waypoint;
+}
+
+void LawnmowerPattern::Start(Point current, Point center)
+{
+  //start the first sweep on the side of the nest the rover is on
+  laneSign = current.y - center.y >= 0 ? 1 : -1;
+}
+
+Point LawnmowerPattern::Next(Point current, Point center)
+{
+  float across = laneSign * (halfWidth - lane * laneSpacing);
+  if (fabs(across) > halfWidth)
+  {
+    //finished the sweep, run the lanes the other way
+    lane = 0;
+    alongX = !alongX;
+    laneStart = true;
+    across = laneSign * halfWidth;
+  }
+
+  //every other lane is driven in the other direction
+  float along = (lane % 2 == 0) == laneStart ? -halfWidth : halfWidth;
+
+  if (laneStart)
+  {
+    laneStart = false;
+  }
+  else
+  {
+    laneStart = true;
+    lane++;
+  }
+
+  return alongX ? Offset(current, center, along, across) : Offset(current, center, across, along);
+}
+
+Point FrontierPattern::Next(Point current, Point center)
+{
+  Point frontierLocation;
+
+  if (coverageMap != nullptr
+      && coverageMap->NearestFrontier(current, minFrontierDistance, frontierLocation))
+  {
+    cout << "SEARCH - frontier x: " << frontierLocation.x << " y: " << frontierLocation.y
+         << " of " << coverageMap->GetFrontierSize() << " frontier cells" << endl;
+  }
+  else
+  {
+    //nothing seen yet, head away from the center to start the coverage
+    frontierLocation.theta = HeadingTo(center, current);
+    frontierLocation.x = current.x + minFrontierDistance * cos(frontierLocation.theta);
+    frontierLocation.y = current.y + minFrontierDistance * sin(frontierLocation.theta);
+  }
+
+  return frontierLocation;
+}
+
+void FrontierPattern::Blocked(Point waypoint)
+{
+  if (coverageMap != nullptr)
+  {
+    cout << "SEARCH - giving up on frontier x: " << waypoint.x << " y: " << waypoint.y << endl;
+    coverageMap->MarkSeen(waypoint, blockedRadius);
+  }
+}
+
+Point RandomPattern::Next(Point current, Point center)
+{
+  Point waypoint;
+  waypoint.theta = current.theta + headingNoise(generator);
+  waypoint.x = current.x + stepLength * cos(waypoint.theta);
+  waypoint.y = current.y + stepLength * sin(waypoint.theta);
+  return waypoint;
+}
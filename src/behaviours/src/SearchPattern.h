@@ -0,0 +1,182 @@
+#ifndef SEARCHPATTERN_H
+#define SEARCHPATTERN_H
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Point.h"
+#include "CoverageMap.h"
+
+using namespace std;
+
+// A search pattern generates search waypoints one at a time.
+//
+// The search controller pulls the next waypoint from the pattern each time
+// the rover gets to the last one, so a pattern only keeps its position in
+// the sequence and works out the next waypoint when it is asked for it.
+// Waypoints are in the map frame and the fixed shapes are laid out around
+// the nest estimate passed in, so they follow the nest as it is refined.
+class SearchPattern
+{
+public:
+  virtual ~SearchPattern() {}
+
+  // Called once before the first waypoint, picks where in the pattern to
+  // start from the rover pose.
+  virtual void Start(Point current, Point center) {}
+
+  // The next waypoint in the map frame.
+  virtual Point Next(Point current, Point center) = 0;
+
+  // The rover gave up on reaching the given waypoint because of obstacles.
+  virtual void Blocked(Point waypoint) {}
+
+  // Fixed shapes hand over to a random walk when obstacles keep getting in
+  // the way, patterns that already adapt to obstacles keep going.
+  virtual bool FallBackWhenBlocked() const {return true;}
+
+  // Shapes laid out around the nest cover every bearing from it, they are
+  // squeezed into the rover's search wedge. Patterns that step from the
+  // rover are only kept from leaving it.
+  virtual bool AroundNest() const {return false;}
+
+  virtual const char* Name() const = 0;
+};
+
+// Creates a pattern by name: square, octagon, star, sector, spiral, levy,
+// lawnmower, frontier or random. Returns nullptr for an unknown name. The
+// frontier pattern needs the coverage map, the random ones use the seed.
+SearchPattern* CreateSearchPattern(const string& name, CoverageMap* coverageMap, unsigned int seed);
+
+// Heading from one point to another.
+float HeadingTo(Point from, Point to);
+
+// Polygons around the nest that grow by a fixed amount every lap. The
+// vertices are offsets from the nest in units of the current scale.
+class PolygonPattern : public SearchPattern
+{
+public:
+  PolygonPattern(const char* name, vector<Point> vertices, float scale, float growth);
+
+  // Starts at the vertex in the opposite direction to the rover heading.
+  void Start(Point current, Point center) override;
+  Point Next(Point current, Point center) override;
+  bool AroundNest() const override {return true;}
+  const char* Name() const override {return name;}
+
+  static PolygonPattern* Square();
+  static PolygonPattern* Octagon();
+  static PolygonPattern* Star(); //6 point star consisting of two triangles
+  static PolygonPattern* Sector();
+
+private:
+  const char* name;
+  vector<Point> vertices;
+  float scale; //meters
+  float growth; //meters added to the scale each lap
+  int index = 0;
+};
+
+// Archimedean spiral out from the nest with a fixed distance between turns,
+// the waypoints are spaced evenly along it.
+class SpiralPattern : public SearchPattern
+{
+public:
+  void Start(Point current, Point center) override;
+  Point Next(Point current, Point center) override;
+  bool AroundNest() const override {return true;}
+  const char* Name() const override {return "spiral";}
+
+private:
+  float Radius() const {return startRadius + turnSpacing * angle / (2 * M_PI);}
+
+  const float startRadius = 1.0; //meters, just outside the nest
+  const float turnSpacing = 0.8; //meters, a little less than the camera footprint width
+  const float waypointSpacing = 1.5; //meters along the spiral
+  const float maxRadius = 11.0; //meters, start over from the nest beyond this
+
+  float angle = 0; //radians turned since the start of the spiral
+  float startAngle = 0;
+};
+
+// Levy walk, uniformly random headings and power law step lengths so most
+// steps are short with the occasional long relocation.
+class LevyWalkPattern : public SearchPattern
+{
+public:
+  LevyWalkPattern(unsigned int seed) : generator(seed) {}
+
+  Point Next(Point current, Point center) override;
+  bool FallBackWhenBlocked() const override {return false;}
+  const char* Name() const override {return "levy";}
+
+private:
+  const float levyExponent = 2.0; //mu, 2 is optimal for sparse targets
+  const float minStep = 1.0; //meters
+  const float maxStep = 8.0; //meters
+  const float maxRadius = 11.0; //meters from the nest, steps beyond this turn back
+
+  mt19937 generator;
+  uniform_real_distribution<float> uniform{0.0, 1.0};
+};
+
+// Back and forth lanes across a square around the nest, the next sweep
+// runs the lanes the other way.
+class LawnmowerPattern : public SearchPattern
+{
+public:
+  void Start(Point current, Point center) override;
+  Point Next(Point current, Point center) override;
+  bool AroundNest() const override {return true;}
+  const char* Name() const override {return "lawnmower";}
+
+private:
+  const float halfWidth = 8.0; //meters
+  const float laneSpacing = 0.8; //meters
+
+  int lane = 0;
+  bool laneStart = true; //at the start or end of the current lane
+  bool alongX = true; //lanes run along the x axis this sweep
+  float laneSign = 1; //which side of the nest the sweep starts on
+};
+
+// Drives to the nearest edge of the ground the camera has already seen.
+class FrontierPattern : public SearchPattern
+{
+public:
+  FrontierPattern(CoverageMap* coverageMap) : coverageMap(coverageMap) {}
+
+  Point Next(Point current, Point center) override;
+  void Blocked(Point waypoint) override;
+  bool FallBackWhenBlocked() const override {return false;}
+  const char* Name() const override {return "frontier";}
+
+private:
+  const float minFrontierDistance = 1.0; //meters, closer waypoints are dropped by the drive controller
+  //meters around a frontier cell given up on that go with it, the cells
+  //behind the same wall would be tried one by one otherwise
+  const float blockedRadius = 1.0;
+
+  CoverageMap* coverageMap;
+};
+
+// Short random steps roughly in the direction the rover is heading.
+class RandomPattern : public SearchPattern
+{
+public:
+  RandomPattern(unsigned int seed) : generator(seed) {}
+
+  Point Next(Point current, Point center) override;
+  bool FallBackWhenBlocked() const override {return false;}
+  const char* Name() const override {return "random";}
+
+private:
+  const float stepLength = 0.5; //meters
+
+  mt19937 generator;
+  normal_distribution<float> headingNoise{0.0, 0.785398}; //45 degrees in radians
+};
+
+#endif // SEARCHPATTERN_H
@@ -0,0 +1,73 @@
+#include "SpatialHash.h"
+
+#include <algorithm> // For find
+#include <cmath> // For floor
+
+SpatialHash::SpatialHash(float cellSize)
+{
+  this->cellSize = cellSize;
+}
+
+void SpatialHash::Update(uint32_t id, Point location)
+{
+  uint64_t key = Key(location.x, location.y);
+
+  auto current = cellOf.find(id);
+  if (current != cellOf.end())
+  {
+    if (current->second == key)
+    {
+      return;
+    }
+    Remove(id);
+  }
+
+  cells[key].push_back(id);
+  cellOf[id] = key;
+}
+
+void SpatialHash::Remove(uint32_t id)
+{
+  auto current = cellOf.find(id);
+  if (current == cellOf.end())
+  {
+    return;
+  }
+
+  auto cell = cells.find(current->second);
+  vector<uint32_t>& ids = cell->second;
+  ids.erase(find(ids.begin(), ids.end(), id));
+  if (ids.empty())
+  {
+    cells.erase(cell);
+  }
+  cellOf.erase(current);
+}
+
+void SpatialHash::Query(Point location, vector<uint32_t>& ids) const
+{
+  int32_t column = (int32_t)floor(location.x / cellSize);
+  int32_t row = (int32_t)floor(location.y / cellSize);
+
+  for (int32_t i = column - 1; i <= column + 1; i++)
+  {
+    for (int32_t j = row - 1; j <= row + 1; j++)
+    {
+      auto cell = cells.find(Key(i, j));
+      if (cell != cells.end())
+      {
+        ids.insert(ids.end(), cell->second.begin(), cell->second.end());
+      }
+    }
+  }
+}
+
+uint64_t SpatialHash::Key(float x, float y) const
+{
+  return Key((int32_t)floor(x / cellSize), (int32_t)floor(y / cellSize));
+}
+
+uint64_t SpatialHash::Key(int32_t column, int32_t row)
+{
+  return ((uint64_t)(uint32_t)column << 32) | (uint32_t)row;
+}
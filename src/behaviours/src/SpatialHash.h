@@ -0,0 +1,44 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Buckets ids by the square cell their location falls in so the ids near a
+// point can be found without going through all of them.
+//
+// A query returns the ids in the cell of the point and the eight cells
+// around it, which includes every id within one cell size of the point and
+// a few further out. Only cells that hold an id are stored, so the arena
+// does not have to be known in advance.
+class SpatialHash
+{
+public:
+  SpatialHash(float cellSize);
+
+  // Moves the id to the cell of its new location, adds it if it is new.
+  void Update(uint32_t id, Point location);
+  void Remove(uint32_t id);
+
+  // Ids in the cells around the point, appended to ids.
+  void Query(Point location, vector<uint32_t>& ids) const;
+
+  float GetCellSize() const {return cellSize;}
+  int GetSize() const {return cellOf.size();}
+
+private:
+
+  uint64_t Key(float x, float y) const;
+  static uint64_t Key(int32_t column, int32_t row);
+
+  float cellSize;
+  unordered_map<uint64_t, vector<uint32_t>> cells;
+  unordered_map<uint32_t, uint64_t> cellOf; //cell key of each id
+};
+
+#endif // SPATIALHASH_H
@@ -0,0 +1,131 @@
+#include "StartupGate.h"
+
+#include <algorithm> // For max
+#include <cmath> // For sqrt
+#include <sstream>
+
+StartupGate::StartupGate()
+{
+  for (int i = 0; i < STARTUP_STAGE_COUNT; i++)
+  {
+    stageLeft[i] = -1;
+  }
+}
+
+void StartupGate::Start(long int time)
+{
+  startTime = time;
+}
+
+void StartupGate::SetPoseCovariance(float varianceX, float varianceY)
+{
+  positionDeviation = sqrt(max(varianceX, varianceY));
+}
+
+void StartupGate::SetCenterSamples(int count, float uncertainty)
+{
+  centerSamples = count;
+  centerUncertainty = uncertainty;
+}
+
+void StartupGate::SkipCenterAndRole()
+{
+  skipped = true;
+}
+
+bool StartupGate::Update(long int time)
+{
+  if (stage == STARTUP_READY || startTime < 0)
+  {
+    return false;
+  }
+
+  while (stage != STARTUP_READY && IsMet(stage))
+  {
+    stageLeft[stage] = time;
+    stage = (Stage)(stage + 1);
+  }
+
+  if (stage != STARTUP_READY && time - startTime > maxWait)
+  {
+    timedOut = true;
+    stage = STARTUP_READY;
+  }
+
+  if (stage == STARTUP_READY)
+  {
+    readyTime = time;
+    return true;
+  }
+  return false;
+}
+
+bool StartupGate::IsMet(Stage stage) const
+{
+  switch (stage)
+  {
+  case STARTUP_WAITING_FOR_POSE:
+    return positionDeviation >= 0 && positionDeviation < maxPositionDeviation;
+  case STARTUP_SAMPLING_CENTER:
+    return skipped || (centerSamples >= minCenterSamples && centerUncertainty >= 0 && centerUncertainty < maxCenterUncertainty);
+  case STARTUP_WAITING_FOR_TF:
+    return transformAvailable;
+  case STARTUP_WAITING_FOR_ROLE:
+    return skipped || role >= 0;
+  default:
+    return true;
+  }
+}
+
+void StartupGate::Moved(long int time)
+{
+  if (motionTime < 0 && stage == STARTUP_READY)
+  {
+    motionTime = time;
+  }
+}
+
+string StartupGate::Describe() const
+{
+  stringstream ss;
+  for (int i = 0; i < STARTUP_READY; i++)
+  {
+    ss << GetStageName((Stage)i) << " ";
+    if (stageLeft[i] >= 0)
+    {
+      ss << stageLeft[i] - startTime << " ms";
+    }
+    else
+    {
+      ss << "not met";
+    }
+    ss << ", ";
+  }
+  if (timedOut)
+  {
+    ss << "gave up after " << maxWait << " ms, ";
+  }
+  if (skipped)
+  {
+    ss << "center and role restored, ";
+  }
+  ss << "ready " << GetTimeToReady() << " ms";
+  if (motionTime >= 0)
+  {
+    ss << ", first motion " << GetTimeToMotion() << " ms";
+  }
+  return ss.str();
+}
+
+const char* StartupGate::GetStageName(Stage stage)
+{
+  switch (stage)
+  {
+  case STARTUP_WAITING_FOR_POSE: return "pose";
+  case STARTUP_SAMPLING_CENTER: return "center";
+  case STARTUP_WAITING_FOR_TF: return "tf";
+  case STARTUP_WAITING_FOR_ROLE: return "role";
+  case STARTUP_READY: return "ready";
+  default: return "unknown";
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef STARTUPGATE_H
+#define STARTUPGATE_H
+
+#include <string>
+
+using namespace std;
+
+// Decides when a booting rover is ready to leave the start and search,
+// from what the node actually knows instead of a fixed delay.
+//
+// The rover waits, in order, for the EKF pose to converge, for enough
+// samples of the nest center taken from the converged pose to average out
+// the GPS noise, for the transforms between the camera and odom frames and
+// for a role from the membership. Each step is left as soon as it is met,
+// later ones that are already met are passed on the same tick. A step that
+// never comes, a GPS that does not converge indoors or a lone rover that
+// gets no heartbeats, does not keep the rover waiting past maxWait, it
+// starts with what it has and the log says what was missing.
+//
+// A rover that restores its state after a restart already has its center
+// and role, those steps are skipped.
+//
+// Times are ROS time in milliseconds, so the gate follows the simulation
+// speed.
+class StartupGate
+{
+public:
+  enum Stage {
+    STARTUP_WAITING_FOR_POSE = 0,
+    STARTUP_SAMPLING_CENTER,
+    STARTUP_WAITING_FOR_TF,
+    STARTUP_WAITING_FOR_ROLE,
+    STARTUP_READY,
+    STARTUP_STAGE_COUNT
+  };
+
+  StartupGate();
+
+  // Time the node came up, the wait and the time to motion count from it.
+  void Start(long int time);
+  bool IsStarted() const {return startTime >= 0;}
+
+  // Position variances of the latest EKF pose, in square meters.
+  void SetPoseCovariance(float varianceX, float varianceY);
+  // Center samples so far and the standard error of their mean.
+  void SetCenterSamples(int count, float uncertainty);
+  void SetTransformAvailable(bool available) {transformAvailable = available;}
+  // Slot of this rover in the membership, -1 until it has one.
+  void SetRole(int role) {this->role = role;}
+
+  // The center and the role came from a snapshot.
+  void SkipCenterAndRole();
+
+  // Center samples only count once the pose has converged.
+  bool ShouldSampleCenter() const {return stage > STARTUP_WAITING_FOR_POSE;}
+
+  // Moves through the stages that are met. Returns true once, on the tick
+  // the rover becomes ready or gives up waiting.
+  bool Update(long int time);
+  bool IsReady() const {return stage == STARTUP_READY;}
+  Stage GetStage() const {return stage;}
+
+  // Called with every drive command, notes the first one that moves.
+  void Moved(long int time);
+  // Milliseconds from Start() to ready and to the first motion, -1 before.
+  long int GetTimeToReady() const {return readyTime < 0 ? -1 : readyTime - startTime;}
+  long int GetTimeToMotion() const {return motionTime < 0 ? -1 : motionTime - startTime;}
+
+  // Milliseconds from Start() each stage was left, and what was missing
+  // when the rover gave up waiting, for the log.
+  string Describe() const;
+
+  static const char* GetStageName(Stage stage);
+
+  const float maxPositionDeviation = 0.5; //meters, square root of the larger variance
+  const int minCenterSamples = 20; //two seconds of behaviour loop ticks
+  const float maxCenterUncertainty = 0.1; //meters, standard error of the center
+  const long int maxWait = 30000; //milliseconds, the old fixed start delay
+
+private:
+
+  bool IsMet(Stage stage) const;
+
+  Stage stage = STARTUP_WAITING_FOR_POSE;
+  long int startTime = -1;
+  long int readyTime = -1;
+  long int motionTime = -1;
+  long int stageLeft[STARTUP_STAGE_COUNT];
+  bool skipped = false;
+  bool timedOut = false;
+
+  float positionDeviation = -1;
+  int centerSamples = 0;
+  float centerUncertainty = -1;
+  bool transformAvailable = false;
+  int role = -1;
+};
+
+#endif // STARTUPGATE_H
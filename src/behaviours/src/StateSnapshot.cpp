@@ -0,0 +1,161 @@
+#include "StateSnapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring> // For memcpy, memset and strerror
+#include <iostream>
+
+StateSnapshot::StateSnapshot()
+{
+}
+
+StateSnapshot::~StateSnapshot()
+{
+  Close();
+}
+
+bool StateSnapshot::Open(const string& path)
+{
+  Close();
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+  {
+    cout << "SNAPSHOT - can't open " << path << ": " << strerror(errno) << endl;
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) < 0 || (status.st_size != sizeof(File) && ftruncate(fd, sizeof(File)) < 0))
+  {
+    cout << "SNAPSHOT - can't size " << path << ": " << strerror(errno) << endl;
+    Close();
+    return false;
+  }
+
+  void* mapped = mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED)
+  {
+    cout << "SNAPSHOT - can't map " << path << ": " << strerror(errno) << endl;
+    Close();
+    return false;
+  }
+  file = (File*)mapped;
+
+  //a new file, or one written by another layout of the state
+  if (file->magic != magic || file->version != version || file->stateBytes != sizeof(RoverState))
+  {
+    memset(file, 0, sizeof(File));
+    file->magic = magic;
+    file->version = version;
+    file->stateBytes = sizeof(RoverState);
+  }
+  return true;
+}
+
+void StateSnapshot::Close()
+{
+  if (file != nullptr)
+  {
+    munmap(file, sizeof(File));
+    file = nullptr;
+  }
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+  }
+}
+
+void StateSnapshot::Save(const RoverState& state, bool sync)
+{
+  if (file == nullptr)
+  {
+    return;
+  }
+
+  //overwrite the older slot, the newer one stays valid until this is done
+  int newest = Newest();
+  Slot& slot = file->slots[newest < 0 ? 0 : 1 - newest];
+  memcpy(&slot.state, &state, sizeof(RoverState));
+  slot.generation = newest < 0 ? 1 : file->slots[newest].generation + 1;
+  slot.crc = Checksum(slot);
+
+  if (sync)
+  {
+    msync(file, sizeof(File), MS_ASYNC);
+  }
+}
+
+bool StateSnapshot::Load(RoverState& state) const
+{
+  int newest = Newest();
+  if (newest < 0)
+  {
+    return false;
+  }
+  memcpy(&state, &file->slots[newest].state, sizeof(RoverState));
+  return true;
+}
+
+int StateSnapshot::Newest() const
+{
+  if (file == nullptr)
+  {
+    return -1;
+  }
+
+  int newest = -1;
+  for (int i = 0; i < 2; i++)
+  {
+    const Slot& slot = file->slots[i];
+    if (slot.generation == 0 || slot.crc != Checksum(slot))
+    {
+      continue;
+    }
+    if (newest < 0 || slot.generation > file->slots[newest].generation)
+    {
+      newest = i;
+    }
+  }
+  return newest;
+}
+
+uint32_t StateSnapshot::Checksum(const Slot& slot)
+{
+  uint8_t bytes[sizeof(uint64_t) + sizeof(RoverState)];
+  memcpy(bytes, &slot.generation, sizeof(uint64_t));
+  memcpy(bytes + sizeof(uint64_t), &slot.state, sizeof(RoverState));
+  return Crc32(bytes, sizeof(bytes));
+}
+
+// CRC-32 as in zlib and ethernet, a byte at a time from a table
+uint32_t StateSnapshot::Crc32(const uint8_t* data, int length)
+{
+  static uint32_t table[256];
+  static bool filled = false;
+  if (!filled)
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++)
+      {
+        value = value & 1 ? 0xedb88320 ^ value >> 1 : value >> 1;
+      }
+      table[i] = value;
+    }
+    filled = true;
+  }
+
+  uint32_t crc = 0xffffffff;
+  for (int i = 0; i < length; i++)
+  {
+    crc = table[(crc ^ data[i]) & 0xff] ^ crc >> 8;
+  }
+  return crc ^ 0xffffffff;
+}
@@ -0,0 +1,88 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+
+#include "Point.h"
+
+using namespace std;
+
+// What a rover needs to go back to work after the behaviours node restarts,
+// without waiting out the start delay again. Fixed size and plain so it can
+// be copied into the snapshot file as it is.
+struct RoverState {
+  int64_t savedTime; //ROS time in milliseconds
+  int64_t runTime; //milliseconds since the rover started working
+
+  Point centerLocationMap; //nest on the map, 1.3 m in front of the start pose
+  Point centerLocation; //average of the center samples
+  double centerM2; //sum of squared differences of the center samples
+  int32_t centerSamples;
+
+  int32_t role; //-1 if the membership had not given one yet
+  uint32_t epoch;
+  int32_t processState;
+};
+
+// Keeps the latest RoverState in a small memory mapped file that survives
+// the process.
+//
+// The file holds two slots. Save() writes the state into the older slot,
+// with a generation one higher than the newer one and a CRC32 over both,
+// so a crash halfway through a save leaves the previous state intact.
+// Load() takes the newest slot whose checksum matches. Saves only touch
+// the mapped page, the kernel writes it back on its own and msync() with
+// MS_ASYNC just asks for it to happen soon, so a save costs a copy and a
+// checksum of a few dozen bytes. A crash of the process loses nothing, a
+// power cut loses at most what the kernel had not written back yet.
+class StateSnapshot
+{
+public:
+  StateSnapshot();
+  ~StateSnapshot();
+
+  // Creates the file if it does not exist. Returns false and leaves the
+  // snapshot closed if it can't be opened or mapped.
+  bool Open(const string& path);
+  void Close();
+  bool IsOpen() const {return file != nullptr;}
+
+  // When sync is false the page is only written to, for the bench.
+  void Save(const RoverState& state, bool sync = true);
+
+  // False if neither slot holds a state with a matching checksum.
+  bool Load(RoverState& state) const;
+
+  static uint32_t Crc32(const uint8_t* data, int length);
+
+private:
+
+  struct Slot {
+    uint64_t generation;
+    uint32_t crc; //over the generation and the state
+    uint32_t spare;
+    RoverState state;
+  };
+
+  // A file with another magic, version or state size is started over.
+  struct File {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stateBytes;
+    uint32_t spare;
+    Slot slots[2];
+  };
+
+  static uint32_t Checksum(const Slot& slot);
+  // Index of the newest valid slot, -1 if there is none.
+  int Newest() const;
+
+  static const uint32_t magic = 0x53574d53; //"SMWS" little endian
+  static const uint32_t version = 1;
+
+  int fd = -1;
+  File* file = nullptr;
+};
+
+#endif // STATESNAPSHOT_H
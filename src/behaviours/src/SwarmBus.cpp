@@ -0,0 +1,184 @@
+#include "SwarmBus.h"
+
+#include <algorithm> // For min and max
+#include <cmath> // For round
+
+SwarmBus::SwarmBus(uint32_t sender, float budget, float burst)
+  : sender(sender), incarnation(random_device()()), budget(budget), burst(burst), tokens(burst)
+{
+}
+
+// FNV-1a, names are short and only a couple of dozen need to differ
+uint32_t SwarmBus::NameHash(const string& name)
+{
+  uint32_t hash = 2166136261u;
+  for (char c : name)
+  {
+    hash ^= (uint8_t)c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+SwarmReport SwarmBus::Quantize(uint8_t type, Point location, int value) const
+{
+  SwarmReport report;
+  report.type = type;
+  report.x = (int16_t)max(-32767.0f, min(32767.0f, roundf(location.x * 100)));
+  report.y = (int16_t)max(-32767.0f, min(32767.0f, roundf(location.y * 100)));
+  report.heading = (int8_t)((int)lroundf(location.theta * 128 / M_PI) & 0xff);
+  report.value = (uint8_t)max(0, min(255, value));
+  return report;
+}
+
+void SwarmBus::Queue(const SwarmReport& report)
+{
+  if ((int)queued.size() >= maxQueuedReports)
+  {
+    queued.pop_front();
+    reportsDropped++;
+  }
+  queued.push_back(report);
+}
+
+void SwarmBus::ReportPose(Point pose, float speed)
+{
+  //only the newest pose is worth sending
+  this->pose = Quantize(SwarmReport::POSE, pose, lroundf(speed * 100) + 128);
+  hasPose = true;
+}
+
+void SwarmBus::ReportResource(Point location, int count)
+{
+  Queue(Quantize(SwarmReport::RESOURCE, location, count));
+}
+
+void SwarmBus::ReportObstacle(Point location, float radius)
+{
+  Queue(Quantize(SwarmReport::OBSTACLE, location, lroundf(radius / 0.05)));
+}
+
+void SwarmBus::ReportRole(int role)
+{
+  Point nowhere = {0, 0, 0};
+  Queue(Quantize(SwarmReport::ROLE, nowhere, role));
+}
+
+void SwarmBus::ReportBid(Point task, int bid)
+{
+  task.theta = 0;
+  Queue(Quantize(SwarmReport::BID, task, bid));
+}
+
+void SwarmBus::ReportReservation(Point entry, int start)
+{
+  entry.theta = 0;
+  Queue(Quantize(SwarmReport::RESERVATION, entry, start));
+}
+
+bool SwarmBus::Flush(long int time, SwarmPacket& packet)
+{
+  if (lastRefill >= 0)
+  {
+    tokens = min(burst, tokens + budget * (time - lastRefill) / 1e3f);
+  }
+  lastRefill = time;
+
+  if (lastFlush >= 0 && time - lastFlush < flushInterval)
+  {
+    return false;
+  }
+
+  if (queued.empty() && !hasPose)
+  {
+    return false;
+  }
+
+  //as many queued reports as the budget allows, the pose goes last since
+  //a newer one is always coming
+  int reports = min((int)queued.size() + (hasPose ? 1 : 0), maxReportsPerPacket);
+  while (reports > 0 && PacketBytes(reports) > tokens)
+  {
+    reports--;
+  }
+
+  if (reports == 0)
+  {
+    return false;
+  }
+
+  packet.sender = sender;
+  packet.seq = seq++;
+  packet.incarnation = incarnation;
+  packet.reports.clear();
+
+  while ((int)packet.reports.size() < reports && !queued.empty())
+  {
+    packet.reports.push_back(queued.front());
+    queued.pop_front();
+  }
+
+  if ((int)packet.reports.size() < reports && hasPose)
+  {
+    packet.reports.push_back(pose);
+    hasPose = false;
+  }
+
+  int bytes = PacketBytes(packet.reports.size());
+  tokens -= bytes;
+  bytesSent += bytes;
+  packetsSent++;
+  lastFlush = time;
+  return true;
+}
+
+bool SwarmBus::Receive(const SwarmPacket& packet, vector<SwarmState>& states)
+{
+  if (packet.sender == sender)
+  {
+    return false;
+  }
+
+  auto previous = last.find(packet.sender);
+  if (previous != last.end() && previous->second.incarnation != packet.incarnation)
+  {
+    //the sender restarted and counts from zero again
+    restarts++;
+  }
+  else if (previous != last.end())
+  {
+    //difference modulo 2^16 so the sequence numbers can wrap
+    int16_t ahead = (int16_t)(packet.seq - previous->second.seq);
+    if (ahead <= 0)
+    {
+      return false;
+    }
+    packetsLost += ahead - 1;
+  }
+  last[packet.sender] = Received{packet.incarnation, packet.seq};
+
+  for (const SwarmReport& report : packet.reports)
+  {
+    SwarmState state;
+    state.sender = packet.sender;
+    state.type = report.type;
+    state.location.x = report.x / 100.0f;
+    state.location.y = report.y / 100.0f;
+    state.location.theta = report.heading * M_PI / 128;
+    state.value = report.value;
+
+    if (report.type == SwarmReport::POSE)
+    {
+      //forward speed in centimeters per second
+      state.value = report.value - 128;
+    }
+    else if (report.type == SwarmReport::OBSTACLE)
+    {
+      //radius in centimeters
+      state.value = report.value * 5;
+    }
+    states.push_back(state);
+  }
+
+  return true;
+}
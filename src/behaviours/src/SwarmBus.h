@@ -0,0 +1,142 @@
+#ifndef SWARMBUS_H
+#define SWARMBUS_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Plain copies of swarmie_msgs/SwarmReport and SwarmPacket so the bus can
+// be used and benchmarked without ROS. The ROSAdapter copies them to and
+// from the messages field by field.
+struct SwarmReport {
+  enum Type : uint8_t {
+    POSE = 0,
+    RESOURCE = 1,
+    OBSTACLE = 2,
+    ROLE = 3,
+    BID = 4,
+    RESERVATION = 5
+  };
+
+  uint8_t type = POSE;
+  int16_t x = 0; //centimeters from the nest
+  int16_t y = 0;
+  int8_t heading = 0; //pi/128 radians
+  uint8_t value = 0; //speed in cm/s plus 128, cubes seen, obstacle radius in 5 cm units, role id, bid or nest second
+};
+
+struct SwarmPacket {
+  uint32_t sender = 0;
+  uint16_t seq = 0;
+  uint8_t incarnation = 0;
+  vector<SwarmReport> reports;
+};
+
+// A report decoded back into meters and radians.
+struct SwarmState {
+  uint32_t sender;
+  uint8_t type;
+  Point location; //map frame relative to the nest
+  int value; //speed in cm/s, cubes seen, obstacle radius in centimeters, role id, bid or nest second
+};
+
+// Batches the swarm reports of one rover into packets under a bandwidth
+// budget, and checks the packets received from the other rovers.
+//
+// Reports are quantized when they are queued. Pose beacons replace the
+// pending pose so only the newest is sent, the other reports wait in a
+// bounded queue. Flush() builds at most one packet per flush interval and
+// only if the token bucket holds enough bytes for it. The bucket refills
+// at the budget rate up to the burst size, so a rover can never use more
+// than its share of the radio whatever the behaviours report. Received
+// packets are dropped if they are from this rover or are not newer than
+// the last packet from their sender, skipped sequence numbers are counted
+// as lost. Packets also carry a byte picked at random when the bus is
+// created, a sender that restarts counts from zero again under a new one
+// and is followed from its first packet on. One restart in 256 picks the
+// same byte again, its packets are then only taken once they pass the
+// sequence number it had reached.
+class SwarmBus
+{
+public:
+  SwarmBus(uint32_t sender, float budget = 400, float burst = 800);
+
+  void ReportPose(Point pose, float speed = 0); //forward speed in m/s
+  void ReportResource(Point location, int count);
+  void ReportObstacle(Point location, float radius);
+  void ReportRole(int role);
+  void ReportBid(Point task, int bid); //0 releases the task
+  void ReportReservation(Point entry, int start); //an entry at the nest releases it
+
+  // Builds the next packet if one is due, there is something to send and
+  // the budget allows. Returns false otherwise.
+  bool Flush(long int time, SwarmPacket& packet);
+
+  // Decodes a packet from another rover. Returns false if it is from this
+  // rover, a duplicate or older than the last one from the same run of its
+  // sender.
+  bool Receive(const SwarmPacket& packet, vector<SwarmState>& states);
+
+  // Bytes on the wire for a packet with the given number of reports, the
+  // serialized message plus the ROS and TCP/IP framing.
+  static int PacketBytes(int reports) {return packetHeaderBytes + reportBytes * reports + transportBytes;}
+
+  static uint32_t NameHash(const string& name);
+
+  static const int reportBytes = 7;
+  static const int packetHeaderBytes = 11; //sender, seq, incarnation and the array length
+  static const int transportBytes = 44; //TCPROS length prefix and TCP/IP headers
+
+  long int GetBytesSent() const {return bytesSent;}
+  int GetPacketsSent() const {return packetsSent;}
+  int GetReportsDropped() const {return reportsDropped;}
+  int GetPacketsLost() const {return packetsLost;}
+  int GetRestarts() const {return restarts;}
+
+private:
+
+  // The last packet received from a sender.
+  struct Received {
+    uint8_t incarnation;
+    uint16_t seq;
+  };
+
+  SwarmReport Quantize(uint8_t type, Point location, int value) const;
+  void Queue(const SwarmReport& report);
+
+  const long int flushInterval = 200; //milliseconds, the pose beacon goes out at 5 Hz
+  const int maxReportsPerPacket = 16;
+  const int maxQueuedReports = 32; //oldest reports are dropped beyond this
+
+  uint32_t sender;
+  uint16_t seq = 0;
+  uint8_t incarnation; //random, new every time the bus is created
+
+  //token bucket in bytes
+  float budget; //bytes per second
+  float burst;
+  float tokens;
+  long int lastRefill = -1;
+  long int lastFlush = -1;
+
+  bool hasPose = false;
+  SwarmReport pose;
+  deque<SwarmReport> queued;
+
+  map<uint32_t, Received> last; //by sender
+
+  long int bytesSent = 0;
+  int packetsSent = 0;
+  int reportsDropped = 0;
+  int packetsLost = 0;
+  int restarts = 0;
+};
+
+#endif // SWARMBUS_H
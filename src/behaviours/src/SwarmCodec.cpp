@@ -0,0 +1,167 @@
+#include "SwarmCodec.h"
+
+#include <algorithm> // For min
+
+int SwarmCodec::Encode(const SwarmPacket& packet, uint8_t* buffer, int capacity)
+{
+  Writer writer(buffer, capacity);
+  writer.Put(packet.sender, 4);
+  writer.Put(packet.seq, 2);
+  writer.Put(packet.incarnation, 1);
+  writer.Put(packet.reports.size(), 1);
+  for (const SwarmReport& report : packet.reports)
+  {
+    writer.Put(report.type, 1);
+    writer.Put((uint16_t)report.x, 2);
+    writer.Put((uint16_t)report.y, 2);
+    writer.Put((uint8_t)report.heading, 1);
+    writer.Put(report.value, 1);
+  }
+  return writer.Length();
+}
+
+int SwarmCodec::Encode(const SwarmHeartbeat& heartbeat, uint8_t* buffer, int capacity)
+{
+  Writer writer(buffer, capacity);
+  writer.Put(heartbeat.name);
+  writer.Put(heartbeat.joined, 1);
+  writer.Put(heartbeat.epoch, 4);
+  writer.Put(heartbeat.roles.size(), 1);
+  for (const string& role : heartbeat.roles)
+  {
+    writer.Put(role);
+  }
+  return writer.Length();
+}
+
+int SwarmCodec::Encode(const vector<ResourceEntry>& delta, int first, int& count, uint8_t* buffer, int capacity)
+{
+  count = max(0, min((int)delta.size() - first, min(255, (capacity - 1) / resourceEntryBytes)));
+
+  Writer writer(buffer, capacity);
+  writer.Put(count, 1);
+  for (int i = first; i < first + count; i++)
+  {
+    const ResourceEntry& entry = delta[i];
+    writer.Put((uint16_t)entry.cellX, 2);
+    writer.Put((uint16_t)entry.cellY, 2);
+    writer.Put(entry.remaining, 1);
+    writer.Put(entry.countClock, 4);
+    writer.Put(entry.countNode, 4);
+    writer.Put(entry.owner, 4);
+    writer.Put(entry.claimClock, 4);
+    writer.Put(entry.claimNode, 4);
+  }
+  return writer.Length();
+}
+
+bool SwarmCodec::Decode(const uint8_t* buffer, int length, SwarmPacket& packet)
+{
+  Reader reader(buffer, length);
+  packet.sender = reader.Get(4);
+  packet.seq = reader.Get(2);
+  packet.incarnation = reader.Get(1);
+  int count = reader.Get(1);
+
+  packet.reports.resize(count);
+  for (SwarmReport& report : packet.reports)
+  {
+    report.type = reader.Get(1);
+    report.x = (int16_t)reader.Get(2);
+    report.y = (int16_t)reader.Get(2);
+    report.heading = (int8_t)reader.Get(1);
+    report.value = reader.Get(1);
+  }
+  return reader.Ok();
+}
+
+bool SwarmCodec::Decode(const uint8_t* buffer, int length, SwarmHeartbeat& heartbeat)
+{
+  Reader reader(buffer, length);
+  heartbeat.name = reader.GetString();
+  heartbeat.joined = reader.Get(1);
+  heartbeat.epoch = reader.Get(4);
+  int count = reader.Get(1);
+
+  heartbeat.roles.resize(count);
+  for (string& role : heartbeat.roles)
+  {
+    role = reader.GetString();
+  }
+  return reader.Ok();
+}
+
+bool SwarmCodec::Decode(const uint8_t* buffer, int length, vector<ResourceEntry>& delta)
+{
+  Reader reader(buffer, length);
+  int count = reader.Get(1);
+
+  delta.resize(count);
+  for (ResourceEntry& entry : delta)
+  {
+    entry.cellX = (int16_t)reader.Get(2);
+    entry.cellY = (int16_t)reader.Get(2);
+    entry.remaining = reader.Get(1);
+    entry.countClock = reader.Get(4);
+    entry.countNode = reader.Get(4);
+    entry.owner = reader.Get(4);
+    entry.claimClock = reader.Get(4);
+    entry.claimNode = reader.Get(4);
+  }
+  return reader.Ok();
+}
+
+void SwarmCodec::Writer::Put(uint32_t value, int bytes)
+{
+  if (length + bytes > capacity)
+  {
+    overflowed = true;
+    return;
+  }
+  for (int i = 0; i < bytes; i++)
+  {
+    buffer[length++] = value >> (8 * i) & 0xff;
+  }
+}
+
+void SwarmCodec::Writer::Put(const string& text)
+{
+  //names are short, longer ones are cut
+  int size = min((int)text.size(), 255);
+  Put(size, 1);
+  if (length + size > capacity)
+  {
+    overflowed = true;
+    return;
+  }
+  copy(text.begin(), text.begin() + size, buffer + length);
+  length += size;
+}
+
+uint32_t SwarmCodec::Reader::Get(int bytes)
+{
+  if (position + bytes > length)
+  {
+    truncated = true;
+    return 0;
+  }
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++)
+  {
+    value |= (uint32_t)buffer[position++] << (8 * i);
+  }
+  return value;
+}
+
+string SwarmCodec::Reader::GetString()
+{
+  int size = Get(1);
+  if (position + size > length)
+  {
+    truncated = true;
+    return "";
+  }
+  string text((const char*)buffer + position, size);
+  position += size;
+  return text;
+}
@@ -0,0 +1,75 @@
+#ifndef SWARMCODEC_H
+#define SWARMCODEC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ResourceRegistry.h"
+#include "SwarmBus.h"
+#include "SwarmMembership.h"
+
+using namespace std;
+
+// Channels the swarm messages go out on over the swarm transport.
+enum SwarmChannel : uint8_t {
+  SWARM_CHANNEL_PACKET = 0,
+  SWARM_CHANNEL_HEARTBEAT = 1,
+  SWARM_CHANNEL_RESOURCES = 2
+};
+
+// Packs the swarm messages into datagrams for the swarm transport, in the
+// same fields as the swarmie_msgs messages, little endian. The sender of
+// a resource delta is the sender of the datagram.
+class SwarmCodec
+{
+public:
+
+  // Return the bytes written, or -1 if the buffer is too small.
+  static int Encode(const SwarmPacket& packet, uint8_t* buffer, int capacity);
+  static int Encode(const SwarmHeartbeat& heartbeat, uint8_t* buffer, int capacity);
+
+  // Encodes as many entries from first on as fit, count is set to how many.
+  static int Encode(const vector<ResourceEntry>& delta, int first, int& count, uint8_t* buffer, int capacity);
+
+  // Return false if the buffer is truncated.
+  static bool Decode(const uint8_t* buffer, int length, SwarmPacket& packet);
+  static bool Decode(const uint8_t* buffer, int length, SwarmHeartbeat& heartbeat);
+  static bool Decode(const uint8_t* buffer, int length, vector<ResourceEntry>& delta);
+
+  static const int resourceEntryBytes = 23;
+
+private:
+
+  class Writer
+  {
+  public:
+    Writer(uint8_t* buffer, int capacity) : buffer(buffer), capacity(capacity) {}
+    void Put(uint32_t value, int bytes);
+    void Put(const string& text);
+    int Length() const {return overflowed ? -1 : length;}
+
+  private:
+    uint8_t* buffer;
+    int capacity;
+    int length = 0;
+    bool overflowed = false;
+  };
+
+  class Reader
+  {
+  public:
+    Reader(const uint8_t* buffer, int length) : buffer(buffer), length(length) {}
+    uint32_t Get(int bytes);
+    string GetString();
+    bool Ok() const {return !truncated;}
+
+  private:
+    const uint8_t* buffer;
+    int length;
+    int position = 0;
+    bool truncated = false;
+  };
+};
+
+#endif // SWARMCODEC_H
@@ -0,0 +1,139 @@
+#include "SwarmMembership.h"
+
+#include <algorithm> // For find and max
+
+SwarmMembership::SwarmMembership(string name)
+  : name(name)
+{
+}
+
+void SwarmMembership::Receive(const SwarmHeartbeat& heartbeat, long int time)
+{
+  if (heartbeat.name == name)
+  {
+    return;
+  }
+
+  if (members.count(heartbeat.name) == 0)
+  {
+    lastChange = time;
+  }
+  members[heartbeat.name] = {time, heartbeat.joined};
+
+  //only the leader's assignment counts, a newer one or the first one from
+  //a leader that just took over
+  if (!heartbeat.roles.empty() && heartbeat.name == GetLeader()
+      && (heartbeat.epoch > epoch || heartbeat.name != assignedBy))
+  {
+    assignment = heartbeat.roles;
+    epoch = heartbeat.epoch;
+    assignedBy = heartbeat.name;
+  }
+}
+
+bool SwarmMembership::Update(long int time, SwarmHeartbeat& heartbeat)
+{
+  if (startTime < 0)
+  {
+    startTime = time;
+    lastChange = time;
+  }
+  members[name] = {time, time - startTime >= joinTime};
+
+  for (auto member = members.begin(); member != members.end(); )
+  {
+    if (time - member->second.lastHeard > failureTimeout)
+    {
+      member = members.erase(member);
+      lastChange = time;
+    }
+    else
+    {
+      member++;
+    }
+  }
+
+  if (IsLeader())
+  {
+    Rebalance();
+  }
+
+  if (!heartbeatDue && lastHeartbeat >= 0 && time - lastHeartbeat < heartbeatInterval)
+  {
+    return false;
+  }
+
+  heartbeat.name = name;
+  heartbeat.joined = members[name].joined;
+  heartbeat.epoch = epoch;
+  heartbeat.roles.clear();
+  if (IsLeader())
+  {
+    heartbeat.roles = assignment;
+  }
+
+  heartbeatDue = false;
+  lastHeartbeat = time;
+  return true;
+}
+
+string SwarmMembership::GetLeader() const
+{
+  for (const auto& member : members)
+  {
+    if (member.second.joined)
+    {
+      return member.first;
+    }
+  }
+  return "";
+}
+
+int SwarmMembership::GetRole() const
+{
+  auto slot = find(assignment.begin(), assignment.end(), name);
+  return slot == assignment.end() ? -1 : slot - assignment.begin();
+}
+
+void SwarmMembership::Rebalance()
+{
+  vector<string> roles = assignment;
+
+  //fill the slot of each rover that left from the end so the more
+  //important roles stay taken and only one other rover changes role
+  for (int slot = 0; slot < (int)roles.size(); slot++)
+  {
+    if (members.count(roles[slot]) > 0)
+    {
+      continue;
+    }
+
+    while (!roles.empty() && members.count(roles.back()) == 0 && (int)roles.size() - 1 > slot)
+    {
+      roles.pop_back();
+    }
+
+    if ((int)roles.size() - 1 > slot)
+    {
+      roles[slot] = roles.back();
+    }
+    roles.pop_back();
+  }
+
+  //new rovers take the last slots in name order
+  for (const auto& member : members)
+  {
+    if (find(roles.begin(), roles.end(), member.first) == roles.end())
+    {
+      roles.push_back(member.first);
+    }
+  }
+
+  if (roles != assignment || assignedBy != name)
+  {
+    assignment = roles;
+    epoch++;
+    assignedBy = name;
+    heartbeatDue = true;
+  }
+}
@@ -0,0 +1,88 @@
+#ifndef SWARMMEMBERSHIP_H
+#define SWARMMEMBERSHIP_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Plain copy of swarmie_msgs/SwarmHeartbeat so the membership can be used
+// and benchmarked without ROS.
+struct SwarmHeartbeat {
+  string name;
+  bool joined = false; //listened long enough to know the assignment
+  uint32_t epoch = 0; //version of the role assignment
+  vector<string> roles; //names in role order, only sent by the leader
+};
+
+// Which rovers are in the swarm, who leads it and the role of each rover.
+//
+// Every rover sends a heartbeat each second, a rover that has not been
+// heard from for a few heartbeats is taken to have failed. The leader is
+// the live rover with the lowest name so every rover agrees on it without
+// an election as soon as their views agree. Only the leader changes the
+// role assignment and it sends the assignment in its heartbeats, the other
+// rovers adopt it. A rover that just started only listens for a few
+// heartbeats before it counts as joined and can lead, so a rover that
+// reboots learns the assignment instead of replacing it.
+//
+// Roles are slots 0 to n-1 in order of importance. When a rover leaves,
+// the rover in the last slot moves into its slot, and a rover that joins
+// takes a new last slot, so each change moves at most one other rover. A
+// rover that reboots before it is declared failed keeps its slot.
+// Membership lookups are in a map sorted by name, so the leader is its
+// first joined entry.
+class SwarmMembership
+{
+public:
+  SwarmMembership(string name);
+
+  void Receive(const SwarmHeartbeat& heartbeat, long int time);
+
+  // Drops the rovers that went silent and rebalances the roles if this
+  // rover leads. Fills the heartbeat and returns true when one is due.
+  bool Update(long int time, SwarmHeartbeat& heartbeat);
+
+  // Lowest joined name, empty until some rover has joined.
+  string GetLeader() const;
+  bool IsLeader() const {return GetLeader() == name;}
+
+  // Slot of this rover in the assignment, -1 until it has one.
+  int GetRole() const;
+  int GetSwarmSize() const {return members.size();}
+  const vector<string>& GetAssignment() const {return assignment;}
+  uint32_t GetEpoch() const {return epoch;}
+
+  // Time the set of live rovers last changed as seen by this rover.
+  long int GetLastChangeTime() const {return lastChange;}
+
+private:
+
+  void Rebalance();
+
+  static const long int heartbeatInterval = 1000; //milliseconds
+  static const long int failureTimeout = 3500; //milliseconds, three missed heartbeats
+  //a new rover listens this long before it leads, so it learns the
+  //current assignment instead of starting a new one
+  static const long int joinTime = failureTimeout;
+
+  string name;
+  long int startTime = -1;
+  long int lastHeartbeat = -1;
+  long int lastChange = 0;
+  bool heartbeatDue = false; //the assignment changed, send it right away
+
+  struct Member {
+    long int lastHeard;
+    bool joined;
+  };
+  map<string, Member> members; //live rovers by name, this one included
+
+  vector<string> assignment;
+  uint32_t epoch = 0;
+  string assignedBy; //the leader the assignment was adopted from
+};
+
+#endif // SWARMMEMBERSHIP_H
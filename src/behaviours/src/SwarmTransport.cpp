@@ -0,0 +1,398 @@
+#include "SwarmTransport.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm> // For find_if, min and remove_if
+#include <cerrno>
+#include <cstring> // For memcpy, memset and strerror
+#include <iostream>
+
+SwarmTransport::SwarmTransport(uint32_t node) : uniform(0.0, 1.0)
+{
+  this->node = node;
+  incarnation = random_device()();
+  memset(reliable, 0, sizeof(reliable));
+  memset(nextSeq, 0, sizeof(nextSeq));
+  memset(&destination, 0, sizeof(destination));
+}
+
+SwarmTransport::~SwarmTransport()
+{
+  Close();
+}
+
+bool SwarmTransport::Open(const string& group, uint16_t port, const string& interfaceAddress, int ttl)
+{
+  Close();
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0)
+  {
+    cout << "TRANSPORT - can't create a socket: " << strerror(errno) << endl;
+    return false;
+  }
+
+  //every rover on the host listens on the same port
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  ip_mreq membership;
+  membership.imr_multiaddr.s_addr = inet_addr(group.c_str());
+  membership.imr_interface.s_addr = interfaceAddress.empty() ? htonl(INADDR_ANY) : inet_addr(interfaceAddress.c_str());
+
+  //rovers simulated on one host hear each other through the loopback
+  unsigned char loop = 1;
+  unsigned char hops = ttl;
+
+  if (bind(fd, (sockaddr*)&local, sizeof(local)) < 0
+      || setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0
+      || (!interfaceAddress.empty() && setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &membership.imr_interface, sizeof(in_addr)) < 0)
+      || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0
+      || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) < 0
+      || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0)
+  {
+    cout << "TRANSPORT - can't join " << group << ":" << port << ": " << strerror(errno) << endl;
+    close(fd);
+    return false;
+  }
+
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(port);
+  destination.sin_addr = membership.imr_multiaddr;
+
+  sendBuffer.assign(maxDatagramBytes, 0);
+  history.assign(historySize * maxDatagramBytes, 0);
+  sent.assign(historySize, Sent{0, 0, 0});
+  receiveBuffers.assign(batchSize * maxDatagramBytes, 0);
+  nackBuffer.assign(maxDatagramBytes, 0);
+
+  socketFd = fd;
+  return true;
+}
+
+void SwarmTransport::Close()
+{
+  if (socketFd >= 0)
+  {
+    close(socketFd);
+    socketFd = -1;
+  }
+  peers.clear();
+}
+
+void SwarmTransport::SetReliable(uint8_t channel, bool reliable)
+{
+  this->reliable[channel] = reliable;
+}
+
+void SwarmTransport::SimulateLoss(float probability, unsigned int seed)
+{
+  lossProbability = probability;
+  lossGenerator.seed(seed);
+}
+
+bool SwarmTransport::Send(uint8_t channel, const uint8_t* data, int length)
+{
+  if (length > maxPayloadBytes || sendBuffer.empty())
+  {
+    return false;
+  }
+  memcpy(GetSendBuffer(), data, length);
+  return Send(channel, length);
+}
+
+bool SwarmTransport::Send(uint8_t channel, int length)
+{
+  if (socketFd < 0 || length > maxPayloadBytes)
+  {
+    return false;
+  }
+
+  Header header;
+  header.kind = DATA;
+  header.channel = channel;
+  header.reliable = reliable[channel];
+  header.retransmitted = false;
+  header.length = length;
+  header.sender = node;
+  header.seq = nextSeq[channel]++;
+  header.incarnation = incarnation;
+  WriteHeader(header, sendBuffer.data());
+
+  int datagramLength = headerBytes + length;
+  if (header.reliable)
+  {
+    //kept until enough newer datagrams push it out
+    memcpy(&history[nextSent * maxDatagramBytes], sendBuffer.data(), datagramLength);
+    sent[nextSent] = Sent{channel, header.seq, datagramLength};
+    nextSent = (nextSent + 1) % historySize;
+  }
+
+  return SendDatagram(sendBuffer.data(), datagramLength);
+}
+
+bool SwarmTransport::SendDatagram(const uint8_t* datagram, int length)
+{
+  if (sendto(socketFd, datagram, length, 0, (const sockaddr*)&destination, sizeof(destination)) != length)
+  {
+    return false;
+  }
+  datagramsSent++;
+  return true;
+}
+
+int SwarmTransport::Poll(long int time, const Handler& handler)
+{
+  if (socketFd < 0)
+  {
+    return 0;
+  }
+
+  mmsghdr messages[batchSize];
+  iovec vectors[batchSize];
+  for (int i = 0; i < batchSize; i++)
+  {
+    vectors[i].iov_base = &receiveBuffers[i * maxDatagramBytes];
+    vectors[i].iov_len = maxDatagramBytes;
+    memset(&messages[i].msg_hdr, 0, sizeof(msghdr));
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int delivered = 0;
+  int count = batchSize;
+  while (count == batchSize)
+  {
+    count = recvmmsg(socketFd, messages, batchSize, MSG_DONTWAIT, nullptr);
+    for (int i = 0; i < count; i++)
+    {
+      const uint8_t* datagram = &receiveBuffers[i * maxDatagramBytes];
+      Header header;
+      if (!ReadHeader(datagram, messages[i].msg_len, header) || header.sender == node)
+      {
+        continue;
+      }
+      if (lossProbability > 0 && uniform(lossGenerator) < lossProbability)
+      {
+        continue;
+      }
+
+      datagramsReceived++;
+      if (header.kind == NACK)
+      {
+        Answer(datagram + headerBytes, header.length);
+      }
+      else if (Accept(header, time))
+      {
+        SwarmDatagram received = {header.sender, header.channel, header.seq, header.retransmitted, datagram + headerBytes, header.length};
+        handler(received);
+        delivered++;
+      }
+    }
+  }
+
+  SendNacks(time);
+  return delivered;
+}
+
+bool SwarmTransport::Accept(const Header& header, long int time)
+{
+  Peer& peer = peers[(uint64_t)header.sender << 8 | header.channel];
+
+  if (!peer.started || peer.incarnation != header.incarnation)
+  {
+    //the first datagram, or the sender restarted and counts from zero again
+    restarts += peer.started;
+    peer.started = true;
+    peer.incarnation = header.incarnation;
+    peer.highest = header.seq;
+    peer.received = 1;
+    peer.missing.clear();
+    return true;
+  }
+
+  //difference modulo 2^32 so the sequence numbers can wrap
+  int32_t ahead = (int32_t)(header.seq - peer.highest);
+  if (ahead > 0)
+  {
+    if (header.reliable)
+    {
+      //only the newest gaps are worth asking for
+      for (uint32_t seq = header.seq - min(ahead - 1, maxMissing); seq != header.seq; seq++)
+      {
+        peer.missing.push_back(Missing{seq, time + nackDelay, 0});
+      }
+      lost += max(0, ahead - 1 - maxMissing);
+      if ((int)peer.missing.size() > maxMissing)
+      {
+        lost += peer.missing.size() - maxMissing;
+        peer.missing.erase(peer.missing.begin(), peer.missing.end() - maxMissing);
+      }
+    }
+
+    peer.received = ahead < 64 ? peer.received << ahead | 1 : 1;
+    peer.highest = header.seq;
+    return true;
+  }
+
+  //older than the newest, new only if it fills a gap
+  uint32_t behind = -ahead;
+  auto gap = find_if(peer.missing.begin(), peer.missing.end(), [&](const Missing& missing) {return missing.seq == header.seq;});
+  if (gap != peer.missing.end())
+  {
+    peer.missing.erase(gap);
+    recovered += header.retransmitted;
+  }
+  else if (behind >= 64 || (peer.received >> behind & 1))
+  {
+    duplicates++;
+    return false;
+  }
+
+  if (behind < 64)
+  {
+    peer.received |= (uint64_t)1 << behind;
+  }
+  return true;
+}
+
+void SwarmTransport::Answer(const uint8_t* payload, int length)
+{
+  //a NACK for an earlier incarnation asks for datagrams this one never sent
+  if (length < 10 || Read32(payload) != node || Read32(payload + 4) != incarnation)
+  {
+    return;
+  }
+
+  uint8_t channel = payload[8];
+  int count = min((int)payload[9], (length - 10) / 4);
+  for (int i = 0; i < count; i++)
+  {
+    uint32_t seq = Read32(payload + 10 + 4 * i);
+    for (int slot = 0; slot < historySize; slot++)
+    {
+      if (sent[slot].length > 0 && sent[slot].channel == channel && sent[slot].seq == seq)
+      {
+        uint8_t* datagram = &history[slot * maxDatagramBytes];
+        datagram[3] |= 2; //retransmitted
+        retransmissions += SendDatagram(datagram, sent[slot].length);
+        break;
+      }
+    }
+  }
+}
+
+void SwarmTransport::SendNacks(long int time)
+{
+  for (auto& entry : peers)
+  {
+    Peer& peer = entry.second;
+    if (peer.missing.empty())
+    {
+      continue;
+    }
+
+    uint8_t* payload = nackBuffer.data() + headerBytes;
+    int count = 0;
+    for (Missing& missing : peer.missing)
+    {
+      if (missing.nextNack > time || count == maxNackSeqs)
+      {
+        continue;
+      }
+      if (missing.nacks == maxNacks)
+      {
+        //asked often enough, the sender no longer has it or can't hear us
+        missing.nacks++;
+        continue;
+      }
+      Write32(missing.seq, payload + 10 + 4 * count);
+      count++;
+      missing.nacks++;
+      missing.nextNack = time + nackInterval;
+    }
+
+    auto given = remove_if(peer.missing.begin(), peer.missing.end(), [&](const Missing& missing) {return missing.nacks > maxNacks;});
+    lost += peer.missing.end() - given;
+    peer.missing.erase(given, peer.missing.end());
+
+    if (count == 0)
+    {
+      continue;
+    }
+
+    Header header;
+    header.kind = NACK;
+    header.channel = entry.first & 0xff;
+    header.reliable = false;
+    header.retransmitted = false;
+    header.length = 10 + 4 * count;
+    header.sender = node;
+    header.seq = 0;
+    header.incarnation = incarnation;
+    WriteHeader(header, nackBuffer.data());
+    Write32(entry.first >> 8, payload);
+    Write32(peer.incarnation, payload + 4);
+    payload[8] = header.channel;
+    payload[9] = count;
+
+    nacksSent += SendDatagram(nackBuffer.data(), headerBytes + header.length);
+  }
+}
+
+// magic, kind, channel, flags, payload length, two spare bytes, sender,
+// sequence number and incarnation, little endian
+void SwarmTransport::WriteHeader(const Header& header, uint8_t* buffer)
+{
+  buffer[0] = magic;
+  buffer[1] = header.kind;
+  buffer[2] = header.channel;
+  buffer[3] = (header.reliable ? 1 : 0) | (header.retransmitted ? 2 : 0);
+  buffer[4] = header.length & 0xff;
+  buffer[5] = header.length >> 8;
+  buffer[6] = 0;
+  buffer[7] = 0;
+  Write32(header.sender, buffer + 8);
+  Write32(header.seq, buffer + 12);
+  Write32(header.incarnation, buffer + 16);
+}
+
+bool SwarmTransport::ReadHeader(const uint8_t* buffer, int length, Header& header)
+{
+  if (length < headerBytes || buffer[0] != magic)
+  {
+    return false;
+  }
+
+  header.kind = buffer[1];
+  header.channel = buffer[2];
+  header.reliable = buffer[3] & 1;
+  header.retransmitted = buffer[3] & 2;
+  header.length = buffer[4] | buffer[5] << 8;
+  header.sender = Read32(buffer + 8);
+  header.seq = Read32(buffer + 12);
+  header.incarnation = Read32(buffer + 16);
+  return header.length <= length - headerBytes && (header.kind == DATA || header.kind == NACK);
+}
+
+uint32_t SwarmTransport::Read32(const uint8_t* buffer)
+{
+  return buffer[0] | buffer[1] << 8 | buffer[2] << 16 | (uint32_t)buffer[3] << 24;
+}
+
+void SwarmTransport::Write32(uint32_t value, uint8_t* buffer)
+{
+  buffer[0] = value & 0xff;
+  buffer[1] = value >> 8 & 0xff;
+  buffer[2] = value >> 16 & 0xff;
+  buffer[3] = value >> 24;
+}
@@ -0,0 +1,195 @@
+#ifndef SWARMTRANSPORT_H
+#define SWARMTRANSPORT_H
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// A datagram as the receive handler sees it. The data points into the
+// receive buffer of the transport and is only valid during the call.
+struct SwarmDatagram {
+  uint32_t sender;
+  uint8_t channel;
+  uint32_t seq;
+  bool retransmitted;
+  const uint8_t* data;
+  int length;
+};
+
+// Peer to peer swarm messages over UDP multicast, without the ROS master.
+//
+// Every rover joins the same multicast group and sends each message once
+// for all the others to hear, instead of over a TCP connection to every
+// subscriber. Datagrams carry the sender's name hash, a channel and a
+// sequence number per sender and channel, so receivers drop duplicates
+// and notice gaps. They also carry an incarnation id picked at random when
+// the transport is created, a rover that restarts counts from zero again
+// under a new id and its receivers start over with it instead of dropping
+// everything it sends as duplicates.
+//
+// A channel marked reliable keeps its last datagrams on the sender. A
+// receiver that sees a gap on a reliable channel waits a moment in case
+// the missing datagram was only reordered, then asks for it with a NACK to
+// the group, and asks again a few times before counting it as lost. The
+// sender answers NACKs for its own datagrams from that history. Missing
+// datagrams are delivered whenever they turn up, so reliable channels
+// should carry messages that can be applied out of order. Channels
+// carrying state that is sent again anyway are best left unreliable.
+//
+// The send buffer, the history and the receive buffers are allocated
+// when the transport is opened. Messages can be encoded straight into the
+// send buffer, and Poll() hands out views of the receive buffers, so
+// nothing is copied or allocated per message.
+//
+// Times are in milliseconds. Not thread safe, send and poll from one
+// thread.
+class SwarmTransport
+{
+public:
+  typedef function<void(const SwarmDatagram&)> Handler;
+
+  SwarmTransport(uint32_t node);
+  ~SwarmTransport();
+
+  // Joins the multicast group on the interface with the given address, or
+  // the default interface if it is empty. Returns false and leaves the
+  // transport closed if the socket can't be set up.
+  bool Open(const string& group, uint16_t port, const string& interfaceAddress = "", int ttl = 1);
+  void Close();
+  bool IsOpen() const {return socketFd >= 0;}
+
+  // To wait on with poll() or select(), -1 when closed.
+  int GetSocket() const {return socketFd;}
+
+  void SetReliable(uint8_t channel, bool reliable);
+
+  // Buffer for the payload of the next message, to encode into in place.
+  uint8_t* GetSendBuffer() {return sendBuffer.data() + headerBytes;}
+
+  // Sends the payload in the send buffer, or copies the given one there
+  // first. Returns false if it is too long or the socket refused it.
+  bool Send(uint8_t channel, int length);
+  bool Send(uint8_t channel, const uint8_t* data, int length);
+
+  // Receives everything waiting on the socket, passes the new datagrams to
+  // the handler, answers NACKs from other rovers and sends the NACKs that
+  // are due. Returns the number of datagrams passed to the handler.
+  int Poll(long int time, const Handler& handler);
+
+  // Drops received datagrams with the given probability, to test the
+  // reliability on loopback where nothing gets lost.
+  void SimulateLoss(float probability, unsigned int seed);
+
+  static const int maxDatagramBytes = 1472; //fits an ethernet frame with the IP and UDP headers
+  static const int headerBytes = 20;
+  static const int maxPayloadBytes = maxDatagramBytes - headerBytes;
+
+  long int GetDatagramsSent() const {return datagramsSent;}
+  long int GetDatagramsReceived() const {return datagramsReceived;}
+  long int GetDuplicates() const {return duplicates;}
+  long int GetNacksSent() const {return nacksSent;}
+  long int GetRetransmissions() const {return retransmissions;}
+  long int GetRecovered() const {return recovered;}
+  long int GetLost() const {return lost;}
+  long int GetRestarts() const {return restarts;}
+
+private:
+
+  enum Kind : uint8_t {
+    DATA = 0,
+    NACK = 1
+  };
+
+  struct Header {
+    uint8_t kind;
+    uint8_t channel;
+    bool reliable;
+    bool retransmitted;
+    uint16_t length;
+    uint32_t sender;
+    uint32_t seq;
+    uint32_t incarnation;
+  };
+
+  struct Missing {
+    uint32_t seq;
+    long int nextNack;
+    int nacks;
+  };
+
+  // What has been received from one sender on one channel.
+  struct Peer {
+    bool started = false;
+    uint32_t incarnation = 0;
+    uint32_t highest = 0;
+    uint64_t received = 0; //bit i set if highest - i was received
+    vector<Missing> missing;
+  };
+
+  struct Sent {
+    uint8_t channel;
+    uint32_t seq;
+    int length; //whole datagram, 0 if the slot is empty
+  };
+
+  static void WriteHeader(const Header& header, uint8_t* buffer);
+  static bool ReadHeader(const uint8_t* buffer, int length, Header& header);
+  static uint32_t Read32(const uint8_t* buffer);
+  static void Write32(uint32_t value, uint8_t* buffer);
+
+  bool SendDatagram(const uint8_t* datagram, int length);
+  // True if the datagram is new, notes the gaps it leaves.
+  bool Accept(const Header& header, long int time);
+  // Resends the datagrams a NACK asks this rover for.
+  void Answer(const uint8_t* payload, int length);
+  void SendNacks(long int time);
+
+  static const uint8_t magic = 0x5a;
+  static const int historySize = 64; //datagrams kept for retransmission
+  static const int batchSize = 16; //datagrams received per system call
+  static const int maxMissing = 32; //per peer, older gaps are given up
+  static const int maxNackSeqs = 64;
+  const long int nackDelay = 20; //milliseconds allowed for reordering
+  const long int nackInterval = 50; //milliseconds between NACKs for the same datagram
+  const int maxNacks = 3;
+
+  uint32_t node;
+  uint32_t incarnation; //random, new every time the transport is created
+  int socketFd = -1;
+  sockaddr_in destination; //the group
+
+  bool reliable[256];
+  uint32_t nextSeq[256];
+
+  vector<uint8_t> sendBuffer;
+  vector<uint8_t> history;
+  vector<Sent> sent;
+  int nextSent = 0;
+
+  vector<uint8_t> receiveBuffers;
+  vector<uint8_t> nackBuffer;
+
+  unordered_map<uint64_t, Peer> peers; //by sender and channel
+
+  float lossProbability = 0;
+  mt19937 lossGenerator;
+  uniform_real_distribution<float> uniform;
+
+  long int datagramsSent = 0;
+  long int datagramsReceived = 0;
+  long int duplicates = 0;
+  long int nacksSent = 0;
+  long int retransmissions = 0;
+  long int recovered = 0;
+  long int lost = 0;
+  long int restarts = 0;
+};
+
+#endif // SWARMTRANSPORT_H
@@ -0,0 +1,269 @@
+#include "TagTracker.h"
+
+#include <cmath> // For trig functions
+#include <limits> // For numeric limits
+
+TagTracker::TagTracker()
+{
+  currentLocation.x = 0;
+  currentLocation.y = 0;
+  currentLocation.theta = 0;
+}
+
+void TagTracker::Reset()
+{
+  tracks.clear();
+}
+
+void TagTracker::SetCurrentLocation(Point currentLocation)
+{
+  this->currentLocation = currentLocation;
+}
+
+void TagTracker::SetCurrentTimeInMilliSecs(long int time)
+{
+  current_time = time;
+
+  //predict every track forward and remove the ones that coasted too long
+  for (int i = tracks.size() - 1; i >= 0; i--)
+  {
+    if (current_time - tracks[i].lastSeen > CoastTime(tracks[i].id))
+    {
+      tracks.erase(tracks.begin() + i);
+      continue;
+    }
+
+    Predict(tracks[i], current_time);
+  }
+}
+
+void TagTracker::Update(const vector<Tag>& tags)
+{
+  //each track may only be associated with one detection per frame
+  vector<bool> associated(tracks.size(), false);
+
+  for (int i = 0; i < tags.size(); i++)
+  {
+    int id = tags[i].getID();
+    if (id != 0 && id != 256)
+    {
+      continue;
+    }
+
+    Point measured = CameraToOdom(tags[i]);
+
+    //greedy nearest neighbour association within the gate for this tag type
+    int best = -1;
+    float bestDistance = GateDistance(id);
+    for (int j = 0; j < associated.size(); j++)
+    {
+      if (associated[j] || tracks[j].id != id)
+      {
+        continue;
+      }
+
+      Predict(tracks[j], current_time);
+      float distance = hypot(tracks[j].x - measured.x, tracks[j].y - measured.y);
+      if (distance < bestDistance)
+      {
+        best = j;
+        bestDistance = distance;
+      }
+    }
+
+    if (best >= 0)
+    {
+      associated[best] = true;
+      Correct(tracks[best], measured.x, measured.y);
+      tracks[best].lastSeen = current_time;
+      tracks[best].hits++;
+    }
+    else if (tracks.size() < maxTracks)
+    {
+      //no track close enough, start a new one at rest
+      TagTrack track;
+      track.id = id;
+      track.trackID = nextTrackID++;
+      track.x = measured.x;
+      track.y = measured.y;
+      track.Px[0] = track.Py[0] = measurementNoise;
+      track.Px[2] = track.Py[2] = initialVelocityVariance;
+      track.lastSeen = current_time;
+      track.lastPredict = current_time;
+      track.hits = 1;
+      tracks.push_back(track);
+    }
+  }
+}
+
+bool TagTracker::GetClosestTrack(int id, TagTrack& track, int excludedTrack) const
+{
+  float closest = std::numeric_limits<float>::max();
+  bool found = false;
+
+  for (const TagTrack& candidate : tracks)
+  {
+    if (candidate.id != id || candidate.trackID == excludedTrack || current_time - candidate.lastSeen > CoastTime(id))
+    {
+      continue;
+    }
+
+    float distance = hypot(candidate.x - currentLocation.x, candidate.y - currentLocation.y);
+    if (distance < closest)
+    {
+      closest = distance;
+      track = candidate;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+void TagTracker::CountVisibleTracks(int id, float offsetCorrection, int& left, int& right) const
+{
+  left = 0;
+  right = 0;
+
+  for (const TagTrack& track : tracks)
+  {
+    if (track.id != id || current_time - track.lastSeen > CoastTime(id))
+    {
+      continue;
+    }
+
+    float forward, lateral;
+    GetRelativePosition(track, forward, lateral);
+
+    //a tag the rover has turned away from is no longer in view even if its track is alive
+    if (forward <= 0 || fabs(atan2(lateral, forward)) > cameraHalfFOV)
+    {
+      continue;
+    }
+
+    // checks if tag is on the right or left side of the image
+    if (lateral + offsetCorrection > 0)
+    {
+      right++;
+    }
+    else
+    {
+      left++;
+    }
+  }
+}
+
+void TagTracker::GetRelativePosition(const TagTrack& track, float& forward, float& lateral) const
+{
+  float dx = track.x - currentLocation.x;
+  float dy = track.y - currentLocation.y;
+
+  //rotate into the rover frame then shift to the camera
+  float c = cos(currentLocation.theta);
+  float s = sin(currentLocation.theta);
+  forward = c * dx + s * dy - cameraForwardOffset;
+  lateral = s * dx - c * dy;
+}
+
+Point TagTracker::CameraToRover(const Tag& tag) const
+{
+  //distance from the camera lens to the tag
+  float lensDistance = hypot(hypot(tag.getPositionX(), tag.getPositionY()), tag.getPositionZ());
+
+  //using a^2 + b^2 = c^2 to remove the height of the camera above the ground
+  float groundDistance = sqrt(fmax(lensDistance * lensDistance - cameraHeight * cameraHeight, 0.0));
+
+  //camera x points right, the rover y axis points left
+  float lateral = tag.getPositionX();
+
+  Point rover;
+  rover.x = sqrt(fmax(groundDistance * groundDistance - lateral * lateral, 0.0)) + cameraForwardOffset;
+  rover.y = -lateral;
+  rover.theta = 0;
+
+  return rover;
+}
+
+Point TagTracker::CameraToOdom(const Tag& tag) const
+{
+  Point rover = CameraToRover(tag);
+
+  float c = cos(currentLocation.theta);
+  float s = sin(currentLocation.theta);
+
+  Point odom;
+  odom.x = currentLocation.x + c * rover.x - s * rover.y;
+  odom.y = currentLocation.y + s * rover.x + c * rover.y;
+  odom.theta = 0;
+
+  return odom;
+}
+
+void TagTracker::Predict(TagTrack& track, long int time)
+{
+  float dt = (time - track.lastPredict) / 1e3;
+  if (dt <= 0)
+  {
+    return;
+  }
+
+  track.x += track.vx * dt;
+  track.y += track.vy * dt;
+
+  //P = F P F' + Q for F = [1 dt; 0 1] with white acceleration noise
+  float dt2 = dt * dt;
+  float q0 = accelerationNoise * dt2 * dt2 / 4;
+  float q1 = accelerationNoise * dt2 * dt / 2;
+  float q2 = accelerationNoise * dt2;
+
+  for (float* P : {track.Px, track.Py})
+  {
+    float pp = P[0] + 2 * dt * P[1] + dt2 * P[2] + q0;
+    float pv = P[1] + dt * P[2] + q1;
+    float vv = P[2] + q2;
+    P[0] = pp;
+    P[1] = pv;
+    P[2] = vv;
+  }
+
+  track.lastPredict = time;
+}
+
+void TagTracker::Correct(TagTrack& track, float mx, float my)
+{
+  float* position[2] = {&track.x, &track.y};
+  float* velocity[2] = {&track.vx, &track.vy};
+  float* covariance[2] = {track.Px, track.Py};
+  float measured[2] = {mx, my};
+
+  for (int axis = 0; axis < 2; axis++)
+  {
+    float* P = covariance[axis];
+
+    //measurement only observes position so the gain has two entries
+    float S = P[0] + measurementNoise;
+    float kp = P[0] / S;
+    float kv = P[1] / S;
+
+    float innovation = measured[axis] - *position[axis];
+    *position[axis] += kp * innovation;
+    *velocity[axis] += kv * innovation;
+
+    float pp = (1 - kp) * P[0];
+    float pv = (1 - kp) * P[1];
+    float vv = P[2] - kv * P[1];
+    P[0] = pp;
+    P[1] = pv;
+    P[2] = vv;
+  }
+}
+
+float TagTracker::GateDistance(int id) const
+{
+  return id == 256 ? nestGate : cubeGate;
+}
+
+long int TagTracker::CoastTime(int id) const
+{
+  return id == 256 ? nestCoastTime : cubeCoastTime;
+}
@@ -0,0 +1,109 @@
+#ifndef TAGTRACKER_H
+#define TAGTRACKER_H
+
+#include <vector>
+
+#include "Point.h"
+#include "Tag.h"
+
+using namespace std;
+
+// A single tracked AprilTag in the odom frame. Each axis is filtered by
+// its own constant velocity Kalman filter (position and velocity), which
+// is equivalent to the full 4 state filter when the measurement noise is
+// the same on both axes and much cheaper to run.
+struct TagTrack {
+  int id = 0; //AprilTag ID, 0 for cubes and 256 for the collection zone
+  int trackID = 0; //unique id given to the track when it is created
+
+  float x = 0; //estimated position in the odom frame
+  float y = 0;
+  float vx = 0; //estimated velocity in the odom frame
+  float vy = 0;
+
+  //covariance of the x and y filters stored as {pp, pv, vv}
+  float Px[3] = {0, 0, 0};
+  float Py[3] = {0, 0, 0};
+
+  long int lastSeen = 0; //time in milliseconds of the last associated detection
+  long int lastPredict = 0; //time in milliseconds the state was last predicted to
+  int hits = 0; //number of detections associated with this track
+};
+
+// Associates AprilTag detections across camera frames and keeps a small
+// Kalman filter per tracked cube or collection zone tag. Detections are
+// moved into the odom frame with the rover pose so that a target keeps a
+// valid position estimate while it drops out of the camera for a few
+// frames. Controllers query the tracks instead of the raw frame.
+class TagTracker
+{
+public:
+  TagTracker();
+
+  void Reset();
+
+  // Odom pose of the rover used to place detections in the world and to
+  // predict where tracked tags are relative to the rover.
+  void SetCurrentLocation(Point currentLocation);
+
+  // Advances all tracks to the given time and drops tracks that have not
+  // been seen for too long.
+  void SetCurrentTimeInMilliSecs(long int time);
+
+  // Associates a new camera frame with the existing tracks.
+  void Update(const vector<Tag>& tags);
+
+  // Returns the closest track with the given ID that is still within its
+  // coast time, other than the excluded track. Returns false if there is no
+  // such track.
+  bool GetClosestTrack(int id, TagTrack& track, int excludedTrack = -1) const;
+
+  // Counts the tracks with the given ID that are still within their coast
+  // time and inside the camera field of view. Left and right follow the
+  // convention of the raw camera frame, offsetCorrection is added to the
+  // lateral position before deciding the side.
+  void CountVisibleTracks(int id, float offsetCorrection, int& left, int& right) const;
+
+  // Predicted position of a track relative to the camera. Forward is the
+  // ground distance ahead of the camera and lateral matches the x axis of
+  // the camera (positive to the right).
+  void GetRelativePosition(const TagTrack& track, float& forward, float& lateral) const;
+
+  const vector<TagTrack>& GetTracks() const {return tracks;}
+
+  // Projects a detection onto the ground in the rover frame, x forward
+  // from the rover center and y to the left.
+  Point CameraToRover(const Tag& tag) const;
+
+private:
+
+  // Projects a detection in camera coordinates onto the ground in the odom frame.
+  Point CameraToOdom(const Tag& tag) const;
+
+  void Predict(TagTrack& track, long int time);
+  void Correct(TagTrack& track, float mx, float my);
+
+  float GateDistance(int id) const;
+  long int CoastTime(int id) const;
+
+  const float cameraHeight = 0.195; //height of the camera lens above the ground in meters
+  const float cameraForwardOffset = 0.145; //distance of the camera ahead of the rover center in meters
+  const float cameraHalfFOV = 0.5; //half of the horizontal field of view in radians
+
+  const float measurementNoise = 0.03 * 0.03; //variance of a detection in m^2
+  const float accelerationNoise = 0.05 * 0.05; //process noise driving the velocity in (m/s^2)^2
+  const float initialVelocityVariance = 0.1 * 0.1;
+
+  const float cubeGate = 0.10; //maximum distance in meters to associate a cube detection with a track
+  const float nestGate = 0.06; //collection zone tags are close together so use a tighter gate
+  const long int cubeCoastTime = 1000; //milliseconds a cube track is predicted without detections
+  const long int nestCoastTime = 500;
+  const int maxTracks = 64; //bounds the association cost if the camera reports garbage
+
+  vector<TagTrack> tracks;
+  Point currentLocation;
+  long int current_time = 0;
+  int nextTrackID = 0;
+};
+
+#endif // TAGTRACKER_H
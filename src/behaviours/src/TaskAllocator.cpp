@@ -0,0 +1,256 @@
+#include "TaskAllocator.h"
+
+#include <algorithm> // For max and min
+#include <cmath> // For floor, hypot and round
+
+TaskAllocator::TaskAllocator()
+{
+  location.x = 0;
+  location.y = 0;
+  location.theta = 0;
+}
+
+uint32_t TaskAllocator::TaskKey(Point location)
+{
+  //tasks are one per meter cell, so the centimeters of the bus do not matter
+  int cellX = (int)floor(location.x);
+  int cellY = (int)floor(location.y);
+  return ((uint32_t)(uint16_t)cellX << 16) | (uint16_t)cellY;
+}
+
+void TaskAllocator::SetTasks(const vector<AllocationTask>& tasks)
+{
+  this->tasks = tasks;
+
+  for (int i = 0; i < (int)bundle.size(); i++)
+  {
+    uint32_t key = TaskKey(bundle[i].location);
+    bool listed = false;
+    for (const AllocationTask& task : tasks)
+    {
+      listed = listed || TaskKey(task.location) == key;
+    }
+
+    if (!listed)
+    {
+      Release(i);
+      break;
+    }
+  }
+}
+
+void TaskAllocator::SetState(Point location, bool carrying, float timeRemaining)
+{
+  this->location = location;
+  this->carrying = carrying;
+  this->timeRemaining = timeRemaining;
+}
+
+void TaskAllocator::Receive(uint32_t sender, const AllocationBid& bid, long int time)
+{
+  if (sender == node)
+  {
+    return;
+  }
+
+  uint32_t key = TaskKey(bid.location);
+  auto winner = winners.find(key);
+
+  if (bid.bid <= 0)
+  {
+    if (winner != winners.end() && winner->second.node == sender)
+    {
+      winners.erase(winner);
+    }
+    return;
+  }
+
+  if (winner != winners.end() && winner->second.node != sender && !Beats(bid.bid, sender, winner->second))
+  {
+    return;
+  }
+
+  bool outbid = winner != winners.end() && winner->second.node == node;
+  winners[key] = {sender, bid.bid, time};
+
+  if (outbid)
+  {
+    for (int i = 0; i < (int)bundle.size(); i++)
+    {
+      if (TaskKey(bundle[i].location) == key)
+      {
+        //the task now belongs to the sender, only the ones after it are released
+        bundle.erase(bundle.begin() + i);
+        bundleBids.erase(bundleBids.begin() + i);
+        Release(i);
+        break;
+      }
+    }
+  }
+}
+
+bool TaskAllocator::Update(long int time)
+{
+  for (auto winner = winners.begin(); winner != winners.end(); )
+  {
+    if (winner->second.node != node && time - winner->second.time > bidTimeout)
+    {
+      winner = winners.erase(winner);
+    }
+    else
+    {
+      winner++;
+    }
+  }
+
+  //the bundle path starts at the nest if a cube has to be dropped off first
+  Point from = location;
+  float elapsed = 0;
+  if (carrying)
+  {
+    elapsed = hypot(location.x, location.y) / speed;
+    from.x = 0;
+    from.y = 0;
+  }
+  for (const AllocationTask& task : bundle)
+  {
+    elapsed += hypot(task.location.x - from.x, task.location.y - from.y) / speed;
+    from = task.location;
+  }
+
+  bool changed = false;
+  while ((int)bundle.size() < maxBundle)
+  {
+    int bestBid = 0;
+    int best = -1;
+
+    for (int i = 0; i < (int)tasks.size(); i++)
+    {
+      uint32_t key = TaskKey(tasks[i].location);
+
+      bool bundled = false;
+      for (const AllocationTask& task : bundle)
+      {
+        bundled = bundled || TaskKey(task.location) == key;
+      }
+      if (bundled)
+      {
+        continue;
+      }
+
+      int bid = Bid(tasks[i], from, elapsed);
+      auto winner = winners.find(key);
+      if (bid <= bestBid || (winner != winners.end() && winner->second.node != node && !Beats(bid, node, winner->second)))
+      {
+        continue;
+      }
+
+      bestBid = bid;
+      best = i;
+    }
+
+    if (best < 0)
+    {
+      break;
+    }
+
+    bundle.push_back(tasks[best]);
+    bundleBids.push_back(bestBid);
+    winners[TaskKey(tasks[best].location)] = {node, bestBid, time};
+    elapsed += hypot(tasks[best].location.x - from.x, tasks[best].location.y - from.y) / speed;
+    from = tasks[best].location;
+    changed = true;
+  }
+
+  if (changed)
+  {
+    rebuilds++;
+    bidsChanged = true;
+  }
+  return changed;
+}
+
+bool TaskAllocator::TakeBids(long int time, vector<AllocationBid>& bids)
+{
+  if (!bidsChanged && lastBids >= 0 && time - lastBids < refreshInterval)
+  {
+    return false;
+  }
+
+  bids = released;
+  released.clear();
+  for (int i = 0; i < (int)bundle.size(); i++)
+  {
+    AllocationBid bid;
+    bid.location = bundle[i].location;
+    bid.bid = bundleBids[i];
+    bids.push_back(bid);
+  }
+
+  bidsChanged = false;
+  lastBids = time;
+  return !bids.empty();
+}
+
+bool TaskAllocator::GetCluster(Point& location) const
+{
+  for (const AllocationTask& task : bundle)
+  {
+    if (task.cluster)
+    {
+      location = task.location;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskAllocator::GetSector(Point& location) const
+{
+  for (const AllocationTask& task : bundle)
+  {
+    if (!task.cluster)
+    {
+      location = task.location;
+      return true;
+    }
+  }
+  return false;
+}
+
+int TaskAllocator::Bid(const AllocationTask& task, Point from, float elapsed) const
+{
+  float time = elapsed + hypot(task.location.x - from.x, task.location.y - from.y) / speed;
+  if (time > timeRemaining)
+  {
+    return 0;
+  }
+
+  //a byte on the bus, never 0 since that is a release
+  return max(1, min(255, (int)round(255 * task.value / (1 + time / timeScale))));
+}
+
+bool TaskAllocator::Beats(int bid, uint32_t bidder, const Winner& winner) const
+{
+  return bid > winner.bid || (bid == winner.bid && bidder > winner.node);
+}
+
+void TaskAllocator::Release(int index)
+{
+  for (int i = index; i < (int)bundle.size(); i++)
+  {
+    auto winner = winners.find(TaskKey(bundle[i].location));
+    if (winner != winners.end() && winner->second.node == node)
+    {
+      winners.erase(winner);
+      AllocationBid release;
+      release.location = bundle[i].location;
+      release.bid = 0;
+      released.push_back(release);
+    }
+  }
+
+  bundle.resize(index);
+  bundleBids.resize(index);
+  bidsChanged = true;
+}
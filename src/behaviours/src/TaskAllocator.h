@@ -0,0 +1,115 @@
+#ifndef TASKALLOCATOR_H
+#define TASKALLOCATOR_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Point.h"
+
+using namespace std;
+
+// Something worth sending a rover to, in the map frame relative to the nest.
+struct AllocationTask {
+  Point location;
+  float value = 1.0; //0 to 1, how much the swarm gains from it
+  bool cluster = true; //a cube cluster, otherwise a search sector
+};
+
+// A bid of one rover on one task as it goes over the swarm bus. A bid of 0
+// releases the task.
+struct AllocationBid {
+  Point location;
+  int bid;
+};
+
+// Market based allocation of the clusters and search sectors, a consensus
+// based bundle algorithm over the swarm bus.
+//
+// Each rover builds a bundle of up to two tasks greedily, bidding on each
+// task its value discounted by the travel time to it along the bundle,
+// counted through the nest if the rover is carrying a cube. Tasks that
+// cannot be reached in the time left are not bid on. A rover only adds a
+// task if its bid beats the best bid it knows of, and reports the bids in
+// its bundle on the bus. When another rover's bid beats one in the bundle,
+// that task and every task after it are released, since their bids were
+// computed from the path through it, and the bundle is rebuilt. Ties go to
+// the larger node. Bids are repeated every second and expire if they are
+// not, so the tasks of a rover that failed go back on the market.
+//
+// The swarm bus is a broadcast, so every rover hears every bid directly and
+// the winning bids are not relayed. Each rover sends at most one packet per
+// flush interval, messages grow linearly with the swarm and only the rovers
+// that were outbid rebuild their bundles.
+class TaskAllocator
+{
+public:
+  TaskAllocator();
+
+  // Name hash of this rover, breaks ties between equal bids.
+  void SetNode(uint32_t node) {this->node = node;}
+
+  // Tasks currently on the market. Bundled tasks that are gone are released.
+  void SetTasks(const vector<AllocationTask>& tasks);
+
+  // Location relative to the nest, whether a cube is held and how many
+  // seconds of the round are left.
+  void SetState(Point location, bool carrying, float timeRemaining);
+
+  // A bid another rover reported on the bus.
+  void Receive(uint32_t sender, const AllocationBid& bid, long int time);
+
+  // Expires stale bids and rebuilds the bundle. Returns true if the bundle
+  // changed.
+  bool Update(long int time);
+
+  // Bids to report if any changed or a refresh is due. Returns false
+  // otherwise.
+  bool TakeBids(long int time, vector<AllocationBid>& bids);
+
+  // Tasks this rover won, in the order to visit them.
+  const vector<AllocationTask>& GetBundle() const {return bundle;}
+
+  // The first cluster or sector in the bundle.
+  bool GetCluster(Point& location) const;
+  bool GetSector(Point& location) const;
+
+  int GetRebuilds() const {return rebuilds;}
+
+  static uint32_t TaskKey(Point location);
+
+private:
+
+  struct Winner {
+    uint32_t node;
+    int bid;
+    long int time;
+  };
+
+  int Bid(const AllocationTask& task, Point from, float elapsed) const;
+  bool Beats(int bid, uint32_t bidder, const Winner& winner) const;
+  void Release(int index);
+
+  const int maxBundle = 2;
+  const float speed = 0.25; //meters per second the rovers average
+  const float timeScale = 120; //seconds of travel that halve a bid
+  const long int refreshInterval = 1000; //milliseconds
+  const long int bidTimeout = 5000; //milliseconds, five missed refreshes
+
+  uint32_t node = 0;
+  Point location;
+  bool carrying = false;
+  float timeRemaining = 1e9;
+
+  vector<AllocationTask> tasks;
+  vector<AllocationTask> bundle;
+  vector<int> bundleBids;
+  unordered_map<uint32_t, Winner> winners; //best bid known on each task
+
+  vector<AllocationBid> released; //to report as bids of 0
+  bool bidsChanged = false;
+  long int lastBids = -1;
+  int rebuilds = 0;
+};
+
+#endif // TASKALLOCATOR_H
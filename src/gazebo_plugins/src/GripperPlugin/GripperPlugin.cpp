@@ -136,6 +136,11 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   wristAngleSubscriber = rosNode->subscribe(wristSubscriptionOptions);
   fingerAngleSubscriber = rosNode->subscribe(fingerSubscriptionOptions);
 
+  // the rover arduino reports its servo angles on prev_cmd, publish the
+  // measured joint angles there so the behaviours see the same topics
+  wristFeedbackPublisher = rosNode->advertise<geometry_msgs::QuaternionStamped>(feedbackTopic(wristTopic), 1);
+  fingerFeedbackPublisher = rosNode->advertise<geometry_msgs::QuaternionStamped>(feedbackTopic(fingerTopic), 1);
+
   ROS_DEBUG_STREAM_COND(isDebuggingModeActive, "[Gripper Plugin : "
     << model->GetName() << "]\n    subscribe to all gripper topics:\n"
     << "        " << wristTopic << endl << "        " << fingerTopic);
@@ -208,6 +213,8 @@ void GripperPlugin::updateWorldEventHandler() {
   float leftFingerAngle = leftFingerJoint->GetAngle(0).Radian();
   float rightFingerAngle = rightFingerJoint->GetAngle(0).Radian();
 
+  publishGripperFeedback(currentState.wristAngle, leftFingerAngle - rightFingerAngle);
+
   // Set the desired gripper state
   desiredState.leftFingerAngle = desiredFingerAngle.Radian() / 2.0;
   desiredState.rightFingerAngle = -desiredFingerAngle.Radian() / 2.0;
@@ -251,6 +258,40 @@ void GripperPlugin::updateWorldEventHandler() {
   }
 }
 
+/**
+ * Publishes the measured gripper angles in the same form as the rover
+ * arduino: a quaternion whose roll is the angle in radians.
+ *
+ * @param wristAngle The current wrist joint angle in radians.
+ * @param fingerAngle The total angle of both fingers in radians.
+ */
+void GripperPlugin::publishGripperFeedback(float wristAngle, float fingerAngle) {
+  geometry_msgs::QuaternionStamped msg;
+  msg.header.stamp = ros::Time::now();
+
+  msg.quaternion.x = sin(wristAngle / 2.0);
+  msg.quaternion.w = cos(wristAngle / 2.0);
+  wristFeedbackPublisher.publish(msg);
+
+  msg.quaternion.x = sin(fingerAngle / 2.0);
+  msg.quaternion.w = cos(fingerAngle / 2.0);
+  fingerFeedbackPublisher.publish(msg);
+}
+
+/**
+ * Derives the feedback topic from a command topic, for example
+ * /hector/fingerAngle/cmd becomes /hector/fingerAngle/prev_cmd.
+ */
+std::string GripperPlugin::feedbackTopic(std::string commandTopic) {
+  size_t position = commandTopic.rfind("/cmd");
+
+  if (position == string::npos) {
+    return commandTopic + "/prev_cmd";
+  }
+
+  return commandTopic.substr(0, position) + "/prev_cmd";
+}
+
 /**
  * This is the subscriber function for the desiredWristAngle variable. Updates
  * to desiredWristAngle will cause the gripper to be moved vertically around
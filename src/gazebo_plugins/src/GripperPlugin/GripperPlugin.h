@@ -8,6 +8,7 @@
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
 #include <std_msgs/Float32.h>
+#include <geometry_msgs/QuaternionStamped.h>
 #include <thread>
 #include "GripperManager.h"
 #include <string>
@@ -63,6 +64,8 @@ namespace gazebo {
 
       // private helper functions
       void processRosQueue();
+      void publishGripperFeedback(float wristAngle, float fingerAngle);
+      std::string feedbackTopic(std::string commandTopic);
       void loadDebugMode();
       void loadUpdatePeriod();
       std::string loadSubscriptionTopic(std::string topicTag);
@@ -89,6 +92,8 @@ namespace gazebo {
 
       // ROS Publishers
       ros::Publisher infoLogPublisher;
+      ros::Publisher wristFeedbackPublisher;
+      ros::Publisher fingerFeedbackPublisher;
 
       // gripper component objects
       GripperManager gripperManager;